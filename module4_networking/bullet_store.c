@@ -0,0 +1,309 @@
+/**
+ * bullet_store.c - Dense Structure-of-Arrays Bullet Container
+ *
+ * See bullet_store.h for the layout and the id scheme.
+ */
+
+#include "bullet_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// x86 with GCC/Clang: vector kernels, picked at runtime
+#if !defined(BULLET_STORE_SCALAR) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BULLET_STORE_X86 1
+#include <immintrin.h>
+#endif
+
+// Alignment of the hot arrays (one AVX register) and element padding
+#define STORE_ALIGN 32
+#define STORE_LANES 8
+
+/**
+ * round_up - Next multiple of 'align' (a power of two)
+ */
+static size_t round_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+// ============================================================================
+// INTEGRATE KERNELS
+// ============================================================================
+//
+// All three do the same thing for indices 0 .. count-1 (rounded up to a
+// multiple of 8 - the padding lanes are computed and ignored):
+//
+//     x += vx * dt;  y += vy * dt;  lifetime -= dt;
+//     cull bit = lifetime <= 0 || x < 0 || x > max_x || y < 0 || y > max_y
+//
+// Each byte of 'cull' covers 8 consecutive indices.
+
+/**
+ * integrate_scalar - Plain C, one bullet at a time
+ */
+static void integrate_scalar(BulletStore* store, float dt, float max_x, float max_y) {
+    for (int i = 0; i < store->count; i++) {
+        store->x[i] += store->vx[i] * dt;
+        store->y[i] += store->vy[i] * dt;
+        store->lifetime[i] -= dt;
+
+        int dead = store->lifetime[i] <= 0.0f ||
+                   store->x[i] < 0.0f || store->x[i] > max_x ||
+                   store->y[i] < 0.0f || store->y[i] > max_y;
+        if (i % 8 == 0) store->cull[i / 8] = 0;
+        store->cull[i / 8] |= (uint8_t)(dead << (i % 8));
+    }
+}
+
+#ifdef BULLET_STORE_X86
+
+/**
+ * integrate_sse2_lanes - 4 bullets at once
+ *
+ * @return  Cull bits for the 4 lanes (movemask of the comparison)
+ */
+static int integrate_sse2_lanes(BulletStore* store, int i, __m128 dt,
+                                __m128 max_x, __m128 max_y) {
+    const __m128 zero = _mm_setzero_ps();
+    __m128 x = _mm_load_ps(store->x + i);
+    __m128 y = _mm_load_ps(store->y + i);
+    __m128 life = _mm_load_ps(store->lifetime + i);
+
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_load_ps(store->vx + i), dt));
+    y = _mm_add_ps(y, _mm_mul_ps(_mm_load_ps(store->vy + i), dt));
+    life = _mm_sub_ps(life, dt);
+
+    _mm_store_ps(store->x + i, x);
+    _mm_store_ps(store->y + i, y);
+    _mm_store_ps(store->lifetime + i, life);
+
+    // Each comparison gives all-ones lanes where true; OR them together
+    __m128 dead = _mm_cmple_ps(life, zero);
+    dead = _mm_or_ps(dead, _mm_cmplt_ps(x, zero));
+    dead = _mm_or_ps(dead, _mm_cmpgt_ps(x, max_x));
+    dead = _mm_or_ps(dead, _mm_cmplt_ps(y, zero));
+    dead = _mm_or_ps(dead, _mm_cmpgt_ps(y, max_y));
+    return _mm_movemask_ps(dead);
+}
+
+/**
+ * integrate_sse2 - 4 lanes per instruction (every x86-64 CPU has SSE2)
+ */
+static void integrate_sse2(BulletStore* store, float dt, float max_x, float max_y) {
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vmax_x = _mm_set1_ps(max_x);
+    const __m128 vmax_y = _mm_set1_ps(max_y);
+
+    for (int i = 0; i < store->count; i += 8) {
+        int low = integrate_sse2_lanes(store, i, vdt, vmax_x, vmax_y);
+        int high = integrate_sse2_lanes(store, i + 4, vdt, vmax_x, vmax_y);
+        store->cull[i / 8] = (uint8_t)(low | (high << 4));
+    }
+}
+
+/**
+ * integrate_avx2 - 8 lanes per instruction
+ *
+ * Compiled for AVX2 regardless of the build flags; only called if the
+ * CPU reports AVX2 support (see bullet_store_init).
+ */
+__attribute__((target("avx2")))
+static void integrate_avx2(BulletStore* store, float dt, float max_x, float max_y) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vmax_x = _mm256_set1_ps(max_x);
+    const __m256 vmax_y = _mm256_set1_ps(max_y);
+
+    for (int i = 0; i < store->count; i += 8) {
+        __m256 x = _mm256_load_ps(store->x + i);
+        __m256 y = _mm256_load_ps(store->y + i);
+        __m256 life = _mm256_load_ps(store->lifetime + i);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_load_ps(store->vx + i), vdt));
+        y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_load_ps(store->vy + i), vdt));
+        life = _mm256_sub_ps(life, vdt);
+
+        _mm256_store_ps(store->x + i, x);
+        _mm256_store_ps(store->y + i, y);
+        _mm256_store_ps(store->lifetime + i, life);
+
+        __m256 dead = _mm256_cmp_ps(life, zero, _CMP_LE_OQ);
+        dead = _mm256_or_ps(dead, _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+        dead = _mm256_or_ps(dead, _mm256_cmp_ps(x, vmax_x, _CMP_GT_OQ));
+        dead = _mm256_or_ps(dead, _mm256_cmp_ps(y, zero, _CMP_LT_OQ));
+        dead = _mm256_or_ps(dead, _mm256_cmp_ps(y, vmax_y, _CMP_GT_OQ));
+        store->cull[i / 8] = (uint8_t)_mm256_movemask_ps(dead);
+    }
+}
+
+#endif // BULLET_STORE_X86
+
+// ============================================================================
+// STORE
+// ============================================================================
+
+/**
+ * bullet_store_init - One aligned allocation, carved into the arrays
+ */
+int bullet_store_init(BulletStore* store, int capacity) {
+    memset(store, 0, sizeof(BulletStore));
+    if (capacity <= 0 || capacity > 65536) return -1;
+
+    size_t padded = round_up((size_t)capacity, STORE_LANES);
+    size_t floats = round_up(padded * sizeof(float), STORE_ALIGN);
+    size_t bytes = round_up(padded, STORE_ALIGN);
+    size_t ids = round_up(padded * sizeof(uint16_t), STORE_ALIGN);
+    size_t index_of = round_up(capacity * sizeof(uint32_t), STORE_ALIGN);
+    size_t cull = round_up(padded / 8, STORE_ALIGN);
+    size_t total = 5 * floats + 2 * bytes + 3 * ids + index_of + cull;
+
+    uint8_t* memory = aligned_alloc(STORE_ALIGN, total);
+    if (memory == NULL) return -1;
+    memset(memory, 0, total);
+
+    store->memory = memory;
+    store->capacity = capacity;
+    store->x = (float*)memory;          memory += floats;
+    store->y = (float*)memory;          memory += floats;
+    store->vx = (float*)memory;         memory += floats;
+    store->vy = (float*)memory;         memory += floats;
+    store->lifetime = (float*)memory;   memory += floats;
+    store->owner = (uint16_t*)memory;   memory += ids;
+    store->weapon = memory;             memory += bytes;
+    store->rewind = memory;             memory += bytes;
+    store->id = (uint16_t*)memory;      memory += ids;
+    store->free_ids = (uint16_t*)memory; memory += ids;
+    store->index_of = (uint32_t*)memory; memory += index_of;
+    store->cull = memory;
+
+    // Free list as a stack: push the highest id first so 0 pops first
+    for (int i = 0; i < capacity; i++) {
+        store->free_ids[i] = (uint16_t)(capacity - 1 - i);
+        store->index_of[i] = BULLET_STORE_NO_INDEX;
+    }
+    store->free_count = capacity;
+
+    store->integrate = integrate_scalar;
+    store->kernel = "scalar";
+#ifdef BULLET_STORE_X86
+    store->integrate = integrate_sse2;
+    store->kernel = "sse2";
+    if (__builtin_cpu_supports("avx2")) {
+        store->integrate = integrate_avx2;
+        store->kernel = "avx2";
+    }
+#endif
+    return 0;
+}
+
+/**
+ * bullet_store_free - Release the one allocation
+ */
+void bullet_store_free(BulletStore* store) {
+    free(store->memory);
+    memset(store, 0, sizeof(BulletStore));
+}
+
+/**
+ * bullet_store_spawn - Pop an id, append at the end
+ */
+int bullet_store_spawn(BulletStore* store, uint16_t owner, float x, float y,
+                       float vx, float vy, uint8_t weapon, float lifetime) {
+    if (store->free_count == 0) return -1;
+
+    uint16_t id = store->free_ids[--store->free_count];
+    int index = store->count++;
+
+    store->x[index] = x;
+    store->y[index] = y;
+    store->vx[index] = vx;
+    store->vy[index] = vy;
+    store->lifetime[index] = lifetime;
+    store->owner[index] = owner;
+    store->weapon[index] = weapon;
+    store->rewind[index] = 0;
+    store->id[index] = id;
+    store->index_of[id] = (uint32_t)index;
+    return id;
+}
+
+/**
+ * bullet_store_remove - Move the last bullet into the hole
+ */
+void bullet_store_remove(BulletStore* store, int index) {
+    int last = --store->count;
+    uint16_t id = store->id[index];
+
+    if (index != last) {
+        store->x[index] = store->x[last];
+        store->y[index] = store->y[last];
+        store->vx[index] = store->vx[last];
+        store->vy[index] = store->vy[last];
+        store->lifetime[index] = store->lifetime[last];
+        store->owner[index] = store->owner[last];
+        store->weapon[index] = store->weapon[last];
+        store->rewind[index] = store->rewind[last];
+        store->id[index] = store->id[last];
+        store->index_of[store->id[index]] = (uint32_t)index;
+    }
+
+    store->index_of[id] = BULLET_STORE_NO_INDEX;
+    store->free_ids[store->free_count++] = id;
+}
+
+/**
+ * bullet_store_copy - memcpy the live prefix of each replicated array
+ *
+ * index_of entries of the bullets dst held before are cleared first,
+ * so ids that died since the last copy don't point anywhere.
+ */
+void bullet_store_copy(BulletStore* dst, const BulletStore* src) {
+    for (int i = 0; i < dst->count; i++) {
+        dst->index_of[dst->id[i]] = BULLET_STORE_NO_INDEX;
+    }
+
+    int count = src->count;
+    memcpy(dst->x, src->x, (size_t)count * sizeof(float));
+    memcpy(dst->y, src->y, (size_t)count * sizeof(float));
+    memcpy(dst->vx, src->vx, (size_t)count * sizeof(float));
+    memcpy(dst->vy, src->vy, (size_t)count * sizeof(float));
+    memcpy(dst->owner, src->owner, (size_t)count * sizeof(uint16_t));
+    memcpy(dst->weapon, src->weapon, (size_t)count * sizeof(uint8_t));
+    memcpy(dst->id, src->id, (size_t)count * sizeof(uint16_t));
+    for (int i = 0; i < count; i++) {
+        dst->index_of[src->id[i]] = (uint32_t)i;
+    }
+    dst->count = count;
+}
+
+/**
+ * bullet_store_update - Run the kernel, then remove what it culled
+ *
+ * Removal walks the cull bits from the highest index down: everything
+ * above the current index has already been checked, so the bullet that
+ * swap-remove moves down is always a live one.
+ */
+int bullet_store_update(BulletStore* store, float dt, float max_x, float max_y) {
+    if (store->count == 0) return 0;
+
+    store->integrate(store, dt, max_x, max_y);
+
+    // Padding lanes past 'count' aren't bullets
+    if (store->count % 8 != 0) {
+        store->cull[store->count / 8] &= (uint8_t)((1u << (store->count % 8)) - 1);
+    }
+
+    int removed = 0;
+    for (int b = (store->count - 1) / 8; b >= 0; b--) {
+        uint8_t bits = store->cull[b];
+        if (bits == 0) continue;
+        for (int bit = 7; bit >= 0; bit--) {
+            if (bits & (1u << bit)) {
+                bullet_store_remove(store, b * 8 + bit);
+                removed++;
+            }
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,163 @@
+/**
+ * bullet_store.h - Dense Structure-of-Arrays Bullet Container
+ *
+ * CONCEPT: Array of Structs vs Struct of Arrays
+ * =============================================
+ * The obvious layout is one struct per bullet:
+ *
+ *     AoS:  [x y vx vy life owner ...][x y vx vy life owner ...] ...
+ *
+ * Moving bullets only needs x, y, vx, vy and lifetime, but every cache
+ * line we load also drags in owner, weapon, the active flag... and with
+ * an "active" flag we walk ALL slots, used or not. Instead, keep each
+ * field in its own array, and keep the live bullets packed at the front:
+ *
+ *     SoA:  x:    [x0 x1 x2 x3 x4 x5 x6 x7 ...]
+ *           y:    [y0 y1 y2 y3 y4 y5 y6 y7 ...]
+ *           vx:   [ ...                       ]
+ *           ...   (live bullets are indices 0 .. count-1)
+ *
+ * Now "move every bullet" is a straight walk over five arrays: exactly
+ * the shape SIMD instructions want - 4 (SSE) or 8 (AVX2) floats per
+ * instruction.
+ *
+ * CONCEPT: Swap-Remove and Stable Ids
+ * ===================================
+ * To stay packed, removing bullet i moves the LAST bullet into its
+ * place - O(1), no gaps:
+ *
+ *     [A B C D E]  remove B  ──▶  [A E C D]
+ *
+ * But that means a bullet's index changes, while clients match bullets
+ * across snapshots by id. So every bullet also gets a stable ID from a
+ * free list, and a small table maps id ──▶ current index:
+ *
+ *     id[index]     which bullet sits at this index
+ *     index_of[id]  where this bullet currently is
+ *
+ * Spawning pops an id (lowest first, which keeps ids small on the wire)
+ * and appends at index 'count' - also O(1), no scanning.
+ *
+ * The integrate kernel is picked at init: AVX2 if the CPU has it, else
+ * SSE2, else plain C. Build with -DBULLET_STORE_SCALAR to force plain C.
+ */
+
+#ifndef BULLET_STORE_H
+#define BULLET_STORE_H
+
+#include <stdint.h>
+
+// index_of[] value for an id that is not in use
+#define BULLET_STORE_NO_INDEX 0xFFFFFFFFu
+
+// Forward declaration (the kernel type takes the store)
+typedef struct BulletStore BulletStore;
+
+/**
+ * BulletStore - Live bullets, one array per field
+ *
+ * Hot arrays (read by the kernel every tick) are 32-byte aligned and
+ * padded to a multiple of 8 elements, so vector loops never need a
+ * scalar tail.
+ */
+struct BulletStore {
+    int capacity;           // Most bullets (ids are 0 .. capacity-1)
+    int count;              // Live bullets: indices 0 .. count-1
+
+    // Hot: integrated and culled every tick
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    float* lifetime;
+
+    // Cold: read when spawning, replicating and hitting
+    uint16_t* owner;
+    uint8_t* weapon;
+    uint8_t* rewind;        // Ticks its hit test looks back (see world_history.h)
+    uint16_t* id;           // Stable id of the bullet at each index
+
+    // Id bookkeeping
+    uint32_t* index_of;     // id -> index (BULLET_STORE_NO_INDEX = free)
+    uint16_t* free_ids;     // Stack of unused ids
+    int free_count;
+
+    uint8_t* cull;          // Kernel scratch: 1 bit per index, 1 = remove
+
+    // Integrate kernel chosen at init, and its name (for the log)
+    void (*integrate)(BulletStore* store, float dt, float max_x, float max_y);
+    const char* kernel;
+
+    void* memory;           // The one allocation
+};
+
+/**
+ * bullet_store_init - Allocate room for 'capacity' bullets
+ *
+ * @param store     Store to initialize
+ * @param capacity  Most bullets alive at once (at most 65536)
+ * @return          0 on success, -1 if out of memory
+ */
+int bullet_store_init(BulletStore* store, int capacity);
+
+/**
+ * bullet_store_free - Release the store's memory
+ *
+ * @param store  Store to free
+ */
+void bullet_store_free(BulletStore* store);
+
+/**
+ * bullet_store_spawn - Add a bullet
+ *
+ * The bullet's rewind starts at 0 (no lag compensation).
+ *
+ * @param store     The store
+ * @param owner     Player who fired it
+ * @param x, y      Position
+ * @param vx, vy    Velocity
+ * @param weapon    Weapon type that fired it
+ * @param lifetime  Seconds until it expires
+ * @return          The bullet's id, or -1 if the store is full
+ */
+int bullet_store_spawn(BulletStore* store, uint16_t owner, float x, float y,
+                       float vx, float vy, uint8_t weapon, float lifetime);
+
+/**
+ * bullet_store_remove - Swap-remove the bullet at 'index'
+ *
+ * The last bullet moves into 'index', so when removing several, go from
+ * the highest index down.
+ *
+ * @param store  The store
+ * @param index  Dense index (0 .. count-1), NOT an id
+ */
+void bullet_store_remove(BulletStore* store, int index);
+
+/**
+ * bullet_store_copy - Make 'dst' hold the same live bullets as 'src'
+ *
+ * Copies what replication reads - position, velocity, owner, weapon and
+ * id, plus the id -> index table - but not lifetimes, rewinds or the
+ * free list: the copy is for reading, not for spawning into.
+ *
+ * @param dst  Store of at least src's capacity
+ * @param src  Store to copy
+ */
+void bullet_store_copy(BulletStore* dst, const BulletStore* src);
+
+/**
+ * bullet_store_update - Move every bullet and remove the dead ones
+ *
+ * Advances positions by velocity * dt and lifetime by -dt, then removes
+ * bullets whose lifetime ran out or that left [0, max_x] x [0, max_y].
+ *
+ * @param store  The store
+ * @param dt     Step length in seconds
+ * @param max_x  Right edge of the world
+ * @param max_y  Bottom edge of the world
+ * @return       Number of bullets removed
+ */
+int bullet_store_update(BulletStore* store, float dt, float max_x, float max_y);
+
+#endif // BULLET_STORE_H
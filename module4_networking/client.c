@@ -19,6 +19,19 @@
 
 #include "protocol.h"
 #include "network.h"
+#include "state_decoder.h"
+#include "wire.h"
+
+// Receive buffer size: big enough for the largest possible frame
+#define CLIENT_RECV_BUFFER_SIZE (sizeof(MessageHeader) + UINT16_MAX)
+
+// How long to wait for MSG_CONNECT_ACK, and for MSG_DISCONNECT to be
+// acked when leaving over UDP
+#define CONNECT_TIMEOUT_MS 5000
+#define DISCONNECT_FLUSH_MS 500
+
+// Players listed on screen (a big match doesn't fit a terminal)
+#define CLIENT_PRINT_ROWS 16
 
 // Global running flag
 static volatile int g_running = 1;
@@ -27,17 +40,20 @@ static volatile int g_running = 1;
  * ClientState - Client-side game state
  */
 typedef struct {
-    Socket socket;          // Connection to server
-    uint8_t player_id;      // Our assigned player ID
+    NetLink link;           // Connection to server (TCP or UDP)
+    uint16_t player_id;     // Our assigned player ID
     uint32_t sequence;      // Input sequence number
+    uint8_t version;        // Wire encoding (PROTOCOL_VERSION or _RAW)
 
-    // Local view of game state (received from server)
-    PlayerState players[MAX_CLIENTS];
-    int player_count;
-    uint32_t last_tick;     // Last server tick received
+    // Snapshots we can apply deltas to (the newest is acked in every input);
+    // decoder.latest is our local view of the game state
+    StateDecoder decoder;
 
     // Our input state
     uint8_t input_flags;
+
+    // Receive memory behind link.recv_buf
+    uint8_t recv_storage[CLIENT_RECV_BUFFER_SIZE];
 } ClientState;
 
 /**
@@ -94,50 +110,93 @@ static void restore_terminal(void) {
 }
 
 /**
- * client_connect - Connect to the game server
+ * client_wait_for_ack - Wait for MSG_CONNECT_ACK
+ *
+ * Polls the link (which also resends MSG_CONNECT over UDP) until the
+ * acknowledgement arrives or CONNECT_TIMEOUT_MS passes.
+ *
+ * @return 1 if 'ack' was filled, 0 on timeout or error
  */
-static int client_connect(ClientState* client, const char* host, uint16_t port) {
-    printf("Connecting to %s:%d...\n", host, port);
+static int client_wait_for_ack(ClientState* client, ConnectAckMsg* ack) {
+    uint64_t deadline = net_time_ms() + CONNECT_TIMEOUT_MS;
+
+    while (g_running && net_time_ms() < deadline) {
+        NetFrame frame;
+        int result = net_link_poll(&client->link, &frame);
+        if (result < 0) return 0;
+        if (result == 0) {
+            net_link_wait(&client->link, NET_UDP_RESEND_MS);
+            continue;
+        }
 
-    client->socket = net_connect_to_server(host, port);
-    if (client->socket == INVALID_SOCKET) {
-        fprintf(stderr, "Failed to connect to server\n");
-        return -1;
+        if (frame.header.type != MSG_CONNECT_ACK) {
+            fprintf(stderr, "Unexpected message type: %d\n", frame.header.type);
+            return 0;
+        }
+        if (frame.header.length < sizeof(ConnectAckMsg)) {
+            fprintf(stderr, "Failed to receive ack data\n");
+            return 0;
+        }
+        memcpy(ack, frame.payload, sizeof(ConnectAckMsg));
+        return 1;
     }
+    return 0;
+}
 
-    printf("Connected! Waiting for server response...\n");
+/**
+ * client_connect - Connect to the game server
+ *
+ * Protocol (same on both transports):
+ *   1. Send MSG_CONNECT (reliable - resent over UDP until acked)
+ *   2. Wait for MSG_CONNECT_ACK
+ */
+static int client_connect(ClientState* client, const char* host, uint16_t port,
+                          NetTransport transport) {
+    printf("Connecting to %s:%d over %s...\n", host, port,
+           (transport == NET_TRANSPORT_UDP) ? "UDP" : "TCP");
 
-    // Wait for connection acknowledgement
-    MessageHeader header;
-    if (net_recv_all(client->socket, &header, sizeof(header)) <= 0) {
-        fprintf(stderr, "Failed to receive connection response\n");
-        net_close(client->socket);
+    if (net_link_open(&client->link, transport, host, port,
+                      client->recv_storage, sizeof(client->recv_storage)) != 0) {
+        fprintf(stderr, "Failed to connect to server\n");
         return -1;
     }
 
-    if (header.type != MSG_CONNECT_ACK) {
-        fprintf(stderr, "Unexpected message type: %d\n", header.type);
-        net_close(client->socket);
+    ConnectMsg connect_msg = { .version = client->version };
+    strncpy(connect_msg.name, "CLI", sizeof(connect_msg.name) - 1);
+    if (net_link_send(&client->link, MSG_CONNECT, &connect_msg, sizeof(connect_msg), 1) < 0) {
+        fprintf(stderr, "Failed to send connect request\n");
+        net_link_close(&client->link);
         return -1;
     }
 
+    printf("Connected! Waiting for server response...\n");
+
+    // Wait for connection acknowledgement
     ConnectAckMsg ack;
-    if (net_recv_all(client->socket, &ack, sizeof(ack)) <= 0) {
-        fprintf(stderr, "Failed to receive ack data\n");
-        net_close(client->socket);
+    if (!client_wait_for_ack(client, &ack)) {
+        fprintf(stderr, "Failed to receive connection response\n");
+        net_link_close(&client->link);
         return -1;
     }
 
     if (!ack.success) {
         fprintf(stderr, "Connection rejected (reason: %d)\n", ack.reason);
-        net_close(client->socket);
+        net_link_close(&client->link);
+        return -1;
+    }
+
+    // The server's limits size our snapshot history
+    if (state_decoder_init(&client->decoder, client->version,
+                           ack.max_players, ack.max_bullets) != 0) {
+        fprintf(stderr, "Out of memory for %d players\n", ack.max_players);
+        net_link_close(&client->link);
         return -1;
     }
 
     client->player_id = ack.player_id;
     client->sequence = 0;
 
-    printf("Joined as Player %d!\n\n", client->player_id);
+    printf("Joined as Player %d (room of %d)!\n\n", client->player_id, ack.max_players);
     return 0;
 }
 
@@ -145,12 +204,11 @@ static int client_connect(ClientState* client, const char* host, uint16_t port)
  * client_disconnect - Disconnect from server
  */
 static void client_disconnect(ClientState* client) {
-    // Send disconnect message
-    MessageHeader header = { .type = MSG_DISCONNECT, .length = 0 };
-    net_send_all(client->socket, &header, sizeof(header));
+    // Send disconnect message (and over UDP, wait briefly for its ack)
+    net_link_send(&client->link, MSG_DISCONNECT, NULL, 0, 1);
+    net_link_flush(&client->link, DISCONNECT_FLUSH_MS);
 
-    net_close(client->socket);
-    client->socket = INVALID_SOCKET;
+    net_link_close(&client->link);
 }
 
 /**
@@ -162,63 +220,65 @@ static void client_send_input(ClientState* client) {
     PlayerInputMsg input = {
         .player_id = client->player_id,
         .input_flags = client->input_flags,
-        .sequence = client->sequence
+        .sequence = client->sequence,
+        .ack_tick = state_decoder_ack(&client->decoder)
     };
+    uint8_t payload[WIRE_INPUT_MAX];
+    int length = wire_encode_input(&input, client->version, payload);
 
-    MessageHeader header = {
-        .type = MSG_PLAYER_INPUT,
-        .length = sizeof(input)
-    };
+    // Unreliable over UDP: the next input supersedes a lost one
+    net_link_send(&client->link, MSG_PLAYER_INPUT, payload, length, 0);
+}
 
-    net_send_all(client->socket, &header, sizeof(header));
-    net_send_all(client->socket, &input, sizeof(input));
+/**
+ * client_apply_state - Apply one MSG_GAME_STATE or MSG_STATE_FRAGMENT
+ *
+ * The payload is a delta against a snapshot we acked earlier; the
+ * decoder rebuilds the full world from it (see state_decoder.h). A
+ * fragment only completes a snapshot once its last piece is in.
+ *
+ * @return 1 if a snapshot was applied, 0 if not (yet)
+ */
+static int client_apply_state(ClientState* client, const NetFrame* frame) {
+    const DecodedState* state;
+    if (frame->header.type == MSG_STATE_FRAGMENT) {
+        state = state_decoder_apply_fragment(&client->decoder, frame->payload,
+                                             frame->header.length);
+    } else {
+        state = state_decoder_apply(&client->decoder, frame->payload, frame->header.length);
+    }
+    return state != NULL;
 }
 
 /**
  * client_receive_state - Receive game state from server
+ *
+ * Handles everything the server has sent since last frame (never
+ * blocks) and applies every complete state message - the newest one wins.
+ *
+ * @return 1 if a state was received, 0 if not, -1 if the server is gone
  */
 static int client_receive_state(ClientState* client) {
-    // Check if data is available (non-blocking)
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(client->socket, &read_fds);
-
-    struct timeval timeout = { 0, 0 };  // No wait
-    if (select(client->socket + 1, &read_fds, NULL, NULL, &timeout) <= 0) {
-        return 0;  // No data available
+    int received = 0;
+    NetFrame frame;
+    int result;
+    while ((result = net_link_poll(&client->link, &frame)) > 0) {
+        if (frame.header.type == MSG_GAME_STATE ||
+            frame.header.type == MSG_STATE_FRAGMENT) {
+            received |= client_apply_state(client, &frame);
+        } else if (frame.header.type == MSG_DISCONNECT) {
+            result = -1;
+            break;
+        }
+        // Other message types are ignored
     }
 
-    // Read header
-    MessageHeader header;
-    int bytes = net_recv_all(client->socket, &header, sizeof(header));
-    if (bytes <= 0) {
+    if (result < 0) {
         printf("Server disconnected\n");
         return -1;
     }
 
-    if (header.type == MSG_GAME_STATE) {
-        // Read game state header (tick, your_sequence, player_count)
-        // The sizeof(GameStateMsg) is just the fixed fields since players[] is flexible
-        GameStateMsg state_header;
-        if (net_recv_all(client->socket, &state_header, sizeof(GameStateMsg)) <= 0) {
-            return -1;
-        }
-
-        client->last_tick = state_header.tick;
-        client->player_count = state_header.player_count;
-
-        // Read player states
-        for (int i = 0; i < state_header.player_count && i < MAX_CLIENTS; i++) {
-            if (net_recv_all(client->socket, &client->players[i],
-                            sizeof(PlayerState)) <= 0) {
-                return -1;
-            }
-        }
-
-        return 1;  // Received state
-    }
-
-    return 0;  // Other message type
+    return received;
 }
 
 /**
@@ -259,19 +319,27 @@ static void client_print_state(const ClientState* client) {
     printf("║     VOID DRIFTER CLIENT - Module 4                        ║\n");
     printf("╚════════════════════════════════════════════════════════════╝\n\n");
 
-    printf("Server Tick: %u    Your ID: %d\n\n", client->last_tick, client->player_id);
+    static const DecodedState none = { 0 };
+    const DecodedState* state = client->decoder.latest ? client->decoder.latest : &none;
+
+    printf("Server Tick: %u    Your ID: %d\n\n", state->tick, client->player_id);
 
-    printf("Players (%d connected):\n", client->player_count);
+    printf("Players (%d connected):\n", state->player_count);
     printf("┌────────┬────────────────────┬─────────────────┬────────┐\n");
     printf("│   ID   │     Position       │    Velocity     │ Health │\n");
     printf("├────────┼────────────────────┼─────────────────┼────────┤\n");
 
-    for (int i = 0; i < client->player_count; i++) {
-        const PlayerState* p = &client->players[i];
+    int rows = (state->player_count < CLIENT_PRINT_ROWS) ? state->player_count
+                                                         : CLIENT_PRINT_ROWS;
+    for (int i = 0; i < rows; i++) {
+        const PlayerState* p = &state->players[i];
         char marker = (p->player_id == client->player_id) ? '*' : ' ';
-        printf("│  %c%d    │ (%6.1f, %6.1f)   │ (%5.1f, %5.1f)  │  %3d   │\n",
+        printf("│  %c%-4d │ (%6.1f, %6.1f)   │ (%5.1f, %5.1f)  │  %3d   │\n",
                marker, p->player_id, p->x, p->y, p->vx, p->vy, p->health);
     }
+    if (state->player_count > rows) {
+        printf("│  ... and %d more\n", state->player_count - rows);
+    }
     printf("└────────┴────────────────────┴─────────────────┴────────┘\n");
     printf("\n* = You\n\n");
 
@@ -293,13 +361,21 @@ static void client_print_state(const ClientState* client) {
 int main(int argc, char* argv[]) {
     const char* host = "127.0.0.1";
     uint16_t port = DEFAULT_PORT;
-
-    // Parse command line arguments
-    if (argc > 1) {
-        host = argv[1];
-    }
-    if (argc > 2) {
-        port = (uint16_t)atoi(argv[2]);
+    NetTransport transport = NET_TRANSPORT_TCP;
+    uint8_t version = PROTOCOL_VERSION;
+
+    // Parse command line arguments: [HOST] [PORT] [--udp] [--raw]
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--udp") == 0) {
+            transport = NET_TRANSPORT_UDP;
+        } else if (strcmp(argv[i], "--raw") == 0) {
+            version = PROTOCOL_VERSION_RAW;  // Unquantized structs
+        } else if (positional++ == 0) {
+            host = argv[i];
+        } else {
+            port = (uint16_t)atoi(argv[i]);
+        }
     }
 
     printf("\n");
@@ -323,17 +399,18 @@ int main(int argc, char* argv[]) {
     // Initialize client state
     ClientState client;
     memset(&client, 0, sizeof(client));
-    client.socket = INVALID_SOCKET;
+    client.link.socket = INVALID_SOCKET;
+    client.version = version;
 
     // Connect to server
-    if (client_connect(&client, host, port) != 0) {
+    if (client_connect(&client, host, port, transport) != 0) {
         restore_terminal();
         net_cleanup();
         return 1;
     }
 
     // Make socket non-blocking for receive
-    net_set_nonblocking(client.socket);
+    net_set_nonblocking(client.link.socket);
 
     // Main client loop
     while (g_running) {
@@ -359,6 +436,7 @@ int main(int argc, char* argv[]) {
 
     // Disconnect
     client_disconnect(&client);
+    state_decoder_free(&client.decoder);
     restore_terminal();
     net_cleanup();
 
@@ -0,0 +1,1370 @@
+/**
+ * game_server.c - One Game World (Room) Implementation
+ *
+ * Everything that used to be "the server" - input handling, physics,
+ * bullets, state broadcast - now operates on a GameServer pointer
+ * instead of a single global world. See game_server.h.
+ */
+
+#include "game_server.h"
+#include "interest.h"
+#include "pipeline.h"
+#include "wire.h"
+#include "tick_scheduler.h"
+#include "log.h"
+#include "recording.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+// Quantized snapshots can only carry bullet velocities up to this
+_Static_assert((int)SPREAD_BULLET_SPEED <= (int)WIRE_BULLET_SPEED_MAX &&
+               (int)RAPID_BULLET_SPEED <= (int)WIRE_BULLET_SPEED_MAX &&
+               (int)LASER_BULLET_SPEED <= (int)WIRE_BULLET_SPEED_MAX,
+               "bullet speed exceeds WIRE_BULLET_SPEED_MAX");
+
+// A hitbox swept over the deepest rewind must fit the grid (spatial_grid.h)
+_Static_assert(2 * ((int)PLAYER_HALF_SIZE + (int)BULLET_HIT_RADIUS) +
+               (int)PLAYER_SPEED * WORLD_HISTORY_MAX_REWIND / TICK_RATE <= 2 * SPATIAL_CELL_SIZE,
+               "lag compensation window too long for SPATIAL_CELL_SIZE");
+
+// A UDP snapshot piece is built entirely in the outbox item's head
+_Static_assert(sizeof(NetUdpHeader) + SNAPSHOT_PIECE_HEAD_MAX <= NET_UDP_HEAD_MAX,
+               "NET_UDP_HEAD_MAX too small for a snapshot piece head");
+
+/**
+ * server_send_queue_size - Bytes per player send queue
+ *
+ * Two of the largest TCP message this room can send - a body at its
+ * worst case, cut into full frames, each with a piece head - plus
+ * PLAYER_SEND_QUEUE_SLACK. Coalescing keeps a backlog at most one
+ * half-sent snapshot and the newest one, so that is always enough for
+ * a client that is still reading at all.
+ */
+static int server_send_queue_size(const SnapshotBuilder* snap) {
+    int pieces = snap->body_capacity / SNAPSHOT_TCP_PAYLOAD_MAX + 1;
+    int largest = snap->body_capacity + (int)SNAPSHOT_HEADER_MAX +
+                  pieces * (int)SNAPSHOT_PIECE_HEAD_MAX;
+    return 2 * largest + PLAYER_SEND_QUEUE_SLACK;
+}
+
+/**
+ * game_server_init - Prepare an empty room
+ *
+ * On failure everything is freed again and 'reactor' stays NULL, so the
+ * room reads as never initialized (game_server_cleanup() is not needed).
+ */
+int game_server_init(GameServer* server, int room_id, NetReactor* reactor,
+                     const RoomLimits* limits, MetricsShard* metrics) {
+    memset(server, 0, sizeof(GameServer));
+    server->room_id = room_id;
+    server->metrics = metrics;
+    server->max_players = limits->max_players;
+    server->sync_bullets = limits->sync_bullets;
+    server->msg_budget = DEFAULT_MSG_BUDGET;
+    server->byte_budget = DEFAULT_BYTE_BUDGET;
+    server->max_rewind = DEFAULT_MAX_REWIND;
+    server->send_stall_ticks = DEFAULT_SEND_STALL_TICKS;
+
+    server->players = calloc((size_t)limits->max_players, sizeof(ServerPlayer));
+    if (server->players == NULL ||
+        bullet_store_init(&server->bullets, limits->max_bullets) < 0 ||
+        spatial_grid_init(&server->grid, limits->max_players) < 0 ||
+        world_history_init(&server->history, limits->max_players) < 0 ||
+        interest_init(&server->interest, limits->max_bullets) < 0 ||
+        snapshot_init(&server->snapshot, limits->max_players, limits->max_bullets,
+                      limits->sync_bullets) < 0) {
+        free(server->players);
+        server->players = NULL;
+        server->max_players = 0;
+        bullet_store_free(&server->bullets);
+        spatial_grid_free(&server->grid);
+        world_history_free(&server->history);
+        interest_free(&server->interest);
+        snapshot_free(&server->snapshot);
+        return -1;
+    }
+    server->send_queue_size = server_send_queue_size(&server->snapshot);
+    server->reactor = reactor;
+    return 0;
+}
+
+/**
+ * game_server_cleanup - Close all client connections and free the arena
+ */
+static void server_close_socket(GameServer* server, ServerPlayer* player);
+
+void game_server_cleanup(GameServer* server) {
+    for (int i = 0; server->players != NULL && i < server->max_players; i++) {
+        if (server->players[i].active && server->players[i].socket != INVALID_SOCKET) {
+            server_close_socket(server, &server->players[i]);
+        }
+        net_send_queue_free(&server->players[i].send_queue);
+        server->players[i].active = 0;
+    }
+    server->player_count = 0;
+    snapshot_free(&server->snapshot);
+    interest_free(&server->interest);
+    bullet_store_free(&server->bullets);
+    spatial_grid_free(&server->grid);
+    world_history_free(&server->history);
+    free(server->players);
+    server->players = NULL;
+}
+
+/**
+ * server_find_free_slot - Find an unused player slot
+ */
+static int server_find_free_slot(GameServer* server) {
+    for (int i = 0; i < server->max_players; i++) {
+        if (!server->players[i].active) {
+            return i;
+        }
+    }
+    return -1;  // No free slots
+}
+
+/**
+ * server_queue_udp - Queue one unreliable message for a UDP player
+ *
+ * Small messages only: the whole datagram is built in the send head.
+ */
+static int server_queue_udp(GameServer* server, ServerPlayer* player,
+                            uint8_t type, const void* payload, int length) {
+    NetUdpSend* item = net_udp_outbox_add(server->udp_out, &player->udp.addr);
+    item->head_length = net_udp_encode(&player->udp, item->head, sizeof(item->head),
+                                       type, payload, length);
+    if (item->head_length < 0) {
+        server->udp_out->count--;  // Too big - give the slot back
+        return -1;
+    }
+    metrics_message(server->metrics, 1, type, sizeof(MessageHeader) + (uint64_t)length);
+    return 0;
+}
+
+/**
+ * server_queue_udp_resends - Queue every reliable message that is due
+ */
+static void server_queue_udp_resends(GameServer* server, ServerPlayer* player, uint64_t now_ms) {
+    while (1) {
+        NetUdpSend* item = net_udp_outbox_add(server->udp_out, &player->udp.addr);
+        item->head_length = net_udp_next_resend(&player->udp, now_ms,
+                                                item->head, sizeof(item->head));
+        if (item->head_length == 0) {
+            server->udp_out->count--;
+            return;
+        }
+    }
+}
+
+/**
+ * server_close_socket - Unregister a TCP player's socket and close it
+ *
+ * The socket is removed from the reactor BEFORE it is closed, so a
+ * recycled descriptor number can never deliver events to a stale slot.
+ * An io_uring closes it only once its last request has completed; a
+ * send still in flight reads the queue's storage, so the ring takes
+ * that over and frees it at the same time.
+ *
+ * In a pipelined room, once a frame handed the socket to the output
+ * thread, closing it is that thread's job (see pipeline.h).
+ */
+static void server_close_socket(GameServer* server, ServerPlayer* player) {
+    if (player->uring_conn >= 0) {
+        for (int h = 0; h < player->held_count; h++) {
+            net_uring_recycle(server->uring, player->held[h].buffer);
+        }
+        free(player->held);
+        player->held = NULL;
+        player->held_count = 0;
+        player->held_capacity = 0;
+
+        void* orphan = NULL;
+        if (player->send_queue.in_flight > 0) {
+            orphan = player->send_queue.data;
+            player->send_queue.data = NULL;
+        }
+        net_uring_remove(server->uring, player->uring_conn, orphan);
+        player->uring_conn = -1;
+    } else {
+        net_reactor_remove(server->reactor, player->socket);
+        if (!player->published) net_close(player->socket);
+    }
+    net_send_queue_free(&player->send_queue);
+}
+
+/**
+ * game_server_disconnect_player - Drop a player and forget their socket
+ *
+ * UDP players have no socket of their own. They get a best-effort
+ * MSG_DISCONNECT instead - which also acks a MSG_DISCONNECT they sent,
+ * so their client doesn't have to wait for a timeout to leave.
+ *
+ * An empty room is no longer ticked, so a pipelined one publishes a
+ * frame right away: otherwise the output thread would keep the last
+ * player's socket open until somebody else joins.
+ */
+static void server_publish_frame(GameServer* server, int wait);
+
+void game_server_disconnect_player(GameServer* server, int player_id, const char* reason) {
+    ServerPlayer* player = &server->players[player_id];
+    if (!player->active) return;
+
+    LOG_INFO("Room %d: Player %d disconnected (%s)", server->room_id, player_id, reason);
+    recorder_disconnect(server->recorder, server->input_tick, player_id);
+    if (player->is_udp) {
+        server_queue_udp(server, player, MSG_DISCONNECT, NULL, 0);
+    } else if (player->socket != INVALID_SOCKET) {
+        server_close_socket(server, player);
+    }
+    player->active = 0;
+    server->player_count--;
+    metrics_add(server->metrics, METRIC_DISCONNECTS, 1);
+    metrics_gauge_add(server->metrics, METRIC_GAUGE_PLAYERS, -1);
+
+    if (server->output != NULL && server->player_count == 0) {
+        server_publish_frame(server, 1);
+    }
+}
+
+/**
+ * server_place_player - Put a player at its spawn point with full health
+ *
+ * Used when a player joins and when it is shot down.
+ */
+static void server_place_player(ServerPlayer* player, int slot) {
+    // Spread players out
+    player->x = 100.0f + (slot * 150.0f);
+    player->y = 400.0f;
+    player->vx = 0;
+    player->vy = 0;
+    player->fixed = (FixedBody){ fixed_from_float(player->x), fixed_from_float(player->y), 0, 0 };
+    player->health = PLAYER_MAX_HEALTH;
+}
+
+/**
+ * server_seat_player - Fill in a free slot for a new player
+ */
+static ServerPlayer* server_seat_player(GameServer* server, int slot, Socket client_socket,
+                                        const struct sockaddr_in* client_addr,
+                                        const ConnectMsg* connect_msg) {
+    ServerPlayer* player = &server->players[slot];
+    memset(player, 0, sizeof(ServerPlayer));
+    player->active = 1;
+    player->socket = client_socket;
+    player->addr = *client_addr;
+    player->server = server;
+    player->version = connect_msg->version;
+    player->uring_conn = -1;
+    if (++server->next_session == 0) server->next_session = 1;
+    player->session = server->next_session;
+    net_recv_buffer_init(&player->recv_buf, player->recv_storage, sizeof(player->recv_storage));
+    net_send_queue_init(&player->send_queue, server->send_queue_size);
+    // Use name from connect message if provided, otherwise default
+    if (connect_msg->name[0] != '\0') {
+        strncpy(player->name, connect_msg->name, sizeof(player->name) - 1);
+        player->name[sizeof(player->name) - 1] = '\0';
+    } else {
+        // Slots fit 16 bits, so GCC can tell the name always fits
+        snprintf(player->name, sizeof(player->name), "Player%u",
+                 (unsigned)(uint16_t)(slot + 1));
+    }
+
+    server_place_player(player, slot);
+    world_history_restart(&server->history, slot, server->tick, player->x, player->y);
+    player->weapon = 0;
+    player->acked_tick = STATE_NO_BASELINE;  // First snapshot is a full one
+
+    server->player_count++;
+    return player;
+}
+
+/**
+ * server_make_ack - Acceptance for 'slot', with the room's table sizes
+ */
+static ConnectAckMsg server_make_ack(const GameServer* server, int slot) {
+    ConnectAckMsg ack = {
+        .success = 1,
+        .player_id = (uint16_t)slot,
+        .reason = 0,
+        .max_players = (uint16_t)server->max_players,
+        .max_bullets = (uint16_t)server->sync_bullets
+    };
+    return ack;
+}
+
+/**
+ * server_send_ack - Send MSG_CONNECT_ACK on a (still blocking) TCP socket
+ */
+static void server_send_ack(GameServer* server, Socket client_socket, const ConnectAckMsg* ack) {
+    NetBatch batch;
+    net_batch_begin(&batch, client_socket, 0);
+    net_batch_add(&batch, MSG_CONNECT_ACK, ack, sizeof(*ack));
+    int sent = net_batch_flush(&batch);
+    if (sent < 0) {
+        metrics_add(server->metrics, METRIC_SEND_FAILURES, 1);
+        return;
+    }
+    metrics_message(server->metrics, 1, MSG_CONNECT_ACK, (uint64_t)sent);
+}
+
+/**
+ * game_server_add_player - Seat a handshaken client in this room
+ *
+ * The room manager already checked the protocol version and reserved a
+ * seat for us, so "full" here only happens if that bookkeeping is wrong.
+ */
+int game_server_add_player(GameServer* server, Socket client_socket,
+                           const struct sockaddr_in* client_addr, const ConnectMsg* connect_msg) {
+    char addr_str[32];
+    net_addr_to_string(client_addr, addr_str, sizeof(addr_str));
+
+    // Find a free player slot
+    int slot = server_find_free_slot(server);
+    if (slot < 0) {
+        LOG_INFO("Room %d full, rejecting connection from %s", server->room_id, addr_str);
+        ConnectAckMsg ack = { .success = 0 };
+        server_send_ack(server, client_socket, &ack);
+        net_close(client_socket);
+        metrics_add(server->metrics, METRIC_REJECTS, 1);
+        return -1;
+    }
+
+    // Initialize player
+    ServerPlayer* player = server_seat_player(server, slot, client_socket,
+                                              client_addr, connect_msg);
+
+    // Send acceptance message
+    ConnectAckMsg ack = server_make_ack(server, slot);
+    server_send_ack(server, client_socket, &ack);
+
+    // The handshake is done, so the socket switches to non-blocking mode
+    // once, for good, and joins the reactor. From now on we only touch it
+    // when the kernel says it has data. With an io_uring the ring reads
+    // and writes it instead (and waits for readiness itself); with I/O
+    // threads, the room's output stage does, once a frame hands it over.
+    int io_thread = (server->output != NULL && server->output->inputs != NULL);
+    if (server->uring != NULL) {
+        player->uring_conn = net_uring_add(server->uring, client_socket, player);
+        player->send_queue.async = 1;
+    } else {
+        net_set_nonblocking(client_socket);
+    }
+    if ((server->uring != NULL) ? player->uring_conn < 0 :
+        !io_thread && net_reactor_add(server->reactor, client_socket, NET_EVENT_READ, player) != 0) {
+        net_close(client_socket);
+        player->active = 0;
+        server->player_count--;
+        return -1;
+    }
+    player->events = io_thread ? 0 : NET_EVENT_READ;
+
+    LOG_INFO("Room %d: Player %d (%s) joined from %s",
+           server->room_id, slot, player->name, addr_str);
+    recorder_connect(server->recorder, server->input_tick, slot, connect_msg);
+    metrics_add(server->metrics, METRIC_CONNECTS, 1);
+    metrics_gauge_add(server->metrics, METRIC_GAUGE_PLAYERS, 1);
+    return slot;
+}
+
+/**
+ * game_server_add_udp_player - Seat a client that connected over UDP
+ *
+ * The connection id encodes where the player lives, so a worker finds
+ * the player for a datagram without any searching:
+ *
+ *     bits 31..22   generation (never 0, changes every join)
+ *     bits 21..12   room index within the worker (udp_id_prefix)
+ *     bits 11..0    player slot (PROTOCOL_MAX_PLAYERS = 4096)
+ *
+ * The generation keeps a late packet from a previous occupant of the
+ * same slot from being mistaken for the new player's.
+ */
+int game_server_add_udp_player(GameServer* server, const struct sockaddr_in* client_addr,
+                               const NetUdpHeader* header, const ConnectMsg* connect_msg) {
+    char addr_str[32];
+    net_addr_to_string(client_addr, addr_str, sizeof(addr_str));
+
+    int slot = server_find_free_slot(server);
+    if (slot < 0) {
+        LOG_INFO("Room %d full, rejecting UDP connection from %s", server->room_id, addr_str);
+        NetUdpConnection reject;
+        net_udp_connection_accept(&reject, 0, client_addr, header);
+        ConnectAckMsg ack = { .success = 0 };
+        NetUdpSend* item = net_udp_outbox_add(server->udp_out, client_addr);
+        item->head_length = net_udp_encode(&reject, item->head, sizeof(item->head),
+                                           MSG_CONNECT_ACK, &ack, sizeof(ack));
+        metrics_message(server->metrics, 1, MSG_CONNECT_ACK, sizeof(MessageHeader) + sizeof(ack));
+        metrics_add(server->metrics, METRIC_REJECTS, 1);
+        return -1;
+    }
+
+    ServerPlayer* player = server_seat_player(server, slot, INVALID_SOCKET,
+                                              client_addr, connect_msg);
+    player->is_udp = 1;
+
+    server->udp_generation = server->udp_generation % 0x3FF + 1;
+    uint32_t id = (server->udp_generation << 22) | server->udp_id_prefix | (uint32_t)slot;
+    net_udp_connection_accept(&player->udp, id, client_addr, header);
+
+    // Sent from the worker's socket: its port is where the client
+    // sends everything from now on
+    ConnectAckMsg ack = server_make_ack(server, slot);
+    net_udp_queue_reliable(&player->udp, MSG_CONNECT_ACK, &ack, sizeof(ack));
+    server_queue_udp_resends(server, player, net_time_ms());
+
+    LOG_INFO("Room %d: Player %d (%s) joined from %s over UDP (connection %08x)",
+           server->room_id, slot, player->name, addr_str, id);
+    recorder_connect(server->recorder, server->input_tick, slot, connect_msg);
+    metrics_message(server->metrics, 1, MSG_CONNECT_ACK, sizeof(MessageHeader) + sizeof(ack));
+    metrics_add(server->metrics, METRIC_CONNECTS, 1);
+    metrics_gauge_add(server->metrics, METRIC_GAUGE_PLAYERS, 1);
+    return slot;
+}
+
+/**
+ * game_server_add_recorded_player - Seat a player that only exists in a recording
+ */
+int game_server_add_recorded_player(GameServer* server, int slot, const ConnectMsg* connect) {
+    if (slot < 0 || slot >= server->max_players || server->players[slot].active) return -1;
+
+    struct sockaddr_in nowhere;
+    memset(&nowhere, 0, sizeof(nowhere));
+    server_seat_player(server, slot, INVALID_SOCKET, &nowhere, connect);
+    return slot;
+}
+
+/**
+ * game_server_find_udp_player - Decode the slot from a connection id
+ */
+int game_server_find_udp_player(const GameServer* server, uint32_t connection_id) {
+    int slot = (int)(connection_id & 0xFFF);
+    if (slot >= server->max_players) return -1;
+
+    const ServerPlayer* player = &server->players[slot];
+    if (!player->active || !player->is_udp || player->udp.connection_id != connection_id) {
+        return -1;
+    }
+    return slot;
+}
+
+/**
+ * server_handle_input - Apply one MSG_PLAYER_INPUT
+ */
+static void server_handle_input(GameServer* server, int player_id, const PlayerInputMsg* input) {
+    ServerPlayer* player = &server->players[player_id];
+
+    // Validate sequence (ignore old/duplicate messages)
+    if (input->sequence <= player->last_sequence) {
+        server->msg_stats.dropped++;
+        return;  // Old message, ignore
+    }
+    player->last_sequence = input->sequence;
+    player->acked_tick = input->ack_tick;
+
+    // Lag compensation: the client aimed at snapshot ack_tick, so its
+    // shots look back (input tick - ack_tick) ticks - RTT plus render
+    // delay - up to the room's cap (see world_history.h)
+    if (input->ack_tick != STATE_NO_BASELINE && input->ack_tick <= server->input_tick) {
+        uint32_t lag = server->input_tick - input->ack_tick;
+        if (lag > (uint32_t)server->max_rewind) lag = (uint32_t)server->max_rewind;
+        player->rewind_ticks = (uint8_t)lag;
+    }
+    recorder_input(server->recorder, server->input_tick, player_id, input);
+
+    // A second input before the next tick supersedes the first - but a
+    // FIRE press is latched so a tap shorter than one tick still shoots
+    uint8_t latched = 0;
+    if (player->input_this_tick) {
+        latched = player->input_flags & INPUT_FIRE;
+        server->msg_stats.collapsed++;
+    }
+    player->input_this_tick = 1;
+
+    // Store input for processing in update
+    player->input_flags = input->input_flags | latched;
+    player->weapon = input->weapon_type;
+
+    // Debug output (compiled out unless LOG_MIN_LEVEL is DEBUG; even
+    // then it only queues a record - see log.h)
+    if (input->input_flags != player->logged_flags) {
+        uint8_t flags = input->input_flags;
+        LOG_DEBUG("Room %d: Player %d input: %s%s%s%s%sweapon=%d",
+                  server->room_id, player_id,
+                  (flags & INPUT_UP) ? "UP " : "", (flags & INPUT_DOWN) ? "DOWN " : "",
+                  (flags & INPUT_LEFT) ? "LEFT " : "", (flags & INPUT_RIGHT) ? "RIGHT " : "",
+                  (flags & INPUT_FIRE) ? "FIRE " : "", input->weapon_type);
+        player->logged_flags = flags;
+    }
+    LOG_DEBUG("Room %d: Player %d (seq=%u)", server->room_id, player_id, input->sequence);
+}
+
+/**
+ * game_server_apply_input - Public entry to server_handle_input (replay)
+ */
+void game_server_apply_input(GameServer* server, int player_id, const PlayerInputMsg* input) {
+    server_handle_input(server, player_id, input);
+}
+
+/**
+ * game_server_apply_queued_input - Check the session, then as a frame would
+ */
+void game_server_apply_queued_input(GameServer* server, int player_id, uint32_t session,
+                                    const PlayerInputMsg* input) {
+    if (player_id >= server->max_players) return;
+    ServerPlayer* player = &server->players[player_id];
+    if (!player->active || player->session != session) return;
+
+    server->msg_stats.handled++;
+    server_handle_input(server, player_id, input);
+}
+
+/**
+ * server_watch_player - Tell the reactor what a TCP player's socket waits for
+ *
+ * READ unless the player is throttled, WRITE while its send queue holds
+ * bytes. Only calls into the reactor when that changes. Waiting for
+ * nothing means leaving the reactor: epoll reports a hangup or error
+ * even with an empty mask, and nobody would handle it until the next
+ * tick.
+ *
+ * With an io_uring: receive unless throttled (or still holding
+ * buffers), and queue a send of whatever is pending if none is in
+ * flight. The worker submits it with the rest of the loop's requests.
+ */
+static void server_watch_player(GameServer* server, ServerPlayer* player) {
+    if (player->uring_conn >= 0) {
+        net_uring_set_recv(server->uring, player->uring_conn,
+                           !player->throttled && player->held_count == 0);
+
+        NetSendQueue* queue = &player->send_queue;
+        const uint8_t* data;
+        int length;
+        if (queue->in_flight == 0 && (length = net_send_queue_begin_async(queue, &data)) > 0 &&
+            net_uring_send(server->uring, player->uring_conn, data, length) != 0) {
+            net_send_queue_end_async(queue, 0);  // Queue full: the next watch retries
+        }
+        return;
+    }
+
+    uint32_t events = player->throttled ? 0 : NET_EVENT_READ;
+    if (net_send_queue_pending(&player->send_queue) > 0) events |= NET_EVENT_WRITE;
+    if (events == player->events) return;
+
+    if (player->events == 0) {
+        if (net_reactor_add(server->reactor, player->socket, events, player) != 0) return;
+    } else if (events == 0) {
+        net_reactor_remove(server->reactor, player->socket);
+    } else {
+        net_reactor_modify(server->reactor, player->socket, events, player);
+    }
+    player->events = events;
+}
+
+/**
+ * server_push_tcp - Send one message to a TCP player through its queue
+ *
+ * @return  0 if it was sent or queued, -1 if the player was disconnected
+ */
+static int server_push_tcp(GameServer* server, int player_id,
+                           const struct iovec* iov, int count) {
+    ServerPlayer* player = &server->players[player_id];
+    int result = net_send_queue_push(&player->send_queue, player->socket, iov, count, 0);
+    if (result == NET_QUEUE_FULL) {
+        metrics_add(server->metrics, METRIC_SLOW_EVICTIONS, 1);
+        game_server_disconnect_player(server, player_id, "send queue full");
+        return -1;
+    }
+    if (result < 0) {
+        metrics_add(server->metrics, METRIC_SEND_FAILURES, 1);
+        game_server_disconnect_player(server, player_id, "send failed");
+        return -1;
+    }
+    server_watch_player(server, player);
+    return 0;
+}
+
+/**
+ * server_throttle_player - Stop reading from a player until next tick
+ *
+ * Level-triggered readiness would wake us again and again for data we've
+ * decided not to handle yet, so the socket loses NET_EVENT_READ (and
+ * leaves the reactor unless it waits to be writable).
+ * server_refill_budgets() re-arms it.
+ */
+static void server_throttle_player(GameServer* server, ServerPlayer* player) {
+    player->throttled = 1;
+    server_watch_player(server, player);
+    server->msg_stats.throttled++;
+}
+
+/**
+ * server_handle_frame - Handle one complete message from a player
+ *
+ * Shared by both transports: the frame was cut out of a TCP stream or
+ * delivered by the UDP sequence layer, the switch doesn't care which.
+ */
+static void server_handle_frame(GameServer* server, int player_id, const NetFrame* frame) {
+    ServerPlayer* player = &server->players[player_id];
+    server->msg_stats.handled++;
+    metrics_message(server->metrics, 0, frame->header.type,
+                    sizeof(MessageHeader) + (uint64_t)frame->header.length);
+
+    // Handle message based on type
+    switch (frame->header.type) {
+        case MSG_PLAYER_INPUT: {
+            PlayerInputMsg input;
+            if (wire_decode_input(frame->payload, frame->header.length,
+                                  player->version, &input) != 0) {
+                server->msg_stats.dropped++;
+                break;
+            }
+            server_handle_input(server, player_id, &input);
+            break;
+        }
+
+        case MSG_DISCONNECT:
+            game_server_disconnect_player(server, player_id, "sent disconnect");
+            break;
+
+        case MSG_PING: {
+            // Echo back pong
+            if (frame->header.length < sizeof(PingMsg)) {
+                server->msg_stats.dropped++;
+                break;
+            }
+            const PingMsg* ping = (const PingMsg*)frame->payload;
+            PongMsg pong = {
+                .client_timestamp = ping->timestamp,
+                .server_timestamp = server->tick
+            };
+            if (player->is_udp) {
+                server_queue_udp(server, player, MSG_PONG, &pong, sizeof(pong));
+                break;
+            }
+            if (server->output != NULL) {
+                // The output thread sends it, ahead of the next snapshot
+                player->pong = pong;
+                player->pong_due = 1;
+                break;
+            }
+            // Through the queue: it may still hold half a snapshot
+            MessageHeader pong_header = { .type = MSG_PONG, .length = sizeof(pong) };
+            struct iovec parts[2] = {
+                { .iov_base = &pong_header, .iov_len = sizeof(pong_header) },
+                { .iov_base = &pong, .iov_len = sizeof(pong) }
+            };
+            if (server_push_tcp(server, player_id, parts, 2) < 0) break;
+            metrics_message(server->metrics, 1, MSG_PONG, sizeof(pong_header) + sizeof(pong));
+            break;
+        }
+
+        default:
+            server->msg_stats.dropped++;
+            LOG_WARN("Room %d: Unknown message type %d from player %d",
+                   server->room_id, frame->header.type, player_id);
+            break;
+    }
+}
+
+/**
+ * server_handle_frames - Handle every complete frame in the receive buffer
+ *
+ * Stops when the player's tick budget runs out (the player is
+ * throttled) or only a partial frame is left.
+ *
+ * @return  1 if the buffer holds no complete frame any more, 0 if the
+ *          player was throttled or disconnected
+ */
+static int server_handle_frames(GameServer* server, int player_id) {
+    ServerPlayer* player = &server->players[player_id];
+    NetFrame frame;
+    int result = 0;
+    while (player->active) {
+        if (player->tick_msgs >= server->msg_budget ||
+            player->tick_bytes >= server->byte_budget) {
+            // Anything else waits for the next tick
+            server_throttle_player(server, player);
+            return 0;
+        }
+
+        result = net_recv_buffer_next(&player->recv_buf, &frame);
+        if (result <= 0) break;
+
+        player->tick_msgs++;
+        player->tick_bytes += (int)sizeof(MessageHeader) + frame.header.length;
+        server_handle_frame(server, player_id, &frame);
+    }
+
+    if (player->active && result < 0) {
+        game_server_disconnect_player(server, player_id, "corrupt message stream");
+    }
+    return player->active;
+}
+
+/**
+ * game_server_handle_client_message - Process data from a client
+ *
+ * Only called for sockets the reactor reported as readable, so the
+ * common case is that data really is waiting.
+ *
+ * One fill() pulls in everything the kernel has queued; we then handle
+ * every complete frame in it until the player's tick budget runs out.
+ * Payloads are read in place - the message structs are packed, so
+ * pointing them at any byte offset is safe.
+ */
+void game_server_handle_client_message(GameServer* server, int player_id) {
+    ServerPlayer* player = &server->players[player_id];
+    if (!player->active || player->throttled) return;
+
+    if (net_recv_buffer_fill(player->socket, &player->recv_buf) < 0) {
+        game_server_disconnect_player(server, player_id, "connection closed");
+        return;
+    }
+    server_handle_frames(server, player_id);
+}
+
+/**
+ * game_server_handle_writable - Flush, and stop watching once drained
+ */
+void game_server_handle_writable(GameServer* server, int player_id) {
+    ServerPlayer* player = &server->players[player_id];
+    if (!player->active || player->socket == INVALID_SOCKET) return;
+
+    if (net_send_queue_flush(&player->send_queue, player->socket) < 0) {
+        metrics_add(server->metrics, METRIC_SEND_FAILURES, 1);
+        game_server_disconnect_player(server, player_id, "send failed");
+        return;
+    }
+    server_watch_player(server, player);
+}
+
+/**
+ * server_read_held - Parse a player's held receive buffers, oldest first
+ *
+ * Frames left in recv_buf go first. Then each round copies as much as
+ * fits into recv_buf (a buffer that was used up goes back to the pool)
+ * and handles the frames that made complete. Stops when nothing is
+ * held any more, or the player is throttled again.
+ */
+static void server_read_held(GameServer* server, int player_id) {
+    ServerPlayer* player = &server->players[player_id];
+
+    // Frames already in recv_buf when the budget ran out come first -
+    // nothing else would parse them if no buffer is held
+    if (!server_handle_frames(server, player_id)) return;
+
+    while (player->active && player->held_count > 0) {
+        int used = 0;
+        while (used < player->held_count) {
+            NetUringEvent* held = &player->held[used];
+            int taken = net_recv_buffer_append(&player->recv_buf, held->data, held->result);
+            held->data += taken;
+            held->result -= taken;
+            if (held->result > 0) break;  // recv_buf is full
+            net_uring_recycle(server->uring, held->buffer);
+            used++;
+        }
+        player->held_count -= used;
+        memmove(player->held, player->held + used, player->held_count * sizeof(NetUringEvent));
+
+        if (!server_handle_frames(server, player_id)) return;
+    }
+}
+
+/**
+ * server_hold - Keep a received buffer until its bytes can be parsed
+ *
+ * A full list is ordinary backpressure (a burst that completed while
+ * receiving was being paused), not misbehaviour: it grows instead.
+ *
+ * @return  0 if held, -1 if out of memory
+ */
+static int server_hold(ServerPlayer* player, const NetUringEvent* event) {
+    if (player->held_count == player->held_capacity) {
+        int capacity = (player->held_capacity > 0) ? 2 * player->held_capacity
+                                                   : PLAYER_HELD_BUFFERS;
+        NetUringEvent* held = realloc(player->held, (size_t)capacity * sizeof(NetUringEvent));
+        if (held == NULL) return -1;
+        player->held = held;
+        player->held_capacity = capacity;
+    }
+    player->held[player->held_count++] = *event;
+    return 0;
+}
+
+/**
+ * game_server_handle_completion - A recv or send of a player completed
+ */
+void game_server_handle_completion(GameServer* server, int player_id,
+                                   const NetUringEvent* event) {
+    ServerPlayer* player = &server->players[player_id];
+    if (!player->active || player->uring_conn != event->conn) {
+        net_uring_recycle(server->uring, event->buffer);  // Already disconnected
+        return;
+    }
+
+    if (event->kind == NET_URING_SEND) {
+        net_send_queue_end_async(&player->send_queue, (event->result > 0) ? event->result : 0);
+        if (event->result < 0 && event->result != -EAGAIN && event->result != -EINTR) {
+            metrics_add(server->metrics, METRIC_SEND_FAILURES, 1);
+            game_server_disconnect_player(server, player_id, "send failed");
+            return;
+        }
+        server_watch_player(server, player);
+        return;
+    }
+
+    if (event->result <= 0) {
+        game_server_disconnect_player(server, player_id, "connection closed");
+        return;
+    }
+    if (server_hold(player, event) != 0) {
+        net_uring_recycle(server->uring, event->buffer);
+        game_server_disconnect_player(server, player_id, "out of memory");
+        return;
+    }
+
+    // A throttled player's bytes wait (in order) for the next tick
+    if (!player->throttled) server_read_held(server, player_id);
+    if (player->active) server_watch_player(server, player);
+}
+
+/**
+ * game_server_handle_datagram - One datagram from a UDP player
+ */
+void game_server_handle_datagram(GameServer* server, int player_id,
+                                 const NetDatagram* datagram, uint64_t now_ms) {
+    ServerPlayer* player = &server->players[player_id];
+
+    if (player->tick_msgs >= server->msg_budget ||
+        player->tick_bytes >= server->byte_budget) {
+        server->msg_stats.dropped++;
+        return;
+    }
+
+    NetFrame frame;
+    if (!net_udp_receive(&player->udp, datagram->data, datagram->length, now_ms, &frame)) {
+        return;  // Stale, duplicate or out-of-order: the sequence layer ate it
+    }
+
+    player->tick_msgs++;
+    player->tick_bytes += (int)sizeof(MessageHeader) + frame.header.length;
+    server_handle_frame(server, player_id, &frame);
+}
+
+/**
+ * server_refill_budgets - Start a new tick's input budget
+ *
+ * Players that were throttled last tick get their held-back messages
+ * handled FIRST, so those inputs count for this tick, then their
+ * socket goes back into the reactor. UDP players are never throttled;
+ * instead this is where their timeouts and reliable resends happen.
+ */
+static void server_refill_budgets(GameServer* server) {
+    uint64_t now_ms = net_time_ms();
+
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        player->tick_msgs = 0;
+        player->tick_bytes = 0;
+
+        if (player->is_udp) {
+            // No connection to break: silence is the only way to notice
+            // a UDP client that crashed or lost its network
+            if (now_ms - player->udp.last_recv_ms > NET_UDP_TIMEOUT_MS) {
+                game_server_disconnect_player(server, i, "timed out");
+            } else {
+                server_queue_udp_resends(server, player, now_ms);
+            }
+            continue;
+        }
+
+        if (player->throttled) {
+            player->throttled = 0;
+            if (player->uring_conn >= 0) {
+                server_read_held(server, i);
+            } else {
+                game_server_handle_client_message(server, i);
+            }
+            if (player->active) server_watch_player(server, player);
+        }
+    }
+}
+
+/**
+ * server_spawn_single_bullet - Create a single bullet with given parameters
+ */
+static void server_spawn_single_bullet(GameServer* server, int player_id,
+                                        float x, float y, float vx, float vy,
+                                        uint8_t weapon_type) {
+    // Full store: the shot is simply lost
+    int id = bullet_store_spawn(&server->bullets, (uint16_t)player_id, x, y, vx, vy,
+                                weapon_type, BULLET_LIFETIME);
+    if (id >= 0) {
+        server->bullets.rewind[server->bullets.index_of[id]] = server->players[player_id].rewind_ticks;
+    }
+}
+
+/**
+ * server_spawn_bullet - Create bullets based on weapon type
+ */
+static void server_spawn_bullet(GameServer* server, int player_id, float x, float y) {
+    uint8_t weapon = server->players[player_id].weapon;
+
+    switch (weapon) {
+        case WEAPON_TYPE_SPREAD: {
+            // Spread: 3 bullets in a fan pattern
+            float speed = SPREAD_BULLET_SPEED;
+            float angles[] = { -0.2618f, 0.0f, 0.2618f };  // -15, 0, +15 degrees in radians
+
+            for (int i = 0; i < 3; i++) {
+                float vx = speed * sinf(angles[i]);
+                float vy = -speed * cosf(angles[i]);
+                float spawn_x = x + 10.0f * sinf(angles[i]);
+                float spawn_y = y - 20.0f;
+                server_spawn_single_bullet(server, player_id, spawn_x, spawn_y, vx, vy, weapon);
+            }
+            break;
+        }
+
+        case WEAPON_TYPE_RAPID: {
+            // Rapid: single fast bullet straight up
+            float speed = RAPID_BULLET_SPEED;
+            server_spawn_single_bullet(server, player_id, x, y - 25.0f, 0, -speed, weapon);
+            break;
+        }
+
+        case WEAPON_TYPE_LASER: {
+            // Laser: single very fast bullet
+            float speed = LASER_BULLET_SPEED;
+            server_spawn_single_bullet(server, player_id, x, y - 30.0f, 0, -speed, weapon);
+            break;
+        }
+
+        default: {
+            // Default to spread behavior
+            float speed = SPREAD_BULLET_SPEED;
+            server_spawn_single_bullet(server, player_id, x, y - 20.0f, 0, -speed, weapon);
+            break;
+        }
+    }
+}
+
+/**
+ * server_update_bullets - Move all bullets, drop expired and off-screen ones
+ */
+static void server_update_bullets(GameServer* server, float dt) {
+    bullet_store_update(&server->bullets, dt, GAME_WIDTH, GAME_HEIGHT);
+}
+
+/**
+ * get_bullet_damage - Damage a bullet deals based on weapon type
+ */
+static int get_bullet_damage(uint8_t weapon_type) {
+    switch (weapon_type) {
+        case WEAPON_TYPE_SPREAD: return SPREAD_BULLET_DAMAGE;
+        case WEAPON_TYPE_RAPID:  return RAPID_BULLET_DAMAGE;
+        case WEAPON_TYPE_LASER:  return LASER_BULLET_DAMAGE;
+        default:                 return SPREAD_BULLET_DAMAGE;
+    }
+}
+
+/**
+ * server_handle_hits - Damage players hit by bullets
+ *
+ * CONCEPT: Broadphase, then Exact Test
+ * ====================================
+ * The players are filed into the spatial grid (see spatial_grid.h) by
+ * their hitbox grown by the bullet radius; each bullet then only tests
+ * the players in its own cell. A bullet never hits the player who fired
+ * it, and is used up by the first player it hits.
+ *
+ * With lag compensation a bullet tests each target where it was
+ * 'rewind' ticks ago (see world_history.h), so a player's grid box
+ * covers everywhere it was over the deepest rewind any live bullet
+ * needs this tick.
+ *
+ * Bullets are walked from the last index down, so the swap-remove of a
+ * spent bullet only moves one that was already tested.
+ */
+static void server_handle_hits(GameServer* server) {
+    const float reach = PLAYER_HALF_SIZE + BULLET_HIT_RADIUS;
+    SpatialGrid* grid = &server->grid;
+    BulletStore* bullets = &server->bullets;
+    WorldHistory* history = &server->history;
+    uint32_t now = server->tick;
+
+    int deepest = 0;
+    for (int b = 0; b < bullets->count; b++) {
+        if (bullets->rewind[b] > deepest) deepest = bullets->rewind[b];
+    }
+
+    spatial_grid_clear(grid);
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+        float min_x = player->x, max_x = player->x;
+        float min_y = player->y, max_y = player->y;
+        for (int r = 1; r <= deepest; r++) {
+            HistoryPoint past = world_history_at(history, i, now, r);
+            if (past.x < min_x) min_x = past.x;
+            if (past.x > max_x) max_x = past.x;
+            if (past.y < min_y) min_y = past.y;
+            if (past.y > max_y) max_y = past.y;
+        }
+        spatial_grid_insert(grid, (uint16_t)i, min_x - reach, min_y - reach,
+                            max_x + reach, max_y + reach);
+    }
+    spatial_grid_finish(grid);
+
+    for (int b = bullets->count - 1; b >= 0; b--) {
+        int count;
+        const uint16_t* nearby = spatial_grid_query(grid, bullets->x[b], bullets->y[b], &count);
+
+        for (int k = 0; k < count; k++) {
+            int target = nearby[k];
+            ServerPlayer* player = &server->players[target];
+            if (target == bullets->owner[b]) continue;  // No self-hits
+            HistoryPoint seen = world_history_at(history, target, now, bullets->rewind[b]);
+            if (fabsf(bullets->x[b] - seen.x) > reach ||
+                fabsf(bullets->y[b] - seen.y) > reach) {
+                continue;
+            }
+
+            player->health -= get_bullet_damage(bullets->weapon[b]);
+            if (player->health <= 0) {
+                LOG_INFO("Room %d: Player %d (%s) shot down by player %d",
+                       server->room_id, target, player->name, bullets->owner[b]);
+                server_place_player(player, target);
+                world_history_restart(history, target, now, player->x, player->y);
+            }
+            bullet_store_remove(bullets, b);
+            break;
+        }
+    }
+}
+
+/**
+ * get_weapon_cooldown - Get fire cooldown based on weapon type
+ */
+static float get_weapon_cooldown(uint8_t weapon_type) {
+    switch (weapon_type) {
+        case WEAPON_TYPE_SPREAD: return 1.0f / SPREAD_FIRE_RATE;
+        case WEAPON_TYPE_RAPID:  return 1.0f / RAPID_FIRE_RATE;
+        case WEAPON_TYPE_LASER:  return 1.0f / LASER_FIRE_RATE;
+        default:                 return 1.0f / SPREAD_FIRE_RATE;
+    }
+}
+
+/**
+ * server_handle_firing - Process fire input from players
+ */
+static void server_handle_firing(GameServer* server, float dt) {
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        // Update cooldown
+        if (player->fire_cooldown > 0) {
+            player->fire_cooldown -= dt;
+        }
+
+        // Check if firing
+        if ((player->input_flags & INPUT_FIRE) && player->fire_cooldown <= 0) {
+            server_spawn_bullet(server, i, player->x, player->y);
+            player->fire_cooldown = get_weapon_cooldown(player->weapon);
+        }
+    }
+}
+
+/**
+ * server_update_physics - Update game physics based on player input
+ *
+ * CONCEPT: Server-Side Physics
+ * ============================
+ * The server runs the same physics that the client would.
+ * Clients send input, server calculates results.
+ *
+ * This prevents cheating - clients can't lie about their position.
+ *
+ * IMPORTANT: The step itself lives in physics.c, which the client
+ * prediction calls too. In PHYSICS_FIXED rooms 'fixed' is the real
+ * state and x..vy are just its float view for snapshots and hits.
+ */
+static void server_update_physics(GameServer* server, float dt) {
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        PhysicsBody body;
+        if (server->physics == PHYSICS_FIXED) {
+            physics_step_fixed(&player->fixed, player->input_flags, PHYSICS_SUBSTEPS);
+            fixed_body_to_float(&body, &player->fixed);
+        } else {
+            body = (PhysicsBody){ player->x, player->y, player->vx, player->vy };
+            physics_step_float(&body, player->input_flags, dt);
+        }
+        player->x = body.x;
+        player->y = body.y;
+        player->vx = body.vx;
+        player->vy = body.vy;
+    }
+
+    // This tick's row of the lag compensation history
+    HistoryPoint* row = world_history_row(&server->history, server->tick);
+    for (int i = 0; i < server->max_players; i++) {
+        if (server->players[i].active) {
+            row[i] = (HistoryPoint){ server->players[i].x, server->players[i].y };
+        }
+    }
+}
+
+/**
+ * server_player_state - What a snapshot says about one player
+ */
+static void server_player_state(const ServerPlayer* sp, int slot, PlayerState* ps) {
+    ps->player_id = (uint16_t)slot;
+    ps->x = sp->x;
+    ps->y = sp->y;
+    ps->vx = sp->vx;
+    ps->vy = sp->vy;
+    ps->health = (int16_t)sp->health;
+    ps->weapon = sp->weapon;
+    ps->flags = (sp->input_flags & INPUT_FIRE) ? 1 : 0;  // Flag if firing
+}
+
+/**
+ * server_send_state - Send game state to all clients
+ *
+ * The interest stage first picks the bullets each client is sent (see
+ * interest.h); the players and the UNION of those sets are recorded in
+ * the room's snapshot history - a bullet nobody is sent never costs a
+ * copy. Each client then gets the delta
+ * of ITS view against the last snapshot it acked - encoded once per
+ * distinct body - plus its own small header, in a single vectored
+ * push into its send queue. No malloc, and a body is only copied for
+ * a client whose socket is backed up.
+ */
+static void server_send_state(GameServer* server) {
+    SnapshotBuilder* snap = &server->snapshot;
+    snapshot_begin(snap, server->tick);
+
+    // Fill player states
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* sp = &server->players[i];
+        if (!sp->active) continue;
+
+        PlayerState* ps = snapshot_add_player(snap);
+        if (ps == NULL) break;
+        server_player_state(sp, i, ps);
+    }
+
+    // Interest stage: the sync_bullets bullets that matter most to
+    // each client, favouring the ones it was sent last tick
+    InterestScratch* interest = &server->interest;
+    interest_begin(interest);
+    for (int i = 0; i < server->max_players; i++) {
+        if (!server->players[i].active) continue;
+        PlayerState viewer;
+        server_player_state(&server->players[i], i, &viewer);
+        interest_select(interest, &server->bullets, &viewer, snapshot_previous_view(snap, i),
+                        snapshot_view(snap, i), server->sync_bullets);
+    }
+
+    // Fill bullet states (after player states): only those some client
+    // is sent, in ascending id order
+    interest_add_bullets(interest, &server->bullets, snap);
+
+    // Send to each client with its own sequence number
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        // Delta of this client's view against the newest snapshot it acked
+        const SnapshotDelta* delta = snapshot_delta(snap, i, player->acked_tick,
+                                                    player->version == PROTOCOL_VERSION);
+        if (delta == NULL) continue;  // Body pool used up: next tick
+
+        if (player->is_udp) {
+            // One datagram per piece: UDP packet header + piece head in
+            // the item's head, shared body slice by reference; the worker
+            // sends the whole batch at once
+            int count = 1;
+            int bytes = 0;
+            for (int index = 0; index < count; index++) {
+                SnapshotPiece piece;
+                count = snapshot_piece(snap, delta, player->last_sequence,
+                                       SNAPSHOT_UDP_PAYLOAD_MAX, index, &piece);
+                NetUdpSend* item = net_udp_outbox_add(server->udp_out, &player->udp.addr);
+                item->head_length = net_udp_write_header(&player->udp, item->head);
+                memcpy(item->head + item->head_length, piece.head, piece.head_length);
+                item->head_length += piece.head_length;
+                item->body = piece.body;
+                item->body_length = piece.body_length;
+
+                int length = piece.head_length + piece.body_length;
+                const MessageHeader* header = (const MessageHeader*)piece.head;
+                metrics_message(server->metrics, 1, header->type, (uint64_t)length);
+                bytes += length;
+            }
+            metrics_observe(server->metrics, METRIC_CLIENT_BYTES, (uint64_t)bytes);
+            continue;
+        }
+
+        // A replayed player: the body is encoded, but nobody receives it
+        if (player->socket == INVALID_SOCKET) continue;
+
+        // Queue the state; a full queue or a dead socket ends the player
+        NetSendQueue* queue = &player->send_queue;
+        int backlog = net_send_queue_pending(queue) > 0;
+        uint64_t superseded = queue->superseded;
+        int sent = snapshot_send(snap, delta, queue, player->socket, player->last_sequence);
+        if (sent < 0) {
+            metrics_add(server->metrics,
+                        (sent == NET_QUEUE_FULL) ? METRIC_SLOW_EVICTIONS : METRIC_SEND_FAILURES, 1);
+            game_server_disconnect_player(server, i,
+                                          (sent == NET_QUEUE_FULL) ? "send queue full" : "send failed");
+            continue;
+        }
+        metrics_add(server->metrics, METRIC_SUPERSEDED, queue->superseded - superseded);
+        snapshot_count_sent(server->metrics, sent);
+
+        // Last tick's bytes still not out: one more tick behind
+        player->backlog_ticks = backlog ? player->backlog_ticks + 1 : 0;
+        if (player->backlog_ticks >= server->send_stall_ticks) {
+            metrics_add(server->metrics, METRIC_SLOW_EVICTIONS, 1);
+            game_server_disconnect_player(server, i, "too slow to read snapshots");
+            continue;
+        }
+        server_watch_player(server, player);
+    }
+}
+
+/**
+ * server_publish_frame - Copy this tick's world into the output ring
+ *
+ * Instead of server_send_state() in a pipelined room. If the output
+ * thread still has PIPELINE_DEPTH frames to send, the tick doesn't wait
+ * for it ('wait' = 0): the frame is skipped, and the next one carries
+ * the whole world anyway - pongs included, they stay due until a frame
+ * takes them.
+ */
+static void server_publish_frame(GameServer* server, int wait) {
+    WorldFrame* frame = pipeline_acquire_frame(server->output, wait);
+    if (frame == NULL) {
+        metrics_add(server->metrics, METRIC_PIPELINE_SKIPS, 1);
+        return;
+    }
+
+    frame->tick = server->tick;
+    frame->player_count = server->player_count;
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        FramePlayer* fp = &frame->players[i];
+        if (!player->active) {
+            fp->session = 0;
+            continue;
+        }
+
+        fp->session = player->session;
+        fp->socket = player->socket;
+        fp->version = player->version;
+        fp->acked_tick = player->acked_tick;
+        fp->last_sequence = player->last_sequence;
+        fp->pong_due = player->pong_due;
+        fp->pong = player->pong;
+        server_player_state(player, i, &fp->state);
+
+        player->pong_due = 0;
+        player->published = 1;
+    }
+    bullet_store_copy(&frame->bullets, &server->bullets);
+
+    pipeline_publish_frame(server->output, frame);
+}
+
+/**
+ * server_take_output_drops - Disconnect whoever the output thread gave up on
+ */
+static void server_take_output_drops(GameServer* server) {
+    for (int i = 0; i < server->max_players; i++) {
+        ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        const char* reason = pipeline_take_drop(server->output, i, player->session);
+        if (reason != NULL) {
+            game_server_disconnect_player(server, i, reason);
+        }
+    }
+}
+
+/**
+ * game_server_tick - Advance the room by one simulation step
+ */
+void game_server_tick(GameServer* server, float dt) {
+    MetricsShard* metrics = server->metrics;
+    int bullets_before = server->bullets.count;
+    uint64_t t0 = tick_now_ns();
+    server->input_tick = server->tick;
+
+    // Players whose snapshots stopped going out leave first
+    if (server->output != NULL) {
+        server_take_output_drops(server);
+    }
+
+    // New tick, new input budget (may handle held-back messages)
+    server_refill_budgets(server);
+    uint64_t t1 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_INPUT, t1 - t0);
+
+    // Update game physics
+    server_update_physics(server, dt);
+    uint64_t t2 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_PHYSICS, t2 - t1);
+
+    // Handle firing, update bullets and apply hits
+    server_handle_firing(server, dt);
+    uint64_t t3 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_FIRING, t3 - t2);
+
+    server_update_bullets(server, dt);
+    uint64_t t4 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_BULLETS, t4 - t3);
+
+    server_handle_hits(server);
+    uint64_t t5 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_HITS, t5 - t4);
+
+    // Inputs from now on belong to the next tick
+    for (int i = 0; i < server->max_players; i++) {
+        server->players[i].input_this_tick = 0;
+    }
+    server->input_tick = server->tick + 1;
+
+    // Send state to all clients (pipelined: hand it to the output thread)
+    if (server->player_count > 0) {
+        if (server->output != NULL) {
+            server_publish_frame(server, 0);
+        } else {
+            server_send_state(server);
+        }
+    }
+    uint64_t t6 = tick_now_ns();
+    metrics_observe(metrics, METRIC_PHASE_SNAPSHOT, t6 - t5);
+    if (server->output != NULL) {
+        metrics_observe(metrics, METRIC_PIPELINE_SIMULATE, t6 - t0);
+    }
+
+    metrics_add(metrics, METRIC_TICKS, 1);
+    metrics_gauge_add(metrics, METRIC_GAUGE_BULLETS, server->bullets.count - bullets_before);
+
+    // Increment tick
+    server->tick++;
+    recorder_end_tick(server->recorder, server);
+}
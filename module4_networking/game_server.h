@@ -0,0 +1,476 @@
+/**
+ * game_server.h - One Game World (a "Room")
+ *
+ * CONCEPT: Many Worlds, One Process
+ * =================================
+ * Originally server.c owned exactly one global game. Now a GameServer is
+ * just a value: a struct holding the players, bullets and tick counter
+ * of ONE match. Nothing in here is global, so we can create as many
+ * independent worlds as we like:
+ *
+ *     GameServer rooms[16];   // 16 matches running side by side
+ *
+ * Who drives a GameServer is up to the caller (see room_manager.h):
+ *     - Sockets arrive already handshaken via game_server_add_player()
+ *     - Readable sockets are handed to game_server_handle_client_message(),
+ *       writable ones (a send queue to drain) to game_server_handle_writable()
+ *     - Or, with an io_uring (GameServer.uring), completions go to
+ *       game_server_handle_completion() instead of both
+ *     - UDP players join via game_server_add_udp_player(); their datagrams
+ *       arrive through game_server_handle_datagram()
+ *     - game_server_tick() advances the world by one step
+ *     - A replay (see recording.h) seats socketless players with
+ *       game_server_add_recorded_player() and feeds their recorded
+ *       inputs through game_server_apply_input()
+ *     - Inputs decoded by I/O threads (see pipeline.h) arrive through
+ *       game_server_apply_queued_input(); the room then reads no socket
+ *
+ * THREADING RULE: A GameServer is touched by exactly one thread (the
+ * worker that owns it). It has no locks because it never needs them.
+ * The one exception is a PIPELINED room (GameServer.output, see
+ * pipeline.h): its snapshot and interest scratch belong to the output
+ * thread, which only ever sees the room through published frames.
+ */
+
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+#include "network.h"
+#include "bullet_store.h"
+#include "spatial_grid.h"
+#include "snapshot.h"
+#include "interest.h"
+#include "metrics.h"
+#include "physics.h"
+#include "world_history.h"
+#include "net_uring.h"
+
+// Simulation steps per second (every room ticks at this rate)
+#define TICK_RATE PHYSICS_TICK_RATE
+
+// Room size unless overridden (see RoomLimits); the protocol allows up
+// to PROTOCOL_MAX_PLAYERS / PROTOCOL_MAX_BULLETS
+#define DEFAULT_MAX_PLAYERS  4      // Players per room
+#define DEFAULT_MAX_BULLETS  200    // Bullets the server tracks per room
+#define DEFAULT_SYNC_BULLETS 50     // Bullets sent to each client per snapshot
+
+// Receive buffer per player (client messages are tiny; this holds
+// hundreds of them if a client falls behind)
+#define PLAYER_RECV_BUFFER_SIZE 2048
+
+// io_uring: received buffers a player holds room for at first. Receiving
+// is paused as soon as it is throttled, but completions already on
+// their way keep arriving, so the list grows (doubling) as needed -
+// never past the ring's buffer pool, which bounds them.
+#define PLAYER_HELD_BUFFERS 8
+
+// Send queue per player, on top of two of the room's largest snapshots
+// (one half-sent, one waiting): room for pongs and other small replies
+#define PLAYER_SEND_QUEUE_SLACK (16 * 1024)
+
+// Ticks a player's send queue may stay backed up before it is evicted
+// (2 s; see GameServer.send_stall_ticks)
+#define DEFAULT_SEND_STALL_TICKS (2 * TICK_RATE)
+
+// Default per-player, per-tick input budget (see GameServer.msg_budget)
+#define DEFAULT_MSG_BUDGET  32      // Messages handled per tick
+#define DEFAULT_BYTE_BUDGET 4096    // Payload + header bytes handled per tick
+
+// Default lag compensation cap in ticks (200 ms; at most
+// WORLD_HISTORY_MAX_REWIND, see GameServer.max_rewind)
+#define DEFAULT_MAX_REWIND 12
+
+// Bullet configuration
+#define BULLET_LIFETIME 2.0f
+#define BULLET_HIT_RADIUS 4.0f
+
+// Player health (the hitbox is PLAYER_HALF_SIZE, see protocol.h)
+#define PLAYER_MAX_HEALTH 100
+
+// Weapon-specific configurations (must match client weapon.c)
+// Fire rates: shots per second -> cooldown = 1/rate
+#define SPREAD_FIRE_RATE    3.0f    // 3 shots/sec
+#define RAPID_FIRE_RATE     10.0f   // 10 shots/sec
+#define LASER_FIRE_RATE     1.5f    // 1.5 shots/sec
+
+#define SPREAD_BULLET_SPEED 400.0f
+#define RAPID_BULLET_SPEED  600.0f
+#define LASER_BULLET_SPEED  800.0f
+
+#define SPREAD_BULLET_DAMAGE 5
+#define RAPID_BULLET_DAMAGE  3
+#define LASER_BULLET_DAMAGE  15
+
+// Forward declarations (ServerPlayer points back at its room; the
+// recorder is defined in recording.h, the output stage in pipeline.h)
+typedef struct GameServer GameServer;
+typedef struct Recorder Recorder;
+typedef struct RoomOutput RoomOutput;
+
+/**
+ * RoomLimits - How big a room's tables are
+ *
+ * Chosen at startup (server --max-players etc.) and announced to every
+ * client in MSG_CONNECT_ACK, so both sides size their tables at runtime.
+ */
+typedef struct {
+    int max_players;        // Player slots (<= PROTOCOL_MAX_PLAYERS)
+    int max_bullets;        // Live bullets (<= PROTOCOL_MAX_BULLETS)
+    int sync_bullets;       // Bullets per client per snapshot
+} RoomLimits;
+
+/**
+ * ServerPlayer - Server's view of a connected player
+ */
+typedef struct {
+    int active;             // Is this slot in use?
+    Socket socket;          // Client's socket (INVALID_SOCKET for UDP players)
+    char name[16];          // Player name
+    struct sockaddr_in addr; // Client address
+    GameServer* server;     // Room this player belongs to (reactor user_data)
+
+    // Incoming bytes not yet parsed into messages (TCP)
+    NetRecvBuffer recv_buf;
+    uint8_t recv_storage[PLAYER_RECV_BUFFER_SIZE];
+
+    // Outgoing bytes the kernel didn't take yet (TCP, see network.h)
+    NetSendQueue send_queue;
+    uint32_t events;        // NET_EVENT_* the reactor watches the socket for
+    int backlog_ticks;      // Consecutive ticks the queue didn't drain
+
+    // io_uring instead of the reactor: the ring's connection number
+    // (-1 = reactor), and received buffers that didn't fit recv_buf yet
+    int uring_conn;
+    NetUringEvent* held;    // Allocated on first use, freed with the socket
+    int held_count;
+    int held_capacity;
+
+    // Wire encoding the client asked for (PROTOCOL_VERSION or _RAW)
+    uint8_t version;
+
+    // UDP players: sequence/ack state instead of a socket
+    int is_udp;
+    NetUdpConnection udp;
+
+    // Pipelined rooms: this stay in the slot (never 0, never reused),
+    // whether a published frame handed the socket to the output thread
+    // yet, and the pong it is to send with the next frame
+    uint32_t session;
+    int published;
+    PongMsg pong;
+    int pong_due;
+
+    // Game state (server is authoritative)
+    float x, y;             // Position
+    float vx, vy;           // Velocity
+    FixedBody fixed;        // The same, exact (PHYSICS_FIXED rooms; x..vy follow it)
+    int health;             // HP
+    uint8_t weapon;         // Current weapon
+    uint8_t input_flags;    // Last received input
+    uint32_t last_sequence; // Last input sequence number
+    uint32_t acked_tick;    // Newest snapshot the client has (delta baseline)
+    uint8_t rewind_ticks;   // Lag its shots are compensated for (see world_history.h)
+    uint8_t logged_flags;   // Input last printed (debug output only)
+    int input_this_tick;    // An input already arrived since the last tick
+
+    // Per-tick budget (reset by game_server_tick)
+    int tick_msgs;          // Messages handled this tick
+    int tick_bytes;         // Bytes handled this tick
+    int throttled;          // Budget spent: socket parked until next tick
+
+    // Weapon state
+    float fire_cooldown;    // Time until can fire again
+} ServerPlayer;
+
+/**
+ * MessageStats - What happened to the messages a room received
+ *
+ * Totals since the room was created (only ever incremented, so a
+ * reader can diff two samples).
+ */
+typedef struct {
+    uint64_t handled;       // Messages processed
+    uint64_t collapsed;     // Inputs replaced by a newer one in the same tick
+    uint64_t dropped;       // Stale, malformed or unknown messages
+    uint64_t throttled;     // Times a player used up their tick budget
+} MessageStats;
+
+/**
+ * GameServer - State of one room
+ *
+ * CONCEPT: Per-Tick Input Budget
+ * ==============================
+ * Every tick, each player may have at most 'msg_budget' messages
+ * (and 'byte_budget' bytes) handled. Whatever arrives beyond that stays
+ * in the player's receive buffer - and then in the kernel, which makes
+ * TCP slow the sender down - until the next tick. A flooding client
+ * therefore can't steal time from the rest of the room, and a merely
+ * bursty one is caught up within a few ticks instead of building a
+ * backlog that keeps growing (the "latency creep").
+ *
+ * Inputs that arrive within the same tick are COLLAPSED: only the
+ * newest one matters for the simulation, except that a FIRE press in
+ * any of them is kept so a quick tap is never lost.
+ *
+ * CONCEPT: Slow Clients Don't Slow the Room
+ * =========================================
+ * The other direction has the same problem: a client that reads too
+ * slowly must not hold up the tick. Snapshots go through the player's
+ * send queue (see NetSendQueue in network.h), which never blocks:
+ *
+ *     keeping up        queue empty, snapshots go straight to the kernel
+ *     hiccup (Wi-Fi)    kernel buffer full; the rest waits in the queue
+ *                       and leaves when the socket is writable again.
+ *                       Unsent old snapshots are superseded by new ones
+ *     too slow / gone   last tick's bytes are still queued when the next
+ *                       snapshot is due, 'send_stall_ticks' ticks in a
+ *                       row (or the queue overflows): evicted
+ *
+ * The high-water mark is the kernel's send buffer itself - our queue
+ * only holds what didn't fit there, so a queue that stays non-empty
+ * means a client a whole socket buffer plus a tick behind, for seconds.
+ */
+struct GameServer {
+    int room_id;            // Index in the room manager (for log output)
+    NetReactor* reactor;    // Owning worker's reactor (NOT owned by us)
+    NetUring* uring;        // Owning worker's io_uring, if it uses one (NOT owned)
+    ServerPlayer* players;  // max_players slots
+    int max_players;
+    int sync_bullets;       // Interest budget per client
+    int player_count;
+    uint32_t tick;          // Server tick counter
+    uint32_t input_tick;    // Tick an input arriving now is simulated in
+    PhysicsMode physics;    // Float or deterministic fixed-point movement
+
+    // Bullets, one array per field (see bullet_store.h)
+    BulletStore bullets;
+
+    // Hit detection broadphase, rebuilt from the players every tick
+    SpatialGrid grid;
+
+    // Lag compensation: recent player positions, and how far back a
+    // shot may look (ticks, 0 = off; DEFAULT_MAX_REWIND unless overridden)
+    WorldHistory history;
+    int max_rewind;
+
+    // Reused every tick to encode MSG_GAME_STATE
+    SnapshotBuilder snapshot;
+    InterestScratch interest;
+
+    // Pipelined: frames go to an output thread, which encodes and sends
+    // them (NULL = send from the tick; owned by the room manager)
+    RoomOutput* output;
+    uint32_t next_session;
+
+    // UDP: datagrams for our players are queued here and sent in batches
+    // by the worker (shared by all rooms of one worker; NULL = TCP only).
+    // Connection ids are generation | udp_id_prefix | slot (see
+    // server_udp_connection_id).
+    NetUdpOutbox* udp_out;
+    uint32_t udp_id_prefix;
+    uint32_t udp_generation;
+
+    // Input budget per player per tick (DEFAULT_* unless overridden)
+    int msg_budget;
+    int byte_budget;
+    MessageStats msg_stats;
+
+    // Slow clients: size of each player's send queue, and how many
+    // ticks in a row it may end a tick undrained (see below)
+    int send_queue_size;
+    int send_stall_ticks;
+
+    // Owning worker's metrics shard (NOT owned by us, see metrics.h)
+    MetricsShard* metrics;
+
+    // Input recording (NULL = off; owned by the room manager)
+    Recorder* recorder;
+};
+
+/**
+ * game_server_init - Prepare an empty room
+ *
+ * Allocates the player slots, the bullet store, the hit grid and the
+ * snapshot arena up front, so ticking never allocates.
+ *
+ * @param server   Room to initialize
+ * @param room_id  Identifier used in log output
+ * @param reactor  Reactor that player sockets will be registered with
+ * @param limits   Table sizes
+ * @param metrics  Shard of the thread that will drive this room
+ * @return         0 on success, -1 if out of memory
+ */
+int game_server_init(GameServer* server, int room_id, NetReactor* reactor,
+                     const RoomLimits* limits, MetricsShard* metrics);
+
+/**
+ * game_server_cleanup - Disconnect every player and free the room's memory
+ *
+ * @param server  Room to clean up
+ */
+void game_server_cleanup(GameServer* server);
+
+/**
+ * game_server_add_player - Seat a handshaken client in this room
+ *
+ * Sends MSG_CONNECT_ACK (accepted or "full"), makes the socket
+ * non-blocking and registers it with the room's reactor - or hands it
+ * to the room's io_uring, if it has one. On failure the socket is
+ * closed.
+ *
+ * @param server   The room
+ * @param socket   Connected client socket (MSG_CONNECT already read)
+ * @param addr     Client address
+ * @param connect  The client's MSG_CONNECT payload
+ * @return         Player slot, or -1 if the client was rejected
+ */
+int game_server_add_player(GameServer* server, Socket socket,
+                           const struct sockaddr_in* addr, const ConnectMsg* connect);
+
+/**
+ * game_server_add_udp_player - Seat a client that connected over UDP
+ *
+ * Assigns the connection id and queues a reliable MSG_CONNECT_ACK in
+ * server->udp_out (or an unreliable rejection if the room is full).
+ *
+ * @param server   The room (udp_out must be set)
+ * @param addr     Client address
+ * @param header   UDP header of the client's MSG_CONNECT packet
+ * @param connect  The client's MSG_CONNECT payload
+ * @return         Player slot, or -1 if the client was rejected
+ */
+int game_server_add_udp_player(GameServer* server, const struct sockaddr_in* addr,
+                               const NetUdpHeader* header, const ConnectMsg* connect);
+
+/**
+ * game_server_add_recorded_player - Seat a replayed player in a given slot
+ *
+ * The player has no socket and no UDP connection: its inputs come from
+ * a recording, and its snapshots are encoded but never sent.
+ *
+ * @param server   The room
+ * @param slot     Slot the player had when recorded
+ * @param connect  Recorded name and protocol version
+ * @return         'slot', or -1 if it is out of range or taken
+ */
+int game_server_add_recorded_player(GameServer* server, int slot, const ConnectMsg* connect);
+
+/**
+ * game_server_apply_input - Handle one decoded MSG_PLAYER_INPUT
+ *
+ * What a frame from the network ends up calling; replay calls it
+ * directly.
+ *
+ * @param server     The room
+ * @param player_id  Active slot
+ * @param input      The input
+ */
+void game_server_apply_input(GameServer* server, int player_id, const PlayerInputMsg* input);
+
+/**
+ * game_server_apply_queued_input - Handle an input an I/O thread decoded
+ *
+ * The input waited in a queue: if its player has left the slot since
+ * (a different session, or none), it is ignored.
+ *
+ * @param server     The room
+ * @param player_id  Slot the input was read for
+ * @param session    Session of the player it was read from
+ * @param input      The input
+ */
+void game_server_apply_queued_input(GameServer* server, int player_id, uint32_t session,
+                                    const PlayerInputMsg* input);
+
+/**
+ * game_server_find_udp_player - Map a connection id to a player slot
+ *
+ * @param server         The room
+ * @param connection_id  From the datagram's NetUdpHeader
+ * @return               Player slot, or -1 if no such connection
+ */
+int game_server_find_udp_player(const GameServer* server, uint32_t connection_id);
+
+/**
+ * game_server_disconnect_player - Drop a player and close their socket
+ *
+ * @param server     The room
+ * @param player_id  Slot to free
+ * @param reason     Printed in the log
+ */
+void game_server_disconnect_player(GameServer* server, int player_id, const char* reason);
+
+/**
+ * game_server_handle_client_message - Process data from a readable socket
+ *
+ * Reads everything waiting on the socket and handles every complete
+ * message, up to the player's budget for this tick. A trailing partial
+ * message waits for the next wakeup; messages over budget wait for the
+ * next tick (the socket is parked in the reactor until then).
+ *
+ * @param server     The room
+ * @param player_id  Slot whose socket the reactor reported ready
+ */
+void game_server_handle_client_message(GameServer* server, int player_id);
+
+/**
+ * game_server_handle_writable - Drain a player's send queue
+ *
+ * The reactor only reports NET_EVENT_WRITE for sockets whose queue has
+ * bytes waiting; once it is empty we stop watching for it.
+ *
+ * @param server     The room
+ * @param player_id  Slot whose socket the reactor reported writable
+ */
+void game_server_handle_writable(GameServer* server, int player_id);
+
+/**
+ * game_server_handle_completion - An io_uring request of a player completed
+ *
+ * The io_uring counterpart of handle_client_message/handle_writable:
+ * received bytes are parsed (or held while the player is throttled),
+ * a completed send releases its bytes and the next one is queued.
+ * Nothing is submitted here; the worker submits once per loop.
+ *
+ * @param server     The room
+ * @param player_id  Slot the completion's user_data points at
+ * @param event      The completion (its receive buffer is recycled)
+ */
+void game_server_handle_completion(GameServer* server, int player_id,
+                                   const NetUringEvent* event);
+
+/**
+ * game_server_handle_datagram - Process one datagram from a UDP player
+ *
+ * Runs it through the sequence/ack layer and handles the message it
+ * carries. Datagrams beyond the player's tick budget are dropped: unlike
+ * TCP there is no kernel backlog to hold them, and the next input will
+ * supersede this one anyway.
+ *
+ * @param server     The room
+ * @param player_id  Slot found with game_server_find_udp_player()
+ * @param datagram   The datagram
+ * @param now_ms     net_time_ms() when the batch was received
+ */
+void game_server_handle_datagram(GameServer* server, int player_id,
+                                 const NetDatagram* datagram, uint64_t now_ms);
+
+/**
+ * game_server_tick - Advance the room by one simulation step
+ *
+ * Refills every player's input budget (handling messages that were
+ * held back last tick first), times out silent UDP players and queues
+ * their due reliable resends, runs physics, firing, bullets and hits, sends
+ * the new state to every player (a pipelined room publishes it to its
+ * output thread instead), and increments the tick counter. Each
+ * phase's duration goes into the room's metrics shard; a recording room
+ * writes a keyframe when one is due.
+ *
+ * @param server  The room
+ * @param dt      Step length in seconds
+ */
+void game_server_tick(GameServer* server, float dt);
+
+#endif // GAME_SERVER_H
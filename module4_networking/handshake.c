@@ -0,0 +1,166 @@
+/**
+ * handshake.c - Non-Blocking MSG_CONNECT Reader
+ *
+ * See handshake.h for why the handshake can't block.
+ *
+ * The table is small (HANDSHAKE_MAX_PENDING), so the deadline sweep is
+ * a plain scan over it; it only runs when something is pending.
+ */
+
+#include "handshake.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+
+/**
+ * handshake_table_init - All slots free
+ */
+int handshake_table_init(HandshakeTable* table, int capacity) {
+    memset(table, 0, sizeof(HandshakeTable));
+    table->slots = calloc((size_t)capacity, sizeof(Handshake));
+    table->free_slots = malloc((size_t)capacity * sizeof(int));
+    if (table->slots == NULL || table->free_slots == NULL) {
+        free(table->slots);
+        free(table->free_slots);
+        return -1;
+    }
+
+    // Hand out slot 0 first
+    for (int i = 0; i < capacity; i++) {
+        table->free_slots[i] = capacity - 1 - i;
+    }
+    table->free_count = capacity;
+    table->capacity = capacity;
+    return 0;
+}
+
+/**
+ * handshake_table_free - Close whoever is still pending
+ */
+void handshake_table_free(HandshakeTable* table, NetReactor* reactor) {
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->slots[i].state != HANDSHAKE_FREE) {
+            handshake_end(table, reactor, &table->slots[i], 1);
+        }
+    }
+    free(table->slots);
+    free(table->free_slots);
+    memset(table, 0, sizeof(HandshakeTable));
+}
+
+/**
+ * handshake_begin - Pop a free slot, watch the socket
+ */
+Handshake* handshake_begin(HandshakeTable* table, NetReactor* reactor, Socket socket,
+                           const struct sockaddr_in* addr, uint64_t now_ms) {
+    if (table->free_count == 0) return NULL;
+
+    Handshake* handshake = &table->slots[table->free_slots[table->free_count - 1]];
+    if (net_reactor_add(reactor, socket, NET_EVENT_READ, handshake) != 0) return NULL;
+    table->free_count--;
+
+    memset(handshake, 0, sizeof(Handshake));
+    handshake->state = HANDSHAKE_HEADER;
+    handshake->socket = socket;
+    handshake->addr = *addr;
+    handshake->deadline_ms = now_ms + HANDSHAKE_TIMEOUT_MS;
+    return handshake;
+}
+
+/**
+ * handshake_fill - recv() up to 'length' bytes of a stage into 'target'
+ *
+ * @return  1 when the stage is complete, 0 if not yet, -1 if the peer
+ *          closed or the socket failed
+ */
+static int handshake_fill(Handshake* handshake, void* target, int length) {
+    while (handshake->received < length) {
+        int n = recv(handshake->socket, (uint8_t*)target + handshake->received,
+                     length - handshake->received, MSG_DONTWAIT);
+        if (n > 0) {
+            handshake->received += n;
+            continue;
+        }
+        if (n == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * handshake_read - Header stage, then payload stage
+ *
+ * Both stages can complete in one call when the whole message is
+ * already waiting (the usual case).
+ */
+int handshake_read(Handshake* handshake) {
+    char addr_str[32];
+
+    if (handshake->state == HANDSHAKE_HEADER) {
+        int result = handshake_fill(handshake, &handshake->header, sizeof(MessageHeader));
+        if (result <= 0) return result;
+
+        if (handshake->header.type != MSG_CONNECT ||
+            handshake->header.length != sizeof(ConnectMsg)) {
+            net_addr_to_string(&handshake->addr, addr_str, sizeof(addr_str));
+            LOG_WARN("Expected MSG_CONNECT, got type %d (%d bytes) from %s",
+                     handshake->header.type, handshake->header.length, addr_str);
+            return -1;
+        }
+        handshake->state = HANDSHAKE_PAYLOAD;
+        handshake->received = 0;
+    }
+
+    return handshake_fill(handshake, &handshake->connect, sizeof(ConnectMsg));
+}
+
+/**
+ * handshake_end - Unwatch, maybe close, push the slot back
+ */
+void handshake_end(HandshakeTable* table, NetReactor* reactor, Handshake* handshake,
+                   int close_socket) {
+    net_reactor_remove(reactor, handshake->socket);
+    if (close_socket) net_close(handshake->socket);
+    handshake->state = HANDSHAKE_FREE;
+    handshake->socket = INVALID_SOCKET;
+    table->free_slots[table->free_count++] = (int)(handshake - table->slots);
+}
+
+/**
+ * handshake_expire - Scan for passed deadlines
+ */
+int handshake_expire(HandshakeTable* table, NetReactor* reactor, uint64_t now_ms) {
+    int expired = 0;
+    for (int i = 0; i < table->capacity && table->free_count < table->capacity; i++) {
+        Handshake* handshake = &table->slots[i];
+        if (handshake->state == HANDSHAKE_FREE || now_ms < handshake->deadline_ms) continue;
+
+        char addr_str[32];
+        net_addr_to_string(&handshake->addr, addr_str, sizeof(addr_str));
+        LOG_WARN("Handshake from %s timed out", addr_str);
+        handshake_end(table, reactor, handshake, 1);
+        expired++;
+    }
+    return expired;
+}
+
+/**
+ * handshake_timeout_ms - Nearest deadline
+ */
+int handshake_timeout_ms(const HandshakeTable* table, uint64_t now_ms) {
+    if (table->free_count == table->capacity) return -1;
+
+    uint64_t nearest = UINT64_MAX;
+    for (int i = 0; i < table->capacity; i++) {
+        const Handshake* handshake = &table->slots[i];
+        if (handshake->state != HANDSHAKE_FREE && handshake->deadline_ms < nearest) {
+            nearest = handshake->deadline_ms;
+        }
+    }
+    return (nearest <= now_ms) ? 0 : (int)(nearest - now_ms);
+}
@@ -0,0 +1,165 @@
+/**
+ * handshake.h - Connections That Haven't Said MSG_CONNECT Yet
+ *
+ * CONCEPT: Never Wait for a Stranger
+ * ==================================
+ * A fresh TCP connection owes us one message: MessageHeader + ConnectMsg
+ * (20 bytes). Reading it with a blocking net_recv_all() right after
+ * accept() means trusting the peer to actually send it:
+ *
+ *     accept() ──▶ net_recv_all() ...waits...      (peer sends nothing)
+ *                        │
+ *                        └── every other join, every metrics scrape
+ *                            and every UDP connect waits with it
+ *
+ * One `nc server 8080` that never types anything froze the front door.
+ * A few hundred of them (a connect flood) did the same with style.
+ *
+ * CONCEPT: A Table of Half-Open Handshakes
+ * ========================================
+ * Instead, an accepted socket goes into a fixed-size HANDSHAKE TABLE and
+ * into the main thread's reactor. Each entry remembers how far its
+ * message has come:
+ *
+ *     HANDSHAKE_HEADER ──(3 header bytes, type MSG_CONNECT)──▶
+ *     HANDSHAKE_PAYLOAD ──(sizeof(ConnectMsg) bytes)──▶ done: route it
+ *            │                        │
+ *            └─── deadline passed, peer hung up, wrong message ──▶ closed
+ *
+ * Every readiness event reads only what the CURRENT stage still needs
+ * (never past the ConnectMsg - whatever the client sends next belongs
+ * to the room), so a client may dribble its 20 bytes one at a time.
+ * Only a complete, well-formed ConnectMsg is handed to the room
+ * manager; nothing reaches a room's tick thread before that.
+ *
+ * The costs are bounded: at most HANDSHAKE_MAX_PENDING sockets are
+ * half-open (the table is allocated once; a connection beyond that is
+ * closed immediately), and each gets HANDSHAKE_TIMEOUT_MS to finish.
+ */
+
+#ifndef HANDSHAKE_H
+#define HANDSHAKE_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+#include "network.h"
+
+// Connections that may be mid-handshake at once
+#define HANDSHAKE_MAX_PENDING 256
+
+// Time a connection has to deliver its MSG_CONNECT
+#define HANDSHAKE_TIMEOUT_MS 3000
+
+/**
+ * HandshakeState - What a pending connection is waiting for
+ */
+typedef enum {
+    HANDSHAKE_FREE = 0,     // Table slot unused
+    HANDSHAKE_HEADER,       // The MessageHeader
+    HANDSHAKE_PAYLOAD       // The ConnectMsg (header already checked)
+} HandshakeState;
+
+/**
+ * Handshake - One accepted socket and its partial MSG_CONNECT
+ */
+typedef struct {
+    HandshakeState state;
+    Socket socket;
+    struct sockaddr_in addr;
+    uint64_t deadline_ms;   // net_time_ms() by which it must be done
+    int received;           // Bytes of the current stage read so far
+    MessageHeader header;
+    ConnectMsg connect;     // Complete once handshake_read() returns 1
+} Handshake;
+
+/**
+ * HandshakeTable - Every pending handshake, plus a stack of free slots
+ */
+typedef struct {
+    Handshake* slots;
+    int* free_slots;        // Indices of unused slots (a stack)
+    int free_count;
+    int capacity;
+} HandshakeTable;
+
+/**
+ * handshake_table_init - Allocate the table
+ *
+ * @param table     Table to initialize
+ * @param capacity  Most pending handshakes
+ * @return          0 on success, -1 if out of memory
+ */
+int handshake_table_init(HandshakeTable* table, int capacity);
+
+/**
+ * handshake_table_free - Close every pending socket and free the table
+ *
+ * @param table    The table
+ * @param reactor  Reactor the sockets are registered with
+ */
+void handshake_table_free(HandshakeTable* table, NetReactor* reactor);
+
+/**
+ * handshake_begin - Track a freshly accepted socket
+ *
+ * Registers the socket with 'reactor' for NET_EVENT_READ, with the
+ * returned entry as user_data.
+ *
+ * @param table    The table
+ * @param reactor  Reactor to watch the socket in
+ * @param socket   Accepted socket
+ * @param addr     Peer address
+ * @param now_ms   net_time_ms()
+ * @return         The entry, or NULL if the table is full (the caller
+ *                 still owns the socket)
+ */
+Handshake* handshake_begin(HandshakeTable* table, NetReactor* reactor, Socket socket,
+                           const struct sockaddr_in* addr, uint64_t now_ms);
+
+/**
+ * handshake_read - Read what the connection's current stage still needs
+ *
+ * Never blocks.
+ *
+ * @param handshake  Entry the reactor reported readable
+ * @return           1 when handshake->connect is complete, 0 if more
+ *                   bytes are needed, -1 if the connection closed or
+ *                   sent something other than a MSG_CONNECT
+ */
+int handshake_read(Handshake* handshake);
+
+/**
+ * handshake_end - Forget a handshake (done, failed or expired)
+ *
+ * Removes the socket from the reactor and frees the slot.
+ *
+ * @param table         The table
+ * @param reactor       Reactor the socket is registered with
+ * @param handshake     Entry to free
+ * @param close_socket  1 to close the socket, 0 if the caller takes it
+ */
+void handshake_end(HandshakeTable* table, NetReactor* reactor, Handshake* handshake,
+                   int close_socket);
+
+/**
+ * handshake_expire - Close every handshake past its deadline
+ *
+ * @param table    The table
+ * @param reactor  Reactor the sockets are registered with
+ * @param now_ms   net_time_ms()
+ * @return         Number of connections closed
+ */
+int handshake_expire(HandshakeTable* table, NetReactor* reactor, uint64_t now_ms);
+
+/**
+ * handshake_timeout_ms - How long the reactor may sleep
+ *
+ * @param table   The table
+ * @param now_ms  net_time_ms()
+ * @return        Milliseconds until the next deadline, or -1 if nothing
+ *                is pending (sleep until an event)
+ */
+int handshake_timeout_ms(const HandshakeTable* table, uint64_t now_ms);
+
+#endif // HANDSHAKE_H
@@ -0,0 +1,97 @@
+/**
+ * input_queue.c - Bounded MPSC Ring Implementation
+ *
+ * See input_queue.h for the per-cell sequence protocol.
+ */
+
+#include "input_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * input_queue_create - Cells numbered 0 .. capacity-1 (all free)
+ *
+ * The head and tail sit on their own cache lines, so the struct comes
+ * from aligned_alloc().
+ */
+InputQueue* input_queue_create(int capacity) {
+    uint32_t size = 2;
+    while (size < (uint32_t)capacity) size *= 2;
+
+    InputQueue* queue = aligned_alloc(64, (sizeof(InputQueue) + 63) & ~(size_t)63);
+    if (queue == NULL) return NULL;
+    memset(queue, 0, sizeof(InputQueue));
+
+    queue->cells = malloc(size * sizeof(InputCell));
+    if (queue->cells == NULL) {
+        free(queue);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->head, 0);
+    return queue;
+}
+
+/**
+ * input_queue_destroy - Free the cells and the queue
+ */
+void input_queue_destroy(InputQueue* queue) {
+    if (queue == NULL) return;
+    free(queue->cells);
+    free(queue);
+}
+
+/**
+ * input_queue_push - Claim a position with CAS, fill, publish
+ *
+ * The cell's sequence tells a producer where it stands:
+ *     == pos      free, try to claim it
+ *     <  pos      still holds the event of the previous lap: full
+ *     >  pos      another producer claimed pos first: reload head
+ */
+int input_queue_push(InputQueue* queue, const InputEvent* event) {
+    uint32_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    InputCell* cell;
+
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        uint32_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            // Lost the race: 'pos' now holds the current head
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    cell->event = *event;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * input_queue_pop - Take the cell at 'tail' once its producer is done
+ */
+int input_queue_pop(InputQueue* queue, InputEvent* event) {
+    uint32_t pos = queue->tail;
+    InputCell* cell = &queue->cells[pos & queue->mask];
+    uint32_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if (sequence != pos + 1) return 0;
+
+    *event = cell->event;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    queue->tail = pos + 1;
+    return 1;
+}
@@ -0,0 +1,109 @@
+/**
+ * input_queue.h - Decoded Inputs From Many I/O Threads to One Worker
+ *
+ * CONCEPT: Parse Off the Tick Thread
+ * ==================================
+ * With --io-threads the simulation workers stop reading sockets. A few
+ * NETWORK I/O THREADS (the pipeline's output stages, see pipeline.h)
+ * own disjoint sets of player sockets: they recv(), cut frames, decode
+ * MSG_PLAYER_INPUT, answer MSG_PING on the spot, and hand the worker
+ * nothing but small, fixed-size InputEvents:
+ *
+ *     I/O thread 0 ──┐
+ *     I/O thread 1 ──┼──▶ [ InputQueue of worker 0 ] ──▶ tick start: apply
+ *     I/O thread 2 ──┘
+ *
+ * The rooms of one worker are spread over several I/O threads, so each
+ * worker's queue has MANY PRODUCERS and ONE CONSUMER.
+ *
+ * CONCEPT: A Bounded Lock-Free MPSC Ring
+ * ======================================
+ * Every cell carries a sequence number that says whose turn it is
+ * (after D. Vyukov's bounded queue):
+ *
+ *     cell.sequence == pos        free: the producer that claims 'pos'
+ *                                 may fill it
+ *     cell.sequence == pos + 1    full: the consumer may take it
+ *
+ * A producer claims a position with one compare-and-swap on 'head'
+ * (the only contended word), writes the event, then release-stores the
+ * cell's sequence. The consumer needs no atomic read-modify-write at
+ * all: it checks the sequence of the cell at 'tail', copies the event
+ * out and hands the cell back for the next lap (sequence = pos +
+ * capacity). A slow producer never blocks the others, only delays the
+ * consumer at its own cell - and only until it has finished writing.
+ *
+ * A full queue rejects the push; the I/O thread counts it and drops the
+ * input (the next one carries the same keys anyway).
+ */
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "protocol.h"
+
+/**
+ * InputEvent - One decoded MSG_PLAYER_INPUT, addressed to a player
+ */
+typedef struct {
+    uint32_t session;       // Player's session (stale events are ignored)
+    uint16_t room;          // Index in the worker's room list
+    uint16_t slot;          // Player slot
+    PlayerInputMsg input;
+} InputEvent;
+
+/**
+ * InputCell - An event and whose turn it is
+ */
+typedef struct {
+    _Atomic uint32_t sequence;
+    InputEvent event;
+} InputCell;
+
+/**
+ * InputQueue - Bounded many-producer, single-consumer ring
+ */
+typedef struct {
+    InputCell* cells;
+    uint32_t mask;                          // Capacity - 1 (a power of two)
+    _Alignas(64) _Atomic uint32_t head;     // Next position to claim (producers)
+    _Alignas(64) uint32_t tail;             // Next position to take (consumer only)
+} InputQueue;
+
+/**
+ * input_queue_create - Allocate a queue
+ *
+ * @param capacity  Events it can hold (rounded up to a power of two)
+ * @return          The queue, or NULL if out of memory
+ */
+InputQueue* input_queue_create(int capacity);
+
+/**
+ * input_queue_destroy - Free a queue
+ *
+ * @param queue  The queue (NULL is ignored)
+ */
+void input_queue_destroy(InputQueue* queue);
+
+/**
+ * input_queue_push - Add an event (any thread)
+ *
+ * @param queue  The queue
+ * @param event  Event to copy in
+ * @return       0 on success, -1 if the queue is full
+ */
+int input_queue_push(InputQueue* queue, const InputEvent* event);
+
+/**
+ * input_queue_pop - Take the oldest event (the consumer thread only)
+ *
+ * @param queue  The queue
+ * @param event  Receives the event
+ * @return       1 if an event was taken, 0 if the queue is empty
+ */
+int input_queue_pop(InputQueue* queue, InputEvent* event);
+
+#endif // INPUT_QUEUE_H
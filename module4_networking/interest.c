@@ -0,0 +1,199 @@
+/**
+ * interest.c - Per-Player Bullet Selection
+ *
+ * See interest.h for the ranking.
+ */
+
+#include "interest.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Candidate - A bullet and its effective distance to the viewer
+ */
+typedef struct InterestCandidate {
+    float score;
+    uint16_t id;
+} Candidate;
+
+/**
+ * closest_approach - Smallest distance within INTEREST_HORIZON
+ *
+ * Relative to the viewer, the bullet moves in a straight line
+ * p(t) = rel + v * t; the closest point is at t = -(rel · v) / |v|²,
+ * clamped to [0, horizon].
+ */
+static float closest_approach(float rx, float ry, float vx, float vy) {
+    float speed_sq = vx * vx + vy * vy;
+    float t = 0.0f;
+    if (speed_sq > 0.0f) {
+        t = -(rx * vx + ry * vy) / speed_sq;
+        if (t < 0.0f) t = 0.0f;
+        if (t > INTEREST_HORIZON) t = INTEREST_HORIZON;
+    }
+    float dx = rx + vx * t;
+    float dy = ry + vy * t;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+/**
+ * select_smallest - Partition so the 'k' smallest scores come first
+ *
+ * Quickselect: like quicksort, but only recurse into the side that
+ * contains position k. O(n) on average; order within each side is
+ * irrelevant to us.
+ */
+static void select_smallest(Candidate* items, int count, int k) {
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        float pivot = items[(lo + hi) / 2].score;
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (items[i].score < pivot) i++;
+            while (items[j].score > pivot) j--;
+            if (i <= j) {
+                Candidate tmp = items[i];
+                items[i] = items[j];
+                items[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            break;  // Position k holds a pivot-equal element: done
+        }
+    }
+}
+
+/**
+ * interest_init - Candidates and both bitsets in one allocation
+ */
+int interest_init(InterestScratch* scratch, int max_bullets) {
+    memset(scratch, 0, sizeof(InterestScratch));
+    scratch->words = (max_bullets + 63) / 64;
+
+    size_t bits_size = (size_t)scratch->words * sizeof(uint64_t);
+    uint8_t* memory = malloc(2 * bits_size + (size_t)max_bullets * sizeof(Candidate));
+    if (memory == NULL) return -1;
+
+    scratch->memory = memory;
+    scratch->marks = (uint64_t*)memory;
+    scratch->selected = (uint64_t*)(memory + bits_size);
+    scratch->candidates = (Candidate*)(memory + 2 * bits_size);
+    memset(scratch->marks, 0, 2 * bits_size);
+    return 0;
+}
+
+/**
+ * interest_free - Release the one allocation
+ */
+void interest_free(InterestScratch* scratch) {
+    free(scratch->memory);
+    memset(scratch, 0, sizeof(InterestScratch));
+}
+
+/**
+ * interest_begin - Clear the union
+ */
+void interest_begin(InterestScratch* scratch) {
+    memset(scratch->selected, 0, (size_t)scratch->words * sizeof(uint64_t));
+}
+
+/**
+ * interest_select - Rank every live bullet, keep the best 'budget'
+ *
+ * Last tick's list is spread into a bitset first, so "was it sent?" is
+ * one bit test per bullet; the winners come back out of a bitset too,
+ * which sorts them by id for free.
+ */
+int interest_select(InterestScratch* scratch, const BulletStore* bullets,
+                    const PlayerState* viewer, const SnapshotView* previous,
+                    SnapshotView* set, int budget) {
+    Candidate* candidates = scratch->candidates;
+    uint64_t* marks = scratch->marks;
+    int count = 0;
+
+    if (previous != NULL) {
+        for (int i = 0; i < previous->count; i++) {
+            uint16_t id = previous->ids[i];
+            marks[id / 64] |= (uint64_t)1 << (id % 64);
+        }
+    }
+
+    // Dense walk: indices 0 .. count-1 are exactly the live bullets
+    for (int i = 0; i < bullets->count; i++) {
+        uint16_t id = bullets->id[i];
+
+        // Bullet relative to the player (position and velocity)
+        float rx = bullets->x[i] - viewer->x;
+        float ry = bullets->y[i] - viewer->y;
+        float score = closest_approach(rx, ry, bullets->vx[i] - viewer->vx,
+                                       bullets->vy[i] - viewer->vy);
+        if (score > INTEREST_RADIUS) continue;
+
+        if (bullets->owner[i] == viewer->player_id) score *= INTEREST_OWN_WEIGHT;
+        if ((marks[id / 64] >> (id % 64)) & 1) score *= INTEREST_KEEP_WEIGHT;
+
+        candidates[count].score = score;
+        candidates[count].id = id;
+        count++;
+    }
+
+    // Marks are reused for the winners: clear just the words we set
+    if (previous != NULL) {
+        for (int i = 0; i < previous->count; i++) marks[previous->ids[i] / 64] = 0;
+    }
+
+    // Under budget: everything goes. Over: only the best 'budget'.
+    if (count > budget) {
+        select_smallest(candidates, count, budget);
+        count = budget;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint16_t id = candidates[i].id;
+        marks[id / 64] |= (uint64_t)1 << (id % 64);
+    }
+
+    // Read the winners back in id order, clearing as we go
+    set->count = 0;
+    for (int w = 0; w < scratch->words && set->count < count; w++) {
+        uint64_t bits = marks[w];
+        if (bits == 0) continue;
+        scratch->selected[w] |= bits;
+        marks[w] = 0;
+        while (bits != 0) {
+            set->ids[set->count++] = (uint16_t)(w * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
+
+/**
+ * interest_add_bullets - Walk the set bits of the union
+ */
+void interest_add_bullets(const InterestScratch* scratch, const BulletStore* bullets,
+                          SnapshotBuilder* snap) {
+    for (int w = 0; w < scratch->words; w++) {
+        for (uint64_t bits = scratch->selected[w]; bits != 0; bits &= bits - 1) {
+            uint16_t id = (uint16_t)(w * 64 + __builtin_ctzll(bits));
+            uint32_t index = bullets->index_of[id];
+
+            BulletState* bs = snapshot_add_bullet(snap, id);
+            if (bs == NULL) return;
+            bs->owner_id = bullets->owner[index];
+            bs->x = bullets->x[index];
+            bs->y = bullets->y[index];
+            bs->vx = bullets->vx[index];
+            bs->vy = bullets->vy[index];
+            bs->weapon_type = bullets->weapon[index];
+        }
+    }
+}
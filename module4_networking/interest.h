@@ -0,0 +1,117 @@
+/**
+ * interest.h - Which Bullets Does Each Player Need to Know About?
+ *
+ * CONCEPT: Area of Interest
+ * =========================
+ * A room tracks thousands of bullets, but a client only gets its
+ * sync budget (--sync-bullets) per snapshot. Sending "the first N in
+ * array order" means that in a big fight WHICH bullets a player sees
+ * depends on free-slot luck: projectiles pop in and out at random.
+ *
+ * Instead, every tick each player gets their own INTEREST SET - the
+ * bullets that matter most to THEM, ranked by one number, the
+ * "effective distance":
+ *
+ *     incoming ──▶  ·  ·  ·  ·  ·  ·  ·  ✈       distance at the closest
+ *                                                 approach within the
+ *                                                 next INTEREST_HORIZON s
+ *
+ *     near     ──▶        ·  ✈                    distance right now
+ *
+ *     own      ──▶  ✈  ·  ·  ·  ·  ·  ·  ·  ·  ·  × INTEREST_OWN_WEIGHT
+ *
+ *     sent last tick                              × INTEREST_KEEP_WEIGHT
+ *
+ * The smallest effective distances win, up to the budget. The last
+ * factor is HYSTERESIS: a bullet the client already has needs a clearly
+ * better rival to be replaced, so two equally distant bullets don't
+ * swap in and out every tick.
+ *
+ * Sets come out as sorted lists of stable bullet ids (see
+ * bullet_store.h), the form snapshot.h stores them in.
+ */
+
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+#include "bullet_store.h"
+
+// Ranking (see above)
+#define INTEREST_HORIZON     1.0f       // Seconds ahead to look for incoming bullets
+#define INTEREST_RADIUS      1000.0f    // Farther than this is never sent (whole screen)
+#define INTEREST_OWN_WEIGHT  0.25f      // Own bullets rank as if 4x closer
+#define INTEREST_KEEP_WEIGHT 0.75f      // Bullets sent last tick rank as if closer
+
+/**
+ * InterestScratch - Per-room working memory for the selection
+ *
+ * 'marks' and 'selected' are bitsets over bullet ids: bit (id % 64) of
+ * word (id / 64). 'selected' collects the union of every set chosen
+ * since interest_begin() - the bullets the snapshot frame must hold.
+ */
+typedef struct {
+    struct InterestCandidate* candidates;   // One per live bullet
+    uint64_t* marks;            // Scratch: last tick's set of one viewer
+    uint64_t* selected;         // Union of this tick's sets
+    int words;                  // Words per bitset
+    void* memory;               // The one allocation
+} InterestScratch;
+
+/**
+ * interest_init - Allocate the scratch for a room
+ *
+ * @param scratch      Scratch to initialize
+ * @param max_bullets  Most bullets in the room (ids are below this)
+ * @return             0 on success, -1 if out of memory
+ */
+int interest_init(InterestScratch* scratch, int max_bullets);
+
+/**
+ * interest_free - Release the scratch
+ *
+ * @param scratch  Scratch to free
+ */
+void interest_free(InterestScratch* scratch);
+
+/**
+ * interest_begin - Start a tick (empty the union)
+ *
+ * @param scratch  The scratch
+ */
+void interest_begin(InterestScratch* scratch);
+
+/**
+ * interest_select - Build one player's interest set
+ *
+ * Reads only the bullets and the viewer's state, so it works on the
+ * live room as well as on a copy of it (see pipeline.h).
+ *
+ * @param scratch   Room's scratch (the set is added to its union)
+ * @param bullets   The room's bullets
+ * @param viewer    The player the set is for (player_id = its slot)
+ * @param previous  That player's set from last tick (NULL = none)
+ * @param set       Receives the set, ids ascending
+ * @param budget    Most bullets to select
+ * @return          Number of bullets selected
+ */
+int interest_select(InterestScratch* scratch, const BulletStore* bullets,
+                    const PlayerState* viewer, const SnapshotView* previous,
+                    SnapshotView* set, int budget);
+
+/**
+ * interest_add_bullets - Put the union of this tick's sets into the snapshot
+ *
+ * Call after every interest_select() and after the players were added:
+ * the bullets go in ascending id order.
+ *
+ * @param scratch  The scratch
+ * @param bullets  The bullets the sets were selected from
+ * @param snap     Snapshot being built
+ */
+void interest_add_bullets(const InterestScratch* scratch, const BulletStore* bullets,
+                          SnapshotBuilder* snap);
+
+#endif // INTEREST_H
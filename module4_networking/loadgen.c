@@ -0,0 +1,739 @@
+/**
+ * loadgen.c - Void Drifter Load Generator
+ *
+ * Plays N bots against a server from ONE process and measures how the
+ * server copes:
+ *
+ *     1. Opens N connections and does the MSG_CONNECT handshake on each
+ *     2. Sends PlayerInputMsg at a fixed rate (random or scripted input)
+ *     3. Decodes every MSG_GAME_STATE / MSG_STATE_FRAGMENT, exactly like
+ *        a real client (so deltas must keep being acked correctly)
+ *     4. Reports connect rate, snapshot rate, bytes/sec and latency
+ *
+ * CONCEPT: One Reactor, Many Connections
+ * ======================================
+ * A thread per bot would measure the load generator's scheduler as much
+ * as the server. Instead every socket goes into one NetReactor (epoll on
+ * Linux) - the same structure the server uses - and a single loop does:
+ *
+ *     wait ≤ 1 ms for readable sockets  ──▶  decode what arrived
+ *     every bot whose next input is due ──▶  send it
+ *     once a second                     ──▶  print a report line
+ *
+ * Each bot's first input is offset by (i / N) of the send interval, so
+ * N bots at 60 Hz send a steady stream rather than N inputs at once.
+ *
+ * CONCEPT: Input-to-Ack Latency
+ * =============================
+ * Every snapshot carries your_sequence: the newest of OUR inputs the
+ * server had simulated when it built the snapshot. We remember when
+ * each sequence was sent, so when your_sequence moves from 41 to 44:
+ *
+ *     sent[42], sent[43], sent[44]  ──▶  now - sent[k]  = 3 samples
+ *
+ * That is the full round trip a player feels: our send, the server's
+ * receive path, waiting for the tick, simulation, snapshot encoding and
+ * the send back. It includes up to one tick of waiting by design - at
+ * 60 Hz expect a floor of a few milliseconds even on localhost.
+ *
+ * CONCEPT: Percentiles, Not Averages
+ * ==================================
+ * An average hides the spikes players notice. p99 = "1 input in 100
+ * waited at least this long"; p999 is 1 in 1000. Samples go into a
+ * log-linear histogram - 16 buckets per power of two - so memory is
+ * fixed and every reported value is within ~6% of the truth:
+ *
+ *     µs:  0..15 exact │ 16..31 by 1 │ 32..63 by 2 │ 64..127 by 4 │ ...
+ *
+ * NOTE: connect() itself is the blocking net_link_open(); --ramp spreads
+ * the opens out. Everything after it (handshake included) is driven by
+ * the reactor.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "protocol.h"
+#include "network.h"
+#include "state_decoder.h"
+#include "wire.h"
+
+// Receive memory per bot: TCP needs room for the largest frame, UDP for
+// one datagram
+#define LOADGEN_TCP_RECV_SIZE (sizeof(MessageHeader) + UINT16_MAX)
+#define LOADGEN_UDP_RECV_SIZE NET_UDP_MAX_PACKET
+
+// Give up on a handshake after this long
+#define LOADGEN_CONNECT_TIMEOUT_MS 5000
+
+// Send times remembered per bot (inputs older than this aren't sampled)
+#define LOADGEN_SEQ_HISTORY 256
+
+// Histogram: 16 sub-buckets per power of two of microseconds
+#define HIST_SUB_BITS 4
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (HIST_SUB_COUNT * 30)
+
+// Events handled per reactor wakeup
+#define LOADGEN_MAX_EVENTS 256
+
+// Global running flag
+static volatile int g_running = 1;
+
+/**
+ * InputMode - Where a bot's input comes from
+ */
+typedef enum {
+    INPUT_MODE_RANDOM,  // New random flags every ~250 ms
+    INPUT_MODE_SWEEP    // Scripted: up, right, down, left, firing on the way
+} InputMode;
+
+/**
+ * BotPhase - Where a connection is in its life
+ */
+typedef enum {
+    BOT_IDLE,           // Not opened yet
+    BOT_CONNECTING,     // MSG_CONNECT sent, waiting for the ack
+    BOT_PLAYING,        // Sending input, receiving state
+    BOT_DONE            // Rejected, failed or lost (socket closed)
+} BotPhase;
+
+/**
+ * Histogram - Log-linear latency histogram in microseconds
+ */
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+/**
+ * Bot - One simulated player
+ */
+typedef struct {
+    BotPhase phase;
+    NetLink link;
+    uint8_t* recv_storage;
+    StateDecoder decoder;
+    uint16_t player_id;
+
+    uint64_t connect_start_us;      // When net_link_open() was called
+    uint64_t next_input_us;         // When the next input is due
+    uint32_t sequence;              // Last input sent
+    uint32_t acked_sequence;        // Newest your_sequence seen
+    uint64_t sent_us[LOADGEN_SEQ_HISTORY];  // Send time of sequence % history
+
+    uint8_t input_flags;
+    uint32_t rng;                   // Per-bot xorshift state
+} Bot;
+
+/**
+ * Stats - Counters since start (the report line shows differences)
+ */
+typedef struct {
+    int connected;
+    int rejected;
+    int failed;                     // Could not connect / timed out
+    int lost;                       // Dropped after connecting
+    uint64_t snapshots;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t inputs;
+    uint64_t first_open_us;
+    uint64_t last_connect_us;
+} Stats;
+
+/**
+ * LoadGen - Settings plus every bot
+ */
+typedef struct {
+    const char* host;
+    uint16_t port;
+    NetTransport transport;
+    uint8_t version;
+    int bot_count;
+    int rate_hz;
+    int duration_s;
+    int ramp_per_s;                 // Opens per second (0 = all at once)
+    InputMode input_mode;
+    uint32_t seed;
+
+    Bot* bots;
+    int opened;                     // Bots 0 .. opened-1 have been started
+    NetReactor* reactor;
+
+    Stats stats;
+    Histogram latency;              // Whole run
+    Histogram interval;             // Since the last report line
+} LoadGen;
+
+/**
+ * signal_handler - Handle Ctrl+C
+ */
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+/**
+ * time_us - Monotonic microseconds
+ */
+static uint64_t time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// ============================================================================
+// HISTOGRAM
+// ============================================================================
+
+/**
+ * hist_bucket - Bucket index of a value
+ *
+ * Values below 16 get their own bucket; above that, the top bit picks a
+ * group and the next 4 bits pick one of its 16 buckets.
+ */
+static int hist_bucket(uint64_t value) {
+    if (value < HIST_SUB_COUNT) return (int)value;
+
+    int top = 63 - __builtin_clzll(value);
+    int shift = top - HIST_SUB_BITS;
+    int index = (shift + 1) * HIST_SUB_COUNT + (int)((value >> shift) - HIST_SUB_COUNT);
+    return (index < HIST_BUCKETS) ? index : HIST_BUCKETS - 1;
+}
+
+/**
+ * hist_value - Middle of the range of values that land in a bucket
+ */
+static uint64_t hist_value(int bucket) {
+    if (bucket < HIST_SUB_COUNT) return (uint64_t)bucket;
+
+    int shift = bucket / HIST_SUB_COUNT - 1;
+    uint64_t low = (uint64_t)(HIST_SUB_COUNT + bucket % HIST_SUB_COUNT) << shift;
+    return low + ((1u << shift) >> 1);
+}
+
+/**
+ * hist_record - Count one sample
+ */
+static void hist_record(Histogram* hist, uint64_t value) {
+    hist->counts[hist_bucket(value)]++;
+    hist->total++;
+    if (value > hist->max) hist->max = value;
+}
+
+/**
+ * hist_percentile - Value below which 'fraction' of the samples fall
+ *
+ * @return  Microseconds (0 if there are no samples)
+ */
+static uint64_t hist_percentile(const Histogram* hist, double fraction) {
+    if (hist->total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(fraction * (double)hist->total + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist->counts[b];
+        if (seen >= rank) {
+            uint64_t value = hist_value(b);
+            return (value < hist->max) ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+// ============================================================================
+// BOTS
+// ============================================================================
+
+/**
+ * bot_random - xorshift32: cheap, and reproducible from --seed
+ */
+static uint32_t bot_random(Bot* bot) {
+    uint32_t x = bot->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bot->rng = x;
+    return x;
+}
+
+/**
+ * bot_next_flags - Pick the input for the next message
+ *
+ * Random: hold a random direction (and sometimes fire) for about 250 ms.
+ * Sweep:  a fixed loop, one direction per second, firing every other
+ *         half second - every bot runs it, shifted by its seed.
+ */
+static uint8_t bot_next_flags(LoadGen* gen, Bot* bot) {
+    static const uint8_t directions[4] = { INPUT_UP, INPUT_RIGHT, INPUT_DOWN, INPUT_LEFT };
+
+    if (gen->input_mode == INPUT_MODE_SWEEP) {
+        uint32_t step = bot->sequence + bot->rng;
+        uint32_t second = step / (uint32_t)gen->rate_hz;
+        uint8_t flags = directions[second % 4];
+        if ((step * 2 / (uint32_t)gen->rate_hz) % 2 == 0) flags |= INPUT_FIRE;
+        return flags;
+    }
+
+    int hold = gen->rate_hz / 4;
+    if (hold < 1) hold = 1;
+    if (bot->sequence % (uint32_t)hold == 0) {
+        uint32_t r = bot_random(bot);
+        uint8_t flags = directions[r % 4];
+        if ((r >> 8) % 3 == 0) flags |= directions[(r >> 4) % 4];
+        if ((r >> 12) % 2 == 0) flags |= INPUT_FIRE;
+        bot->input_flags = flags;
+    }
+    return bot->input_flags;
+}
+
+/**
+ * bot_close - Stop watching and close a bot's connection
+ */
+static void bot_close(LoadGen* gen, Bot* bot) {
+    if (bot->link.socket != INVALID_SOCKET) {
+        net_reactor_remove(gen->reactor, bot->link.socket);
+        net_link_close(&bot->link);
+    }
+    bot->phase = BOT_DONE;
+}
+
+/**
+ * bot_open - Connect and send MSG_CONNECT
+ *
+ * The ack is handled by bot_handle_frame() when it arrives.
+ */
+static void bot_open(LoadGen* gen, Bot* bot, int index) {
+    uint64_t now = time_us();
+    bot->connect_start_us = now;
+    if (gen->stats.first_open_us == 0) gen->stats.first_open_us = now;
+
+    int capacity = (gen->transport == NET_TRANSPORT_TCP) ? (int)LOADGEN_TCP_RECV_SIZE
+                                                          : LOADGEN_UDP_RECV_SIZE;
+    bot->recv_storage = malloc((size_t)capacity);
+    if (bot->recv_storage == NULL ||
+        net_link_open(&bot->link, gen->transport, gen->host, gen->port,
+                      bot->recv_storage, capacity) != 0) {
+        bot->phase = BOT_DONE;
+        gen->stats.failed++;
+        return;
+    }
+
+    ConnectMsg connect_msg = { .version = gen->version };
+    snprintf(connect_msg.name, sizeof(connect_msg.name), "bot%d", index);
+
+    if (net_reactor_add(gen->reactor, bot->link.socket, NET_EVENT_READ, bot) != 0 ||
+        net_link_send(&bot->link, MSG_CONNECT, &connect_msg, sizeof(connect_msg), 1) < 0) {
+        bot_close(gen, bot);
+        gen->stats.failed++;
+        return;
+    }
+    gen->stats.bytes_out += sizeof(MessageHeader) + sizeof(connect_msg);
+    bot->phase = BOT_CONNECTING;
+}
+
+/**
+ * bot_handle_ack - MSG_CONNECT_ACK: size the decoder, start sending
+ */
+static void bot_handle_ack(LoadGen* gen, Bot* bot, int index, const NetFrame* frame) {
+    ConnectAckMsg ack;
+    if (frame->header.length < sizeof(ConnectAckMsg)) {
+        bot_close(gen, bot);
+        gen->stats.failed++;
+        return;
+    }
+    memcpy(&ack, frame->payload, sizeof(ack));
+
+    if (!ack.success) {
+        bot_close(gen, bot);
+        gen->stats.rejected++;
+        return;
+    }
+    if (state_decoder_init(&bot->decoder, gen->version, ack.max_players, ack.max_bullets) != 0) {
+        bot_close(gen, bot);
+        gen->stats.failed++;
+        return;
+    }
+
+    uint64_t now = time_us();
+    uint64_t interval = 1000000u / (uint64_t)gen->rate_hz;
+    bot->player_id = ack.player_id;
+    bot->phase = BOT_PLAYING;
+    bot->next_input_us = now + interval * (uint64_t)index / (uint64_t)gen->bot_count;
+    gen->stats.connected++;
+    gen->stats.last_connect_us = now;
+}
+
+/**
+ * bot_handle_state - Decode a snapshot and sample newly acked inputs
+ */
+static void bot_handle_state(LoadGen* gen, Bot* bot, const NetFrame* frame) {
+    const DecodedState* state;
+    if (frame->header.type == MSG_STATE_FRAGMENT) {
+        state = state_decoder_apply_fragment(&bot->decoder, frame->payload,
+                                             frame->header.length);
+    } else {
+        state = state_decoder_apply(&bot->decoder, frame->payload, frame->header.length);
+    }
+    if (state == NULL) return;
+
+    gen->stats.snapshots++;
+
+    uint32_t acked = bot->decoder.your_sequence;
+    if (acked <= bot->acked_sequence || acked > bot->sequence) return;
+
+    // Inputs older than the history were overwritten: sample the rest
+    uint32_t first = bot->acked_sequence + 1;
+    if (acked - first >= LOADGEN_SEQ_HISTORY) first = acked - LOADGEN_SEQ_HISTORY + 1;
+
+    uint64_t now = time_us();
+    for (uint32_t seq = first; seq <= acked; seq++) {
+        uint64_t latency = now - bot->sent_us[seq % LOADGEN_SEQ_HISTORY];
+        hist_record(&gen->latency, latency);
+        hist_record(&gen->interval, latency);
+    }
+    bot->acked_sequence = acked;
+}
+
+/**
+ * bot_handle_frame - Route one received message
+ */
+static void bot_handle_frame(LoadGen* gen, Bot* bot, const NetFrame* frame) {
+    gen->stats.bytes_in += sizeof(MessageHeader) + frame->header.length;
+
+    if (bot->phase == BOT_CONNECTING) {
+        if (frame->header.type == MSG_CONNECT_ACK) {
+            bot_handle_ack(gen, bot, (int)(bot - gen->bots), frame);
+        }
+        return;
+    }
+
+    switch (frame->header.type) {
+        case MSG_GAME_STATE:
+        case MSG_STATE_FRAGMENT:
+            bot_handle_state(gen, bot, frame);
+            break;
+        case MSG_DISCONNECT:
+            bot_close(gen, bot);
+            gen->stats.lost++;
+            break;
+        default:
+            break;  // Pongs etc. aren't measured here
+    }
+}
+
+/**
+ * bot_drain - Handle everything the bot's link has received
+ *
+ * Over UDP this also drives MSG_CONNECT resends and the silence timeout,
+ * so connecting UDP bots are drained every loop, readable or not.
+ */
+static void bot_drain(LoadGen* gen, Bot* bot) {
+    NetFrame frame;
+    int result;
+    while (bot->phase == BOT_CONNECTING || bot->phase == BOT_PLAYING) {
+        result = net_link_poll(&bot->link, &frame);
+        if (result == 0) return;
+        if (result < 0) {
+            int was_playing = (bot->phase == BOT_PLAYING);
+            bot_close(gen, bot);
+            if (was_playing) gen->stats.lost++; else gen->stats.failed++;
+            return;
+        }
+        bot_handle_frame(gen, bot, &frame);
+    }
+}
+
+/**
+ * bot_send_input - Send the next PlayerInputMsg and remember when
+ */
+static void bot_send_input(LoadGen* gen, Bot* bot, uint64_t now) {
+    bot->sequence++;
+
+    PlayerInputMsg input = {
+        .player_id = bot->player_id,
+        .input_flags = bot_next_flags(gen, bot),
+        .weapon_type = WEAPON_TYPE_SPREAD,
+        .sequence = bot->sequence,
+        .ack_tick = state_decoder_ack(&bot->decoder)
+    };
+    uint8_t payload[WIRE_INPUT_MAX];
+    int length = wire_encode_input(&input, gen->version, payload);
+
+    bot->sent_us[bot->sequence % LOADGEN_SEQ_HISTORY] = now;
+    if (net_link_send(&bot->link, MSG_PLAYER_INPUT, payload, length, 0) < 0) {
+        bot_close(gen, bot);
+        gen->stats.lost++;
+        return;
+    }
+    gen->stats.inputs++;
+    gen->stats.bytes_out += sizeof(MessageHeader) + (uint64_t)length;
+}
+
+// ============================================================================
+// MAIN LOOP
+// ============================================================================
+
+/**
+ * loadgen_open_due - Open the bots --ramp allows by now
+ */
+static void loadgen_open_due(LoadGen* gen, uint64_t start, uint64_t now) {
+    int target = gen->bot_count;
+    if (gen->ramp_per_s > 0) {
+        uint64_t allowed = (now - start) * (uint64_t)gen->ramp_per_s / 1000000u + 1;
+        if (allowed < (uint64_t)target) target = (int)allowed;
+    }
+    while (gen->opened < target && g_running) {
+        bot_open(gen, &gen->bots[gen->opened], gen->opened);
+        gen->opened++;
+    }
+}
+
+/**
+ * loadgen_service - Send due inputs, time out stuck handshakes
+ */
+static void loadgen_service(LoadGen* gen, uint64_t now) {
+    uint64_t interval = 1000000u / (uint64_t)gen->rate_hz;
+
+    for (int i = 0; i < gen->opened; i++) {
+        Bot* bot = &gen->bots[i];
+
+        if (bot->phase == BOT_CONNECTING) {
+            if (gen->transport == NET_TRANSPORT_UDP) bot_drain(gen, bot);
+            if (bot->phase == BOT_CONNECTING &&
+                now - bot->connect_start_us > LOADGEN_CONNECT_TIMEOUT_MS * 1000u) {
+                bot_close(gen, bot);
+                gen->stats.failed++;
+            }
+            continue;
+        }
+
+        if (bot->phase != BOT_PLAYING || now < bot->next_input_us) continue;
+
+        bot_send_input(gen, bot, now);
+        bot->next_input_us += interval;
+        if (bot->next_input_us < now) {
+            bot->next_input_us = now + interval;  // Fell behind: don't burst
+        }
+    }
+}
+
+/**
+ * loadgen_report - Print one line covering the last interval
+ */
+static void loadgen_report(LoadGen* gen, const Stats* last, double seconds, double elapsed) {
+    const Stats* s = &gen->stats;
+    int active = s->connected - s->lost;
+
+    printf("[%6.1fs] bots %5d/%-5d  snaps/s %8.0f  in %8.1f KB/s  out %7.1f KB/s"
+           "  p50 %6.2f ms  p99 %6.2f ms\n",
+           elapsed, active, gen->bot_count,
+           (double)(s->snapshots - last->snapshots) / seconds,
+           (double)(s->bytes_in - last->bytes_in) / seconds / 1024.0,
+           (double)(s->bytes_out - last->bytes_out) / seconds / 1024.0,
+           hist_percentile(&gen->interval, 0.50) / 1000.0,
+           hist_percentile(&gen->interval, 0.99) / 1000.0);
+    fflush(stdout);
+    memset(&gen->interval, 0, sizeof(Histogram));
+}
+
+/**
+ * loadgen_summary - Print the totals for the whole run
+ */
+static void loadgen_summary(const LoadGen* gen, double elapsed) {
+    const Stats* s = &gen->stats;
+
+    double connect_span = (s->last_connect_us > s->first_open_us)
+                        ? (double)(s->last_connect_us - s->first_open_us) / 1e6 : 0.0;
+    double connect_rate = (connect_span > 0.0) ? s->connected / connect_span : 0.0;
+
+    printf("\n");
+    printf("=== Load test summary (%.1f s) ===\n", elapsed);
+    printf("Connections:   %d ok, %d rejected, %d failed, %d lost\n",
+           s->connected, s->rejected, s->failed, s->lost);
+    printf("Connect rate:  %.0f/s (%d handshakes in %.3f s)\n",
+           connect_rate, s->connected, connect_span);
+    printf("Snapshots:     %llu (%.0f/s)\n",
+           (unsigned long long)s->snapshots, s->snapshots / elapsed);
+    printf("Inputs sent:   %llu (%.0f/s)\n",
+           (unsigned long long)s->inputs, s->inputs / elapsed);
+    printf("Bytes in:      %llu (%.1f KB/s)\n",
+           (unsigned long long)s->bytes_in, s->bytes_in / elapsed / 1024.0);
+    printf("Bytes out:     %llu (%.1f KB/s)\n",
+           (unsigned long long)s->bytes_out, s->bytes_out / elapsed / 1024.0);
+    printf("Input-to-ack latency (%llu samples):\n",
+           (unsigned long long)gen->latency.total);
+    printf("    p50  %8.2f ms\n", hist_percentile(&gen->latency, 0.50) / 1000.0);
+    printf("    p99  %8.2f ms\n", hist_percentile(&gen->latency, 0.99) / 1000.0);
+    printf("    p999 %8.2f ms\n", hist_percentile(&gen->latency, 0.999) / 1000.0);
+    printf("    max  %8.2f ms\n", gen->latency.max / 1000.0);
+}
+
+/**
+ * loadgen_run - Open the bots and drive them until time is up
+ */
+static void loadgen_run(LoadGen* gen) {
+    NetEvent events[LOADGEN_MAX_EVENTS];
+    uint64_t start = time_us();
+    uint64_t end = start + (uint64_t)gen->duration_s * 1000000u;
+    uint64_t next_report = start + 1000000u;
+    uint64_t last_report = start;
+    Stats last = gen->stats;
+
+    while (g_running) {
+        uint64_t now = time_us();
+        if (gen->duration_s > 0 && now >= end) break;
+
+        loadgen_open_due(gen, start, now);
+
+        int count = net_reactor_wait(gen->reactor, events, LOADGEN_MAX_EVENTS, 1);
+        for (int i = 0; i < count; i++) {
+            bot_drain(gen, (Bot*)events[i].user_data);
+        }
+
+        now = time_us();
+        loadgen_service(gen, now);
+
+        if (now >= next_report) {
+            loadgen_report(gen, &last, (now - last_report) / 1e6, (now - start) / 1e6);
+            last = gen->stats;
+            last_report = now;
+            next_report += 1000000u;
+        }
+    }
+
+    loadgen_summary(gen, (time_us() - start) / 1e6);
+}
+
+/**
+ * loadgen_shutdown - Say goodbye on every live connection, free the bots
+ */
+static void loadgen_shutdown(LoadGen* gen) {
+    for (int i = 0; i < gen->opened; i++) {
+        Bot* bot = &gen->bots[i];
+        if (bot->phase == BOT_PLAYING) {
+            // Over UDP this is a single best-effort try; the server times
+            // out anyone whose goodbye is lost
+            net_link_send(&bot->link, MSG_DISCONNECT, NULL, 0, 1);
+        }
+        if (bot->phase == BOT_CONNECTING || bot->phase == BOT_PLAYING) {
+            bot_close(gen, bot);
+        }
+        state_decoder_free(&bot->decoder);
+        free(bot->recv_storage);
+    }
+    free(gen->bots);
+    net_reactor_destroy(gen->reactor);
+}
+
+/**
+ * print_usage - Show command line options
+ */
+static void print_usage(const char* program) {
+    printf("Usage: %s [HOST] [PORT] [options]\n", program);
+    printf("  --clients N     Connections to open (default 100)\n");
+    printf("  --rate HZ       Inputs per second per connection (default 60)\n");
+    printf("  --duration S    Seconds to run, 0 = until Ctrl+C (default 10)\n");
+    printf("  --ramp N        Connections opened per second, 0 = all at once (default 0)\n");
+    printf("  --input MODE    random or sweep (scripted) (default random)\n");
+    printf("  --seed N        Seed for the bots' input (default 1)\n");
+    printf("  --udp           Connect over UDP instead of TCP\n");
+    printf("  --raw           Use the unquantized encoding (PROTOCOL_VERSION_RAW)\n");
+}
+
+/**
+ * main - Load generator entry point
+ */
+int main(int argc, char* argv[]) {
+    LoadGen gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.host = "127.0.0.1";
+    gen.port = DEFAULT_PORT;
+    gen.transport = NET_TRANSPORT_TCP;
+    gen.version = PROTOCOL_VERSION;
+    gen.bot_count = 100;
+    gen.rate_hz = 60;
+    gen.duration_s = 10;
+    gen.input_mode = INPUT_MODE_RANDOM;
+    gen.seed = 1;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--udp") == 0) {
+            gen.transport = NET_TRANSPORT_UDP;
+        } else if (strcmp(arg, "--raw") == 0) {
+            gen.version = PROTOCOL_VERSION_RAW;
+        } else if (strcmp(arg, "--clients") == 0 && value) {
+            gen.bot_count = atoi(value); i++;
+        } else if (strcmp(arg, "--rate") == 0 && value) {
+            gen.rate_hz = atoi(value); i++;
+        } else if (strcmp(arg, "--duration") == 0 && value) {
+            gen.duration_s = atoi(value); i++;
+        } else if (strcmp(arg, "--ramp") == 0 && value) {
+            gen.ramp_per_s = atoi(value); i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            gen.seed = (uint32_t)strtoul(value, NULL, 10); i++;
+        } else if (strcmp(arg, "--input") == 0 && value) {
+            gen.input_mode = (strcmp(value, "sweep") == 0) ? INPUT_MODE_SWEEP
+                                                           : INPUT_MODE_RANDOM;
+            i++;
+        } else if (strcmp(arg, "--help") == 0 || arg[0] == '-') {
+            print_usage(argv[0]);
+            return (strcmp(arg, "--help") == 0) ? 0 : 1;
+        } else if (positional++ == 0) {
+            gen.host = arg;
+        } else {
+            gen.port = (uint16_t)atoi(arg);
+        }
+    }
+
+    if (gen.bot_count < 1 || gen.rate_hz < 1 || gen.rate_hz > 1000 ||
+        gen.duration_s < 0 || gen.ramp_per_s < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    if (net_init() != 0) {
+        fprintf(stderr, "Failed to initialize networking\n");
+        return 1;
+    }
+
+    gen.bots = calloc((size_t)gen.bot_count, sizeof(Bot));
+    gen.reactor = net_reactor_create(gen.bot_count);
+    if (gen.bots == NULL || gen.reactor == NULL) {
+        fprintf(stderr, "Out of memory for %d connections\n", gen.bot_count);
+        free(gen.bots);
+        net_reactor_destroy(gen.reactor);
+        net_cleanup();
+        return 1;
+    }
+    for (int i = 0; i < gen.bot_count; i++) {
+        gen.bots[i].link.socket = INVALID_SOCKET;
+        gen.bots[i].rng = (gen.seed * 2654435761u + (uint32_t)i * 40503u) | 1u;
+    }
+
+    printf("Load test: %d %s connections to %s:%d, %d inputs/s each, %s input",
+           gen.bot_count, (gen.transport == NET_TRANSPORT_UDP) ? "UDP" : "TCP",
+           gen.host, gen.port, gen.rate_hz,
+           (gen.input_mode == INPUT_MODE_SWEEP) ? "sweep" : "random");
+    if (gen.duration_s > 0) printf(", %d s", gen.duration_s);
+    printf("\n\n");
+
+    loadgen_run(&gen);
+    loadgen_shutdown(&gen);
+    net_cleanup();
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * log.h - Asynchronous Logging Without Stalling the Tick
+ *
+ * CONCEPT: printf() Is a System Call Waiting to Happen
+ * ====================================================
+ * printf() looks free, but stdout is line-buffered on a terminal and
+ * fully buffered into a pipe or file - sooner or later it calls write(),
+ * and write() blocks for as long as the reader (a terminal, `tee`, a full
+ * disk) makes it. One log line per input message at 60 Hz per player is
+ * enough to turn that into millisecond tick stalls.
+ *
+ * So the thread that LOGS never writes. It drops a fixed-size record
+ * into a ring and moves on; a background thread turns records into text
+ * and does the blocking I/O:
+ *
+ *     worker 0 ──► [ring] ─┐
+ *     worker 1 ──► [ring] ─┼──► formatter thread ──► fprintf + fflush
+ *     main     ──► [ring] ─┘    (merges by time)
+ *
+ * CONCEPT: One Ring Per Thread
+ * ============================
+ * Every thread gets its own single-producer/single-consumer ring the
+ * first time it logs. With exactly one writer and one reader the ring
+ * needs no lock: the writer owns 'head', the reader owns 'tail', and an
+ * acquire/release pair on each is all the synchronisation there is.
+ *
+ * When a ring is full the record is DROPPED and counted - the tick never
+ * waits for the log. The formatter reports drops as they happen:
+ *
+ *     [   12.031] WARN  log: 37 records dropped
+ *
+ * CONCEPT: Format Later
+ * =====================
+ * A record holds the format string POINTER (it must be a literal) and
+ * the raw argument values, not text. Strings (%s) are the exception:
+ * a name or address may live in a stack buffer, so their bytes are
+ * copied into the record (truncated if they don't fit).
+ *
+ * CONCEPT: Compile-Time Levels
+ * ============================
+ * LOG_DEBUG() and friends are macros. Anything below LOG_MIN_LEVEL
+ * compiles to nothing - its arguments aren't even evaluated:
+ *
+ *     make                          # LOG_MIN_LEVEL = INFO: no debug lines
+ *     make LOG_LEVEL=0              # everything, including per-input seq
+ *
+ * Before log_init() (and after log_shutdown()) log lines are printed
+ * directly, so tools that never start the logger still see them.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+// Lowest level compiled in (override with -DLOG_MIN_LEVEL=...)
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Records per thread ring (a power of two)
+#define LOG_RING_RECORDS 1024
+
+// Threads that can log through the rings (more fall back to dropping)
+#define LOG_MAX_THREADS 64
+
+// Argument values and copied string bytes one record holds
+#define LOG_MAX_ARGS 8
+#define LOG_TEXT_BYTES 104
+
+// How long the formatter sleeps when every ring is empty
+#define LOG_FLUSH_INTERVAL_MS 5
+
+/**
+ * LogRecord - One log call, unformatted (192 bytes)
+ */
+typedef struct {
+    uint64_t time_ns;               // CLOCK_MONOTONIC
+    const char* format;             // String literal
+    uint8_t level;
+    uint8_t arg_count;
+    uint8_t text_used;              // Bytes of 'text' taken by %s copies
+    uint64_t args[LOG_MAX_ARGS];    // Integers, doubles (bit pattern), text offsets
+    char text[LOG_TEXT_BYTES];
+} LogRecord;
+
+/**
+ * log_init - Start the formatter thread
+ *
+ * @param out  Where lines go (NULL = stdout)
+ * @return     0 on success, -1 if the thread couldn't start (log lines
+ *             are then printed directly)
+ */
+int log_init(FILE* out);
+
+/**
+ * log_shutdown - Write everything still queued and stop the formatter
+ *
+ * Call it once the other logging threads have stopped; a line logged
+ * while it runs may be lost, but never written into freed memory (the
+ * per-thread rings live until the process exits).
+ */
+void log_shutdown(void);
+
+/**
+ * log_write - Queue one record (use the LOG_* macros instead)
+ *
+ * Supports the usual integer, floating-point, %s, %c and %p conversions
+ * with flags, width, precision and length modifiers; '*' widths and %n
+ * are not.
+ *
+ * @param level   LOG_LEVEL_*
+ * @param format  printf format - must be a string literal
+ */
+void log_write(int level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * log_dropped - Records dropped so far because a ring was full
+ */
+uint64_t log_dropped(void);
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOG_H
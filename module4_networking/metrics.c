@@ -0,0 +1,449 @@
+/**
+ * metrics.c - Metrics Registry and Scrape Endpoint
+ *
+ * See metrics.h for the shard-per-writer layout.
+ */
+
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+
+#include "protocol.h"
+
+// Scrape output grows from here if a render doesn't fit
+#define METRICS_TEXT_INITIAL (32 * 1024)
+
+/**
+ * HistogramInfo - Name, labels and bucket bounds of one histogram
+ *
+ * 'scale' converts recorded units into the exposed ones (nanoseconds
+ * are exposed as seconds, as Prometheus convention asks).
+ */
+typedef struct {
+    const char* name;
+    const char* label;          // Label pair, or NULL
+    const char* help;
+    double scale;
+    uint64_t bounds[METRICS_MAX_BUCKETS];
+    int bound_count;
+} HistogramInfo;
+
+// Tick phase bounds: 10 µs .. 50 ms (one tick is 16.7 ms)
+#define PHASE_BOUNDS { 10000, 25000, 50000, 100000, 250000, 500000, 1000000, \
+                       2500000, 5000000, 10000000, 16666667, 50000000 }, 12
+
+static const HistogramInfo g_histograms[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_PHASE_INPUT] = { "void_drifter_tick_phase_seconds", "phase=\"input\"",
+        "Time per room tick spent in each phase", 1e-9, PHASE_BOUNDS },
+    [METRIC_PHASE_PHYSICS] = { "void_drifter_tick_phase_seconds", "phase=\"physics\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_PHASE_FIRING] = { "void_drifter_tick_phase_seconds", "phase=\"firing\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_PHASE_BULLETS] = { "void_drifter_tick_phase_seconds", "phase=\"bullets\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_PHASE_HITS] = { "void_drifter_tick_phase_seconds", "phase=\"hits\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_PHASE_SNAPSHOT] = { "void_drifter_tick_phase_seconds", "phase=\"snapshot\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_WORKER_TICK] = { "void_drifter_worker_tick_seconds", NULL,
+        "Work per worker tick: every room plus the UDP flush", 1e-9, PHASE_BOUNDS },
+    [METRIC_CLIENT_BYTES] = { "void_drifter_client_sent_bytes", NULL,
+        "Bytes sent to one client in one tick",
+        1.0, { 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072 }, 12 },
+    [METRIC_PIPELINE_SIMULATE] = { "void_drifter_pipeline_stage_seconds", "stage=\"simulate\"",
+        "Pipelined rooms: time per frame in each stage (see pipeline.h)", 1e-9, PHASE_BOUNDS },
+    [METRIC_PIPELINE_HANDOFF] = { "void_drifter_pipeline_stage_seconds", "stage=\"handoff\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+    [METRIC_PIPELINE_OUTPUT] = { "void_drifter_pipeline_stage_seconds", "stage=\"output\"",
+        NULL, 1e-9, PHASE_BOUNDS },
+};
+
+// Label value per MessageType (index 0: types we don't know)
+static const char* const g_message_names[METRICS_MESSAGE_TYPES] = {
+    "unknown", "connect", "connect_ack", "disconnect", "player_input",
+    "game_state", "ping", "pong", "state_fragment"
+};
+
+_Static_assert(MSG_STATE_FRAGMENT == METRICS_MESSAGE_TYPES - 1,
+               "a new MessageType needs a name in g_message_names");
+
+/**
+ * metrics_create - One cache-aligned allocation for all shards
+ */
+Metrics* metrics_create(int shard_count) {
+    Metrics* metrics = calloc(1, sizeof(Metrics));
+    if (metrics == NULL) return NULL;
+
+    size_t bytes = (size_t)shard_count * sizeof(MetricsShard);
+    metrics->shards = aligned_alloc(_Alignof(MetricsShard), bytes);
+    metrics->text = malloc(METRICS_TEXT_INITIAL);
+    if (metrics->shards == NULL || metrics->text == NULL) {
+        metrics_destroy(metrics);
+        return NULL;
+    }
+    memset(metrics->shards, 0, bytes);
+    metrics->shard_count = shard_count;
+    metrics->text_capacity = METRICS_TEXT_INITIAL;
+    return metrics;
+}
+
+/**
+ * metrics_destroy - Free shards, text buffer and registry
+ */
+void metrics_destroy(Metrics* metrics) {
+    if (metrics == NULL) return;
+    free(metrics->shards);
+    free(metrics->text);
+    free(metrics);
+}
+
+/**
+ * metrics_shard - Index into the shard array
+ */
+MetricsShard* metrics_shard(Metrics* metrics, int index) {
+    return &metrics->shards[index];
+}
+
+/**
+ * bump - Single-writer increment (see metrics_add)
+ */
+static void bump(_Atomic uint64_t* value, uint64_t amount) {
+    uint64_t current = atomic_load_explicit(value, memory_order_relaxed);
+    atomic_store_explicit(value, current + amount, memory_order_relaxed);
+}
+
+/**
+ * metrics_message - Per-type message count plus the byte total
+ */
+void metrics_message(MetricsShard* shard, int outgoing, uint8_t type, uint64_t bytes) {
+    int index = (type < METRICS_MESSAGE_TYPES) ? type : 0;
+    if (outgoing) {
+        bump(&shard->messages_out[index], 1);
+        metrics_add(shard, METRIC_BYTES_OUT, bytes);
+    } else {
+        bump(&shard->messages_in[index], 1);
+        metrics_add(shard, METRIC_BYTES_IN, bytes);
+    }
+}
+
+/**
+ * metrics_observe - Find the first bound >= value (at most 16 compares)
+ */
+void metrics_observe(MetricsShard* shard, MetricHistogram id, uint64_t value) {
+    const HistogramInfo* info = &g_histograms[id];
+    MetricsBuckets* hist = &shard->histograms[id];
+
+    int bucket = 0;
+    while (bucket < info->bound_count && value > info->bounds[bucket]) {
+        bucket++;
+    }
+    bump(&hist->counts[bucket], 1);
+    bump(&hist->sum, value);
+}
+
+// ============================================================================
+// RENDERING
+// ============================================================================
+
+/**
+ * TextOut - Append-only view of the registry's text buffer
+ */
+typedef struct {
+    Metrics* metrics;
+    int length;
+} TextOut;
+
+/**
+ * text_printf - Append formatted text, growing the buffer if needed
+ */
+static void text_printf(TextOut* out, const char* format, ...) {
+    Metrics* metrics = out->metrics;
+
+    while (1) {
+        int space = metrics->text_capacity - out->length;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(metrics->text + out->length, (size_t)space, format, args);
+        va_end(args);
+
+        if (n < 0) return;
+        if (n < space) {
+            out->length += n;
+            return;
+        }
+
+        char* bigger = realloc(metrics->text, (size_t)metrics->text_capacity * 2);
+        if (bigger == NULL) {
+            metrics->text[out->length] = '\0';  // Drop this line, keep the rest
+            return;
+        }
+        metrics->text = bigger;
+        metrics->text_capacity *= 2;
+    }
+}
+
+/**
+ * load - Relaxed read of a value another thread may be writing
+ */
+static uint64_t load(_Atomic uint64_t* value) {
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+/**
+ * sum_counter - One counter added up across all shards
+ */
+static uint64_t sum_counter(const Metrics* metrics, MetricCounter id) {
+    uint64_t total = 0;
+    for (int s = 0; s < metrics->shard_count; s++) {
+        total += load(&metrics->shards[s].counters[id]);
+    }
+    return total;
+}
+
+/**
+ * render_counter - HELP, TYPE and one unlabelled sample
+ */
+static void render_counter(TextOut* out, const Metrics* metrics, const char* name,
+                           const char* help, MetricCounter id) {
+    text_printf(out, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    text_printf(out, "%s %llu\n", name,
+                (unsigned long long)sum_counter(metrics, id));
+}
+
+/**
+ * render_gauge - Sum of every shard's share
+ */
+static void render_gauge(TextOut* out, const Metrics* metrics, const char* name,
+                         const char* help, MetricGauge id) {
+    int64_t total = 0;
+    for (int s = 0; s < metrics->shard_count; s++) {
+        total += atomic_load_explicit(&metrics->shards[s].gauges[id], memory_order_relaxed);
+    }
+    text_printf(out, "# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+    text_printf(out, "%s %lld\n", name, (long long)total);
+}
+
+/**
+ * render_messages - One counter per MessageType
+ */
+static void render_messages(TextOut* out, const Metrics* metrics, int outgoing) {
+    const char* name = outgoing ? "void_drifter_messages_sent_total"
+                                : "void_drifter_messages_received_total";
+    text_printf(out, "# HELP %s Messages %s, by type\n# TYPE %s counter\n",
+                name, outgoing ? "sent" : "received", name);
+
+    for (int t = 0; t < METRICS_MESSAGE_TYPES; t++) {
+        uint64_t total = 0;
+        for (int s = 0; s < metrics->shard_count; s++) {
+            MetricsShard* shard = &metrics->shards[s];
+            total += load(outgoing ? &shard->messages_out[t] : &shard->messages_in[t]);
+        }
+        text_printf(out, "%s{type=\"%s\"} %llu\n", name, g_message_names[t],
+                    (unsigned long long)total);
+    }
+}
+
+/**
+ * render_histogram - Cumulative buckets, sum and count
+ *
+ * Histograms sharing a name (the tick phases) get one HELP/TYPE header,
+ * written by the first of them.
+ */
+static void render_histogram(TextOut* out, const Metrics* metrics, MetricHistogram id) {
+    const HistogramInfo* info = &g_histograms[id];
+    const char* label = info->label ? info->label : "";
+    const char* comma = info->label ? "," : "";
+
+    if (info->help != NULL) {
+        text_printf(out, "# HELP %s %s\n# TYPE %s histogram\n",
+                    info->name, info->help, info->name);
+    }
+
+    uint64_t cumulative = 0;
+    uint64_t raw_sum = 0;
+    for (int s = 0; s < metrics->shard_count; s++) {
+        raw_sum += load(&metrics->shards[s].histograms[id].sum);
+    }
+
+    for (int b = 0; b <= info->bound_count; b++) {
+        for (int s = 0; s < metrics->shard_count; s++) {
+            cumulative += load(&metrics->shards[s].histograms[id].counts[b]);
+        }
+        if (b < info->bound_count) {
+            text_printf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n", info->name, label, comma,
+                        (double)info->bounds[b] * info->scale,
+                        (unsigned long long)cumulative);
+        } else {
+            text_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", info->name, label, comma,
+                        (unsigned long long)cumulative);
+        }
+    }
+
+    double sum = (double)raw_sum * info->scale;
+    const char* open = info->label ? "{" : "";
+    const char* close = info->label ? "}" : "";
+    text_printf(out, "%s_sum%s%s%s %.9g\n", info->name, open, label, close, sum);
+    text_printf(out, "%s_count%s%s%s %llu\n", info->name, open, label, close,
+                (unsigned long long)cumulative);
+}
+
+/**
+ * metrics_render - Sum the shards into the exposition format
+ */
+const char* metrics_render(Metrics* metrics) {
+    TextOut out = { .metrics = metrics, .length = 0 };
+    metrics->text[0] = '\0';
+
+    render_counter(&out, metrics, "void_drifter_ticks_total",
+                   "Room ticks simulated", METRIC_TICKS);
+    render_counter(&out, metrics, "void_drifter_connects_total",
+                   "Players seated in a room", METRIC_CONNECTS);
+    render_counter(&out, metrics, "void_drifter_disconnects_total",
+                   "Players that left or were dropped", METRIC_DISCONNECTS);
+    render_counter(&out, metrics, "void_drifter_rejected_connects_total",
+                   "Handshakes turned away (server full, bad version)", METRIC_REJECTS);
+    render_counter(&out, metrics, "void_drifter_failed_handshakes_total",
+                   "Connections closed before a valid MSG_CONNECT (timeout, garbage, table full)",
+                   METRIC_HANDSHAKE_FAILURES);
+    render_counter(&out, metrics, "void_drifter_send_failures_total",
+                   "Failed TCP sends and UDP datagrams the kernel refused",
+                   METRIC_SEND_FAILURES);
+    render_counter(&out, metrics, "void_drifter_received_bytes_total",
+                   "Message bytes received (header + payload)", METRIC_BYTES_IN);
+    render_counter(&out, metrics, "void_drifter_sent_bytes_total",
+                   "Message bytes sent (header + payload)", METRIC_BYTES_OUT);
+    render_counter(&out, metrics, "void_drifter_superseded_snapshots_total",
+                   "Queued snapshots replaced by a newer one before sending",
+                   METRIC_SUPERSEDED);
+    render_counter(&out, metrics, "void_drifter_slow_client_evictions_total",
+                   "Players dropped because their send queue never drained",
+                   METRIC_SLOW_EVICTIONS);
+    render_counter(&out, metrics, "void_drifter_worker_syscalls_total",
+                   "Socket system calls made by the worker threads (see net_syscall_count)",
+                   METRIC_NET_SYSCALLS);
+    render_counter(&out, metrics, "void_drifter_pipeline_skipped_frames_total",
+                   "Frames not published because the output stage was still busy",
+                   METRIC_PIPELINE_SKIPS);
+    render_counter(&out, metrics, "void_drifter_input_queue_drops_total",
+                   "Decoded inputs an I/O thread dropped because its worker's queue was full",
+                   METRIC_INPUT_DROPS);
+    render_messages(&out, metrics, 0);
+    render_messages(&out, metrics, 1);
+    render_gauge(&out, metrics, "void_drifter_players",
+                 "Players currently seated", METRIC_GAUGE_PLAYERS);
+    render_gauge(&out, metrics, "void_drifter_bullets",
+                 "Live bullets across all rooms", METRIC_GAUGE_BULLETS);
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        render_histogram(&out, metrics, (MetricHistogram)h);
+    }
+    return metrics->text;
+}
+
+// ============================================================================
+// SCRAPE ENDPOINT
+// ============================================================================
+
+/**
+ * metrics_listen - socket(AF_UNIX), bind, listen
+ */
+Socket metrics_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Metrics socket path too long: %s\n", path);
+        return INVALID_SOCKET;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    Socket sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        perror("socket(AF_UNIX) failed");
+        return INVALID_SOCKET;
+    }
+
+    // A previous run that crashed leaves its socket file behind
+    unlink(path);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 8) < 0) {
+        perror("metrics socket bind/listen failed");
+        close(sock);
+        return INVALID_SOCKET;
+    }
+
+    net_set_nonblocking(sock);
+    return sock;
+}
+
+/**
+ * metrics_serve - Accept, read the request, write the text, close
+ *
+ * The accepted socket stays non-blocking; poll() bounds every wait, so
+ * a scraper that never sends or never reads costs the main thread at
+ * most METRICS_IO_TIMEOUT_MS per step - and the workers nothing.
+ */
+int metrics_serve(Metrics* metrics, Socket listen_socket) {
+    Socket client = accept(listen_socket, NULL, NULL);
+    if (client == INVALID_SOCKET) return 0;
+    fcntl(client, F_SETFL, O_NONBLOCK);
+
+    // The request: "GET /metrics HTTP/1.x ..." or just a newline
+    char request[256];
+    struct pollfd pfd = { .fd = client, .events = POLLIN, .revents = 0 };
+    ssize_t n = 0;
+    if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) > 0) {
+        n = recv(client, request, sizeof(request) - 1, 0);
+    }
+    int http = (n >= 4 && memcmp(request, "GET ", 4) == 0);
+
+    const char* body = metrics_render(metrics);
+    size_t body_length = strlen(body);
+
+    char header[160];
+    int header_length = 0;
+    if (http) {
+        header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.0 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\n"
+                                 "Content-Length: %zu\r\n"
+                                 "Connection: close\r\n\r\n", body_length);
+    }
+
+    struct iovec parts[2] = {
+        { .iov_base = header, .iov_len = (size_t)header_length },
+        { .iov_base = (void*)body, .iov_len = body_length }
+    };
+    struct iovec* current = http ? parts : parts + 1;
+    int remaining = http ? 2 : 1;
+
+    pfd.events = POLLOUT;
+    while (remaining > 0) {
+        ssize_t sent = writev(client, current, remaining);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) break;
+            if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) <= 0) break;  // Scraper stalled
+            continue;
+        }
+        while (remaining > 0 && (size_t)sent >= current->iov_len) {
+            sent -= (ssize_t)current->iov_len;
+            current++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            current->iov_base = (char*)current->iov_base + sent;
+            current->iov_len -= (size_t)sent;
+        }
+    }
+
+    net_close(client);
+    return 1;
+}
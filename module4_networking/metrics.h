@@ -0,0 +1,254 @@
+/**
+ * metrics.h - Counters and Histograms, Scraped Over a Unix Socket
+ *
+ * CONCEPT: Telemetry Without Slowing the Tick
+ * ===========================================
+ * printf() tells us what happened to ONE player; an ops dashboard wants
+ * totals and distributions: how long each tick phase takes, how many
+ * messages of each type go in and out, how many sends fail. The server
+ * keeps these as plain numbers and a scraper (Prometheus, or curl) asks
+ * for them whenever it likes:
+ *
+ *     $ curl --unix-socket /tmp/void_drifter.sock http://localhost/metrics
+ *     # TYPE void_drifter_messages_received_total counter
+ *     void_drifter_messages_received_total{type="player_input"} 183402
+ *     ...
+ *
+ * The hard part is doing that while worker threads update the numbers
+ * 60 times a second, without a lock and without the scrape disturbing
+ * them.
+ *
+ * CONCEPT: One Shard Per Writer
+ * =============================
+ * A single shared counter bumped by every worker would bounce its cache
+ * line between cores on every increment. Instead every thread that
+ * writes metrics gets its OWN copy (a shard), padded to a cache line:
+ *
+ *     shard 0: main thread     (handshakes, rejects)
+ *     shard 1: worker 0        (its rooms: ticks, messages, bytes...)
+ *     shard 2: worker 1
+ *     ...
+ *     shard 1 + W + s: output stage s (--pipeline: one per worker,
+ *                      --io-threads: one per I/O thread; W workers)
+ *
+ * Each shard has exactly one writer, so an update is a relaxed atomic
+ * load + store - no lock, no read-modify-write instruction, no fence.
+ * The scraper sums the shards with relaxed loads. It may see one shard
+ * a few increments "newer" than another, which is fine for monitoring;
+ * what it never sees is a torn value.
+ *
+ * CONCEPT: Histograms
+ * ===================
+ * Tick durations and per-client bytes are histograms: counts per bucket
+ * of a fixed list of upper bounds, plus the sum of all observations.
+ * The exposition format is cumulative (le = "less or equal"):
+ *
+ *     void_drifter_tick_phase_seconds_bucket{phase="hits",le="0.0001"} 950
+ *     void_drifter_tick_phase_seconds_bucket{phase="hits",le="0.00025"} 998
+ *     void_drifter_tick_phase_seconds_bucket{phase="hits",le="+Inf"} 1000
+ *     void_drifter_tick_phase_seconds_sum{phase="hits"} 0.0421
+ *     void_drifter_tick_phase_seconds_count{phase="hits"} 1000
+ *
+ * so Prometheus can compute any percentile over any time window.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "network.h"
+
+// Bucket bounds per histogram (+Inf is extra)
+#define METRICS_MAX_BUCKETS 16
+
+// Message counters are indexed by MessageType; 0 counts unknown types
+#define METRICS_MESSAGE_TYPES 9
+
+// How long a scraper may take to send its request / read the reply
+#define METRICS_IO_TIMEOUT_MS 200
+
+/**
+ * MetricCounter - Totals that only ever grow
+ */
+typedef enum {
+    METRIC_TICKS,               // Room ticks simulated
+    METRIC_CONNECTS,            // Players seated
+    METRIC_DISCONNECTS,         // Players that left or were dropped
+    METRIC_REJECTS,             // Handshakes turned away (full, bad version)
+    METRIC_HANDSHAKE_FAILURES,  // Connections closed before a valid MSG_CONNECT
+    METRIC_SEND_FAILURES,       // TCP sends that failed, UDP datagrams refused
+    METRIC_BYTES_IN,            // Message bytes received (header + payload)
+    METRIC_BYTES_OUT,           // Message bytes sent (header + payload)
+    METRIC_SUPERSEDED,          // Queued snapshots replaced by a newer one unsent
+    METRIC_SLOW_EVICTIONS,      // Players dropped for not reading fast enough
+    METRIC_NET_SYSCALLS,        // Socket system calls made by the workers
+    METRIC_PIPELINE_SKIPS,      // Frames not published: output stage still busy
+    METRIC_INPUT_DROPS,         // Decoded inputs lost to a full worker input queue
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+/**
+ * MetricGauge - Current values (each shard holds its share)
+ */
+typedef enum {
+    METRIC_GAUGE_PLAYERS,       // Players seated right now
+    METRIC_GAUGE_BULLETS,       // Live bullets across all rooms
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+/**
+ * MetricHistogram - Distributions
+ *
+ * The tick phases are in the order game_server_tick() runs them.
+ */
+typedef enum {
+    METRIC_PHASE_INPUT,         // Budget refill, held-back input, UDP timeouts
+    METRIC_PHASE_PHYSICS,
+    METRIC_PHASE_FIRING,
+    METRIC_PHASE_BULLETS,
+    METRIC_PHASE_HITS,
+    METRIC_PHASE_SNAPSHOT,      // Interest, encoding and sending (pipelined: the frame copy)
+    METRIC_WORKER_TICK,         // One worker tick: every room + UDP flush
+    METRIC_CLIENT_BYTES,        // Bytes sent to one client in one tick
+    METRIC_PIPELINE_SIMULATE,   // Pipelined room tick, frame copy included
+    METRIC_PIPELINE_HANDOFF,    // Time a frame waited for the output thread
+    METRIC_PIPELINE_OUTPUT,     // Interest, encoding and sending of one frame
+    METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+// Tick phases are the first histograms
+#define METRIC_PHASE_COUNT (METRIC_PHASE_SNAPSHOT + 1)
+
+/**
+ * MetricsBuckets - One histogram's counts (last bucket = +Inf)
+ */
+typedef struct {
+    _Atomic uint64_t counts[METRICS_MAX_BUCKETS + 1];
+    _Atomic uint64_t sum;
+} MetricsBuckets;
+
+/**
+ * MetricsShard - Everything one thread writes
+ *
+ * Aligned to a cache line so two threads' shards never share one.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+    _Atomic uint64_t messages_in[METRICS_MESSAGE_TYPES];
+    _Atomic uint64_t messages_out[METRICS_MESSAGE_TYPES];
+    _Atomic int64_t gauges[METRIC_GAUGE_COUNT];
+    MetricsBuckets histograms[METRIC_HISTOGRAM_COUNT];
+} MetricsShard;
+
+/**
+ * Metrics - The registry: one shard per writing thread
+ */
+typedef struct {
+    MetricsShard* shards;
+    int shard_count;
+
+    // Scrape output (main thread only)
+    char* text;
+    int text_capacity;
+} Metrics;
+
+/**
+ * metrics_create - Allocate a registry with 'shard_count' zeroed shards
+ *
+ * @param shard_count  Threads that will write metrics
+ * @return             New registry, or NULL if out of memory
+ */
+Metrics* metrics_create(int shard_count);
+
+/**
+ * metrics_destroy - Free the registry
+ *
+ * @param metrics  Registry (NULL is ignored)
+ */
+void metrics_destroy(Metrics* metrics);
+
+/**
+ * metrics_shard - The shard a thread writes to
+ *
+ * @param metrics  The registry
+ * @param index    0 .. shard_count-1
+ * @return         The shard
+ */
+MetricsShard* metrics_shard(Metrics* metrics, int index);
+
+/**
+ * metrics_add - Increase a counter
+ *
+ * Only the shard's own thread may call this (single writer: a plain
+ * load + store, no atomic read-modify-write needed).
+ */
+static inline void metrics_add(MetricsShard* shard, MetricCounter id, uint64_t amount) {
+    uint64_t value = atomic_load_explicit(&shard->counters[id], memory_order_relaxed);
+    atomic_store_explicit(&shard->counters[id], value + amount, memory_order_relaxed);
+}
+
+/**
+ * metrics_gauge_add - Move a gauge up or down (single writer, see metrics_add)
+ */
+static inline void metrics_gauge_add(MetricsShard* shard, MetricGauge id, int64_t delta) {
+    int64_t value = atomic_load_explicit(&shard->gauges[id], memory_order_relaxed);
+    atomic_store_explicit(&shard->gauges[id], value + delta, memory_order_relaxed);
+}
+
+/**
+ * metrics_message - Count one message received or sent
+ *
+ * @param shard     The calling thread's shard
+ * @param outgoing  0 = received, 1 = sent
+ * @param type      MessageType (anything unknown is counted under 0)
+ * @param bytes     Header + payload
+ */
+void metrics_message(MetricsShard* shard, int outgoing, uint8_t type, uint64_t bytes);
+
+/**
+ * metrics_observe - Record one histogram sample
+ *
+ * @param shard  The calling thread's shard
+ * @param id     Which histogram
+ * @param value  Nanoseconds for durations, bytes for sizes
+ */
+void metrics_observe(MetricsShard* shard, MetricHistogram id, uint64_t value);
+
+/**
+ * metrics_render - Write every metric in the Prometheus text format
+ *
+ * Safe to call while other threads update their shards.
+ *
+ * @param metrics  The registry
+ * @return         The text (owned by the registry, valid until the
+ *                 next call), NUL-terminated
+ */
+const char* metrics_render(Metrics* metrics);
+
+/**
+ * metrics_listen - Open the Unix-domain socket scrapers connect to
+ *
+ * A stale socket file left by an earlier run is replaced. The socket is
+ * non-blocking, ready for a reactor.
+ *
+ * @param path  Filesystem path of the socket
+ * @return      Listening socket, or INVALID_SOCKET on error
+ */
+Socket metrics_listen(const char* path);
+
+/**
+ * metrics_serve - Answer one scraper waiting on the metrics socket
+ *
+ * Accepts the connection, reads its request (an HTTP GET gets an HTTP
+ * response, anything else - even an empty line - gets the bare text)
+ * and closes it. Each step waits at most METRICS_IO_TIMEOUT_MS.
+ *
+ * @param metrics        The registry
+ * @param listen_socket  From metrics_listen()
+ * @return               1 if a scraper was served, 0 if none was waiting
+ */
+int metrics_serve(Metrics* metrics, Socket listen_socket);
+
+#endif // METRICS_H
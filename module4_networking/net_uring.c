@@ -0,0 +1,625 @@
+/**
+ * net_uring.c - io_uring Socket Backend Implementation
+ *
+ * See net_uring.h for the idea. There is no liburing here: the three
+ * system calls and the ring layout come straight from
+ * <linux/io_uring.h>, which keeps the whole mechanism visible:
+ *
+ *     io_uring_setup()     create the rings, mmap() them
+ *     io_uring_register()  hand the kernel our receive buffer ring
+ *     io_uring_enter()     "I wrote N new SQEs" (the only hot-path call)
+ *
+ * MEMORY ORDERING: the kernel reads the SQ tail and writes the CQ tail
+ * concurrently with us, so those are accessed with acquire/release
+ * atomics; everything else in the rings is plain memory guarded by them.
+ */
+
+// syscall() and MAP_ANONYMOUS are not part of C11
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "net_uring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// user_data of a request says what it is and whose it is:
+//     bits 63..32 connection, 31..8 generation, 7..0 NetUringKind
+// Kind 0 marks our own cancel requests, whose completions are ignored.
+#define URING_KIND_INTERNAL 0
+
+/**
+ * UringConn - One connection's requests
+ */
+typedef struct {
+    int in_use;
+    Socket socket;
+    void* user_data;
+    uint32_t generation;    // Bumped every time the slot is reused
+    int ops;                // Requests whose last completion is still due
+    int recv_armed;         // A multishot recv is pending
+    int recv_cancelling;    // ...and a cancel for it is on its way
+    int recv_wanted;        // Re-arm it when it ends
+    int closing;            // Removed: close the socket once ops is 0
+    void* orphan;           // Freed together with the socket
+} UringConn;
+
+struct NetUring {
+    int fd;
+
+    // Submission queue (shared with the kernel)
+    void* sq_ring;
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned* sq_flags;     // IORING_SQ_CQ_OVERFLOW: completions wait in the kernel
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail; // Next SQE we fill (published on submit)
+    unsigned sq_queued;     // Filled but not submitted yet
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    // Completion queue (shared with the kernel)
+    void* cq_ring;
+    size_t cq_ring_size;    // 0 = it lives in sq_ring (IORING_FEAT_SINGLE_MMAP)
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // Provided receive buffers (buffer group 0)
+    struct io_uring_buf* buf_ring;
+    size_t buf_ring_size;
+    uint16_t* buf_tail;     // Overlays buf_ring[0].resv
+    uint16_t buf_local_tail;
+    int buf_count;
+    uint8_t* buffers;
+
+    // Connections
+    UringConn* conns;
+    int max_conns;
+    int* free_conns;        // Stack of unused slots
+    int free_count;
+
+    // Multishot accept (INVALID_SOCKET = none)
+    Socket listen;
+    void* accept_user_data;
+};
+
+/**
+ * uring_user_data - Pack kind, connection and generation
+ */
+static uint64_t uring_user_data(int kind, int conn, uint32_t generation) {
+    return ((uint64_t)(uint32_t)conn << 32) | ((uint64_t)(generation & 0xFFFFFF) << 8) |
+           (uint64_t)kind;
+}
+
+/**
+ * uring_enter - io_uring_enter(), counted like every other socket call
+ */
+static int uring_enter(NetUring* uring, unsigned to_submit, unsigned flags) {
+    for (;;) {
+        net_syscall_count++;
+        int n = (int)syscall(__NR_io_uring_enter, uring->fd, to_submit, 0, flags, NULL, 0);
+        if (n >= 0 || errno != EINTR) return n;
+    }
+}
+
+/**
+ * uring_get_sqe - Next free submission entry, zeroed
+ *
+ * A full queue is submitted first to make room.
+ *
+ * @return  The entry, or NULL if the queue stays full
+ */
+static struct io_uring_sqe* uring_get_sqe(NetUring* uring) {
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    if (uring->sq_local_tail - head >= uring->sq_entries) {
+        if (net_uring_submit(uring) <= 0) return NULL;
+        head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        if (uring->sq_local_tail - head >= uring->sq_entries) return NULL;
+    }
+
+    unsigned index = uring->sq_local_tail & uring->sq_mask;
+    struct io_uring_sqe* sqe = &uring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    uring->sq_array[index] = index;
+    uring->sq_local_tail++;
+    uring->sq_queued++;
+    return sqe;
+}
+
+/**
+ * uring_arm_accept - Queue the multishot accept
+ */
+static int uring_arm_accept(NetUring* uring) {
+    struct io_uring_sqe* sqe = uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = uring->listen;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = uring_user_data(NET_URING_ACCEPT, 0, 0);
+    return 0;
+}
+
+/**
+ * uring_arm_recv - Queue a multishot recv into buffer group 0
+ */
+static int uring_arm_recv(NetUring* uring, int c) {
+    UringConn* conn = &uring->conns[c];
+    struct io_uring_sqe* sqe = uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = uring_user_data(NET_URING_RECV, c, conn->generation);
+    conn->ops++;
+    conn->recv_armed = 1;
+    return 0;
+}
+
+/**
+ * uring_release - Close a removed connection's socket, free its slot
+ */
+static void uring_release(NetUring* uring, int c) {
+    UringConn* conn = &uring->conns[c];
+    net_close(conn->socket);
+    free(conn->orphan);
+    conn->orphan = NULL;
+    conn->socket = INVALID_SOCKET;
+    conn->in_use = 0;
+    conn->generation++;
+    uring->free_conns[uring->free_count++] = c;
+}
+
+/**
+ * uring_map_rings - mmap() the SQ ring, CQ ring and SQE array
+ */
+static int uring_map_rings(NetUring* uring, const struct io_uring_params* params) {
+    uring->sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    size_t cq_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels put both rings in one mapping
+    int single = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && cq_size > uring->sq_ring_size) uring->sq_ring_size = cq_size;
+
+    uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          uring->fd, IORING_OFF_SQ_RING);
+    if (uring->sq_ring == MAP_FAILED) {
+        uring->sq_ring = NULL;
+        return -1;
+    }
+    if (single) {
+        uring->cq_ring = uring->sq_ring;
+    } else {
+        uring->cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              uring->fd, IORING_OFF_CQ_RING);
+        if (uring->cq_ring == MAP_FAILED) {
+            uring->cq_ring = NULL;
+            return -1;
+        }
+        uring->cq_ring_size = cq_size;
+    }
+
+    uring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       uring->fd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED) {
+        uring->sqes = NULL;
+        return -1;
+    }
+
+    uint8_t* sq = uring->sq_ring;
+    uring->sq_head = (unsigned*)(sq + params->sq_off.head);
+    uring->sq_tail = (unsigned*)(sq + params->sq_off.tail);
+    uring->sq_array = (unsigned*)(sq + params->sq_off.array);
+    uring->sq_flags = (unsigned*)(sq + params->sq_off.flags);
+    uring->sq_mask = *(unsigned*)(sq + params->sq_off.ring_mask);
+    uring->sq_entries = *(unsigned*)(sq + params->sq_off.ring_entries);
+    uring->sq_local_tail = *uring->sq_tail;
+
+    uint8_t* cq = uring->cq_ring;
+    uring->cq_head = (unsigned*)(cq + params->cq_off.head);
+    uring->cq_tail = (unsigned*)(cq + params->cq_off.tail);
+    uring->cq_mask = *(unsigned*)(cq + params->cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe*)(cq + params->cq_off.cqes);
+    return 0;
+}
+
+/**
+ * uring_setup_buffers - Allocate the pool, register its ring, fill it
+ */
+static int uring_setup_buffers(NetUring* uring, int buffers) {
+    int count = 1;
+    while (count < buffers && count < NET_URING_MAX_BUFFERS) count *= 2;
+
+    // The kernel wants the ring page-aligned
+    long page = sysconf(_SC_PAGESIZE);
+    size_t size = (size_t)count * sizeof(struct io_uring_buf);
+    uring->buf_ring_size = (size + (size_t)page - 1) / (size_t)page * (size_t)page;
+    uring->buf_ring = mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buf_ring == MAP_FAILED) {
+        uring->buf_ring = NULL;
+        return -1;
+    }
+    uring->buffers = malloc((size_t)count * NET_URING_BUFFER_SIZE);
+    if (uring->buffers == NULL) return -1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)uring->buf_ring;
+    reg.ring_entries = (uint32_t)count;
+    reg.bgid = 0;
+    if (syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+
+    uring->buf_count = count;
+    uring->buf_tail = &uring->buf_ring[0].resv;
+    for (int b = 0; b < count; b++) {
+        net_uring_recycle(uring, b);
+    }
+    return 0;
+}
+
+/**
+ * net_uring_create - io_uring_setup(), map the rings, register buffers
+ */
+NetUring* net_uring_create(int entries, int max_conns, int buffers) {
+    NetUring* uring = calloc(1, sizeof(NetUring));
+    if (uring == NULL) return NULL;
+    uring->fd = -1;
+    uring->listen = INVALID_SOCKET;
+
+    // A deep CQ: every player can have a recv and a send completing
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = (unsigned)entries * 4;
+    uring->fd = (int)syscall(__NR_io_uring_setup, (unsigned)entries, &params);
+    if (uring->fd < 0 || uring_map_rings(uring, &params) != 0 ||
+        (buffers > 0 && uring_setup_buffers(uring, buffers) != 0)) {
+        net_uring_destroy(uring);
+        return NULL;
+    }
+
+    if (max_conns > 0) {
+        uring->conns = calloc((size_t)max_conns, sizeof(UringConn));
+        uring->free_conns = malloc((size_t)max_conns * sizeof(int));
+        if (uring->conns == NULL || uring->free_conns == NULL) {
+            net_uring_destroy(uring);
+            return NULL;
+        }
+        for (int i = 0; i < max_conns; i++) {
+            uring->free_conns[i] = max_conns - 1 - i;
+            uring->conns[i].socket = INVALID_SOCKET;
+        }
+        uring->free_count = max_conns;
+        uring->max_conns = max_conns;
+    }
+    return uring;
+}
+
+/**
+ * net_uring_destroy - Shut every socket down, then unmap and free
+ *
+ * shutdown() ends the requests still pending on a socket before the
+ * ring (and with it the memory they point into) goes away.
+ */
+void net_uring_destroy(NetUring* uring) {
+    if (uring == NULL) return;
+
+    for (int i = 0; i < uring->max_conns; i++) {
+        UringConn* conn = &uring->conns[i];
+        if (!conn->in_use) continue;
+        shutdown(conn->socket, SHUT_RDWR);
+        net_close(conn->socket);
+        free(conn->orphan);
+    }
+    if (uring->fd >= 0) close(uring->fd);
+
+    if (uring->sqes != NULL) munmap(uring->sqes, uring->sqes_size);
+    if (uring->cq_ring != NULL && uring->cq_ring_size > 0) munmap(uring->cq_ring, uring->cq_ring_size);
+    if (uring->sq_ring != NULL) munmap(uring->sq_ring, uring->sq_ring_size);
+    if (uring->buf_ring != NULL) munmap(uring->buf_ring, uring->buf_ring_size);
+    free(uring->buffers);
+    free(uring->conns);
+    free(uring->free_conns);
+    free(uring);
+}
+
+/**
+ * net_uring_fd - The ring's own descriptor
+ */
+int net_uring_fd(const NetUring* uring) {
+    return uring->fd;
+}
+
+/**
+ * net_uring_accept - Remember the listener, queue the accept
+ */
+int net_uring_accept(NetUring* uring, Socket listen, void* user_data) {
+    uring->listen = listen;
+    uring->accept_user_data = user_data;
+    return uring_arm_accept(uring);
+}
+
+/**
+ * net_uring_add - Pop a slot, arm its recv
+ */
+int net_uring_add(NetUring* uring, Socket socket, void* user_data) {
+    if (uring->free_count == 0) return -1;
+
+    int c = uring->free_conns[uring->free_count - 1];
+    UringConn* conn = &uring->conns[c];
+    uint32_t generation = conn->generation;
+    memset(conn, 0, sizeof(UringConn));
+    conn->in_use = 1;
+    conn->socket = socket;
+    conn->user_data = user_data;
+    conn->generation = generation;
+    conn->recv_wanted = 1;
+    if (uring_arm_recv(uring, c) != 0) {
+        conn->in_use = 0;
+        return -1;
+    }
+    uring->free_count--;
+    return c;
+}
+
+/**
+ * net_uring_set_recv - Cancel or re-arm the multishot recv
+ *
+ * While a cancel is on its way the recv counts as armed; its final
+ * completion re-arms it if receiving was switched back on meanwhile.
+ */
+void net_uring_set_recv(NetUring* uring, int c, int enabled) {
+    UringConn* conn = &uring->conns[c];
+    if (conn->closing || conn->recv_wanted == enabled) return;
+    conn->recv_wanted = enabled;
+
+    if (enabled) {
+        if (!conn->recv_armed) uring_arm_recv(uring, c);
+        return;
+    }
+    if (conn->recv_armed && !conn->recv_cancelling) {
+        struct io_uring_sqe* sqe = uring_get_sqe(uring);
+        if (sqe == NULL) return;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = uring_user_data(NET_URING_RECV, c, conn->generation);
+        sqe->user_data = uring_user_data(URING_KIND_INTERNAL, c, conn->generation);
+        conn->recv_cancelling = 1;
+    }
+}
+
+/**
+ * net_uring_send - Queue one IORING_OP_SEND
+ *
+ * MSG_NOSIGNAL: a peer that hung up is an error result, not SIGPIPE.
+ */
+int net_uring_send(NetUring* uring, int c, const void* data, int length) {
+    UringConn* conn = &uring->conns[c];
+    if (conn->closing) return -1;
+
+    struct io_uring_sqe* sqe = uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->socket;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = (uint32_t)length;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uring_user_data(NET_URING_SEND, c, conn->generation);
+    conn->ops++;
+    return 0;
+}
+
+/**
+ * net_uring_remove - Cancel everything on the socket, close when idle
+ *
+ * If no SQE is free for the cancel, shutdown() ends the requests just
+ * the same (with an error or end-of-stream result).
+ */
+void net_uring_remove(NetUring* uring, int c, void* orphan) {
+    UringConn* conn = &uring->conns[c];
+    conn->closing = 1;
+    conn->recv_wanted = 0;
+    conn->orphan = orphan;
+    if (conn->ops == 0) {
+        uring_release(uring, c);
+        return;
+    }
+
+    struct io_uring_sqe* sqe = uring_get_sqe(uring);
+    if (sqe == NULL) {
+        shutdown(conn->socket, SHUT_RDWR);
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = conn->socket;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = uring_user_data(URING_KIND_INTERNAL, c, conn->generation);
+}
+
+/**
+ * net_uring_recycle - Append the buffer at the ring's tail
+ *
+ * Field by field: buf_ring[0].resv is the tail itself.
+ */
+void net_uring_recycle(NetUring* uring, int buffer) {
+    if (buffer < 0) return;
+
+    struct io_uring_buf* slot = &uring->buf_ring[uring->buf_local_tail & (uring->buf_count - 1)];
+    slot->addr = (uint64_t)(uintptr_t)(uring->buffers + (size_t)buffer * NET_URING_BUFFER_SIZE);
+    slot->len = NET_URING_BUFFER_SIZE;
+    slot->bid = (uint16_t)buffer;
+    uring->buf_local_tail++;
+    __atomic_store_n(uring->buf_tail, uring->buf_local_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * net_uring_submit - Publish the SQ tail, one io_uring_enter()
+ *
+ * Completions that didn't fit the CQ (a burst of accepts, say) wait in
+ * the kernel's overflow list, and the ring descriptor stays readable
+ * until they are moved over - IORING_ENTER_GETEVENTS does that, so the
+ * same call also runs when only the overflow needs flushing.
+ */
+int net_uring_submit(NetUring* uring) {
+    if (uring == NULL) return 0;
+    unsigned overflow = __atomic_load_n(uring->sq_flags, __ATOMIC_ACQUIRE) &
+                        IORING_SQ_CQ_OVERFLOW;
+    if (uring->sq_queued == 0 && !overflow) return 0;
+
+    __atomic_store_n(uring->sq_tail, uring->sq_local_tail, __ATOMIC_RELEASE);
+    int n = uring_enter(uring, uring->sq_queued, overflow ? IORING_ENTER_GETEVENTS : 0);
+    if (n < 0) {
+        // EAGAIN/EBUSY: the kernel is short of memory or completions
+        // are backed up - the SQEs stay queued for the next submit
+        if (errno == EAGAIN || errno == EBUSY) return 0;
+        perror("io_uring_enter() failed");
+        return -1;
+    }
+    uring->sq_queued -= (unsigned)n;
+    return n;
+}
+
+/**
+ * uring_complete - Account for one CQE; fill 'event' if the caller needs it
+ *
+ * STEP BY STEP:
+ * 1. Accepts: re-arm a multishot accept the kernel ended; report it
+ * 2. A request's LAST completion (no IORING_CQE_F_MORE) lowers the
+ *    connection's request count
+ * 3. Removed connections: give buffers back, close once idle
+ * 4. A recv that ended (cancelled, out of buffers, ...) is re-armed if
+ *    we still want data; only data, end-of-stream and real errors
+ *    reach the caller
+ *
+ * @return  1 if 'event' was filled in, 0 if the CQE was internal
+ */
+static int uring_complete(NetUring* uring, const struct io_uring_cqe* cqe, NetUringEvent* event) {
+    int kind = (int)(cqe->user_data & 0xFF);
+    int more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    int buffer = (cqe->flags & IORING_CQE_F_BUFFER) ?
+        (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+
+    // --- STEP 1: Accepts ---
+    if (kind == NET_URING_ACCEPT) {
+        if (!more && uring->listen != INVALID_SOCKET) uring_arm_accept(uring);
+        if (cqe->res == -ECANCELED) return 0;
+        *event = (NetUringEvent){ NET_URING_ACCEPT, -1, uring->accept_user_data,
+                                  cqe->res, NULL, -1 };
+        return 1;
+    }
+
+    int c = (int)(cqe->user_data >> 32);
+    uint32_t generation = (uint32_t)(cqe->user_data >> 8) & 0xFFFFFF;
+    if (kind == URING_KIND_INTERNAL || c >= uring->max_conns) return 0;
+
+    UringConn* conn = &uring->conns[c];
+    if (!conn->in_use || (conn->generation & 0xFFFFFF) != generation) {
+        net_uring_recycle(uring, buffer);  // Can't happen: slots wait for ops == 0
+        return 0;
+    }
+
+    // --- STEP 2: Last completion of a request ---
+    if (!more) {
+        conn->ops--;
+        if (kind == NET_URING_RECV) {
+            conn->recv_armed = 0;
+            conn->recv_cancelling = 0;
+        }
+    }
+
+    // --- STEP 3: Removed ---
+    if (conn->closing) {
+        net_uring_recycle(uring, buffer);
+        if (conn->ops == 0) uring_release(uring, c);
+        return 0;
+    }
+
+    // --- STEP 4: Keep receiving ---
+    if (kind == NET_URING_RECV && !more) {
+        int restartable = cqe->res > 0 || cqe->res == -ENOBUFS || cqe->res == -ECANCELED;
+        if (restartable && conn->recv_wanted) uring_arm_recv(uring, c);
+        if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED) return 0;
+    }
+
+    *event = (NetUringEvent){ (NetUringKind)kind, c, conn->user_data, cqe->res, NULL, buffer };
+    if (buffer >= 0) {
+        event->data = uring->buffers + (size_t)buffer * NET_URING_BUFFER_SIZE;
+    }
+    return 1;
+}
+
+/**
+ * net_uring_reap - Walk the CQ from our head to the kernel's tail
+ */
+int net_uring_reap(NetUring* uring, NetUringEvent* events, int max) {
+    unsigned head = *uring->cq_head;
+    unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+    int filled = 0;
+
+    while (head != tail && filled < max) {
+        const struct io_uring_cqe* cqe = &uring->cqes[head & uring->cq_mask];
+        head++;
+        filled += uring_complete(uring, cqe, &events[filled]);
+    }
+
+    // The slots are the kernel's again
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+    return filled;
+}
+
+#else // !__linux__
+
+// No io_uring: creation fails and the callers stay on the reactor
+
+NetUring* net_uring_create(int entries, int max_conns, int buffers) {
+    (void)entries; (void)max_conns; (void)buffers;
+    return NULL;
+}
+void net_uring_destroy(NetUring* uring) { (void)uring; }
+int net_uring_fd(const NetUring* uring) { (void)uring; return -1; }
+int net_uring_accept(NetUring* uring, Socket listen, void* user_data) {
+    (void)uring; (void)listen; (void)user_data;
+    return -1;
+}
+int net_uring_add(NetUring* uring, Socket socket, void* user_data) {
+    (void)uring; (void)socket; (void)user_data;
+    return -1;
+}
+void net_uring_set_recv(NetUring* uring, int conn, int enabled) {
+    (void)uring; (void)conn; (void)enabled;
+}
+int net_uring_send(NetUring* uring, int conn, const void* data, int length) {
+    (void)uring; (void)conn; (void)data; (void)length;
+    return -1;
+}
+void net_uring_remove(NetUring* uring, int conn, void* orphan) {
+    (void)uring; (void)conn; (void)orphan;
+}
+void net_uring_recycle(NetUring* uring, int buffer) { (void)uring; (void)buffer; }
+int net_uring_submit(NetUring* uring) { (void)uring; return 0; }
+int net_uring_reap(NetUring* uring, NetUringEvent* events, int max) {
+    (void)uring; (void)events; (void)max;
+    return 0;
+}
+
+#endif // __linux__
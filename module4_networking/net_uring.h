@@ -0,0 +1,224 @@
+/**
+ * net_uring.h - io_uring Socket Backend (Linux)
+ *
+ * CONCEPT: One System Call Per Loop, Not Per Socket
+ * =================================================
+ * The reactor (network.h) tells us WHICH sockets are ready; every read
+ * and write is still its own system call. For a worker with 200 players
+ * a single tick costs roughly
+ *
+ *     epoll_wait + 200 x recv() + 200 x sendmsg() + epoll_ctl()s ...
+ *
+ * and each of those crosses into the kernel and back. With io_uring the
+ * requests themselves become entries in a ring of memory shared with the
+ * kernel:
+ *
+ *     user space                        kernel
+ *     ┌──────────────────────┐  enter  ┌──────────────────────────┐
+ *     │ SQ: send #3, send #9 │ ──────▶ │ does the I/O, as sockets │
+ *     │     recv #12 (rearm) │  (one   │ become ready             │
+ *     └──────────────────────┘ syscall)└────────────┬─────────────┘
+ *     ┌──────────────────────┐                      │
+ *     │ CQ: 41 bytes for #3  │ ◀────────────────────┘ (no syscall:
+ *     │     sent 812 to #9   │     completions are written into
+ *     └──────────────────────┘     memory we simply read)
+ *
+ * A whole tick's snapshot fan-out is queued as SQEs and handed over with
+ * ONE io_uring_enter(), and completions are reaped without any call.
+ *
+ * CONCEPT: Multishot Requests and Provided Buffers
+ * ================================================
+ * A plain recv request completes once. A MULTISHOT recv stays armed and
+ * posts a completion every time data arrives - one submission per
+ * connection, for its whole life. But a request that lives forever
+ * can't own a destination buffer, so the kernel picks one from a pool
+ * we PROVIDE up front (a "buffer ring", IORING_REGISTER_PBUF_RING):
+ *
+ *     buffer ring:  [b0][b1][b2][b3] ...   (we own the tail, the kernel
+ *                     │                     takes from the head)
+ *     completion:   "conn 7: 64 bytes in b1"
+ *     we:           parse b1, then net_uring_recycle(b1) puts it back
+ *
+ * The listen socket gets the same treatment: one multishot accept
+ * delivers every new connection.
+ *
+ * CONCEPT: Ordering, and When a Socket May Close
+ * ==============================================
+ * Each connection has at most ONE send in flight (a second one could
+ * complete first and interleave its bytes). The caller gathers
+ * everything it wants to send in its NetSendQueue and submits that as a
+ * single SEND - which is what linking SQEs would give us, without one
+ * failed piece cancelling the rest of a chain.
+ *
+ * A socket can't simply be closed while requests on it are pending: its
+ * descriptor number could be reused by the next accept(), and a stale
+ * completion would land on the wrong player. net_uring_remove() cancels
+ * the requests and closes the socket only once the last one completed.
+ * Completion user_data carries a generation number, so nothing from a
+ * previous occupant of a connection slot ever reaches the caller.
+ *
+ * Requires Linux 6.0 or newer (multishot recv, buffer rings); on older
+ * kernels or other platforms net_uring_create() returns NULL and the
+ * caller stays with the reactor.
+ */
+
+#ifndef NET_URING_H
+#define NET_URING_H
+
+#include <stdint.h>
+
+#include "network.h"
+
+// Receive buffers (per ring, shared by all its connections)
+#define NET_URING_BUFFER_SIZE 2048
+#define NET_URING_MAX_BUFFERS 4096  // Power of two
+
+// Opaque: the mapped rings, buffer pool and connection table
+typedef struct NetUring NetUring;
+
+/**
+ * NetUringKind - What a completion reports
+ */
+typedef enum {
+    NET_URING_ACCEPT = 1,   // result: the new socket, or -errno
+    NET_URING_RECV,         // result: bytes in 'data' (0 = peer closed, <0 = -errno)
+    NET_URING_SEND          // result: bytes sent, or -errno
+} NetUringKind;
+
+/**
+ * NetUringEvent - One completion handed to the caller
+ */
+typedef struct {
+    NetUringKind kind;
+    int conn;               // Connection (from net_uring_add), -1 for accepts
+    void* user_data;        // What was passed to net_uring_add/net_uring_accept
+    int result;
+    const uint8_t* data;    // RECV: the received bytes (inside a pool buffer)
+    int buffer;             // RECV: pool buffer to net_uring_recycle(), else -1
+} NetUringEvent;
+
+/**
+ * net_uring_create - Set up a ring (and its receive buffer pool)
+ *
+ * @param entries    Submission queue size (completion queue: 4x)
+ * @param max_conns  Connections net_uring_add() may track (0 = accept only)
+ * @param buffers    Receive buffers of NET_URING_BUFFER_SIZE (rounded up
+ *                   to a power of two, at most NET_URING_MAX_BUFFERS;
+ *                   0 = no receiving)
+ * @return           The ring, or NULL if io_uring is unavailable
+ */
+NetUring* net_uring_create(int entries, int max_conns, int buffers);
+
+/**
+ * net_uring_destroy - Close the ring and every socket still in it
+ *
+ * @param uring  The ring (NULL is ignored)
+ */
+void net_uring_destroy(NetUring* uring);
+
+/**
+ * net_uring_fd - Descriptor that polls readable while completions wait
+ *
+ * Register it with a NetReactor to sleep on the ring and other sockets
+ * at once.
+ */
+int net_uring_fd(const NetUring* uring);
+
+/**
+ * net_uring_accept - Arm a multishot accept on a listening socket
+ *
+ * Re-armed automatically if the kernel ever ends it.
+ *
+ * @param uring      The ring
+ * @param listen     Listening socket
+ * @param user_data  Reported with every NET_URING_ACCEPT
+ * @return           0 on success, -1 if the queue is full
+ */
+int net_uring_accept(NetUring* uring, Socket listen, void* user_data);
+
+/**
+ * net_uring_add - Hand a connected socket to the ring
+ *
+ * Arms a multishot recv into the buffer pool. The ring owns the socket
+ * from now on: it is closed by net_uring_remove().
+ *
+ * @param uring      The ring
+ * @param socket     Connected socket
+ * @param user_data  Reported with every completion of this connection
+ * @return           Connection number, or -1 if the table is full
+ */
+int net_uring_add(NetUring* uring, Socket socket, void* user_data);
+
+/**
+ * net_uring_set_recv - Pause or resume receiving on a connection
+ *
+ * Pausing cancels the multishot recv: new data stays in the kernel (and
+ * TCP flow control slows the sender), but completions already posted
+ * still arrive.
+ *
+ * @param uring    The ring
+ * @param conn     Connection
+ * @param enabled  1 to receive, 0 to pause
+ */
+void net_uring_set_recv(NetUring* uring, int conn, int enabled);
+
+/**
+ * net_uring_send - Queue a send of 'length' bytes
+ *
+ * The memory must stay untouched until the NET_URING_SEND completion.
+ * Only one send per connection may be in flight.
+ *
+ * @param uring   The ring
+ * @param conn    Connection
+ * @param data    Bytes to send
+ * @param length  How many
+ * @return        0 if queued, -1 on failure
+ */
+int net_uring_send(NetUring* uring, int conn, const void* data, int length);
+
+/**
+ * net_uring_remove - Stop using a connection and close its socket
+ *
+ * The close happens once every request on the socket has completed;
+ * 'orphan' (memory a pending send still reads, may be NULL) is freed
+ * at the same moment.
+ *
+ * @param uring   The ring
+ * @param conn    Connection
+ * @param orphan  malloc()'d memory to free with the socket
+ */
+void net_uring_remove(NetUring* uring, int conn, void* orphan);
+
+/**
+ * net_uring_recycle - Give a receive buffer back to the pool
+ *
+ * @param uring   The ring
+ * @param buffer  NetUringEvent.buffer (-1 is ignored)
+ */
+void net_uring_recycle(NetUring* uring, int buffer);
+
+/**
+ * net_uring_submit - Hand every queued request to the kernel
+ *
+ * One io_uring_enter() for all of them; does nothing if none are queued.
+ *
+ * @param uring  The ring (NULL is ignored)
+ * @return       Requests submitted, or -1 on failure
+ */
+int net_uring_submit(NetUring* uring);
+
+/**
+ * net_uring_reap - Take completions off the completion queue
+ *
+ * No system call. Completions of removed connections and re-arming of
+ * multishot requests are handled internally; re-arms are submitted with
+ * the next net_uring_submit().
+ *
+ * @param uring   The ring
+ * @param events  Output array
+ * @param max     Size of 'events'
+ * @return        Number of events filled in
+ */
+int net_uring_reap(NetUring* uring, NetUringEvent* events, int max);
+
+#endif // NET_URING_H
@@ -18,6 +18,11 @@
  * Each of these is a SYSTEM CALL - a request to the OS kernel.
  */
 
+// recvmmsg()/sendmmsg() are GNU extensions (must come before any #include)
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "network.h"
 
 #include <stdio.h>
@@ -27,6 +32,23 @@
 #include <fcntl.h>       // For fcntl() (non-blocking mode)
 #include <errno.h>       // For errno
 #include <netdb.h>       // For gethostbyname()
+#include <time.h>        // For clock_gettime() (UDP resends/timeouts)
+#include <poll.h>        // For poll() (net_link_wait, reactor fallback)
+#include <netinet/tcp.h> // For TCP_NODELAY, TCP_CORK
+
+#ifdef __linux__
+#include <sys/epoll.h>   // For epoll_create1(), epoll_ctl(), epoll_wait()
+#endif
+
+// macOS has no MSG_NOSIGNAL (only the per-socket SO_NOSIGPIPE). There a
+// send to a peer that hung up is kept an error - not a crash - by the
+// SIG_IGN for SIGPIPE that the server installs, as for net_send_all().
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Per thread, so each worker counts only its own calls (see network.h)
+_Thread_local uint64_t net_syscall_count = 0;
 
 /**
  * net_init - Initialize networking
@@ -142,6 +164,30 @@ Socket net_accept_client(Socket server_socket, struct sockaddr_in* client_addr)
     return client_fd;
 }
 
+/**
+ * net_resolve - Turn "host" + port into an address
+ *
+ * If 'host' is an IP like "127.0.0.1", inet_pton() converts it directly.
+ * If it's a hostname like "localhost", we need DNS resolution.
+ */
+int net_resolve(const char* host, uint16_t port, struct sockaddr_in* out) {
+    memset(out, 0, sizeof(*out));
+    out->sin_family = AF_INET;
+    out->sin_port = htons(port);
+
+    // Try to parse as IP address first
+    if (inet_pton(AF_INET, host, &out->sin_addr) <= 0) {
+        // Not a valid IP, try DNS resolution
+        struct hostent* he = gethostbyname(host);
+        if (he == NULL) {
+            fprintf(stderr, "Could not resolve hostname: %s\n", host);
+            return -1;
+        }
+        memcpy(&out->sin_addr, he->h_addr_list[0], he->h_length);
+    }
+    return 0;
+}
+
 /**
  * net_connect_to_server - Connect as a client
  *
@@ -152,24 +198,9 @@ Socket net_accept_client(Socket server_socket, struct sockaddr_in* client_addr)
  */
 Socket net_connect_to_server(const char* host, uint16_t port) {
     // --- STEP 1: Resolve hostname ---
-    //
-    // If 'host' is an IP like "127.0.0.1", inet_addr() converts it directly.
-    // If it's a hostname like "localhost", we need DNS resolution.
-
     struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(port);
-
-    // Try to parse as IP address first
-    if (inet_pton(AF_INET, host, &server_addr.sin_addr) <= 0) {
-        // Not a valid IP, try DNS resolution
-        struct hostent* he = gethostbyname(host);
-        if (he == NULL) {
-            fprintf(stderr, "Could not resolve hostname: %s\n", host);
-            return INVALID_SOCKET;
-        }
-        memcpy(&server_addr.sin_addr, he->h_addr_list[0], he->h_length);
+    if (net_resolve(host, port, &server_addr) != 0) {
+        return INVALID_SOCKET;
     }
 
     // --- STEP 2: Create socket ---
@@ -190,6 +221,9 @@ Socket net_connect_to_server(const char* host, uint16_t port) {
         return INVALID_SOCKET;
     }
 
+    // --- STEP 4: Every message leaves at once (see network.h) ---
+    net_set_nodelay(sock);
+
     return sock;
 }
 
@@ -210,6 +244,7 @@ int net_send_all(Socket socket, const void* data, int length) {
     int total_sent = 0;
 
     while (total_sent < length) {
+        net_syscall_count++;
         int bytes_sent = send(socket, ptr + total_sent, length - total_sent, 0);
 
         if (bytes_sent < 0) {
@@ -232,6 +267,121 @@ int net_send_all(Socket socket, const void* data, int length) {
     return total_sent;
 }
 
+/**
+ * net_send_vectored - Send several buffers with sendmsg()
+ *
+ * After a partial send we skip the pieces that went out completely and
+ * trim the one that went out halfway, then call sendmsg() again. We work
+ * on a local copy of the iovec array so the caller's stays intact.
+ */
+int net_send_vectored(Socket socket, const struct iovec* iov, int count) {
+    if (count < 1 || count > NET_MAX_IOVECS) return -1;
+
+    struct iovec parts[NET_MAX_IOVECS];
+    memcpy(parts, iov, count * sizeof(struct iovec));
+
+    struct iovec* current = parts;
+    int remaining = count;
+    int total_sent = 0;
+
+    while (remaining > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = current;
+        msg.msg_iovlen = remaining;
+
+        net_syscall_count++;
+        ssize_t bytes_sent = sendmsg(socket, &msg, 0);
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                // Interrupted by signal, try again
+                continue;
+            }
+            perror("sendmsg() failed");
+            return -1;
+        }
+
+        total_sent += (int)bytes_sent;
+
+        // Skip fully sent pieces, trim a partially sent one
+        while (remaining > 0 && (size_t)bytes_sent >= current->iov_len) {
+            bytes_sent -= (ssize_t)current->iov_len;
+            current++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            current->iov_base = (char*)current->iov_base + bytes_sent;
+            current->iov_len -= (size_t)bytes_sent;
+        }
+    }
+
+    return total_sent;
+}
+
+/**
+ * net_batch_begin - Empty batch for 'socket'
+ */
+void net_batch_begin(NetBatch* batch, Socket socket, int cork) {
+    batch->socket = socket;
+    batch->cork = cork;
+    batch->corked = 0;
+    batch->count = 0;
+    batch->failed = 0;
+    batch->sent = 0;
+}
+
+/**
+ * batch_write - One sendmsg() for everything appended so far
+ */
+static void batch_write(NetBatch* batch) {
+    if (batch->count == 0) return;
+    if (!batch->failed) {
+        int sent = net_send_vectored(batch->socket, batch->parts, 2 * batch->count);
+        if (sent < 0) {
+            batch->failed = 1;
+        } else {
+            batch->sent += sent;
+        }
+    }
+    batch->count = 0;
+}
+
+/**
+ * net_batch_add - Header into the batch, payload by reference
+ *
+ * A full batch is written first - corked, if asked to, since more
+ * writes are coming.
+ */
+int net_batch_add(NetBatch* batch, uint8_t type, const void* payload, int length) {
+    if (batch->count == NET_BATCH_MESSAGES) {
+        if (batch->cork && !batch->corked && !batch->failed) {
+            batch->corked = (net_set_cork(batch->socket, 1) == 0);
+        }
+        batch_write(batch);
+    }
+    if (batch->failed) return -1;
+
+    MessageHeader* header = &batch->headers[batch->count];
+    header->type = type;
+    header->length = (uint16_t)length;
+    batch->parts[2 * batch->count] = (struct iovec){ header, sizeof(MessageHeader) };
+    batch->parts[2 * batch->count + 1] = (struct iovec){ (void*)payload, (size_t)length };
+    batch->count++;
+    return 0;
+}
+
+/**
+ * net_batch_flush - Last write, then uncork
+ */
+int net_batch_flush(NetBatch* batch) {
+    batch_write(batch);
+    if (batch->corked) {
+        net_set_cork(batch->socket, 0);
+        batch->corked = 0;
+    }
+    return batch->failed ? -1 : batch->sent;
+}
+
 /**
  * net_recv_all - Receive exactly N bytes
  *
@@ -243,6 +393,7 @@ int net_recv_all(Socket socket, void* buffer, int length) {
     int total_received = 0;
 
     while (total_received < length) {
+        net_syscall_count++;
         int bytes_received = recv(socket, ptr + total_received,
                                    length - total_received, 0);
 
@@ -300,6 +451,32 @@ int net_set_nonblocking(Socket socket) {
     return 0;
 }
 
+/**
+ * net_set_nodelay - setsockopt(TCP_NODELAY)
+ */
+int net_set_nodelay(Socket socket) {
+    int on = 1;
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+        perror("setsockopt(TCP_NODELAY) failed");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * net_set_cork - setsockopt(TCP_CORK), or TCP_NOPUSH where that's the name
+ */
+int net_set_cork(Socket socket, int on) {
+#if defined(TCP_CORK)
+    return setsockopt(socket, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+#elif defined(TCP_NOPUSH)
+    return setsockopt(socket, IPPROTO_TCP, TCP_NOPUSH, &on, sizeof(on));
+#else
+    (void)socket; (void)on;
+    return -1;
+#endif
+}
+
 /**
  * net_get_error_string - Get error description
  */
@@ -325,3 +502,1211 @@ char* net_addr_to_string(const struct sockaddr_in* addr, char* buffer, int size)
 
     return buffer;
 }
+
+/**
+ * NetReactor - Backend state
+ *
+ * Both backends keep a user_data lookup so NetEvent can hand back the
+ * caller's pointer:
+ *     - epoll:  table indexed by fd (epoll only gives us the fd back)
+ *     - poll(): parallel arrays of pollfd + user_data
+ */
+struct NetReactor {
+#ifdef __linux__
+    int epoll_fd;
+    struct epoll_event* ready;   // Scratch array for epoll_wait()
+    int ready_capacity;
+    void** user_data;            // user_data[fd]
+    int user_data_capacity;
+#else
+    struct pollfd* fds;
+    void** user_data;            // user_data[i] belongs to fds[i]
+    int count;
+    int capacity;
+#endif
+};
+
+#ifdef __linux__
+
+/**
+ * reactor_to_epoll - Translate NET_EVENT_* bits to EPOLL* bits
+ */
+static uint32_t reactor_to_epoll(uint32_t events) {
+    uint32_t result = 0;
+    if (events & NET_EVENT_READ)  result |= EPOLLIN;
+    if (events & NET_EVENT_WRITE) result |= EPOLLOUT;
+    return result;
+}
+
+/**
+ * reactor_reserve_fd - Grow the user_data table so 'fd' is a valid index
+ */
+static int reactor_reserve_fd(NetReactor* reactor, int fd) {
+    if (fd < reactor->user_data_capacity) return 0;
+
+    int new_capacity = reactor->user_data_capacity;
+    while (new_capacity <= fd) new_capacity *= 2;
+
+    void** grown = realloc(reactor->user_data, new_capacity * sizeof(void*));
+    if (grown == NULL) return -1;
+
+    memset(grown + reactor->user_data_capacity, 0,
+           (new_capacity - reactor->user_data_capacity) * sizeof(void*));
+    reactor->user_data = grown;
+    reactor->user_data_capacity = new_capacity;
+    return 0;
+}
+
+#endif
+
+/**
+ * net_reactor_create - Create a reactor
+ */
+NetReactor* net_reactor_create(int max_sockets) {
+    if (max_sockets < 16) max_sockets = 16;
+
+    NetReactor* reactor = calloc(1, sizeof(NetReactor));
+    if (reactor == NULL) return NULL;
+
+#ifdef __linux__
+    // EPOLL_CLOEXEC: don't leak the epoll fd into child processes
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->ready_capacity = max_sockets;
+    reactor->ready = malloc(max_sockets * sizeof(struct epoll_event));
+    reactor->user_data_capacity = max_sockets;
+    reactor->user_data = calloc(max_sockets, sizeof(void*));
+
+    if (reactor->epoll_fd < 0 || reactor->ready == NULL || reactor->user_data == NULL) {
+        perror("epoll_create1() failed");
+        net_reactor_destroy(reactor);
+        return NULL;
+    }
+#else
+    reactor->capacity = max_sockets;
+    reactor->fds = malloc(max_sockets * sizeof(struct pollfd));
+    reactor->user_data = malloc(max_sockets * sizeof(void*));
+
+    if (reactor->fds == NULL || reactor->user_data == NULL) {
+        net_reactor_destroy(reactor);
+        return NULL;
+    }
+#endif
+
+    return reactor;
+}
+
+/**
+ * net_reactor_destroy - Destroy a reactor
+ */
+void net_reactor_destroy(NetReactor* reactor) {
+    if (reactor == NULL) return;
+
+#ifdef __linux__
+    if (reactor->epoll_fd >= 0) {
+        close(reactor->epoll_fd);
+    }
+    free(reactor->ready);
+#else
+    free(reactor->fds);
+#endif
+    free(reactor->user_data);
+    free(reactor);
+}
+
+/**
+ * net_reactor_add - Start watching a socket
+ */
+int net_reactor_add(NetReactor* reactor, Socket socket, uint32_t events, void* user_data) {
+    if (reactor == NULL || socket == INVALID_SOCKET) return -1;
+
+#ifdef __linux__
+    if (reactor_reserve_fd(reactor, socket) != 0) return -1;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = reactor_to_epoll(events);
+    ev.data.fd = socket;
+
+    net_syscall_count++;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, socket, &ev) < 0) {
+        perror("epoll_ctl(ADD) failed");
+        return -1;
+    }
+    reactor->user_data[socket] = user_data;
+#else
+    if (reactor->count == reactor->capacity) {
+        int new_capacity = reactor->capacity * 2;
+        struct pollfd* fds = realloc(reactor->fds, new_capacity * sizeof(struct pollfd));
+        if (fds == NULL) return -1;
+        reactor->fds = fds;
+
+        void** data = realloc(reactor->user_data, new_capacity * sizeof(void*));
+        if (data == NULL) return -1;
+        reactor->user_data = data;
+
+        reactor->capacity = new_capacity;
+    }
+
+    struct pollfd* pfd = &reactor->fds[reactor->count];
+    pfd->fd = socket;
+    pfd->events = 0;
+    if (events & NET_EVENT_READ)  pfd->events |= POLLIN;
+    if (events & NET_EVENT_WRITE) pfd->events |= POLLOUT;
+    pfd->revents = 0;
+    reactor->user_data[reactor->count] = user_data;
+    reactor->count++;
+#endif
+
+    return 0;
+}
+
+/**
+ * net_reactor_modify - Change what we wait for on a socket
+ */
+int net_reactor_modify(NetReactor* reactor, Socket socket, uint32_t events, void* user_data) {
+    if (reactor == NULL || socket == INVALID_SOCKET) return -1;
+
+#ifdef __linux__
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = reactor_to_epoll(events);
+    ev.data.fd = socket;
+
+    net_syscall_count++;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, socket, &ev) < 0) {
+        perror("epoll_ctl(MOD) failed");
+        return -1;
+    }
+    reactor->user_data[socket] = user_data;
+    return 0;
+#else
+    for (int i = 0; i < reactor->count; i++) {
+        if (reactor->fds[i].fd == socket) {
+            reactor->fds[i].events = 0;
+            if (events & NET_EVENT_READ)  reactor->fds[i].events |= POLLIN;
+            if (events & NET_EVENT_WRITE) reactor->fds[i].events |= POLLOUT;
+            reactor->user_data[i] = user_data;
+            return 0;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+ * net_reactor_remove - Stop watching a socket
+ */
+int net_reactor_remove(NetReactor* reactor, Socket socket) {
+    if (reactor == NULL || socket == INVALID_SOCKET) return -1;
+
+#ifdef __linux__
+    // Linux < 2.6.9 required a non-NULL event pointer even for DEL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    net_syscall_count++;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, socket, &ev) < 0) {
+        return -1;
+    }
+    if (socket < reactor->user_data_capacity) {
+        reactor->user_data[socket] = NULL;
+    }
+    return 0;
+#else
+    for (int i = 0; i < reactor->count; i++) {
+        if (reactor->fds[i].fd == socket) {
+            // Swap-remove: move the last entry into this hole
+            reactor->count--;
+            reactor->fds[i] = reactor->fds[reactor->count];
+            reactor->user_data[i] = reactor->user_data[reactor->count];
+            return 0;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+ * net_reactor_wait - Collect ready sockets
+ *
+ * EINTR (a signal such as Ctrl+C arrived) is reported as "0 events"
+ * so the caller's loop gets a chance to check its running flag.
+ */
+int net_reactor_wait(NetReactor* reactor, NetEvent* events, int max_events, int timeout_ms) {
+    if (reactor == NULL || events == NULL || max_events <= 0) return -1;
+
+#ifdef __linux__
+    if (max_events > reactor->ready_capacity) {
+        struct epoll_event* grown = realloc(reactor->ready,
+                                            max_events * sizeof(struct epoll_event));
+        if (grown == NULL) return -1;
+        reactor->ready = grown;
+        reactor->ready_capacity = max_events;
+    }
+
+    net_syscall_count++;
+    int n = epoll_wait(reactor->epoll_fd, reactor->ready, max_events, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return 0;
+        perror("epoll_wait() failed");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int fd = reactor->ready[i].data.fd;
+        uint32_t ev = reactor->ready[i].events;
+
+        events[i].socket = fd;
+        events[i].events = 0;
+        if (ev & EPOLLIN)              events[i].events |= NET_EVENT_READ;
+        if (ev & EPOLLOUT)             events[i].events |= NET_EVENT_WRITE;
+        if (ev & (EPOLLERR | EPOLLHUP)) events[i].events |= NET_EVENT_ERROR;
+        events[i].user_data = reactor->user_data[fd];
+    }
+
+    return n;
+#else
+    net_syscall_count++;
+    int n = poll(reactor->fds, (nfds_t)reactor->count, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return 0;
+        perror("poll() failed");
+        return -1;
+    }
+
+    int filled = 0;
+    for (int i = 0; i < reactor->count && filled < max_events && n > 0; i++) {
+        short rev = reactor->fds[i].revents;
+        if (rev == 0) continue;
+        n--;
+
+        events[filled].socket = reactor->fds[i].fd;
+        events[filled].events = 0;
+        if (rev & POLLIN)              events[filled].events |= NET_EVENT_READ;
+        if (rev & POLLOUT)             events[filled].events |= NET_EVENT_WRITE;
+        if (rev & (POLLERR | POLLHUP)) events[filled].events |= NET_EVENT_ERROR;
+        events[filled].user_data = reactor->user_data[i];
+        filled++;
+    }
+
+    return filled;
+#endif
+}
+
+/**
+ * net_recv_buffer_init - Attach a receive buffer to caller storage
+ */
+void net_recv_buffer_init(NetRecvBuffer* buffer, uint8_t* storage, int capacity) {
+    buffer->data = storage;
+    buffer->capacity = capacity;
+    buffer->head = 0;
+    buffer->tail = 0;
+    buffer->peer_closed = 0;
+}
+
+/**
+ * net_recv_buffer_fill - Read everything that is waiting on a socket
+ *
+ * STEP BY STEP:
+ * 1. Slide unread bytes (at most one partial frame, usually) to offset 0
+ * 2. recv() into all the free space at once
+ * 3. A short read means the kernel queue is empty - stop without paying
+ *    for the extra recv() that would only return EAGAIN
+ */
+int net_recv_buffer_fill(Socket socket, NetRecvBuffer* buffer) {
+    if (buffer->peer_closed) return -1;
+
+    // --- STEP 1: Reclaim consumed space ---
+    if (buffer->head > 0) {
+        int unread = buffer->tail - buffer->head;
+        if (unread > 0) {
+            memmove(buffer->data, buffer->data + buffer->head, unread);
+        }
+        buffer->head = 0;
+        buffer->tail = unread;
+    }
+
+    // --- STEP 2: Read until the kernel queue or our buffer is empty ---
+    int total = 0;
+    while (buffer->tail < buffer->capacity) {
+        int space = buffer->capacity - buffer->tail;
+        net_syscall_count++;
+        int n = recv(socket, buffer->data + buffer->tail, space, MSG_DONTWAIT);
+
+        if (n > 0) {
+            buffer->tail += n;
+            total += n;
+            if (n < space) break;  // --- STEP 3: Drained ---
+            continue;
+        }
+
+        if (n == 0) {
+            // Peer closed the connection
+            buffer->peer_closed = 1;
+            break;
+        }
+
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+        // Real error (e.g. ECONNRESET)
+        buffer->peer_closed = 1;
+        break;
+    }
+
+    if (total == 0 && buffer->peer_closed) return -1;
+    return total;
+}
+
+/**
+ * net_recv_buffer_append - Reclaim consumed space, copy what fits
+ */
+int net_recv_buffer_append(NetRecvBuffer* buffer, const uint8_t* data, int length) {
+    if (buffer->head > 0) {
+        int unread = buffer->tail - buffer->head;
+        if (unread > 0) {
+            memmove(buffer->data, buffer->data + buffer->head, unread);
+        }
+        buffer->head = 0;
+        buffer->tail = unread;
+    }
+
+    int space = buffer->capacity - buffer->tail;
+    int taken = (length < space) ? length : space;
+    memcpy(buffer->data + buffer->tail, data, taken);
+    buffer->tail += taken;
+    return taken;
+}
+
+/**
+ * net_recv_buffer_next - Take the next complete frame
+ *
+ * The header is copied out with memcpy because it may sit at any byte
+ * offset; the payload is handed out in place.
+ */
+int net_recv_buffer_next(NetRecvBuffer* buffer, NetFrame* frame) {
+    int unread = buffer->tail - buffer->head;
+    if (unread < (int)sizeof(MessageHeader)) return 0;
+
+    MessageHeader header;
+    memcpy(&header, buffer->data + buffer->head, sizeof(header));
+
+    int frame_size = (int)sizeof(MessageHeader) + header.length;
+    if (frame_size > buffer->capacity) {
+        // Can never fit - the stream is garbage (or hostile)
+        return -1;
+    }
+    if (unread < frame_size) return 0;  // Rest is still in flight
+
+    frame->header = header;
+    frame->payload = buffer->data + buffer->head + sizeof(MessageHeader);
+    buffer->head += frame_size;
+    return 1;
+}
+
+/**
+ * net_send_queue_init - Empty, no storage yet
+ */
+void net_send_queue_init(NetSendQueue* queue, int capacity) {
+    memset(queue, 0, sizeof(NetSendQueue));
+    queue->capacity = capacity;
+    queue->latest = -1;
+}
+
+/**
+ * net_send_queue_free - Drop the storage and anything still queued
+ */
+void net_send_queue_free(NetSendQueue* queue) {
+    free(queue->data);
+    queue->data = NULL;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->latest = -1;
+    queue->in_flight = 0;
+}
+
+/**
+ * queue_sendmsg - One non-blocking sendmsg()
+ *
+ * A full send buffer is not an error here, just "0 bytes taken".
+ *
+ * @return  Bytes the kernel took, or -1 on a socket error
+ */
+static int queue_sendmsg(Socket socket, struct iovec* iov, int count) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    for (;;) {
+        net_syscall_count++;
+        ssize_t bytes_sent = sendmsg(socket, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (bytes_sent >= 0) return (int)bytes_sent;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+}
+
+/**
+ * net_send_queue_push - Send one message (or queue what can't go out now)
+ *
+ * STEP BY STEP:
+ * 1. Nothing queued: one sendmsg() straight from the caller's pieces.
+ *    Usually that's the whole message and we're done (not for an
+ *    async queue - its owner sends)
+ * 2. A newer snapshot makes the unsent older one worthless: cut it out
+ * 3. Copy whatever the kernel didn't take to the tail (sliding the
+ *    queue back to offset 0 first if the end is in the way - unless
+ *    bytes are in flight)
+ */
+int net_send_queue_push(NetSendQueue* queue, Socket socket,
+                        const struct iovec* iov, int count, int flags) {
+    if (count < 1 || count > NET_MAX_IOVECS) return -1;
+
+    int length = 0;
+    for (int i = 0; i < count; i++) length += (int)iov[i].iov_len;
+
+    // --- STEP 1: Fast path, zero copy ---
+    int sent = 0;
+    if (net_send_queue_pending(queue) == 0 && queue->async) {
+        queue->head = 0;
+        queue->tail = 0;
+        queue->latest = -1;
+    } else if (net_send_queue_pending(queue) == 0) {
+        queue->head = 0;
+        queue->tail = 0;
+        queue->latest = -1;
+
+        struct iovec parts[NET_MAX_IOVECS];
+        memcpy(parts, iov, count * sizeof(struct iovec));
+        sent = queue_sendmsg(socket, parts, count);
+        if (sent < 0) return -1;
+        if (sent == length) return length;
+    } else if ((flags & NET_QUEUE_LATEST) && !(flags & NET_QUEUE_CONTINUE) &&
+               queue->latest >= 0) {
+        // --- STEP 2: Supersede the unsent snapshot ---
+        int stale = queue->latest_end - queue->latest;
+        memmove(queue->data + queue->latest, queue->data + queue->latest_end,
+                queue->tail - queue->latest_end);
+        queue->tail -= stale;
+        queue->latest = -1;
+        queue->superseded++;
+    }
+
+    // --- STEP 3: Queue the rest ---
+    int rest = length - sent;
+    if (net_send_queue_pending(queue) + rest > queue->capacity) return NET_QUEUE_FULL;
+    if (queue->data == NULL) {
+        queue->data = malloc(queue->capacity);
+        if (queue->data == NULL) return -1;
+    }
+    if (queue->tail + rest > queue->capacity) {
+        if (queue->in_flight > 0) return NET_QUEUE_FULL;
+        int pending = net_send_queue_pending(queue);
+        memmove(queue->data, queue->data + queue->head, pending);
+        if (queue->latest >= 0) {
+            queue->latest -= queue->head;
+            queue->latest_end -= queue->head;
+        }
+        queue->head = 0;
+        queue->tail = pending;
+    }
+
+    int start = queue->tail;
+    int skip = sent;
+    for (int i = 0; i < count; i++) {
+        int piece = (int)iov[i].iov_len;
+        if (skip >= piece) {
+            skip -= piece;
+            continue;
+        }
+        memcpy(queue->data + queue->tail, (const uint8_t*)iov[i].iov_base + skip, piece - skip);
+        queue->tail += piece - skip;
+        skip = 0;
+    }
+
+    // Only a message of which nothing has left yet can be superseded
+    if (flags & NET_QUEUE_CONTINUE) {
+        if (queue->latest >= 0 && queue->latest_end == start) queue->latest_end = queue->tail;
+    } else if ((flags & NET_QUEUE_LATEST) && sent == 0) {
+        queue->latest = start;
+        queue->latest_end = queue->tail;
+    }
+    return length;
+}
+
+/**
+ * net_send_queue_flush - send() from the head until the kernel stops taking
+ */
+int net_send_queue_flush(NetSendQueue* queue, Socket socket) {
+    while (net_send_queue_pending(queue) > 0) {
+        int pending = net_send_queue_pending(queue);
+        net_syscall_count++;
+        int n = send(socket, queue->data + queue->head, pending, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        queue->head += n;
+        if (n < pending) break;  // Send buffer full again
+    }
+
+    // The snapshot has started to leave: it must now be finished
+    if (queue->latest >= 0 && queue->head > queue->latest) queue->latest = -1;
+
+    if (net_send_queue_pending(queue) == 0) {
+        queue->head = 0;
+        queue->tail = 0;
+        queue->latest = -1;
+    }
+    return net_send_queue_pending(queue);
+}
+
+/**
+ * net_send_queue_begin_async - Slide to offset 0, pin the bytes to send
+ *
+ * Sliding now, while nothing is in flight, keeps the free space at the
+ * end big enough for the pushes that arrive while the send is pending.
+ */
+int net_send_queue_begin_async(NetSendQueue* queue, const uint8_t** data) {
+    int pending = net_send_queue_pending(queue);
+    if (pending == 0) return 0;
+
+    if (queue->head > 0) {
+        memmove(queue->data, queue->data + queue->head, pending);
+        if (queue->latest >= 0) {
+            queue->latest -= queue->head;
+            queue->latest_end -= queue->head;
+        }
+        queue->head = 0;
+        queue->tail = pending;
+    }
+
+    // Whatever precedes the newest snapshot goes first; the snapshot
+    // itself only once it is at the front (and then it can't be dropped)
+    int length = pending;
+    if (queue->latest > 0) {
+        length = queue->latest;
+    } else {
+        queue->latest = -1;
+    }
+
+    queue->in_flight = length;
+    *data = queue->data;
+    return length;
+}
+
+/**
+ * net_send_queue_end_async - Release the pinned bytes that went out
+ */
+void net_send_queue_end_async(NetSendQueue* queue, int sent) {
+    queue->in_flight = 0;
+    queue->head += sent;
+    if (net_send_queue_pending(queue) == 0) {
+        queue->head = 0;
+        queue->tail = 0;
+        queue->latest = -1;
+    }
+}
+
+/**
+ * net_time_ms - Monotonic milliseconds
+ */
+uint64_t net_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+/**
+ * net_create_udp_socket - socket(SOCK_DGRAM) + bind + non-blocking
+ *
+ * UDP has no listen()/accept(): one socket receives datagrams from
+ * every peer, and recvfrom() tells us who sent each one.
+ */
+Socket net_create_udp_socket(uint16_t port) {
+    Socket sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == INVALID_SOCKET) {
+        perror("socket(SOCK_DGRAM) failed");
+        return INVALID_SOCKET;
+    }
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind(SOCK_DGRAM) failed");
+        close(sock);
+        return INVALID_SOCKET;
+    }
+
+    net_set_nonblocking(sock);
+    return sock;
+}
+
+/**
+ * udp_seq_newer - Is sequence 'a' newer than 'b'?
+ *
+ * Sequences are 16 bits and wrap around (65535 -> 0). Treating the
+ * difference as SIGNED makes "a little bit ahead" win even across the
+ * wrap: udp_seq_newer(2, 65534) is true.
+ */
+static int udp_seq_newer(uint16_t a, uint16_t b) {
+    return (int16_t)(uint16_t)(a - b) > 0;
+}
+
+/**
+ * net_udp_connection_init - Start a fresh connection
+ */
+void net_udp_connection_init(NetUdpConnection* conn, uint32_t id, const struct sockaddr_in* addr) {
+    memset(conn, 0, sizeof(NetUdpConnection));
+    conn->connection_id = id;
+    conn->addr = *addr;
+    conn->last_recv_ms = net_time_ms();
+}
+
+/**
+ * net_udp_connection_accept - Server side: start from a client's MSG_CONNECT
+ */
+void net_udp_connection_accept(NetUdpConnection* conn, uint32_t id,
+                               const struct sockaddr_in* addr, const NetUdpHeader* connect) {
+    net_udp_connection_init(conn, id, addr);
+    conn->remote_sequence = connect->sequence;
+    conn->received_any = 1;
+    if (connect->flags & NET_UDP_FLAG_RELIABLE) {
+        conn->reliable_recv_seq = (uint16_t)(connect->reliable_seq + 1);
+    }
+}
+
+/**
+ * net_udp_parse_header - Validate and copy out a datagram's header
+ */
+int net_udp_parse_header(const uint8_t* packet, int length, NetUdpHeader* out) {
+    if (length < (int)sizeof(NetUdpHeader)) return -1;
+    memcpy(out, packet, sizeof(NetUdpHeader));
+    return (out->protocol_id == NET_UDP_PROTOCOL_ID) ? 0 : -1;
+}
+
+/**
+ * udp_write_header - Stamp sequence and ack history into a new packet
+ */
+static int udp_write_header(NetUdpConnection* conn, uint8_t* out,
+                            uint8_t flags, uint16_t reliable_seq) {
+    NetUdpHeader header = {
+        .protocol_id = NET_UDP_PROTOCOL_ID,
+        .connection_id = conn->connection_id,
+        .sequence = conn->local_sequence++,
+        .ack = conn->remote_sequence,
+        .ack_bits = conn->received_bits,
+        .flags = (uint8_t)(flags | (conn->received_any ? NET_UDP_FLAG_HAS_ACK : 0)),
+        .reliable_seq = reliable_seq
+    };
+    memcpy(out, &header, sizeof(header));
+    return (int)sizeof(header);
+}
+
+/**
+ * net_udp_write_header - Write an unreliable header
+ */
+int net_udp_write_header(NetUdpConnection* conn, uint8_t* out) {
+    return udp_write_header(conn, out, 0, 0);
+}
+
+/**
+ * net_udp_encode - Header + MessageHeader + payload in one buffer
+ */
+int net_udp_encode(NetUdpConnection* conn, uint8_t* out, int capacity,
+                   uint8_t type, const void* payload, int length) {
+    int total = (int)(sizeof(NetUdpHeader) + sizeof(MessageHeader)) + length;
+    if (total > capacity) return -1;
+
+    int offset = net_udp_write_header(conn, out);
+    MessageHeader header = { .type = type, .length = (uint16_t)length };
+    memcpy(out + offset, &header, sizeof(header));
+    if (length > 0) {
+        memcpy(out + offset + sizeof(header), payload, length);
+    }
+    return total;
+}
+
+/**
+ * net_udp_queue_reliable - Park a control message in the outbox
+ */
+int net_udp_queue_reliable(NetUdpConnection* conn, uint8_t type,
+                           const void* payload, int length) {
+    if (length > NET_UDP_RELIABLE_MAX) return -1;
+
+    for (int i = 0; i < NET_UDP_RELIABLE_WINDOW; i++) {
+        NetUdpReliable* slot = &conn->outbox[i];
+        if (slot->length != 0) continue;
+
+        MessageHeader header = { .type = type, .length = (uint16_t)length };
+        memcpy(slot->message, &header, sizeof(header));
+        if (length > 0) {
+            memcpy(slot->message + sizeof(header), payload, length);
+        }
+        slot->length = (int)sizeof(header) + length;
+        slot->reliable_seq = conn->reliable_send_seq++;
+        slot->sent = 0;
+        return 0;
+    }
+    return -1;  // Window full - peer isn't acking
+}
+
+/**
+ * net_udp_next_resend - Build the oldest due reliable datagram
+ *
+ * Oldest first, so the receiver (which only accepts the next number
+ * in order) isn't handed messages it must throw away.
+ */
+int net_udp_next_resend(NetUdpConnection* conn, uint64_t now_ms, uint8_t* out, int capacity) {
+    NetUdpReliable* due = NULL;
+
+    for (int i = 0; i < NET_UDP_RELIABLE_WINDOW; i++) {
+        NetUdpReliable* slot = &conn->outbox[i];
+        if (slot->length == 0) continue;
+        if (slot->sent && now_ms - slot->sent_ms < NET_UDP_RESEND_MS) continue;
+        if (due == NULL || udp_seq_newer(due->reliable_seq, slot->reliable_seq)) {
+            due = slot;
+        }
+    }
+    if (due == NULL) return 0;
+
+    int total = (int)sizeof(NetUdpHeader) + due->length;
+    if (total > capacity) return 0;
+
+    due->packet_seq = conn->local_sequence;
+    due->sent = 1;
+    due->sent_ms = now_ms;
+
+    int offset = udp_write_header(conn, out, NET_UDP_FLAG_RELIABLE, due->reliable_seq);
+    memcpy(out + offset, due->message, due->length);
+    return total;
+}
+
+/**
+ * net_udp_reliable_pending - Reliable messages not acked yet
+ */
+int net_udp_reliable_pending(const NetUdpConnection* conn) {
+    int pending = 0;
+    for (int i = 0; i < NET_UDP_RELIABLE_WINDOW; i++) {
+        if (conn->outbox[i].length != 0) pending++;
+    }
+    return pending;
+}
+
+/**
+ * udp_record_received - Add a packet number to our receive history
+ *
+ *     remote_sequence = 100, received_bits = ...0101
+ *                                              │ └─ 99 received
+ *                                              └─── 97 received
+ *
+ * @return 1 if it is the newest packet so far, 0 if older or duplicate
+ */
+static int udp_record_received(NetUdpConnection* conn, uint16_t sequence) {
+    if (!conn->received_any) {
+        conn->received_any = 1;
+        conn->remote_sequence = sequence;
+        conn->received_bits = 0;
+        return 1;
+    }
+
+    if (udp_seq_newer(sequence, conn->remote_sequence)) {
+        // Slide the window forward; the old newest becomes bit (shift-1)
+        uint16_t shift = (uint16_t)(sequence - conn->remote_sequence);
+        uint32_t bits = (shift < 32) ? (conn->received_bits << shift) : 0;
+        if (shift <= 32) bits |= 1u << (shift - 1);
+        conn->received_bits = bits;
+        conn->remote_sequence = sequence;
+        return 1;
+    }
+
+    uint16_t behind = (uint16_t)(conn->remote_sequence - sequence);
+    if (behind >= 1 && behind <= 32) {
+        conn->received_bits |= 1u << (behind - 1);
+    }
+    return 0;
+}
+
+/**
+ * udp_process_acks - Retire reliable messages whose packet was acked
+ */
+static void udp_process_acks(NetUdpConnection* conn, uint16_t ack, uint32_t ack_bits) {
+    for (int i = 0; i < NET_UDP_RELIABLE_WINDOW; i++) {
+        NetUdpReliable* slot = &conn->outbox[i];
+        if (slot->length == 0 || !slot->sent) continue;
+
+        uint16_t behind = (uint16_t)(ack - slot->packet_seq);
+        if (behind == 0 || (behind <= 32 && (ack_bits & (1u << (behind - 1))))) {
+            slot->length = 0;
+        }
+    }
+}
+
+/**
+ * net_udp_receive - Run one datagram through the sequence/ack layer
+ */
+int net_udp_receive(NetUdpConnection* conn, const uint8_t* packet, int length,
+                    uint64_t now_ms, NetFrame* frame) {
+    NetUdpHeader header;
+    if (net_udp_parse_header(packet, length, &header) != 0) return 0;
+
+    // Before the server assigns our id (connection_id == 0) we accept
+    // anything; afterwards only packets for our connection.
+    if (conn->connection_id != 0 && header.connection_id != conn->connection_id) {
+        return 0;
+    }
+
+    // The datagram must contain exactly one complete frame
+    int body = length - (int)sizeof(NetUdpHeader);
+    MessageHeader message;
+    if (body < (int)sizeof(MessageHeader)) return 0;
+    memcpy(&message, packet + sizeof(NetUdpHeader), sizeof(message));
+    if ((int)sizeof(MessageHeader) + message.length > body) return 0;
+
+    // A reliable message from the FUTURE (one before it was lost): drop
+    // it WITHOUT recording the packet, so the sender resends it later -
+    // in order.
+    int reliable = header.flags & NET_UDP_FLAG_RELIABLE;
+    if (reliable && udp_seq_newer(header.reliable_seq, conn->reliable_recv_seq)) {
+        return 0;
+    }
+
+    if (conn->connection_id == 0) {
+        conn->connection_id = header.connection_id;
+    }
+    conn->last_recv_ms = now_ms;
+
+    int newest = udp_record_received(conn, header.sequence);
+    if (header.flags & NET_UDP_FLAG_HAS_ACK) {
+        udp_process_acks(conn, header.ack, header.ack_bits);
+    }
+
+    if (reliable) {
+        if (header.reliable_seq != conn->reliable_recv_seq) {
+            return 0;  // Duplicate of something already delivered
+        }
+        conn->reliable_recv_seq++;
+    } else if (!newest) {
+        return 0;  // Stale: something newer was already delivered
+    }
+
+    frame->header = message;
+    frame->payload = packet + sizeof(NetUdpHeader) + sizeof(MessageHeader);
+    return 1;
+}
+
+/**
+ * net_udp_recv_batch - Receive up to 'max' datagrams
+ *
+ * CONCEPT: Batched System Calls
+ * =============================
+ * recvfrom() returns ONE datagram per system call. With 64 players
+ * sending input at 60 Hz that is ~4000 syscalls a second just to read.
+ * recvmmsg() fills an array of message headers in a single call.
+ */
+int net_udp_recv_batch(Socket socket, NetDatagram* out, int max) {
+    if (max > NET_UDP_BATCH_SIZE) max = NET_UDP_BATCH_SIZE;
+    if (max <= 0) return 0;
+
+#ifdef __linux__
+    struct mmsghdr msgs[NET_UDP_BATCH_SIZE];
+    struct iovec iov[NET_UDP_BATCH_SIZE];
+    memset(msgs, 0, max * sizeof(struct mmsghdr));
+
+    for (int i = 0; i < max; i++) {
+        iov[i].iov_base = out[i].data;
+        iov[i].iov_len = sizeof(out[i].data);
+        msgs[i].msg_hdr.msg_name = &out[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(out[i].addr);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int n;
+    do {
+        net_syscall_count++;
+        n = recvmmsg(socket, msgs, max, MSG_DONTWAIT, NULL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        perror("recvmmsg() failed");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        // Oversized datagrams were cut off - they can't be ours
+        out[i].length = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : (int)msgs[i].msg_len;
+    }
+    return n;
+#else
+    int count = 0;
+    while (count < max) {
+        socklen_t addr_len = sizeof(out[count].addr);
+        net_syscall_count++;
+        ssize_t n = recvfrom(socket, out[count].data, sizeof(out[count].data), MSG_DONTWAIT,
+                             (struct sockaddr*)&out[count].addr, &addr_len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (count == 0) {
+                perror("recvfrom() failed");
+                return -1;
+            }
+            break;
+        }
+        out[count].length = (int)n;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * net_udp_send_batch - Send many datagrams (sendmmsg on Linux)
+ *
+ * Each datagram is gathered from two pieces - its own head and the
+ * (possibly shared) body - so nothing is copied here either.
+ */
+int net_udp_send_batch(Socket socket, const NetUdpSend* items, int count) {
+    int done = 0;      // Datagrams handled (sent or dropped)
+    int sent = 0;
+
+    while (done < count) {
+        int n = count - done;
+        if (n > NET_UDP_BATCH_SIZE) n = NET_UDP_BATCH_SIZE;
+
+#ifdef __linux__
+        struct mmsghdr msgs[NET_UDP_BATCH_SIZE];
+        struct iovec iov[NET_UDP_BATCH_SIZE][2];
+        memset(msgs, 0, n * sizeof(struct mmsghdr));
+
+        for (int i = 0; i < n; i++) {
+            const NetUdpSend* item = &items[done + i];
+            iov[i][0].iov_base = (void*)item->head;
+            iov[i][0].iov_len = (size_t)item->head_length;
+            iov[i][1].iov_base = (void*)item->body;
+            iov[i][1].iov_len = (size_t)item->body_length;
+            msgs[i].msg_hdr.msg_name = (void*)&item->addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(item->addr);
+            msgs[i].msg_hdr.msg_iov = iov[i];
+            msgs[i].msg_hdr.msg_iovlen = (item->body_length > 0) ? 2 : 1;
+        }
+
+        net_syscall_count++;
+        int result = sendmmsg(socket, msgs, n, 0);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            // This datagram can't go out right now - drop it, try the rest
+            done++;
+            continue;
+        }
+        done += result;
+        sent += result;
+#else
+        for (int i = 0; i < n; i++) {
+            const NetUdpSend* item = &items[done + i];
+            struct iovec iov[2] = {
+                { .iov_base = (void*)item->head, .iov_len = (size_t)item->head_length },
+                { .iov_base = (void*)item->body, .iov_len = (size_t)item->body_length }
+            };
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = (void*)&item->addr;
+            msg.msg_namelen = sizeof(item->addr);
+            msg.msg_iov = iov;
+            msg.msg_iovlen = (item->body_length > 0) ? 2 : 1;
+            net_syscall_count++;
+            if (sendmsg(socket, &msg, 0) >= 0) sent++;
+        }
+        done += n;
+#endif
+    }
+
+    return sent;
+}
+
+/**
+ * net_udp_outbox_add - Reserve the next datagram
+ */
+NetUdpSend* net_udp_outbox_add(NetUdpOutbox* outbox, const struct sockaddr_in* addr) {
+    if (outbox->count == outbox->capacity) {
+        net_udp_outbox_flush(outbox);
+    }
+
+    NetUdpSend* item = &outbox->items[outbox->count++];
+    item->addr = *addr;
+    item->head_length = 0;
+    item->body = NULL;
+    item->body_length = 0;
+    return item;
+}
+
+/**
+ * net_udp_outbox_flush - Send everything collected so far
+ */
+int net_udp_outbox_flush(NetUdpOutbox* outbox) {
+    if (outbox->count == 0) return 0;
+    int sent = net_udp_send_batch(outbox->socket, outbox->items, outbox->count);
+    outbox->dropped += (uint64_t)(outbox->count - sent);
+    outbox->count = 0;
+    return sent;
+}
+
+/**
+ * link_send_datagram - Send one UDP datagram to the server
+ */
+static int link_send_datagram(NetLink* link, const uint8_t* data, int length) {
+    ssize_t n = sendto(link->socket, data, length, 0,
+                       (const struct sockaddr*)&link->udp.addr, sizeof(link->udp.addr));
+    return (n == length) ? 0 : -1;
+}
+
+/**
+ * link_send_reliable_due - Send every reliable message that is due
+ */
+static void link_send_reliable_due(NetLink* link) {
+    uint8_t packet[NET_UDP_HEAD_MAX];
+    uint64_t now = net_time_ms();
+    int length;
+    while ((length = net_udp_next_resend(&link->udp, now, packet, sizeof(packet))) > 0) {
+        link_send_datagram(link, packet, length);
+    }
+}
+
+/**
+ * net_link_open - Connect over TCP or UDP
+ */
+int net_link_open(NetLink* link, NetTransport transport, const char* host, uint16_t port,
+                  uint8_t* storage, int capacity) {
+    memset(link, 0, sizeof(NetLink));
+    link->transport = transport;
+    net_recv_buffer_init(&link->recv_buf, storage, capacity);
+
+    if (transport == NET_TRANSPORT_TCP) {
+        link->socket = net_connect_to_server(host, port);
+        return (link->socket == INVALID_SOCKET) ? -1 : 0;
+    }
+
+    struct sockaddr_in server_addr;
+    if (capacity < NET_UDP_MAX_PACKET || net_resolve(host, port, &server_addr) != 0) {
+        return -1;
+    }
+
+    // Port 0: the kernel picks our local port
+    link->socket = net_create_udp_socket(0);
+    if (link->socket == INVALID_SOCKET) return -1;
+
+    net_udp_connection_init(&link->udp, 0, &server_addr);
+    return 0;
+}
+
+/**
+ * net_link_send - Send one message
+ */
+int net_link_send(NetLink* link, uint8_t type, const void* payload, int length, int reliable) {
+    if (link->transport == NET_TRANSPORT_TCP) {
+        NetBatch batch;
+        net_batch_begin(&batch, link->socket, 0);
+        net_batch_add(&batch, type, payload, length);
+        return (net_batch_flush(&batch) < 0) ? -1 : 0;
+    }
+
+    if (reliable) {
+        if (net_udp_queue_reliable(&link->udp, type, payload, length) != 0) return -1;
+        link_send_reliable_due(link);
+        return 0;
+    }
+
+    uint8_t packet[NET_UDP_MAX_PACKET];
+    int size = net_udp_encode(&link->udp, packet, sizeof(packet), type, payload, length);
+    if (size < 0) return -1;
+    return link_send_datagram(link, packet, size);
+}
+
+/**
+ * net_link_poll - Get the next received message, if any
+ */
+int net_link_poll(NetLink* link, NetFrame* frame) {
+    if (link->transport == NET_TRANSPORT_TCP) {
+        int result = net_recv_buffer_next(&link->recv_buf, frame);
+        if (result != 0) return result;
+        if (net_recv_buffer_fill(link->socket, &link->recv_buf) < 0) return -1;
+        return net_recv_buffer_next(&link->recv_buf, frame);
+    }
+
+    uint64_t now = net_time_ms();
+    link_send_reliable_due(link);
+    if (now - link->udp.last_recv_ms > NET_UDP_TIMEOUT_MS) {
+        return -1;  // Server went silent
+    }
+
+    // The receive buffer holds exactly one datagram at a time
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(link->socket, link->recv_buf.data, link->recv_buf.capacity,
+                             MSG_DONTWAIT, (struct sockaddr*)&from, &from_len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+
+        // Only the server's host; once connected, only the port that
+        // answered our MSG_CONNECT (the worker hosting us)
+        if (from.sin_addr.s_addr != link->udp.addr.sin_addr.s_addr) continue;
+        int connected = (link->udp.connection_id != 0);
+        if (connected && from.sin_port != link->udp.addr.sin_port) continue;
+
+        if (net_udp_receive(&link->udp, link->recv_buf.data, (int)n, now, frame)) {
+            if (!connected) {
+                link->udp.addr = from;
+            }
+            return 1;
+        }
+    }
+}
+
+/**
+ * net_link_wait - poll() until the socket is readable
+ */
+void net_link_wait(NetLink* link, int timeout_ms) {
+    struct pollfd pfd = { .fd = link->socket, .events = POLLIN, .revents = 0 };
+    poll(&pfd, 1, timeout_ms);
+}
+
+/**
+ * net_link_flush - Keep resending until reliable messages are acked
+ *
+ * Incoming messages are discarded - this is only used when leaving.
+ */
+void net_link_flush(NetLink* link, int timeout_ms) {
+    if (link->transport != NET_TRANSPORT_UDP) return;
+
+    uint64_t deadline = net_time_ms() + (uint64_t)timeout_ms;
+    NetFrame frame;
+    while (net_udp_reliable_pending(&link->udp) > 0 && net_time_ms() < deadline) {
+        net_link_wait(link, NET_UDP_RESEND_MS / 2);
+        while (net_link_poll(link, &frame) > 0) {
+        }
+    }
+}
+
+/**
+ * net_link_close - Close the link's socket
+ */
+void net_link_close(NetLink* link) {
+    net_close(link->socket);
+    link->socket = INVALID_SOCKET;
+}
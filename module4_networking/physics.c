@@ -0,0 +1,182 @@
+/**
+ * physics.c - Ship Movement, Shared by Server and Client
+ *
+ * See physics.h for why there are two steps and how the fixed one
+ * stays bit-exact.
+ */
+
+#include "physics.h"
+
+#include <math.h>
+
+// friction_table is computed for this (and PLAYER_FRICTION = 0.95)
+_Static_assert(PHYSICS_SUBSTEPS == 16, "regenerate friction_table for PHYSICS_SUBSTEPS");
+
+// Substeps per second: the denominator of every fixed-step time
+#define SUBSTEP_RATE (PHYSICS_TICK_RATE * PHYSICS_SUBSTEPS)
+
+// Constants in Q16.16 (the float ones are whole numbers, so exact)
+#define FIXED_SPEED      ((fixed_t)PLAYER_SPEED * FIXED_ONE)
+#define FIXED_ACCEL      ((int64_t)PLAYER_ACCELERATION * FIXED_ONE)    // Per second
+#define FIXED_HALF_SIZE  ((fixed_t)PLAYER_HALF_SIZE * FIXED_ONE)
+#define FIXED_WIDTH      ((fixed_t)GAME_WIDTH * FIXED_ONE)
+#define FIXED_HEIGHT     ((fixed_t)GAME_HEIGHT * FIXED_ONE)
+#define FIXED_INV_SQRT2  46341     // 1/sqrt(2), rounded
+
+/**
+ * friction_table - PLAYER_FRICTION ^ (k / PHYSICS_SUBSTEPS) in Q16.16
+ *
+ * Generated offline (round(0.95 ** (k / 16) * 65536)) and written out
+ * as literals: computing them with powf() at startup would bring back
+ * the libm differences this table exists to avoid.
+ */
+static const fixed_t friction_table[PHYSICS_SUBSTEPS + 1] = {
+    65536, 65326, 65117, 64909, 64701, 64494, 64287, 64082, 63877,
+    63672, 63468, 63265, 63063, 62861, 62660, 62459, 62259
+};
+
+// ============================================================================
+// FLOAT STEP
+// ============================================================================
+
+/**
+ * physics_step_float - Acceleration, friction, speed cap, bounds
+ */
+void physics_step_float(PhysicsBody* body, uint8_t input_flags, float dt) {
+    // Apply input to velocity
+    float accel_x = 0, accel_y = 0;
+    if (input_flags & INPUT_UP)    accel_y = -1.0f;
+    if (input_flags & INPUT_DOWN)  accel_y = 1.0f;
+    if (input_flags & INPUT_LEFT)  accel_x = -1.0f;
+    if (input_flags & INPUT_RIGHT) accel_x = 1.0f;
+
+    // Normalize diagonal movement
+    if (accel_x != 0 && accel_y != 0) {
+        float inv_sqrt2 = 0.7071f;
+        accel_x *= inv_sqrt2;
+        accel_y *= inv_sqrt2;
+    }
+
+    // Apply acceleration
+    body->vx += accel_x * PLAYER_ACCELERATION * dt;
+    body->vy += accel_y * PLAYER_ACCELERATION * dt;
+
+    // Apply friction (adjusted for frame rate)
+    float friction = powf(PLAYER_FRICTION, dt * 60.0f);
+    body->vx *= friction;
+    body->vy *= friction;
+
+    // Clamp velocity to max speed
+    float speed = sqrtf(body->vx * body->vx + body->vy * body->vy);
+    if (speed > PLAYER_SPEED) {
+        float scale = PLAYER_SPEED / speed;
+        body->vx *= scale;
+        body->vy *= scale;
+    }
+
+    // Stop if very slow
+    if (fabsf(body->vx) < 1.0f) body->vx = 0;
+    if (fabsf(body->vy) < 1.0f) body->vy = 0;
+
+    // Update position
+    body->x += body->vx * dt;
+    body->y += body->vy * dt;
+
+    // Clamp to arena bounds
+    float hw = PLAYER_HALF_SIZE, hh = PLAYER_HALF_SIZE;
+    if (body->x < hw) { body->x = hw; body->vx = 0; }
+    if (body->x > GAME_WIDTH - hw) { body->x = GAME_WIDTH - hw; body->vx = 0; }
+    if (body->y < hh) { body->y = hh; body->vy = 0; }
+    if (body->y > GAME_HEIGHT - hh) { body->y = GAME_HEIGHT - hh; body->vy = 0; }
+}
+
+// ============================================================================
+// FIXED STEP
+// ============================================================================
+
+/**
+ * isqrt64 - floor(sqrt(value)), one result bit per iteration
+ */
+static uint64_t isqrt64(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+/**
+ * fixed_substep - One step of at most one tick
+ */
+static void fixed_substep(FixedBody* body, uint8_t input_flags, int substeps) {
+    int dir_x = 0, dir_y = 0;
+    if (input_flags & INPUT_UP)    dir_y = -1;
+    if (input_flags & INPUT_DOWN)  dir_y = 1;
+    if (input_flags & INPUT_LEFT)  dir_x = -1;
+    if (input_flags & INPUT_RIGHT) dir_x = 1;
+
+    // Velocity gained in this step, scaled down on diagonals
+    fixed_t accel = (fixed_t)(FIXED_ACCEL * substeps / SUBSTEP_RATE);
+    if (dir_x != 0 && dir_y != 0) accel = fixed_mul(accel, FIXED_INV_SQRT2);
+    body->vx += dir_x * accel;
+    body->vy += dir_y * accel;
+
+    fixed_t friction = friction_table[substeps];
+    body->vx = fixed_mul(body->vx, friction);
+    body->vy = fixed_mul(body->vy, friction);
+
+    // Speed cap: compare squares (Q32.32) and only take a root when over
+    int64_t speed_sq = (int64_t)body->vx * body->vx + (int64_t)body->vy * body->vy;
+    if (speed_sq > (int64_t)FIXED_SPEED * FIXED_SPEED) {
+        fixed_t speed = (fixed_t)isqrt64((uint64_t)speed_sq);
+        body->vx = (fixed_t)((int64_t)body->vx * FIXED_SPEED / speed);
+        body->vy = (fixed_t)((int64_t)body->vy * FIXED_SPEED / speed);
+    }
+
+    if (body->vx > -FIXED_ONE && body->vx < FIXED_ONE) body->vx = 0;
+    if (body->vy > -FIXED_ONE && body->vy < FIXED_ONE) body->vy = 0;
+
+    body->x += (fixed_t)((int64_t)body->vx * substeps / SUBSTEP_RATE);
+    body->y += (fixed_t)((int64_t)body->vy * substeps / SUBSTEP_RATE);
+
+    if (body->x < FIXED_HALF_SIZE) { body->x = FIXED_HALF_SIZE; body->vx = 0; }
+    if (body->x > FIXED_WIDTH - FIXED_HALF_SIZE) { body->x = FIXED_WIDTH - FIXED_HALF_SIZE; body->vx = 0; }
+    if (body->y < FIXED_HALF_SIZE) { body->y = FIXED_HALF_SIZE; body->vy = 0; }
+    if (body->y > FIXED_HEIGHT - FIXED_HALF_SIZE) { body->y = FIXED_HEIGHT - FIXED_HALF_SIZE; body->vy = 0; }
+}
+
+/**
+ * physics_step_fixed - Whole ticks first, then the remainder
+ */
+void physics_step_fixed(FixedBody* body, uint8_t input_flags, int substeps) {
+    while (substeps > PHYSICS_SUBSTEPS) {
+        fixed_substep(body, input_flags, PHYSICS_SUBSTEPS);
+        substeps -= PHYSICS_SUBSTEPS;
+    }
+    if (substeps > 0) fixed_substep(body, input_flags, substeps);
+}
+
+/**
+ * fixed_body_from_float / fixed_body_to_float - Field by field
+ */
+void fixed_body_from_float(FixedBody* out, const PhysicsBody* body) {
+    out->x = fixed_from_float(body->x);
+    out->y = fixed_from_float(body->y);
+    out->vx = fixed_from_float(body->vx);
+    out->vy = fixed_from_float(body->vy);
+}
+
+void fixed_body_to_float(PhysicsBody* out, const FixedBody* body) {
+    out->x = fixed_to_float(body->x);
+    out->y = fixed_to_float(body->y);
+    out->vx = fixed_to_float(body->vx);
+    out->vy = fixed_to_float(body->vy);
+}
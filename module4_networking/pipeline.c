@@ -0,0 +1,626 @@
+/**
+ * pipeline.c - Output Stage of a Pipelined Worker
+ *
+ * See pipeline.h for the two stages, the frame ring and who owns which
+ * socket. The send path below is server_send_state() of game_server.c,
+ * reading a WorldFrame instead of the live room; the read path (I/O
+ * threads only) is server_handle_frames(), ending in an InputQueue
+ * instead of the live room.
+ */
+
+#include "pipeline.h"
+#include "tick_scheduler.h"
+#include "wire.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+// Ready sockets handled per reactor wakeup
+#define OUTPUT_MAX_EVENTS 64
+
+// Log text per OutputDrop
+static const char* const g_drop_reasons[] = {
+    [OUTPUT_DROP_NONE] = NULL,
+    [OUTPUT_DROP_QUEUE_FULL] = "send queue full",
+    [OUTPUT_DROP_SEND_FAILED] = "send failed",
+    [OUTPUT_DROP_TOO_SLOW] = "too slow to read snapshots",
+    [OUTPUT_DROP_CLOSED] = "connection closed",
+    [OUTPUT_DROP_DISCONNECTED] = "sent disconnect",
+    [OUTPUT_DROP_CORRUPT] = "corrupt message stream"
+};
+
+// ============================================================================
+// SENDERS (output thread)
+// ============================================================================
+
+/**
+ * output_watch - NET_EVENT_WRITE while the client's queue holds bytes
+ *
+ * Plus NET_EVENT_READ on an I/O thread, unless the client is throttled.
+ * Without one, a client that keeps up is never in the reactor at all.
+ */
+static void output_watch(OutputClient* client) {
+    NetReactor* reactor = client->room->stage->reactor;
+    uint32_t events = (net_send_queue_pending(&client->queue) > 0) ? NET_EVENT_WRITE : 0;
+    if (client->room->inputs != NULL && !client->throttled) events |= NET_EVENT_READ;
+    if (events == client->events) return;
+
+    if (client->events == 0) {
+        if (net_reactor_add(reactor, client->socket, events, client) != 0) return;
+    } else if (events == 0) {
+        net_reactor_remove(reactor, client->socket);
+    } else {
+        net_reactor_modify(reactor, client->socket, events, client);
+    }
+    client->events = events;
+}
+
+/**
+ * output_unwatch - Leave the reactor, forget whatever is queued
+ */
+static void output_unwatch(OutputClient* client) {
+    if (client->events != 0) {
+        net_reactor_remove(client->room->stage->reactor, client->socket);
+        client->events = 0;
+    }
+    net_send_queue_free(&client->queue);
+}
+
+/**
+ * output_drop - Stop serving a client and tell the worker why
+ *
+ * The socket stays open: the worker drops the player at its next tick
+ * (without I/O threads it still reads it until then). The frame after
+ * that closes it.
+ */
+static void output_drop(OutputClient* client, OutputDrop reason) {
+    RoomOutput* out = client->room;
+    int slot = (int)(client - out->clients);
+
+    if (reason == OUTPUT_DROP_SEND_FAILED) {
+        metrics_add(out->stage->metrics, METRIC_SEND_FAILURES, 1);
+    } else if (reason == OUTPUT_DROP_QUEUE_FULL || reason == OUTPUT_DROP_TOO_SLOW) {
+        metrics_add(out->stage->metrics, METRIC_SLOW_EVICTIONS, 1);
+    }
+    output_unwatch(client);
+    client->dropped = 1;
+
+    out->drop_reason[slot] = (uint8_t)reason;
+    atomic_store_explicit(&out->drop_session[slot], client->session, memory_order_release);
+}
+
+/**
+ * output_flush - The reactor reported a client writable
+ */
+static void output_flush(OutputClient* client) {
+    if (client->session == 0 || client->dropped) return;
+
+    if (net_send_queue_flush(&client->queue, client->socket) < 0) {
+        output_drop(client, OUTPUT_DROP_SEND_FAILED);
+        return;
+    }
+    output_watch(client);
+}
+
+/**
+ * output_follow_sessions - Adopt new sessions, close the ones that ended
+ *
+ * A session missing from a frame was dropped by the worker, which had
+ * unregistered its socket before publishing - so nobody else can still
+ * be using it.
+ */
+static void output_follow_sessions(RoomOutput* out, const WorldFrame* frame) {
+    for (int slot = 0; slot < out->max_players; slot++) {
+        const FramePlayer* fp = &frame->players[slot];
+        OutputClient* client = &out->clients[slot];
+        if (client->session == fp->session) continue;
+
+        if (client->session != 0) {
+            output_unwatch(client);
+            net_close(client->socket);
+        }
+
+        client->session = fp->session;
+        client->socket = fp->socket;
+        if (fp->session == 0) continue;
+
+        client->backlog_ticks = 0;
+        client->dropped = 0;
+        net_send_queue_init(&client->queue, out->send_queue_size);
+
+        if (out->inputs != NULL) {
+            // From now on this thread reads it, too
+            net_recv_buffer_init(&client->recv_buf, client->recv_storage,
+                                 sizeof(client->recv_storage));
+            client->version = fp->version;
+            client->tick_msgs = 0;
+            client->tick_bytes = 0;
+            client->throttled = 0;
+            output_watch(client);
+        }
+    }
+}
+
+/**
+ * output_send_pong - Queue a pong ahead of the snapshot
+ *
+ * @return  0 if sent or queued, -1 if the client was dropped
+ */
+static int output_send_pong(OutputClient* client, const PongMsg* pong) {
+    MessageHeader header = { .type = MSG_PONG, .length = sizeof(*pong) };
+    struct iovec parts[2] = {
+        { .iov_base = &header, .iov_len = sizeof(header) },
+        { .iov_base = (void*)pong, .iov_len = sizeof(*pong) }
+    };
+    int result = net_send_queue_push(&client->queue, client->socket, parts, 2, 0);
+    if (result < 0) {
+        output_drop(client, (result == NET_QUEUE_FULL) ? OUTPUT_DROP_QUEUE_FULL
+                                                       : OUTPUT_DROP_SEND_FAILED);
+        return -1;
+    }
+    metrics_message(client->room->stage->metrics, 1, MSG_PONG, sizeof(header) + sizeof(*pong));
+    return 0;
+}
+
+// ============================================================================
+// READERS (I/O threads only)
+// ============================================================================
+
+/**
+ * output_handle_frame - Handle one complete message from a client
+ *
+ * Inputs go to the worker, pongs go out right away: the round trip a
+ * client measures no longer waits for the room's next tick.
+ */
+static void output_handle_frame(OutputClient* client, const NetFrame* frame) {
+    RoomOutput* out = client->room;
+    MetricsShard* metrics = out->stage->metrics;
+    int slot = (int)(client - out->clients);
+    metrics_message(metrics, 0, frame->header.type,
+                    sizeof(MessageHeader) + (uint64_t)frame->header.length);
+
+    switch (frame->header.type) {
+        case MSG_PLAYER_INPUT: {
+            InputEvent event = {
+                .session = client->session,
+                .room = out->room_index,
+                .slot = (uint16_t)slot
+            };
+            if (wire_decode_input(frame->payload, frame->header.length,
+                                  client->version, &event.input) != 0) {
+                break;
+            }
+            if (input_queue_push(out->inputs, &event) != 0) {
+                metrics_add(metrics, METRIC_INPUT_DROPS, 1);
+            }
+            break;
+        }
+
+        case MSG_DISCONNECT:
+            output_drop(client, OUTPUT_DROP_DISCONNECTED);
+            break;
+
+        case MSG_PING: {
+            if (frame->header.length < sizeof(PingMsg)) break;
+            const PingMsg* ping = (const PingMsg*)frame->payload;
+            PongMsg pong = {
+                .client_timestamp = ping->timestamp,
+                .server_timestamp = out->tick
+            };
+            // Through the queue: it may still hold half a snapshot
+            if (output_send_pong(client, &pong) == 0) output_watch(client);
+            break;
+        }
+
+        default:
+            LOG_WARN("Room %d: Unknown message type %d from player %d",
+                     out->room_id, frame->header.type, slot);
+            break;
+    }
+}
+
+/**
+ * output_handle_frames - Handle every complete frame in the receive buffer
+ *
+ * Stops when the client's budget runs out (it is throttled until the
+ * room's next frame), only a partial frame is left, or it was dropped.
+ */
+static void output_handle_frames(OutputClient* client) {
+    RoomOutput* out = client->room;
+    NetFrame frame;
+    int result = 0;
+    while (!client->dropped) {
+        if (client->tick_msgs >= out->msg_budget || client->tick_bytes >= out->byte_budget) {
+            client->throttled = 1;
+            output_watch(client);
+            return;
+        }
+
+        result = net_recv_buffer_next(&client->recv_buf, &frame);
+        if (result <= 0) break;
+
+        client->tick_msgs++;
+        client->tick_bytes += (int)sizeof(MessageHeader) + frame.header.length;
+        output_handle_frame(client, &frame);
+    }
+
+    if (!client->dropped && result < 0) {
+        output_drop(client, OUTPUT_DROP_CORRUPT);
+    }
+}
+
+/**
+ * output_read - The reactor reported a client readable
+ */
+static void output_read(OutputClient* client) {
+    if (client->session == 0 || client->dropped || client->throttled) return;
+
+    if (net_recv_buffer_fill(client->socket, &client->recv_buf) < 0) {
+        output_drop(client, OUTPUT_DROP_CLOSED);
+        return;
+    }
+    output_handle_frames(client);
+}
+
+/**
+ * output_refill_budgets - A new frame: a new budget for every client
+ *
+ * Throttled clients get their held-back messages handled first, then
+ * their socket is read again - as server_refill_budgets() does.
+ */
+static void output_refill_budgets(RoomOutput* out) {
+    for (int slot = 0; slot < out->max_players; slot++) {
+        OutputClient* client = &out->clients[slot];
+        if (client->session == 0 || client->dropped) continue;
+
+        client->tick_msgs = 0;
+        client->tick_bytes = 0;
+        if (client->throttled) {
+            client->throttled = 0;
+            output_handle_frames(client);
+            if (!client->dropped) output_watch(client);
+        }
+    }
+}
+
+/**
+ * output_send_frame - Interest, encoding and fan-out of one frame
+ *
+ * Same steps as server_send_state(): players first, then each client's
+ * interest set against its set of the previous frame, then the union of
+ * the sets, then one delta per client into its send queue.
+ */
+static void output_send_frame(RoomOutput* out, const WorldFrame* frame) {
+    MetricsShard* metrics = out->stage->metrics;
+    SnapshotBuilder* snap = out->snapshot;
+    snapshot_begin(snap, frame->tick);
+
+    for (int slot = 0; slot < out->max_players; slot++) {
+        if (frame->players[slot].session == 0) continue;
+        PlayerState* ps = snapshot_add_player(snap);
+        if (ps == NULL) break;
+        *ps = frame->players[slot].state;
+    }
+
+    InterestScratch* interest = out->interest;
+    interest_begin(interest);
+    for (int slot = 0; slot < out->max_players; slot++) {
+        if (frame->players[slot].session == 0) continue;
+        interest_select(interest, &frame->bullets, &frame->players[slot].state,
+                        snapshot_previous_view(snap, slot), snapshot_view(snap, slot),
+                        out->sync_bullets);
+    }
+    interest_add_bullets(interest, &frame->bullets, snap);
+
+    for (int slot = 0; slot < out->max_players; slot++) {
+        const FramePlayer* fp = &frame->players[slot];
+        OutputClient* client = &out->clients[slot];
+        if (fp->session == 0 || client->dropped) continue;
+
+        if (fp->pong_due && output_send_pong(client, &fp->pong) < 0) continue;
+
+        const SnapshotDelta* delta = snapshot_delta(snap, slot, fp->acked_tick,
+                                                    fp->version == PROTOCOL_VERSION);
+        if (delta == NULL) continue;  // Body pool used up: next frame
+
+        NetSendQueue* queue = &client->queue;
+        int backlog = net_send_queue_pending(queue) > 0;
+        uint64_t superseded = queue->superseded;
+        int sent = snapshot_send(snap, delta, queue, client->socket, fp->last_sequence);
+        if (sent < 0) {
+            output_drop(client, (sent == NET_QUEUE_FULL) ? OUTPUT_DROP_QUEUE_FULL
+                                                         : OUTPUT_DROP_SEND_FAILED);
+            continue;
+        }
+        metrics_add(metrics, METRIC_SUPERSEDED, queue->superseded - superseded);
+        snapshot_count_sent(metrics, sent);
+
+        client->backlog_ticks = backlog ? client->backlog_ticks + 1 : 0;
+        if (client->backlog_ticks >= out->send_stall_ticks) {
+            output_drop(client, OUTPUT_DROP_TOO_SLOW);
+            continue;
+        }
+        output_watch(client);
+    }
+}
+
+/**
+ * output_drain_room - Send every frame waiting in a room's ring, oldest first
+ */
+static void output_drain_room(RoomOutput* out) {
+    MetricsShard* metrics = out->stage->metrics;
+    uint32_t tail = atomic_load_explicit(&out->tail, memory_order_relaxed);
+
+    while (tail != atomic_load_explicit(&out->head, memory_order_acquire)) {
+        const WorldFrame* frame = &out->frames[tail % PIPELINE_DEPTH];
+        uint64_t start = tick_now_ns();
+        metrics_observe(metrics, METRIC_PIPELINE_HANDOFF, start - frame->published_ns);
+
+        output_follow_sessions(out, frame);
+        if (out->inputs != NULL) {
+            out->tick = frame->tick + 1;
+            output_refill_budgets(out);
+        }
+        if (frame->player_count > 0) {
+            output_send_frame(out, frame);
+        }
+        metrics_observe(metrics, METRIC_PIPELINE_OUTPUT, tick_now_ns() - start);
+
+        // The worker may reuse the frame from here on
+        atomic_store_explicit(&out->tail, ++tail, memory_order_release);
+    }
+}
+
+/**
+ * output_thread_func - Sleep until frames or ready sockets, send (and read), repeat
+ */
+static void* output_thread_func(void* arg) {
+    OutputStage* stage = (OutputStage*)arg;
+    NetEvent events[OUTPUT_MAX_EVENTS];
+
+    while (atomic_load_explicit(&stage->running, memory_order_acquire)) {
+        int ready = net_reactor_wait(stage->reactor, events, OUTPUT_MAX_EVENTS, -1);
+
+        for (int e = 0; e < ready; e++) {
+            if (events[e].user_data == stage) {
+                char buffer[64];
+                while (read(stage->wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+                }
+                continue;
+            }
+            OutputClient* client = (OutputClient*)events[e].user_data;
+            if (client->room->inputs == NULL) {
+                output_flush(client);
+                continue;
+            }
+
+            // An I/O thread's client: drain its send queue first, then read
+            if (events[e].events & NET_EVENT_WRITE) {
+                output_flush(client);
+            }
+            if (events[e].events != NET_EVENT_WRITE) {
+                output_read(client);
+            }
+        }
+
+        for (int r = 0; r < stage->room_count; r++) {
+            output_drain_room(stage->rooms[r]);
+        }
+
+        metrics_add(stage->metrics, METRIC_NET_SYSCALLS, net_syscall_count - stage->syscalls_seen);
+        stage->syscalls_seen = net_syscall_count;
+    }
+    return NULL;
+}
+
+// ============================================================================
+// OUTPUT STAGE
+// ============================================================================
+
+/**
+ * pipeline_stage_init - Reactor and doorbell, like a worker's
+ */
+int pipeline_stage_init(OutputStage* stage, int index, int max_rooms, int max_sockets,
+                        MetricsShard* metrics) {
+    memset(stage, 0, sizeof(OutputStage));
+    stage->index = index;
+    stage->metrics = metrics;
+    stage->wake_pipe[0] = stage->wake_pipe[1] = -1;
+    stage->rooms = calloc((size_t)max_rooms, sizeof(RoomOutput*));
+    stage->room_capacity = max_rooms;
+    stage->reactor = net_reactor_create(max_sockets + 1);
+
+    if (stage->rooms == NULL || stage->reactor == NULL || pipe(stage->wake_pipe) != 0) {
+        pipeline_stage_free(stage);
+        return -1;
+    }
+    fcntl(stage->wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(stage->wake_pipe[1], F_SETFL, O_NONBLOCK);
+    net_reactor_add(stage->reactor, stage->wake_pipe[0], NET_EVENT_READ, stage);
+    return 0;
+}
+
+/**
+ * pipeline_stage_start - One thread per stage
+ *
+ * The caller blocks SIGINT/SIGTERM around this, as for the workers.
+ */
+int pipeline_stage_start(OutputStage* stage) {
+    atomic_store_explicit(&stage->running, 1, memory_order_release);
+    if (pthread_create(&stage->thread, NULL, output_thread_func, stage) != 0) {
+        fprintf(stderr, "Failed to create output thread %d\n", stage->index);
+        return -1;
+    }
+    stage->started = 1;
+    return 0;
+}
+
+/**
+ * pipeline_stage_wake - Ring the doorbell
+ */
+void pipeline_stage_wake(OutputStage* stage) {
+    if (stage == NULL) return;
+
+    char bell = 1;
+    if (write(stage->wake_pipe[1], &bell, 1) < 0 && errno != EAGAIN) {
+        perror("write(wake_pipe) failed");
+    }
+}
+
+/**
+ * pipeline_stage_stop - Clear 'running', ring, join
+ */
+void pipeline_stage_stop(OutputStage* stage) {
+    if (!stage->started) return;
+
+    atomic_store_explicit(&stage->running, 0, memory_order_release);
+    pipeline_stage_wake(stage);
+    pthread_join(stage->thread, NULL);
+    stage->started = 0;
+}
+
+/**
+ * pipeline_stage_free - Release what pipeline_stage_init() set up
+ */
+void pipeline_stage_free(OutputStage* stage) {
+    net_reactor_destroy(stage->reactor);
+    if (stage->wake_pipe[0] >= 0) close(stage->wake_pipe[0]);
+    if (stage->wake_pipe[1] >= 0) close(stage->wake_pipe[1]);
+    free(stage->rooms);
+    stage->reactor = NULL;
+    stage->wake_pipe[0] = stage->wake_pipe[1] = -1;
+    stage->rooms = NULL;
+}
+
+// ============================================================================
+// ROOMS
+// ============================================================================
+
+/**
+ * pipeline_room_create - Frames, senders and drop slots in one go
+ *
+ * The ring's head and tail sit on their own cache lines, so the struct
+ * comes from aligned_alloc().
+ */
+RoomOutput* pipeline_room_create(GameServer* server, OutputStage* stage,
+                                 InputQueue* inputs, int room_index) {
+    if (stage->room_count == stage->room_capacity) return NULL;
+
+    size_t size = (sizeof(RoomOutput) + 63) & ~(size_t)63;
+    RoomOutput* out = aligned_alloc(64, size);
+    if (out == NULL) return NULL;
+    memset(out, 0, sizeof(RoomOutput));
+
+    int max_players = server->max_players;
+    out->stage = stage;
+    out->room_id = server->room_id;
+    out->max_players = max_players;
+    out->sync_bullets = server->sync_bullets;
+    out->send_queue_size = server->send_queue_size;
+    out->send_stall_ticks = server->send_stall_ticks;
+    out->snapshot = &server->snapshot;
+    out->interest = &server->interest;
+    out->inputs = inputs;
+    out->room_index = (uint16_t)room_index;
+    out->msg_budget = server->msg_budget;
+    out->byte_budget = server->byte_budget;
+    out->tick = server->tick;
+    atomic_init(&out->head, 0);
+    atomic_init(&out->tail, 0);
+
+    int failed = 0;
+    out->clients = calloc((size_t)max_players, sizeof(OutputClient));
+    out->drop_session = calloc((size_t)max_players, sizeof(_Atomic uint32_t));
+    out->drop_reason = calloc((size_t)max_players, sizeof(uint8_t));
+    failed |= (out->clients == NULL || out->drop_session == NULL || out->drop_reason == NULL);
+    for (int f = 0; f < PIPELINE_DEPTH; f++) {
+        out->frames[f].players = calloc((size_t)max_players, sizeof(FramePlayer));
+        failed |= (out->frames[f].players == NULL);
+        failed |= (bullet_store_init(&out->frames[f].bullets, server->bullets.capacity) != 0);
+    }
+    if (failed) {
+        pipeline_room_destroy(out);
+        return NULL;
+    }
+
+    for (int slot = 0; slot < max_players; slot++) {
+        out->clients[slot].room = out;
+        out->clients[slot].socket = INVALID_SOCKET;
+        atomic_init(&out->drop_session[slot], 0);
+    }
+
+    stage->rooms[stage->room_count++] = out;
+    server->output = out;
+    return out;
+}
+
+/**
+ * pipeline_room_destroy - Follow the unsent frames, then close the rest
+ */
+void pipeline_room_destroy(RoomOutput* out) {
+    if (out == NULL) return;
+
+    if (out->clients != NULL) {
+        uint32_t head = atomic_load_explicit(&out->head, memory_order_acquire);
+        for (uint32_t t = atomic_load_explicit(&out->tail, memory_order_relaxed); t != head; t++) {
+            output_follow_sessions(out, &out->frames[t % PIPELINE_DEPTH]);
+        }
+        for (int slot = 0; slot < out->max_players; slot++) {
+            OutputClient* client = &out->clients[slot];
+            if (client->session == 0) continue;
+            output_unwatch(client);
+            net_close(client->socket);
+        }
+    }
+
+    for (int f = 0; f < PIPELINE_DEPTH; f++) {
+        free(out->frames[f].players);
+        bullet_store_free(&out->frames[f].bullets);
+    }
+    free(out->clients);
+    free((void*)out->drop_session);
+    free(out->drop_reason);
+    free(out);
+}
+
+/**
+ * pipeline_acquire_frame - The slot at 'head', once 'tail' has left it
+ */
+WorldFrame* pipeline_acquire_frame(RoomOutput* out, int wait) {
+    uint32_t head = atomic_load_explicit(&out->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&out->tail, memory_order_acquire) >= PIPELINE_DEPTH) {
+        if (!wait) return NULL;
+        pipeline_stage_wake(out->stage);
+        while (head - atomic_load_explicit(&out->tail, memory_order_acquire) >= PIPELINE_DEPTH) {
+            sched_yield();
+        }
+    }
+    return &out->frames[head % PIPELINE_DEPTH];
+}
+
+/**
+ * pipeline_publish_frame - Stamp it, then move 'head' past it
+ */
+void pipeline_publish_frame(RoomOutput* out, WorldFrame* frame) {
+    frame->published_ns = tick_now_ns();
+    uint32_t head = atomic_load_explicit(&out->head, memory_order_relaxed);
+    atomic_store_explicit(&out->head, head + 1, memory_order_release);
+}
+
+/**
+ * pipeline_take_drop - Compare the slot's dropped session with ours
+ *
+ * Sessions are never reused, so nothing has to be cleared: a newer
+ * player in the same slot simply doesn't match.
+ */
+const char* pipeline_take_drop(const RoomOutput* out, int slot, uint32_t session) {
+    uint32_t dropped = atomic_load_explicit(&out->drop_session[slot], memory_order_acquire);
+    if (dropped != session) return NULL;
+    return g_drop_reasons[out->drop_reason[slot]];
+}
@@ -0,0 +1,335 @@
+/**
+ * pipeline.h - Simulate the Next Tick While This One Is Being Sent
+ *
+ * CONCEPT: A Two-Stage Pipeline
+ * =============================
+ * A worker tick used to do everything back to back: simulate, then
+ * pick every client's interest set, encode its delta and push it into
+ * its socket. The second half grows with players x bullets, and all of
+ * it comes out of the same 16.7 ms:
+ *
+ *     worker  │ simulate 1 │ encode+send 1 │ simulate 2 │ encode+send 2 │
+ *
+ * With --pipeline each worker gets a second thread, its OUTPUT STAGE.
+ * The worker only simulates and then publishes a copy of the world (a
+ * WorldFrame); the output thread encodes and sends that frame while the
+ * worker is already simulating the next tick:
+ *
+ *     worker  │ simulate 1 │ simulate 2 │ simulate 3 │
+ *     output               │ encode+send 1 │ encode+send 2 │
+ *                          ▲ frame 1     ▲ frame 2
+ *
+ * The tick keeps only the copy (a few memcpy()s of the bullet arrays),
+ * so a room can hold about twice the entities for the same tick time.
+ * The price is latency: a snapshot leaves up to one frame later.
+ *
+ * CONCEPT: A Bounded Handoff
+ * ==========================
+ * Each room has PIPELINE_DEPTH frames in a single-producer,
+ * single-consumer ring (the same head/tail scheme as the log ring in
+ * log.c). A published frame is IMMUTABLE: the worker never touches it
+ * again until the output thread moved 'tail' past it.
+ *
+ *     frames:  [ frame 7 ][ frame 8 ]      head = 9 (worker writes)
+ *                  ▲                       tail = 7 (output writes)
+ *                  └── being sent
+ *
+ * If the output stage falls so far behind that both frames are still
+ * unsent, the worker does NOT wait: it skips publishing that tick
+ * (void_drifter_pipeline_skipped_frames_total). Every frame holds the
+ * whole world, so the next one makes up for it - and a slow output
+ * stage costs snapshot rate, never simulation rate.
+ *
+ * CONCEPT: Who Owns What
+ * ======================
+ * A player's socket is READ by the worker (input, unchanged - unless
+ * there are I/O threads, below) and WRITTEN by the output thread
+ * (snapshots, pongs). Everything the output thread needs travels
+ * inside the frame:
+ *
+ *     worker ──frame──▶ output   players (state, acked tick, pending
+ *                                pong, socket + SESSION), bullets
+ *     worker ◀─drops─── output   "I gave up on session S" (send queue
+ *                                full, send failed, too slow - or, on
+ *                                an I/O thread, the client left)
+ *
+ * A session number identifies one stay of one player in one slot. When
+ * a frame shows a slot with a new session, the output thread adopts
+ * that socket; when the old session is gone from the frame, the worker
+ * has already dropped the player and unregistered the socket, so the
+ * output thread closes it. A socket is therefore closed exactly once,
+ * by the last thread that used it. The room's SnapshotBuilder and
+ * InterestScratch belong to the output thread while a room is
+ * pipelined.
+ *
+ * CONCEPT: Stage Timing
+ * =====================
+ * void_drifter_pipeline_stage_seconds has one histogram per stage:
+ *     simulate  game_server_tick() of a pipelined room, frame copy included
+ *     handoff   time a frame waited in the ring before the output thread took it
+ *     output    interest, encoding and sending of one frame
+ *
+ * CONCEPT: I/O Threads (--io-threads N)
+ * =====================================
+ * Reading is the last socket work left on the worker: every recv(),
+ * every frame cut and decoded, every pong - in between ticks, so a
+ * ping's round trip also measures how long the worker was busy ticking.
+ * With --io-threads N there are N stages instead of one per worker,
+ * rooms are dealt to them round-robin, and each one READS its clients'
+ * sockets as well:
+ *
+ *     I/O thread ──▶ recv, cut, decode ──▶ MSG_PLAYER_INPUT ──▶ InputQueue
+ *                                     ├──▶ MSG_PING: pong queued at once
+ *                                     └──▶ EOF, MSG_DISCONNECT: drop
+ *     worker     ──▶ tick start: apply every queued input, simulate, publish
+ *
+ * The worker never touches a player socket after the handshake. The
+ * per-tick budget is enforced by the I/O thread, "tick" meaning the
+ * room's frames: a client that used up its budget is throttled until
+ * the next frame arrives. A session ends the same way as a send
+ * failure does - reported through the drop slot, noticed at the next
+ * tick. Inputs reach the worker through its InputQueue (input_queue.h,
+ * several I/O threads may feed one worker).
+ *
+ * Pipelined rooms are TCP over the reactor only: UDP datagrams and
+ * io_uring sends are batched by the worker itself.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "game_server.h"
+#include "input_queue.h"
+
+// Frames in flight per room (worker -> output thread)
+#define PIPELINE_DEPTH 2
+
+/**
+ * FramePlayer - One slot as the output thread needs it
+ */
+typedef struct {
+    uint32_t session;       // 0 = slot empty
+    Socket socket;
+    uint8_t version;        // Wire encoding (PROTOCOL_VERSION or _RAW)
+    uint32_t acked_tick;    // Delta baseline
+    uint32_t last_sequence; // Echoed in the snapshot
+    int pong_due;           // Send 'pong' before the snapshot
+    PongMsg pong;
+    PlayerState state;      // Position etc.; player_id = slot
+} FramePlayer;
+
+/**
+ * WorldFrame - Everything one snapshot is built from
+ */
+typedef struct {
+    uint32_t tick;
+    uint64_t published_ns;  // tick_now_ns() when it entered the ring
+    int player_count;
+    FramePlayer* players;   // max_players slots
+    BulletStore bullets;    // Replicated fields only (bullet_store_copy)
+} WorldFrame;
+
+/**
+ * OutputDrop - Why the output thread gave up on a session
+ */
+typedef enum {
+    OUTPUT_DROP_NONE = 0,
+    OUTPUT_DROP_QUEUE_FULL,
+    OUTPUT_DROP_SEND_FAILED,
+    OUTPUT_DROP_TOO_SLOW,
+    OUTPUT_DROP_CLOSED,         // I/O threads only, from here on
+    OUTPUT_DROP_DISCONNECTED,
+    OUTPUT_DROP_CORRUPT
+} OutputDrop;
+
+// Forward declarations
+typedef struct OutputStage OutputStage;
+
+/**
+ * OutputClient - The output thread's side of one player slot
+ */
+typedef struct {
+    uint32_t session;       // Adopted session (0 = none)
+    Socket socket;
+    NetSendQueue queue;     // Snapshots and pongs the kernel didn't take yet
+    uint32_t events;        // NET_EVENT_* the reactor watches the socket for
+    int backlog_ticks;      // Consecutive frames the queue didn't drain
+    int dropped;            // Gave up; waiting for the worker to notice
+    RoomOutput* room;       // Back-pointer (the client is reactor user_data)
+
+    // I/O threads only: the read side, as ServerPlayer has it
+    NetRecvBuffer recv_buf;
+    uint8_t recv_storage[PLAYER_RECV_BUFFER_SIZE];
+    uint8_t version;        // Wire encoding of its inputs
+    int tick_msgs;          // Messages handled since the last frame
+    int tick_bytes;         // Bytes handled since the last frame
+    int throttled;          // Budget used up: not reading until the next frame
+} OutputClient;
+
+/**
+ * RoomOutput - One pipelined room: its frame ring and its senders
+ */
+struct RoomOutput {
+    WorldFrame frames[PIPELINE_DEPTH];
+    _Alignas(64) _Atomic uint32_t head;     // Frames published (worker)
+    _Alignas(64) _Atomic uint32_t tail;     // Frames sent (output thread)
+
+    // Output thread -> worker, per slot: the session given up on
+    // (release-stored after its drop_reason)
+    _Atomic uint32_t* drop_session;
+    uint8_t* drop_reason;   // OutputDrop
+
+    // Output thread only
+    OutputClient* clients;      // max_players
+    SnapshotBuilder* snapshot;  // The room's (NOT owned)
+    InterestScratch* interest;  // The room's (NOT owned)
+    OutputStage* stage;
+
+    int room_id;
+    int max_players;
+    int sync_bullets;
+    int send_queue_size;
+    int send_stall_ticks;
+
+    // I/O threads only (NULL: the worker reads the sockets itself)
+    InputQueue* inputs;     // The worker's queue
+    uint16_t room_index;    // Room's index in its worker's room list
+    int msg_budget;         // Per client per frame, as in GameServer
+    int byte_budget;
+    uint32_t tick;          // Room's tick as of the last frame (for pongs)
+};
+
+/**
+ * OutputStage - The output thread of one worker (or I/O thread), for all of its rooms
+ */
+struct OutputStage {
+    pthread_t thread;
+    int index;                  // Stage number
+    NetReactor* reactor;        // Client sockets (read or backed up) + wake pipe
+    int wake_pipe[2];           // Worker writes here after publishing
+
+    RoomOutput** rooms;
+    int room_count;
+    int room_capacity;
+
+    MetricsShard* metrics;      // Written by the output thread only
+    uint64_t syscalls_seen;     // net_syscall_count already counted
+    _Atomic int running;
+    int started;
+};
+
+/**
+ * pipeline_stage_init - Set up an output stage (not started yet)
+ *
+ * @param stage        Stage to initialize
+ * @param index        Stage number (for log output)
+ * @param max_rooms    Rooms it will serve
+ * @param max_sockets  Client sockets it may watch at once
+ * @param metrics      Shard of the output thread
+ * @return             0 on success, -1 on failure
+ */
+int pipeline_stage_init(OutputStage* stage, int index, int max_rooms, int max_sockets,
+                        MetricsShard* metrics);
+
+/**
+ * pipeline_stage_start - Spawn the output thread
+ *
+ * @param stage  The stage
+ * @return       0 on success, -1 if the thread could not be created
+ */
+int pipeline_stage_start(OutputStage* stage);
+
+/**
+ * pipeline_stage_wake - Tell the output thread new frames are waiting
+ *
+ * One write() to its wake pipe; a full pipe already guarantees a
+ * wakeup. The worker rings once per loop, not once per frame.
+ *
+ * @param stage  The stage (NULL is ignored)
+ */
+void pipeline_stage_wake(OutputStage* stage);
+
+/**
+ * pipeline_stage_stop - Stop and join the output thread
+ *
+ * Frames still in the rings are left there (pipeline_room_destroy()
+ * closes their sockets).
+ *
+ * @param stage  The stage
+ */
+void pipeline_stage_stop(OutputStage* stage);
+
+/**
+ * pipeline_stage_free - Release the reactor and the wake pipe
+ *
+ * Destroy the stage's rooms first.
+ *
+ * @param stage  The stage
+ */
+void pipeline_stage_free(OutputStage* stage);
+
+/**
+ * pipeline_room_create - Pipeline a room through an output stage
+ *
+ * Allocates the frames (players and a bullet store of the room's size
+ * each) and the per-slot senders, and sets server->output. From now on
+ * the room's snapshot and interest scratch belong to the stage's
+ * thread.
+ *
+ * With 'inputs' the stage also reads the room's sockets, within the
+ * room's msg_budget/byte_budget, and game_server_add_player() leaves
+ * them out of the worker's reactor.
+ *
+ * @param server      The room (no players yet)
+ * @param stage       Stage that will send its frames (not started yet)
+ * @param inputs      Worker's input queue, or NULL if the worker reads
+ * @param room_index  Room's index in its worker's room list
+ * @return            The room's output, or NULL if out of memory
+ */
+RoomOutput* pipeline_room_create(GameServer* server, OutputStage* stage,
+                                 InputQueue* inputs, int room_index);
+
+/**
+ * pipeline_room_destroy - Close every socket the pipeline still holds
+ *
+ * Call after the stage's thread stopped and game_server_cleanup():
+ * unsent frames are followed session by session, so every socket that
+ * was ever handed over is closed exactly once.
+ *
+ * @param out  The room's output (NULL is ignored)
+ */
+void pipeline_room_destroy(RoomOutput* out);
+
+/**
+ * pipeline_acquire_frame - Next free frame, for the worker to fill in
+ *
+ * @param out   The room's output
+ * @param wait  0: return NULL if both frames are still unsent;
+ *              1: wake the output thread and yield until one is free
+ * @return      The frame, or NULL
+ */
+WorldFrame* pipeline_acquire_frame(RoomOutput* out, int wait);
+
+/**
+ * pipeline_publish_frame - Hand a filled-in frame to the output thread
+ *
+ * @param out    The room's output
+ * @param frame  From pipeline_acquire_frame()
+ */
+void pipeline_publish_frame(RoomOutput* out, WorldFrame* frame);
+
+/**
+ * pipeline_take_drop - Did the output thread give up on this player?
+ *
+ * @param out      The room's output
+ * @param slot     Player slot
+ * @param session  The player's session
+ * @return         Reason for the log, or NULL if the player is fine
+ */
+const char* pipeline_take_drop(const RoomOutput* out, int slot, uint32_t session);
+
+#endif // PIPELINE_H
@@ -0,0 +1,532 @@
+/**
+ * recording.c - Append-Only Room Recordings and mmap'd Replay
+ *
+ * See recording.h for the file layout.
+ */
+
+#include "recording.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ============================================================================
+// KEYFRAMES
+// ============================================================================
+
+/**
+ * history_size - Bytes of the WorldHistory rows
+ */
+static size_t history_size(const GameServer* server) {
+    return (size_t)WORLD_HISTORY_TICKS * server->max_players * sizeof(HistoryPoint);
+}
+
+/**
+ * record_keyframe_size - Header + every slot + every bullet + every free id + history
+ */
+size_t record_keyframe_size(const GameServer* server) {
+    return sizeof(RecordKeyframe) +
+           (size_t)server->max_players * sizeof(RecordPlayer) +
+           (size_t)server->bullets.capacity * (sizeof(RecordBullet) + sizeof(uint16_t)) +
+           history_size(server);
+}
+
+/**
+ * record_encode_keyframe - Active players by slot, bullets by index, free ids
+ *
+ * Bullets are kept in ARRAY order and the free ids in STACK order: both
+ * decide what happens next (hit test order, which id the next shot
+ * gets), so a restored room must have them exactly as they were.
+ */
+size_t record_encode_keyframe(const GameServer* server, uint8_t* out) {
+    const BulletStore* bullets = &server->bullets;
+    uint8_t* p = out + sizeof(RecordKeyframe);
+
+    RecordKeyframe keyframe = {
+        .tick = server->tick,
+        .bullet_count = (uint32_t)bullets->count,
+        .free_count = (uint32_t)bullets->free_count
+    };
+
+    for (int i = 0; i < server->max_players; i++) {
+        const ServerPlayer* player = &server->players[i];
+        if (!player->active) continue;
+
+        RecordPlayer record = {
+            .slot = (uint16_t)i,
+            .version = player->version,
+            .weapon = player->weapon,
+            .input_flags = player->input_flags,
+            .input_this_tick = (uint8_t)player->input_this_tick,
+            .x = player->x, .y = player->y,
+            .vx = player->vx, .vy = player->vy,
+            .fixed_x = player->fixed.x, .fixed_y = player->fixed.y,
+            .fixed_vx = player->fixed.vx, .fixed_vy = player->fixed.vy,
+            .health = player->health,
+            .last_sequence = player->last_sequence,
+            .acked_tick = player->acked_tick,
+            .fire_cooldown = player->fire_cooldown,
+            .rewind_ticks = player->rewind_ticks,
+            .history_since = server->history.since[i]
+        };
+        memcpy(record.name, player->name, sizeof(record.name));
+        memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+        keyframe.player_count++;
+    }
+
+    for (int b = 0; b < bullets->count; b++) {
+        RecordBullet record = {
+            .x = bullets->x[b], .y = bullets->y[b],
+            .vx = bullets->vx[b], .vy = bullets->vy[b],
+            .lifetime = bullets->lifetime[b],
+            .id = bullets->id[b],
+            .owner = bullets->owner[b],
+            .weapon = bullets->weapon[b],
+            .rewind = bullets->rewind[b]
+        };
+        memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+    }
+
+    memcpy(p, bullets->free_ids, (size_t)bullets->free_count * sizeof(uint16_t));
+    p += (size_t)bullets->free_count * sizeof(uint16_t);
+
+    memcpy(p, server->history.points, history_size(server));
+    p += history_size(server);
+
+    memcpy(out, &keyframe, sizeof(keyframe));
+    return (size_t)(p - out);
+}
+
+/**
+ * record_restore_keyframe - Reseat the players, refill the bullet store
+ */
+int record_restore_keyframe(GameServer* server, const uint8_t* payload, size_t length) {
+    RecordKeyframe keyframe;
+    if (length < sizeof(keyframe)) return -1;
+    memcpy(&keyframe, payload, sizeof(keyframe));
+
+    BulletStore* bullets = &server->bullets;
+    size_t expected = sizeof(keyframe) +
+                      (size_t)keyframe.player_count * sizeof(RecordPlayer) +
+                      (size_t)keyframe.bullet_count * sizeof(RecordBullet) +
+                      (size_t)keyframe.free_count * sizeof(uint16_t) +
+                      history_size(server);
+    if (expected != length ||
+        keyframe.player_count > (uint32_t)server->max_players ||
+        keyframe.bullet_count + keyframe.free_count != (uint32_t)bullets->capacity) {
+        return -1;
+    }
+
+    // Players: a restored room only ever holds recorded (socketless) ones
+    for (int i = 0; i < server->max_players; i++) {
+        server->players[i].active = 0;
+    }
+    server->player_count = 0;
+
+    const uint8_t* p = payload + sizeof(keyframe);
+    for (int i = 0; i < keyframe.player_count; i++, p += sizeof(RecordPlayer)) {
+        RecordPlayer record;
+        memcpy(&record, p, sizeof(record));
+
+        ConnectMsg connect = { .version = record.version };
+        memcpy(connect.name, record.name, sizeof(connect.name));
+        if (game_server_add_recorded_player(server, record.slot, &connect) < 0) return -1;
+
+        ServerPlayer* player = &server->players[record.slot];
+        memcpy(player->name, record.name, sizeof(player->name));
+        player->weapon = record.weapon;
+        player->input_flags = record.input_flags;
+        player->logged_flags = record.input_flags;
+        player->input_this_tick = record.input_this_tick;
+        player->x = record.x;
+        player->y = record.y;
+        player->vx = record.vx;
+        player->vy = record.vy;
+        player->fixed = (FixedBody){ record.fixed_x, record.fixed_y,
+                                     record.fixed_vx, record.fixed_vy };
+        player->health = record.health;
+        player->last_sequence = record.last_sequence;
+        player->acked_tick = record.acked_tick;
+        player->fire_cooldown = record.fire_cooldown;
+        player->rewind_ticks = record.rewind_ticks;
+        server->history.since[record.slot] = record.history_since;
+    }
+
+    // Bullets: same array order, same ids, same free stack
+    for (int id = 0; id < bullets->capacity; id++) {
+        bullets->index_of[id] = BULLET_STORE_NO_INDEX;
+    }
+    bullets->count = (int)keyframe.bullet_count;
+    for (int b = 0; b < bullets->count; b++, p += sizeof(RecordBullet)) {
+        RecordBullet record;
+        memcpy(&record, p, sizeof(record));
+        if (record.id >= bullets->capacity) return -1;
+
+        bullets->x[b] = record.x;
+        bullets->y[b] = record.y;
+        bullets->vx[b] = record.vx;
+        bullets->vy[b] = record.vy;
+        bullets->lifetime[b] = record.lifetime;
+        bullets->id[b] = record.id;
+        bullets->owner[b] = record.owner;
+        bullets->weapon[b] = record.weapon;
+        bullets->rewind[b] = record.rewind;
+        bullets->index_of[record.id] = (uint32_t)b;
+    }
+    bullets->free_count = (int)keyframe.free_count;
+    memcpy(bullets->free_ids, p, (size_t)keyframe.free_count * sizeof(uint16_t));
+    p += (size_t)keyframe.free_count * sizeof(uint16_t);
+
+    // History last: seating the players above wrote into it
+    memcpy(server->history.points, p, history_size(server));
+
+    server->tick = keyframe.tick;
+    server->input_tick = keyframe.tick;
+    return 0;
+}
+
+// ============================================================================
+// RECORDER
+// ============================================================================
+
+/**
+ * write_all - write() until everything is out
+ */
+static int write_all(int fd, const void* data, size_t length) {
+    const uint8_t* p = data;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * recorder_fail - Stop recording after an I/O error (the room carries on)
+ */
+static void recorder_fail(Recorder* recorder, const char* what) {
+    LOG_WARN("Recording stopped: %s failed (%s)", what, strerror(errno));
+    close(recorder->fd);
+    recorder->fd = -1;
+}
+
+/**
+ * recorder_flush - Write the buffered records
+ *
+ * Page-cache writes, 64 KB at a time - rare, and short next to a tick.
+ */
+static void recorder_flush(Recorder* recorder) {
+    if (recorder->fd < 0 || recorder->used == 0) return;
+    if (write_all(recorder->fd, recorder->buffer, recorder->used) != 0) {
+        recorder_fail(recorder, "write");
+        return;
+    }
+    recorder->written += recorder->used;
+    recorder->used = 0;
+}
+
+/**
+ * recorder_append - Buffer one record (larger than the buffer: write it now)
+ */
+static void recorder_append(Recorder* recorder, uint8_t type,
+                            const void* payload, size_t length) {
+    RecordHeader header = { .type = type, .length = (uint32_t)length };
+    size_t total = sizeof(header) + length;
+
+    if (recorder->used + total > RECORD_BUFFER_SIZE) recorder_flush(recorder);
+    if (recorder->fd < 0) return;
+
+    if (total > RECORD_BUFFER_SIZE) {
+        if (write_all(recorder->fd, &header, sizeof(header)) != 0 ||
+            write_all(recorder->fd, payload, length) != 0) {
+            recorder_fail(recorder, "write");
+            return;
+        }
+        recorder->written += total;
+        return;
+    }
+
+    memcpy(recorder->buffer + recorder->used, &header, sizeof(header));
+    memcpy(recorder->buffer + recorder->used + sizeof(header), payload, length);
+    recorder->used += total;
+}
+
+/**
+ * recorder_event - Append an event, preceded by REC_TICK if the tick moved
+ */
+static void recorder_event(Recorder* recorder, uint32_t tick, uint8_t type,
+                           const void* payload, size_t length) {
+    if (recorder == NULL || recorder->fd < 0) return;
+    if (tick != recorder->last_tick) {
+        recorder_append(recorder, REC_TICK, &tick, sizeof(tick));
+        recorder->last_tick = tick;
+    }
+    recorder_append(recorder, type, payload, length);
+}
+
+/**
+ * recorder_keyframe - Append a keyframe and index it
+ *
+ * The recording is flushed first, so the index never points past what
+ * is actually in the file.
+ */
+static void recorder_keyframe(Recorder* recorder, const GameServer* server) {
+    size_t length = record_encode_keyframe(server, recorder->scratch);
+
+    recorder_flush(recorder);
+    uint64_t offset = recorder->written;
+    recorder_append(recorder, REC_KEYFRAME, recorder->scratch, length);
+    recorder_flush(recorder);
+    if (recorder->fd < 0) return;
+
+    RecordIndexEntry entry = { .tick = server->tick, .offset = offset };
+    if (recorder->index_fd >= 0 &&
+        write_all(recorder->index_fd, &entry, sizeof(entry)) != 0) {
+        LOG_WARN("Recording index stopped: write failed (%s)", strerror(errno));
+        close(recorder->index_fd);
+        recorder->index_fd = -1;
+    }
+
+    // Events up to the next REC_TICK belong to the keyframe's tick
+    recorder->last_tick = server->tick;
+    recorder->next_keyframe = server->tick + RECORD_KEYFRAME_TICKS;
+}
+
+/**
+ * recorder_open - Create both files, write the header and a keyframe
+ */
+Recorder* recorder_open(const char* path, const GameServer* server) {
+    Recorder* recorder = calloc(1, sizeof(Recorder));
+    char* index_path = malloc(strlen(path) + sizeof(".idx"));
+    if (recorder == NULL || index_path == NULL) {
+        free(recorder);
+        free(index_path);
+        return NULL;
+    }
+    sprintf(index_path, "%s.idx", path);
+
+    recorder->scratch_size = record_keyframe_size(server);
+    recorder->buffer = malloc(RECORD_BUFFER_SIZE);
+    recorder->scratch = malloc(recorder->scratch_size);
+    recorder->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    recorder->index_fd = open(index_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    free(index_path);
+
+    if (recorder->buffer == NULL || recorder->scratch == NULL ||
+        recorder->fd < 0 || recorder->index_fd < 0) {
+        if (recorder->fd >= 0) close(recorder->fd);
+        if (recorder->index_fd >= 0) close(recorder->index_fd);
+        free(recorder->buffer);
+        free(recorder->scratch);
+        free(recorder);
+        return NULL;
+    }
+
+    RecordFileHeader header = {
+        .magic = RECORD_MAGIC,
+        .version = RECORD_VERSION,
+        .tick_rate = TICK_RATE,
+        .room_id = (uint16_t)server->room_id,
+        .max_players = (uint16_t)server->max_players,
+        .max_bullets = (uint32_t)server->bullets.capacity,
+        .sync_bullets = (uint32_t)server->sync_bullets,
+        .physics = (uint32_t)server->physics,
+        .max_rewind = (uint32_t)server->max_rewind
+    };
+    memcpy(recorder->buffer, &header, sizeof(header));
+    recorder->used = sizeof(header);
+
+    recorder_keyframe(recorder, server);
+    return recorder;
+}
+
+/**
+ * recorder_close - REC_END marks a recording that was finished cleanly
+ */
+void recorder_close(Recorder* recorder, const GameServer* server) {
+    if (recorder == NULL) return;
+
+    if (recorder->fd >= 0) {
+        uint32_t tick = server->tick;
+        recorder_append(recorder, REC_END, &tick, sizeof(tick));
+        recorder_flush(recorder);
+        if (recorder->fd >= 0) close(recorder->fd);
+    }
+    if (recorder->index_fd >= 0) close(recorder->index_fd);
+    free(recorder->buffer);
+    free(recorder->scratch);
+    free(recorder);
+}
+
+/**
+ * recorder_connect - A player was seated
+ */
+void recorder_connect(Recorder* recorder, uint32_t tick, int slot, const ConnectMsg* connect) {
+    RecordConnect record = { .slot = (uint16_t)slot, .version = connect->version };
+    memcpy(record.name, connect->name, sizeof(record.name));
+    recorder_event(recorder, tick, REC_CONNECT, &record, sizeof(record));
+}
+
+/**
+ * recorder_disconnect - A player left (for whatever reason)
+ */
+void recorder_disconnect(Recorder* recorder, uint32_t tick, int slot) {
+    uint16_t record = (uint16_t)slot;
+    recorder_event(recorder, tick, REC_DISCONNECT, &record, sizeof(record));
+}
+
+/**
+ * recorder_input - An input passed the sequence check
+ */
+void recorder_input(Recorder* recorder, uint32_t tick, int slot, const PlayerInputMsg* input) {
+    RecordInput record = {
+        .slot = (uint16_t)slot,
+        .input_flags = input->input_flags,
+        .weapon_type = input->weapon_type,
+        .sequence = input->sequence,
+        .ack_tick = input->ack_tick
+    };
+    recorder_event(recorder, tick, REC_INPUT, &record, sizeof(record));
+}
+
+/**
+ * recorder_end_tick - Keyframe every RECORD_KEYFRAME_TICKS
+ */
+void recorder_end_tick(Recorder* recorder, const GameServer* server) {
+    if (recorder == NULL || recorder->fd < 0) return;
+    if (server->tick >= recorder->next_keyframe) {
+        recorder_keyframe(recorder, server);
+    }
+}
+
+// ============================================================================
+// REPLAY
+// ============================================================================
+
+/**
+ * map_file - mmap() a whole file read-only
+ *
+ * @return  The mapping, or NULL if missing, empty or unmappable
+ */
+static const uint8_t* map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // The mapping stays valid without the descriptor
+    if (data == MAP_FAILED) return NULL;
+
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+/**
+ * replay_open - Map the recording and, if it exists, its index
+ */
+int replay_open(Replay* replay, const char* path) {
+    memset(replay, 0, sizeof(Replay));
+
+    replay->data = map_file(path, &replay->size);
+    if (replay->data == NULL) return -1;
+
+    if (replay->size < sizeof(RecordFileHeader)) {
+        replay_close(replay);
+        return -1;
+    }
+    memcpy(&replay->header, replay->data, sizeof(RecordFileHeader));
+    if (replay->header.magic != RECORD_MAGIC || replay->header.version != RECORD_VERSION) {
+        replay_close(replay);
+        return -1;
+    }
+    replay->position = sizeof(RecordFileHeader);
+
+    // Read front to back: let the kernel read ahead aggressively
+    madvise((void*)replay->data, replay->size, MADV_SEQUENTIAL);
+
+    char* index_path = malloc(strlen(path) + sizeof(".idx"));
+    if (index_path != NULL) {
+        sprintf(index_path, "%s.idx", path);
+        replay->index = (const RecordIndexEntry*)map_file(index_path, &replay->index_size);
+        replay->keyframe_count = (int)(replay->index_size / sizeof(RecordIndexEntry));
+        free(index_path);
+    }
+    return 0;
+}
+
+/**
+ * replay_close - Unmap the recording and the index
+ */
+void replay_close(Replay* replay) {
+    if (replay->data != NULL) munmap((void*)replay->data, replay->size);
+    if (replay->index != NULL) munmap((void*)replay->index, replay->index_size);
+    memset(replay, 0, sizeof(Replay));
+}
+
+/**
+ * replay_seek - Binary search for the last keyframe with tick <= 'tick'
+ */
+int64_t replay_seek(Replay* replay, uint32_t tick) {
+    size_t offset = sizeof(RecordFileHeader);
+
+    if (replay->keyframe_count > 0) {
+        int lo = 0, hi = replay->keyframe_count - 1, found = -1;
+        while (lo <= hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (replay->index[mid].tick <= tick) {
+                found = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if (found < 0) return -1;
+        offset = (size_t)replay->index[found].offset;
+    }
+
+    // Whatever the index says, a keyframe must actually be there
+    RecordHeader header;
+    RecordKeyframe keyframe;
+    if (offset + sizeof(header) + sizeof(keyframe) > replay->size) return -1;
+    memcpy(&header, replay->data + offset, sizeof(header));
+    memcpy(&keyframe, replay->data + offset + sizeof(header), sizeof(keyframe));
+    if (header.type != REC_KEYFRAME) return -1;
+
+    replay->position = offset;
+    return keyframe.tick;
+}
+
+/**
+ * replay_next - Hand out the next record straight from the mapping
+ */
+int replay_next(Replay* replay, uint8_t* type, const uint8_t** payload, uint32_t* length) {
+    size_t left = replay->size - replay->position;
+    if (left == 0) return 0;
+
+    RecordHeader header;
+    if (left < sizeof(header)) return -1;
+    memcpy(&header, replay->data + replay->position, sizeof(header));
+    if (left - sizeof(header) < header.length) return -1;
+
+    *type = header.type;
+    *payload = replay->data + replay->position + sizeof(header);
+    *length = header.length;
+    replay->position += sizeof(header) + header.length;
+    return 1;
+}
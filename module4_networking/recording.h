@@ -0,0 +1,305 @@
+/**
+ * recording.h - Record a Room's Inputs, Replay Them Without a Network
+ *
+ * CONCEPT: Record the Causes, Not the Effects
+ * ===========================================
+ * A room is DETERMINISTIC: the same state plus the same inputs in the
+ * same ticks gives the same next state, bit for bit (same binary, same
+ * CPU). So to reproduce a match we don't need its snapshots - only
+ * what came IN:
+ *
+ *     tick 1200   connect     slot 2 "Ace" (protocol 5)
+ *     tick 1200   input       slot 0  UP|FIRE  seq 8812  ack 1198
+ *     tick 1201   input       slot 2  LEFT     seq 17    ack 1199
+ *     tick 1307   disconnect  slot 0
+ *
+ * Replaying feeds those to a fresh GameServer and ticks it - with no
+ * sockets and no sleeping, as fast as the CPU allows. That makes a
+ * recorded match both a BENCHMARK (ticks per second, time per phase) and
+ * a REGRESSION TEST (did a change alter the simulation?).
+ *
+ * CONCEPT: The File
+ * =================
+ * One append-only file per room, a header and then records:
+ *
+ *     ┌────────┬──────┬───────┬───────┬──────┬───────┬─────┬──────┬─────┐
+ *     │ header │ KEY  │ TICK  │ INPUT │ TICK │ INPUT │ ... │ KEY  │ ... │
+ *     │        │ t=0  │ t=12  │       │ t=13 │       │     │t=600 │     │
+ *     └────────┴──────┴───────┴───────┴──────┴───────┴─────┴──────┴─────┘
+ *
+ * Every record is a 5-byte RecordHeader (type, length) plus its
+ * payload; an input costs 17 bytes. A TICK record is written only when
+ * the tick changes, and events are stamped with the tick they are
+ * SIMULATED in (see GameServer.input_tick), not the one running when
+ * they arrived.
+ *
+ * CONCEPT: Keyframes and the Index
+ * ================================
+ * Every RECORD_KEYFRAME_TICKS a KEYFRAME record holds the complete
+ * simulation state - players, every bullet in array order, the free id
+ * stack and the lag compensation history - so replay can start there
+ * instead of at tick 0. Next to the recording, an index file gets one
+ * RecordIndexEntry (tick, file offset) per keyframe:
+ *
+ *     room-000.vdr       the recording
+ *     room-000.vdr.idx   [tick 0, @28] [tick 600, @9731] [tick 1200, ...]
+ *
+ * Replay mmap()s both: seeking is a binary search in the index and a
+ * pointer into the recording. When replay runs THROUGH a keyframe it
+ * encodes its own state the same way and compares - any difference
+ * means the simulation is no longer what was recorded.
+ *
+ * Not recorded: anything that only affects what is SENT (snapshot
+ * history, interest sets, UDP sequence state). After a seek the first
+ * snapshots are full instead of deltas, which changes encode times but
+ * not the simulation.
+ */
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "game_server.h"
+
+#define RECORD_MAGIC   0x31524456u  // "VDR1"
+#define RECORD_VERSION 3
+
+// Ticks between keyframes (10 seconds)
+#define RECORD_KEYFRAME_TICKS (TICK_RATE * 10)
+
+// Records are collected here and written in one go
+#define RECORD_BUFFER_SIZE 65536
+
+/**
+ * RecordType - What a record holds
+ */
+typedef enum {
+    REC_TICK = 1,       // uint32 tick: following events belong to it
+    REC_CONNECT,        // RecordConnect
+    REC_DISCONNECT,     // uint16 slot
+    REC_INPUT,          // RecordInput
+    REC_KEYFRAME,       // RecordKeyframe + players + bullets + free ids
+    REC_END             // uint32 tick: the room's tick when recording stopped
+} RecordType;
+
+/**
+ * RecordFileHeader - Start of every recording: the room's shape
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tick_rate;
+    uint16_t room_id;
+    uint16_t max_players;
+    uint32_t max_bullets;
+    uint32_t sync_bullets;
+    uint32_t physics;       // PhysicsMode
+    uint32_t max_rewind;    // Lag compensation cap (ticks)
+} RecordFileHeader;
+
+/**
+ * RecordHeader - Start of every record
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;           // RecordType
+    uint32_t length;        // Payload bytes that follow
+} RecordHeader;
+
+/**
+ * RecordConnect / RecordInput - Event payloads
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t slot;
+    uint8_t version;
+    char name[16];
+} RecordConnect;
+
+typedef struct __attribute__((packed)) {
+    uint16_t slot;
+    uint8_t input_flags;
+    uint8_t weapon_type;
+    uint32_t sequence;
+    uint32_t ack_tick;
+} RecordInput;
+
+/**
+ * RecordKeyframe - Keyframe payload, followed by its arrays
+ *
+ * RecordPlayer and RecordBullet are the simulation fields of ServerPlayer
+ * and of one BulletStore index.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t tick;
+    uint16_t player_count;  // RecordPlayer entries that follow
+    uint32_t bullet_count;  // RecordBullet entries after those
+    uint32_t free_count;    // uint16 free ids after those (stack order)
+                            // Then the WorldHistory rows (all slots)
+} RecordKeyframe;
+
+typedef struct __attribute__((packed)) {
+    uint16_t slot;
+    uint8_t version;
+    uint8_t weapon;
+    uint8_t input_flags;
+    uint8_t input_this_tick;
+    char name[16];
+    float x, y, vx, vy;
+    int32_t fixed_x, fixed_y, fixed_vx, fixed_vy;  // PHYSICS_FIXED state
+    int32_t health;
+    uint32_t last_sequence;
+    uint32_t acked_tick;
+    float fire_cooldown;
+    uint8_t rewind_ticks;
+    uint32_t history_since;
+} RecordPlayer;
+
+typedef struct __attribute__((packed)) {
+    float x, y, vx, vy, lifetime;
+    uint16_t id;
+    uint16_t owner;
+    uint8_t weapon;
+    uint8_t rewind;
+} RecordBullet;
+
+/**
+ * RecordIndexEntry - One keyframe in the .idx file
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t tick;
+    uint32_t reserved;
+    uint64_t offset;        // Of the keyframe's RecordHeader
+} RecordIndexEntry;
+
+/**
+ * Recorder - Appends one room's events to its file (worker thread only)
+ */
+typedef struct Recorder {
+    int fd;                 // Recording (-1 once a write failed)
+    int index_fd;           // Keyframe index
+    uint8_t* buffer;        // RECORD_BUFFER_SIZE bytes not yet written
+    size_t used;
+    uint64_t written;       // Bytes already in the file
+    uint32_t last_tick;     // Tick of the last REC_TICK written
+    uint32_t next_keyframe; // Tick of the next keyframe
+    uint8_t* scratch;       // Keyframe encoding
+    size_t scratch_size;
+} Recorder;
+
+/**
+ * Replay - A recording opened for reading (mmap'd)
+ */
+typedef struct {
+    const uint8_t* data;    // The whole recording
+    size_t size;
+    const RecordIndexEntry* index;  // Keyframes (NULL if no index file)
+    int keyframe_count;
+    size_t index_size;
+    RecordFileHeader header;
+    size_t position;        // Offset of the next record
+} Replay;
+
+/**
+ * recorder_open - Start recording a room
+ *
+ * Creates 'path' and 'path'.idx (truncating old ones) and writes the
+ * header plus a first keyframe of the room's current state.
+ *
+ * @param path    Recording file
+ * @param server  The room (already initialized)
+ * @return        New recorder, or NULL on error
+ */
+Recorder* recorder_open(const char* path, const GameServer* server);
+
+/**
+ * recorder_close - Write REC_END, flush and close
+ *
+ * @param recorder  Recorder (NULL is ignored)
+ * @param server    The room, for its final tick
+ */
+void recorder_close(Recorder* recorder, const GameServer* server);
+
+/**
+ * recorder_connect / recorder_disconnect / recorder_input - Append one event
+ *
+ * A NULL recorder is ignored, so callers don't need to check.
+ *
+ * @param tick  Tick the event is simulated in (GameServer.input_tick)
+ */
+void recorder_connect(Recorder* recorder, uint32_t tick, int slot, const ConnectMsg* connect);
+void recorder_disconnect(Recorder* recorder, uint32_t tick, int slot);
+void recorder_input(Recorder* recorder, uint32_t tick, int slot, const PlayerInputMsg* input);
+
+/**
+ * recorder_end_tick - Called after each tick: keyframe if one is due
+ *
+ * @param recorder  Recorder (NULL is ignored)
+ * @param server    The room, its tick already advanced
+ */
+void recorder_end_tick(Recorder* recorder, const GameServer* server);
+
+/**
+ * record_keyframe_size - Largest keyframe payload a room can produce
+ */
+size_t record_keyframe_size(const GameServer* server);
+
+/**
+ * record_encode_keyframe - Serialize a room's simulation state
+ *
+ * @param server  The room
+ * @param out     At least record_keyframe_size() bytes
+ * @return        Bytes written
+ */
+size_t record_encode_keyframe(const GameServer* server, uint8_t* out);
+
+/**
+ * record_restore_keyframe - Replace a room's state with a keyframe
+ *
+ * Restored players have no socket (see game_server_add_recorded_player).
+ *
+ * @param server   Room created with the recording's limits
+ * @param payload  REC_KEYFRAME payload
+ * @param length   Payload bytes
+ * @return         0 on success, -1 if the keyframe doesn't fit the room
+ */
+int record_restore_keyframe(GameServer* server, const uint8_t* payload, size_t length);
+
+/**
+ * replay_open - Map a recording (and its index, if present)
+ *
+ * @param replay  Filled in
+ * @param path    Recording file
+ * @return        0 on success, -1 if missing or not a recording
+ */
+int replay_open(Replay* replay, const char* path);
+
+/**
+ * replay_close - Unmap everything
+ */
+void replay_close(Replay* replay);
+
+/**
+ * replay_seek - Position at the newest keyframe at or before 'tick'
+ *
+ * Binary search in the index. Without an index the position is the
+ * first keyframe (right after the header).
+ *
+ * @param replay  The replay
+ * @param tick    Wanted tick
+ * @return        Tick of the keyframe now next, or -1 if there is none
+ */
+int64_t replay_seek(Replay* replay, uint32_t tick);
+
+/**
+ * replay_next - Read the record at the current position and advance
+ *
+ * @param replay   The replay
+ * @param type     Record type
+ * @param payload  Points into the mapping
+ * @param length   Payload bytes
+ * @return         1 = record, 0 = end of file, -1 = truncated record
+ */
+int replay_next(Replay* replay, uint8_t* type, const uint8_t** payload, uint32_t* length);
+
+#endif // RECORDING_H
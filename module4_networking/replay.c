@@ -0,0 +1,311 @@
+/**
+ * replay.c - Re-run a Recorded Room as Fast as Possible
+ *
+ * Reads a recording made with `./server --record DIR` (see recording.h)
+ * and drives a GameServer from it - no sockets, no sleeping:
+ *
+ *     1. Seeks to the newest keyframe at or before --from (mmap'd index)
+ *        and restores the room from it
+ *     2. Applies every recorded connect, input and disconnect in the
+ *        tick it was simulated in, ticking the room in between
+ *     3. At every later keyframe, compares the room with the recording
+ *     4. Reports ticks per second and the average time of each tick phase
+ *
+ * CONCEPT: A Recording Is a Benchmark and a Test
+ * ==============================================
+ * The ticks are the same ones the live server ran, so ticks/second here
+ * measures the simulation (and snapshot encoding) of a REAL match
+ * without network noise - run it before and after a change. And since
+ * the room is deterministic, a keyframe mismatch means the change
+ * altered gameplay: the exit code is 1, so a directory of recordings
+ * works as a regression suite.
+ *
+ * Snapshots are still built for every player (they are part of a
+ * tick's cost), just never sent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game_server.h"
+#include "recording.h"
+#include "metrics.h"
+#include "log.h"
+
+/**
+ * ReplayStats - What happened during one run
+ */
+typedef struct {
+    uint64_t ticks;
+    uint64_t events;
+    int keyframes_ok;
+    int keyframes_bad;
+    int64_t first_bad_tick;     // -1 = none
+    int truncated;              // The recording ends mid-record
+} ReplayStats;
+
+/**
+ * now_seconds - CLOCK_MONOTONIC in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * replay_advance - Tick the room until it reaches 'tick' (or 'stop')
+ *
+ * @return  1 if 'tick' was reached, 0 if 'stop' came first
+ */
+static int replay_advance(GameServer* server, uint32_t tick, uint32_t stop,
+                          float dt, ReplayStats* stats) {
+    while (server->tick < tick) {
+        if (server->tick >= stop) return 0;
+        game_server_tick(server, dt);
+        stats->ticks++;
+    }
+    return 1;
+}
+
+/**
+ * replay_verify - Compare the room with a recorded keyframe
+ */
+static void replay_verify(GameServer* server, const uint8_t* payload, uint32_t length,
+                          uint8_t* scratch, ReplayStats* stats) {
+    size_t size = record_encode_keyframe(server, scratch);
+    if (size == length && memcmp(scratch, payload, size) == 0) {
+        stats->keyframes_ok++;
+        return;
+    }
+    stats->keyframes_bad++;
+    if (stats->first_bad_tick < 0) stats->first_bad_tick = server->tick;
+}
+
+/**
+ * replay_run - Apply records from the current position until the end or 'stop'
+ */
+static void replay_run(Replay* replay, GameServer* server, uint32_t stop,
+                       int verify, ReplayStats* stats) {
+    float dt = 1.0f / replay->header.tick_rate;
+    uint8_t* scratch = malloc(record_keyframe_size(server));
+
+    uint8_t type;
+    const uint8_t* payload;
+    uint32_t length;
+    int result;
+    while ((result = replay_next(replay, &type, &payload, &length)) > 0) {
+        uint32_t tick;
+        switch (type) {
+            case REC_TICK:
+            case REC_END:
+                if (length < sizeof(tick)) break;
+                memcpy(&tick, payload, sizeof(tick));
+                if (!replay_advance(server, tick, stop, dt, stats)) return;
+                break;
+
+            case REC_CONNECT: {
+                RecordConnect record;
+                if (length < sizeof(record)) break;
+                memcpy(&record, payload, sizeof(record));
+                ConnectMsg connect = { .version = record.version };
+                memcpy(connect.name, record.name, sizeof(connect.name));
+                game_server_add_recorded_player(server, record.slot, &connect);
+                stats->events++;
+                break;
+            }
+
+            case REC_DISCONNECT: {
+                uint16_t slot;
+                if (length < sizeof(slot)) break;
+                memcpy(&slot, payload, sizeof(slot));
+                if (slot < server->max_players) {
+                    game_server_disconnect_player(server, slot, "recorded");
+                }
+                stats->events++;
+                break;
+            }
+
+            case REC_INPUT: {
+                RecordInput record;
+                if (length < sizeof(record)) break;
+                memcpy(&record, payload, sizeof(record));
+                if (record.slot >= server->max_players ||
+                    !server->players[record.slot].active) {
+                    break;
+                }
+                PlayerInputMsg input = {
+                    .player_id = record.slot,
+                    .input_flags = record.input_flags,
+                    .weapon_type = record.weapon_type,
+                    .sequence = record.sequence,
+                    .ack_tick = record.ack_tick
+                };
+                game_server_apply_input(server, record.slot, &input);
+                stats->events++;
+                break;
+            }
+
+            case REC_KEYFRAME: {
+                RecordKeyframe keyframe;
+                if (length < sizeof(keyframe)) break;
+                memcpy(&keyframe, payload, sizeof(keyframe));
+                if (!replay_advance(server, keyframe.tick, stop, dt, stats)) return;
+                if (verify && scratch != NULL) {
+                    replay_verify(server, payload, length, scratch, stats);
+                }
+                break;
+            }
+
+            default:
+                break;  // Newer record type: skip it
+        }
+    }
+    if (result < 0) stats->truncated = 1;
+    free(scratch);
+}
+
+/**
+ * phase_average_us - Mean of one metrics histogram, in microseconds
+ */
+static double phase_average_us(const MetricsShard* shard, MetricHistogram id) {
+    const MetricsBuckets* h = &shard->histograms[id];
+    uint64_t count = 0;
+    for (int b = 0; b <= METRICS_MAX_BUCKETS; b++) {
+        count += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+    }
+    if (count == 0) return 0.0;
+    return (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / (double)count / 1000.0;
+}
+
+/**
+ * print_usage - Show command line options
+ */
+static void print_usage(const char* program) {
+    printf("Usage: %s RECORDING [options]\n", program);
+    printf("  --from TICK     Start at the newest keyframe at or before TICK (default 0)\n");
+    printf("  --to TICK       Stop after reaching TICK (default: end of recording)\n");
+    printf("  --no-verify     Don't compare the room with later keyframes\n");
+}
+
+/**
+ * main - Replay entry point
+ */
+int main(int argc, char* argv[]) {
+    const char* path = NULL;
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    int verify = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--from") == 0 && value) {
+            from = (uint32_t)strtoul(value, NULL, 10); i++;
+        } else if (strcmp(arg, "--to") == 0 && value) {
+            to = (uint32_t)strtoul(value, NULL, 10); i++;
+        } else if (strcmp(arg, "--no-verify") == 0) {
+            verify = 0;
+        } else if (arg[0] == '-' || path != NULL) {
+            print_usage(argv[0]);
+            return (strcmp(arg, "--help") == 0) ? 0 : 1;
+        } else {
+            path = arg;
+        }
+    }
+    if (path == NULL) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Replay replay;
+    if (replay_open(&replay, path) != 0) {
+        fprintf(stderr, "%s is not a recording\n", path);
+        return 1;
+    }
+
+    const RecordFileHeader* header = &replay.header;
+    printf("Recording: room %d, %d players, %u bullets (%u per client), %d Hz, "
+           "%s physics, %d keyframes indexed\n",
+           header->room_id, header->max_players, header->max_bullets,
+           header->sync_bullets, header->tick_rate,
+           (header->physics == PHYSICS_FIXED) ? "fixed" : "float", replay.keyframe_count);
+
+    Metrics* metrics = metrics_create(1);
+    RoomLimits limits = {
+        .max_players = header->max_players,
+        .max_bullets = (int)header->max_bullets,
+        .sync_bullets = (int)header->sync_bullets
+    };
+    GameServer server;
+    if (metrics == NULL ||
+        game_server_init(&server, header->room_id, NULL, &limits, metrics_shard(metrics, 0)) != 0) {
+        fprintf(stderr, "Out of memory for the room\n");
+        metrics_destroy(metrics);
+        replay_close(&replay);
+        return 1;
+    }
+    server.physics = (PhysicsMode)header->physics;
+    server.max_rewind = (header->max_rewind <= WORLD_HISTORY_MAX_REWIND) ?
+        (int)header->max_rewind : WORLD_HISTORY_MAX_REWIND;
+
+    // Seek, then restore the keyframe we landed on
+    int64_t start = replay_seek(&replay, from);
+    uint8_t type;
+    const uint8_t* payload;
+    uint32_t length;
+    if (start < 0 || replay_next(&replay, &type, &payload, &length) != 1 ||
+        record_restore_keyframe(&server, payload, length) != 0) {
+        fprintf(stderr, "No usable keyframe at or before tick %u\n", from);
+        game_server_cleanup(&server);
+        metrics_destroy(metrics);
+        replay_close(&replay);
+        return 1;
+    }
+
+    // Join/leave lines go through the logger thread, not the timed loop
+    log_init(stdout);
+
+    ReplayStats stats = { .first_bad_tick = -1 };
+    double t0 = now_seconds();
+    replay_run(&replay, &server, to, verify, &stats);
+    double elapsed = now_seconds() - t0;
+
+    log_shutdown();
+
+    double rate = (elapsed > 0) ? (double)stats.ticks / elapsed : 0.0;
+    printf("\n=== Replay: ticks %lld..%u ===\n", (long long)start, server.tick);
+    printf("Ticks:         %llu in %.3f s = %.0f ticks/s (%.1fx real time)\n",
+           (unsigned long long)stats.ticks, elapsed, rate, rate / header->tick_rate);
+    printf("Events:        %llu connects, inputs and disconnects\n",
+           (unsigned long long)stats.events);
+
+    const MetricsShard* shard = metrics_shard(metrics, 0);
+    static const char* const phase_names[METRIC_PHASE_COUNT] = {
+        "input", "physics", "firing", "bullets", "hits", "snapshot"
+    };
+    printf("Phase avg:    ");
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        printf(" %s %.1f us%s", phase_names[p], phase_average_us(shard, (MetricHistogram)p),
+               (p < METRIC_PHASE_COUNT - 1) ? "," : "\n");
+    }
+
+    if (verify) {
+        printf("Keyframes:     %d match, %d differ", stats.keyframes_ok, stats.keyframes_bad);
+        if (stats.first_bad_tick >= 0) {
+            printf(" (first at tick %lld)", (long long)stats.first_bad_tick);
+        }
+        printf("\n");
+    }
+    if (stats.truncated) {
+        printf("Note: the recording ends mid-record (server didn't shut down cleanly)\n");
+    }
+
+    game_server_cleanup(&server);
+    metrics_destroy(metrics);
+    replay_close(&replay);
+    return (stats.keyframes_bad > 0) ? 1 : 0;
+}
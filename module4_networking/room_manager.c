@@ -0,0 +1,843 @@
+/**
+ * room_manager.c - Room Manager and Worker Pool Implementation
+ *
+ * LIFECYCLE:
+ *     1. room_manager_create()  - allocate rooms, reactors, wake pipes
+ *     2. room_manager_start()   - UDP sockets, io_urings, output stages
+ *                                 (and input queues), then one pinned
+ *                                 thread per worker
+ *     3. room_manager_route()   - (main thread) send new players to rooms
+ *     4. room_manager_stop()    - signal + join the workers, then the
+ *                                 output stages
+ *     5. room_manager_destroy() - disconnect everyone, free memory
+ */
+
+// pthread_setaffinity_np() and CPU_SET() are GNU extensions
+#define _GNU_SOURCE
+
+#include "room_manager.h"
+#include "log.h"
+#include "recording.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sched.h>       // For cpu_set_t
+#endif
+
+// Ready sockets handled per reactor wakeup, per worker
+#define WORKER_MAX_EVENTS 64
+
+// io_uring submission queue size per worker (a full queue is simply
+// submitted early)
+#define WORKER_URING_ENTRIES 256
+
+// How often each worker prints its tick statistics (5 seconds)
+#define TICK_REPORT_INTERVAL_NS (5ULL * 1000000000ULL)
+
+/**
+ * worker_pin_to_cpu - Bind the calling worker thread to one core
+ */
+static void worker_pin_to_cpu(RoomWorker* worker) {
+#ifdef __linux__
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count <= 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(worker->index % cpu_count, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        LOG_WARN("Worker %d: could not pin to CPU %ld",
+                worker->index, worker->index % cpu_count);
+    }
+#else
+    (void)worker;
+#endif
+}
+
+/**
+ * worker_drain_wake_pipe - Empty the wake pipe after the reactor fired
+ */
+static void worker_drain_wake_pipe(RoomWorker* worker) {
+    char buffer[64];
+    while (read(worker->wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+/**
+ * worker_seat_pending - Move players from the inbox into their rooms
+ *
+ * The inbox lock is held only long enough to copy the list out, so the
+ * main thread is never blocked behind a slow MSG_CONNECT_ACK send.
+ */
+static void worker_seat_pending(RoomWorker* worker) {
+    PendingJoin joins[ROOM_INBOX_SIZE];
+
+    pthread_mutex_lock(&worker->inbox_lock);
+    int count = worker->inbox_count;
+    memcpy(joins, worker->inbox, count * sizeof(PendingJoin));
+    worker->inbox_count = 0;
+    pthread_mutex_unlock(&worker->inbox_lock);
+
+    for (int i = 0; i < count; i++) {
+        Room* room = joins[i].room;
+        if (joins[i].is_udp) {
+            game_server_add_udp_player(&room->server, &joins[i].addr,
+                                       &joins[i].udp_header, &joins[i].connect);
+        } else {
+            game_server_add_player(&room->server, joins[i].socket,
+                                   &joins[i].addr, &joins[i].connect);
+        }
+
+        pthread_mutex_lock(&worker->manager->lock);
+        room->reserved--;
+        room->seated = room->server.player_count;
+        pthread_mutex_unlock(&worker->manager->lock);
+    }
+}
+
+/**
+ * worker_receive_datagrams - Hand waiting UDP datagrams to their players
+ *
+ * The connection id says which room and slot a datagram belongs to
+ * (see game_server_add_udp_player). The sender's address must match
+ * too, so a guessed id alone can't inject input.
+ */
+static void worker_receive_datagrams(RoomWorker* worker) {
+    int count;
+    do {
+        count = net_udp_recv_batch(worker->udp_socket, worker->udp_in, NET_UDP_BATCH_SIZE);
+        uint64_t now_ms = net_time_ms();
+
+        for (int i = 0; i < count; i++) {
+            const NetDatagram* datagram = &worker->udp_in[i];
+            NetUdpHeader header;
+            if (net_udp_parse_header(datagram->data, datagram->length, &header) != 0) continue;
+
+            int room_index = (int)((header.connection_id >> 12) & 0x3FF);
+            if (room_index >= worker->room_count) continue;
+
+            GameServer* server = &worker->rooms[room_index]->server;
+            int slot = game_server_find_udp_player(server, header.connection_id);
+            if (slot < 0) continue;
+
+            const ServerPlayer* player = &server->players[slot];
+            if (player->udp.addr.sin_addr.s_addr != datagram->addr.sin_addr.s_addr ||
+                player->udp.addr.sin_port != datagram->addr.sin_port) {
+                continue;
+            }
+            game_server_handle_datagram(server, slot, datagram, now_ms);
+        }
+    } while (count == NET_UDP_BATCH_SIZE);
+}
+
+/**
+ * worker_reap_uring - Hand every io_uring completion to its player
+ *
+ * Called every loop iteration, not just when the reactor reports the
+ * ring's descriptor: looking at the completion queue costs no system
+ * call, and completions may arrive while we are busy ticking.
+ */
+static void worker_reap_uring(RoomWorker* worker) {
+    if (worker->uring == NULL) return;
+
+    NetUringEvent events[WORKER_MAX_EVENTS];
+    int count;
+    do {
+        count = net_uring_reap(worker->uring, events, WORKER_MAX_EVENTS);
+        for (int i = 0; i < count; i++) {
+            ServerPlayer* player = (ServerPlayer*)events[i].user_data;
+            GameServer* server = player->server;
+            game_server_handle_completion(server, (int)(player - server->players), &events[i]);
+        }
+    } while (count == WORKER_MAX_EVENTS);
+}
+
+/**
+ * worker_drain_inputs - Apply every input the I/O threads queued for us
+ *
+ * Called at the start of each tick, so the inputs count for that tick
+ * just as if the worker had read them between ticks itself.
+ */
+static void worker_drain_inputs(RoomWorker* worker) {
+    if (worker->inputs == NULL) return;
+
+    InputEvent event;
+    while (input_queue_pop(worker->inputs, &event)) {
+        if (event.room >= worker->room_count) continue;
+        game_server_apply_queued_input(&worker->rooms[event.room]->server, event.slot,
+                                       event.session, &event.input);
+    }
+}
+
+/**
+ * worker_wake_outputs - Ring every output stage our rooms publish to
+ */
+static void worker_wake_outputs(RoomWorker* worker) {
+    for (int i = 0; i < worker->output_count; i++) {
+        pipeline_stage_wake(worker->outputs[i]);
+    }
+}
+
+/**
+ * worker_publish_seats - Report players who left back to the router
+ */
+static void worker_publish_seats(RoomWorker* worker) {
+    pthread_mutex_lock(&worker->manager->lock);
+    for (int i = 0; i < worker->room_count; i++) {
+        worker->rooms[i]->seated = worker->rooms[i]->server.player_count;
+    }
+    pthread_mutex_unlock(&worker->manager->lock);
+}
+
+/**
+ * worker_count_udp_drops - Add datagrams the kernel refused to the metrics
+ */
+static void worker_count_udp_drops(RoomWorker* worker) {
+    uint64_t dropped = worker->udp_out.dropped;
+    metrics_add(worker->metrics, METRIC_SEND_FAILURES, dropped - worker->udp_dropped_seen);
+    worker->udp_dropped_seen = dropped;
+}
+
+/**
+ * worker_count_syscalls - Add this thread's new socket system calls to the metrics
+ */
+static void worker_count_syscalls(RoomWorker* worker) {
+    metrics_add(worker->metrics, METRIC_NET_SYSCALLS, net_syscall_count - worker->syscalls_seen);
+    worker->syscalls_seen = net_syscall_count;
+}
+
+/**
+ * worker_player_count - Players across all rooms of this worker
+ */
+static int worker_player_count(const RoomWorker* worker) {
+    int total = 0;
+    for (int i = 0; i < worker->room_count; i++) {
+        total += worker->rooms[i]->server.player_count;
+    }
+    return total;
+}
+
+/**
+ * worker_report_stats - Log tick timing once per TICK_REPORT_INTERVAL_NS
+ *
+ * Proof that the worker really holds TICK_RATE: the achieved rate, how
+ * much of each period the work used, and how close we came to missing
+ * a deadline.
+ */
+static void worker_report_stats(RoomWorker* worker) {
+    TickScheduler* sched = &worker->sched;
+    if (tick_now_ns() - sched->window_start_ns < TICK_REPORT_INTERVAL_NS) return;
+
+    tick_scheduler_take_window(sched, &worker->last_stats);
+
+    const TickStats* st = &worker->last_stats;
+    LOG_INFO("Worker %d: %.1f Hz, work avg %.3f ms / max %.3f ms, "
+             "min slack %.3f ms, overruns %llu, skipped %llu",
+             worker->index, st->rate_hz, st->avg_work_ms, st->max_work_ms,
+             st->min_slack_ms, (unsigned long long)st->overruns,
+             (unsigned long long)st->skipped);
+
+    // Message totals across our rooms (since startup)
+    MessageStats total = { 0 };
+    for (int i = 0; i < worker->room_count; i++) {
+        const MessageStats* ms = &worker->rooms[i]->server.msg_stats;
+        total.handled += ms->handled;
+        total.collapsed += ms->collapsed;
+        total.dropped += ms->dropped;
+        total.throttled += ms->throttled;
+    }
+    LOG_INFO("Worker %d: messages %llu, collapsed %llu, dropped %llu, throttled %llu",
+             worker->index, (unsigned long long)total.handled,
+             (unsigned long long)total.collapsed, (unsigned long long)total.dropped,
+             (unsigned long long)total.throttled);
+}
+
+/**
+ * worker_thread_func - The tick loop of one worker
+ *
+ * Same shape as the old single-room main loop, just repeated for every
+ * room this worker owns:
+ *     1. Reactor: handle readable player sockets, waiting at most
+ *        until the next tick deadline (with io_uring: then reap the
+ *        completions instead)
+ *     2. Seat players handed over by the main thread
+ *     3. Tick every non-empty room - once, or several times in a row
+ *        if we fell behind (see tick_scheduler.h)
+ *
+ * The reactor wait IS the sleep: input is handled the moment it
+ * arrives, and the loop still wakes exactly on each absolute deadline.
+ * With io_uring every send and re-arm queued along the way goes to the
+ * kernel in one batch wherever UDP datagrams are flushed - after
+ * handling input, and after the ticks. With a pipeline the ticks only
+ * publish frames; the output stages are woken once they are all in.
+ * With I/O threads the reactor only ever reports the wake pipe, and
+ * each tick starts by draining the input queue.
+ */
+static void* worker_thread_func(void* arg) {
+    RoomWorker* worker = (RoomWorker*)arg;
+    RoomManager* manager = worker->manager;
+    TickScheduler* sched = &worker->sched;
+
+    worker_pin_to_cpu(worker);
+
+    float dt = 1.0f / TICK_RATE;
+    NetEvent events[WORKER_MAX_EVENTS];
+    int idle = 1;
+
+    tick_scheduler_init(sched, TICK_RATE, manager->max_catchup);
+
+    while (manager->running) {
+        // No players on this worker = nothing to simulate. Block until
+        // the main thread wakes us with a new player (or shutdown).
+        int timeout_ms = idle ? -1 : tick_scheduler_timeout_ms(sched);
+        int ready = net_reactor_wait(worker->reactor, events, WORKER_MAX_EVENTS, timeout_ms);
+
+        for (int e = 0; e < ready; e++) {
+            if (events[e].user_data == worker) {
+                worker_drain_wake_pipe(worker);
+                continue;
+            }
+            if (events[e].user_data == &worker->udp_socket) {
+                worker_receive_datagrams(worker);
+                continue;
+            }
+            if (events[e].user_data == &worker->uring) {
+                continue;  // Reaped below, every iteration
+            }
+
+            // A player socket: drain its send queue first, then read. A
+            // throttled player only waits for WRITE, so an error goes to
+            // the flush, which fails and drops the player.
+            ServerPlayer* player = (ServerPlayer*)events[e].user_data;
+            GameServer* server = player->server;
+            int slot = (int)(player - server->players);
+            if (events[e].events & (NET_EVENT_WRITE | NET_EVENT_ERROR)) {
+                game_server_handle_writable(server, slot);
+            }
+            if (events[e].events != NET_EVENT_WRITE) {
+                game_server_handle_client_message(server, slot);
+            }
+        }
+
+        worker_reap_uring(worker);
+        worker_seat_pending(worker);
+
+        // Pongs and connect acks go out right away, not at the next tick
+        net_udp_outbox_flush(&worker->udp_out);
+        net_uring_submit(worker->uring);
+
+        if (worker_player_count(worker) == 0) {
+            // The last player's leaving may have published a frame
+            worker_wake_outputs(worker);
+            worker_publish_seats(worker);
+            idle = 1;
+            continue;
+        }
+
+        if (idle) {
+            // Time spent idle is not "missed ticks" - start a fresh grid
+            tick_scheduler_reset(sched);
+            idle = 0;
+            continue;
+        }
+
+        // Woken early by I/O: go back to waiting for the deadline.
+        // Under 1 ms left: the reactor can't wait that precisely, so
+        // finish with an absolute-deadline sleep instead.
+        if (tick_scheduler_timeout_ms(sched) > 0) continue;
+        tick_scheduler_sleep(sched);
+
+        int due = tick_scheduler_due(sched);
+        for (int t = 0; t < due; t++) {
+            tick_scheduler_begin_work(sched);
+            worker_drain_inputs(worker);
+            for (int i = 0; i < worker->room_count; i++) {
+                GameServer* server = &worker->rooms[i]->server;
+                if (server->player_count > 0) {
+                    game_server_tick(server, dt);
+                }
+            }
+
+            // Every UDP snapshot of every room, in as few syscalls as
+            // possible - and before a catch-up tick reuses the bodies
+            // the queued datagrams point into
+            net_udp_outbox_flush(&worker->udp_out);
+            net_uring_submit(worker->uring);
+            tick_scheduler_end_work(sched);
+            metrics_observe(worker->metrics, METRIC_WORKER_TICK, sched->last_work_ns);
+        }
+        worker_wake_outputs(worker);
+
+        worker_count_udp_drops(worker);
+        worker_count_syscalls(worker);
+        worker_publish_seats(worker);
+        worker_report_stats(worker);
+    }
+
+    return NULL;
+}
+
+/**
+ * room_manager_create - Allocate rooms and workers
+ */
+RoomManager* room_manager_create(int worker_count, int room_count, const RoomLimits* limits,
+                                 Metrics* metrics) {
+    if (worker_count < 1) worker_count = 1;
+    if (room_count < worker_count) room_count = worker_count;
+    if (room_count > worker_count * ROOM_MAX_PER_WORKER) {
+        fprintf(stderr, "At most %d rooms per worker\n", ROOM_MAX_PER_WORKER);
+        return NULL;
+    }
+
+    RoomManager* manager = calloc(1, sizeof(RoomManager));
+    if (manager == NULL) return NULL;
+
+    manager->rooms = calloc(room_count, sizeof(Room));
+    manager->workers = calloc(worker_count, sizeof(RoomWorker));
+    if (manager->rooms == NULL || manager->workers == NULL) {
+        free(manager->rooms);
+        free(manager->workers);
+        free(manager);
+        return NULL;
+    }
+    manager->room_count = room_count;
+    manager->worker_count = worker_count;
+    manager->limits = *limits;
+    manager->metrics = metrics;
+    manager->max_catchup = TICK_DEFAULT_MAX_CATCHUP;
+    manager->msg_budget = DEFAULT_MSG_BUDGET;
+    manager->max_rewind = DEFAULT_MAX_REWIND;
+    manager->byte_budget = DEFAULT_BYTE_BUDGET;
+    pthread_mutex_init(&manager->lock, NULL);
+
+    int rooms_per_worker = (room_count + worker_count - 1) / worker_count;
+
+    for (int w = 0; w < worker_count; w++) {
+        RoomWorker* worker = &manager->workers[w];
+        worker->index = w;
+        worker->manager = manager;
+        worker->wake_pipe[0] = worker->wake_pipe[1] = -1;
+        worker->udp_socket = INVALID_SOCKET;
+        worker->metrics = metrics_shard(metrics, 1 + w);
+        pthread_mutex_init(&worker->inbox_lock, NULL);
+    }
+
+    for (int w = 0; w < worker_count; w++) {
+        RoomWorker* worker = &manager->workers[w];
+        worker->rooms = calloc(rooms_per_worker, sizeof(Room*));
+        // Player sockets + wake pipe + (optional) UDP socket and io_uring
+        worker->reactor = net_reactor_create(rooms_per_worker * limits->max_players + 3);
+
+        if (worker->rooms == NULL || worker->reactor == NULL || pipe(worker->wake_pipe) != 0) {
+            fprintf(stderr, "Failed to set up worker %d\n", w);
+            room_manager_destroy(manager);
+            return NULL;
+        }
+
+        // The wake pipe is just a doorbell: both ends non-blocking, and the
+        // worker pointer itself marks it in the reactor.
+        fcntl(worker->wake_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(worker->wake_pipe[1], F_SETFL, O_NONBLOCK);
+        net_reactor_add(worker->reactor, worker->wake_pipe[0], NET_EVENT_READ, worker);
+    }
+
+    // Deal rooms round-robin so neighbouring rooms land on different cores
+    for (int r = 0; r < room_count; r++) {
+        RoomWorker* worker = &manager->workers[r % worker_count];
+        Room* room = &manager->rooms[r];
+
+        room->worker = worker;
+        worker->rooms[worker->room_count++] = room;
+        if (game_server_init(&room->server, r, worker->reactor, limits, worker->metrics) != 0) {
+            fprintf(stderr, "Failed to set up room %d\n", r);
+            room_manager_destroy(manager);
+            return NULL;
+        }
+        room->server.udp_id_prefix = (uint32_t)(worker->room_count - 1) << 12;
+    }
+
+    return manager;
+}
+
+/**
+ * worker_open_udp - Give a worker its UDP socket and batch buffers
+ *
+ * Bound to port 0: the kernel picks a free port, and clients learn it
+ * from the source address of their MSG_CONNECT_ACK.
+ */
+static int worker_open_udp(RoomWorker* worker) {
+    int capacity = worker->room_count * worker->manager->limits.max_players * 2 +
+                   NET_UDP_BATCH_SIZE;
+
+    worker->udp_in = calloc(NET_UDP_BATCH_SIZE, sizeof(NetDatagram));
+    worker->udp_out.items = calloc(capacity, sizeof(NetUdpSend));
+    worker->udp_out.capacity = capacity;
+    worker->udp_socket = net_create_udp_socket(0);
+    worker->udp_out.socket = worker->udp_socket;
+
+    if (worker->udp_in == NULL || worker->udp_out.items == NULL ||
+        worker->udp_socket == INVALID_SOCKET ||
+        net_reactor_add(worker->reactor, worker->udp_socket, NET_EVENT_READ,
+                        &worker->udp_socket) != 0) {
+        fprintf(stderr, "Failed to set up UDP for worker %d\n", worker->index);
+        return -1;
+    }
+
+    for (int i = 0; i < worker->room_count; i++) {
+        worker->rooms[i]->server.udp_out = &worker->udp_out;
+    }
+    return 0;
+}
+
+/**
+ * worker_open_uring - Give a worker an io_uring for its player sockets
+ *
+ * Room for every seat of every room it runs, twice over: a player that
+ * left keeps its connection slot until the ring's last request on its
+ * socket has completed. The ring's descriptor joins the reactor, so the
+ * worker still sleeps in one place.
+ */
+static int worker_open_uring(RoomWorker* worker) {
+    int seats = worker->room_count * worker->manager->limits.max_players;
+    worker->uring = net_uring_create(WORKER_URING_ENTRIES, 2 * seats, 2 * seats);
+    if (worker->uring == NULL) return -1;
+    if (net_reactor_add(worker->reactor, net_uring_fd(worker->uring), NET_EVENT_READ,
+                        &worker->uring) != 0) {
+        net_uring_destroy(worker->uring);
+        worker->uring = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < worker->room_count; i++) {
+        worker->rooms[i]->server.uring = worker->uring;
+    }
+    return 0;
+}
+
+/**
+ * manager_open_urings - A ring per worker, or none at all
+ *
+ * io_uring may be missing (old kernel) or forbidden (containers often
+ * block it): then every worker stays on its reactor.
+ */
+static void manager_open_urings(RoomManager* manager) {
+    for (int w = 0; w < manager->worker_count; w++) {
+        if (worker_open_uring(&manager->workers[w]) == 0) continue;
+
+        fprintf(stderr, "io_uring unavailable, using the epoll reactor\n");
+        for (int v = 0; v < w; v++) {
+            RoomWorker* worker = &manager->workers[v];
+            if (worker->uring != NULL) {
+                net_reactor_remove(worker->reactor, net_uring_fd(worker->uring));
+                net_uring_destroy(worker->uring);
+                worker->uring = NULL;
+            }
+            for (int i = 0; i < worker->room_count; i++) {
+                worker->rooms[i]->server.uring = NULL;
+            }
+        }
+        manager->io_uring = 0;
+        return;
+    }
+}
+
+/**
+ * worker_add_output - Remember a stage one of our rooms publishes to
+ */
+static void worker_add_output(RoomWorker* worker, OutputStage* stage) {
+    for (int i = 0; i < worker->output_count; i++) {
+        if (worker->outputs[i] == stage) return;
+    }
+    worker->outputs[worker->output_count++] = stage;
+}
+
+/**
+ * manager_open_stages - Output stages, with rooms dealt round-robin
+ *
+ * Room r goes to stage (r % stages). With one stage per worker that is
+ * the room's own worker's stage; with I/O threads a worker's rooms are
+ * spread over several stages, which all feed the worker's one input
+ * queue - room for two frames' worth of every seat's budget.
+ *
+ * Pipelined rooms are TCP over the reactor only (see pipeline.h).
+ */
+static int manager_open_stages(RoomManager* manager) {
+    if (manager->udp || manager->io_uring) {
+        fprintf(stderr, "The pipeline supports TCP over epoll only\n");
+        return -1;
+    }
+
+    int count = (manager->io_threads > 0) ? manager->io_threads : manager->worker_count;
+    manager->stages = calloc(count, sizeof(OutputStage));
+    if (manager->stages == NULL) return -1;
+
+    int rooms_per_stage = (manager->room_count + count - 1) / count;
+    int sockets = rooms_per_stage * manager->limits.max_players;
+    for (int s = 0; s < count; s++) {
+        if (pipeline_stage_init(&manager->stages[s], s, rooms_per_stage, sockets,
+                                metrics_shard(manager->metrics, 1 + manager->worker_count + s)) != 0) {
+            fprintf(stderr, "Failed to set up output stage %d\n", s);
+            return -1;
+        }
+        manager->stage_count++;
+    }
+
+    for (int w = 0; w < manager->worker_count; w++) {
+        RoomWorker* worker = &manager->workers[w];
+        worker->outputs = calloc(count, sizeof(OutputStage*));
+        if (worker->outputs == NULL) return -1;
+
+        if (manager->io_threads > 0) {
+            worker->inputs = input_queue_create(worker->room_count * manager->limits.max_players *
+                                                manager->msg_budget * 2);
+            if (worker->inputs == NULL) {
+                fprintf(stderr, "Failed to set up the input queue of worker %d\n", w);
+                return -1;
+            }
+        }
+
+        for (int i = 0; i < worker->room_count; i++) {
+            GameServer* server = &worker->rooms[i]->server;
+            OutputStage* stage = &manager->stages[server->room_id % count];
+            if (pipeline_room_create(server, stage, worker->inputs, i) == NULL) {
+                fprintf(stderr, "Failed to pipeline room %d\n", server->room_id);
+                return -1;
+            }
+            worker_add_output(worker, stage);
+        }
+    }
+    return 0;
+}
+
+/**
+ * manager_open_recorders - One recording per room in manager->record_dir
+ */
+static int manager_open_recorders(RoomManager* manager) {
+    if (mkdir(manager->record_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s: %s\n", manager->record_dir, strerror(errno));
+        return -1;
+    }
+
+    char path[1024];
+    for (int r = 0; r < manager->room_count; r++) {
+        GameServer* server = &manager->rooms[r].server;
+        snprintf(path, sizeof(path), "%s/room-%03d.vdr", manager->record_dir, r);
+        server->recorder = recorder_open(path, server);
+        if (server->recorder == NULL) {
+            fprintf(stderr, "Failed to start recording %s\n", path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * room_manager_start - Spawn the worker threads
+ *
+ * Ctrl+C must reach the main thread (which owns shutdown), so SIGINT and
+ * SIGTERM are blocked while the workers are created - new threads
+ * inherit the creator's signal mask.
+ */
+int room_manager_start(RoomManager* manager) {
+    if (manager->udp) {
+        for (int w = 0; w < manager->worker_count; w++) {
+            if (worker_open_udp(&manager->workers[w]) != 0) return -1;
+        }
+    }
+    if (manager->io_uring) {
+        manager_open_urings(manager);
+    }
+    for (int r = 0; r < manager->room_count; r++) {
+        manager->rooms[r].server.physics = manager->physics;
+        manager->rooms[r].server.max_rewind = manager->max_rewind;
+        manager->rooms[r].server.msg_budget = manager->msg_budget;
+        manager->rooms[r].server.byte_budget = manager->byte_budget;
+    }
+    if (manager->io_threads > 0) {
+        manager->pipeline = 1;
+    }
+    if (manager->pipeline && manager_open_stages(manager) != 0) {
+        return -1;
+    }
+    if (manager->record_dir != NULL && manager_open_recorders(manager) != 0) {
+        return -1;
+    }
+
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+
+    manager->running = 1;
+    int result = 0;
+
+    for (int s = 0; s < manager->stage_count && result == 0; s++) {
+        result = pipeline_stage_start(&manager->stages[s]);
+    }
+    for (int w = 0; w < manager->worker_count && result == 0; w++) {
+        RoomWorker* worker = &manager->workers[w];
+        if (pthread_create(&worker->thread, NULL, worker_thread_func, worker) != 0) {
+            fprintf(stderr, "Failed to create worker thread %d\n", w);
+            result = -1;
+            break;
+        }
+        manager->started_workers++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (result != 0) {
+        room_manager_stop(manager);
+    }
+    return result;
+}
+
+/**
+ * room_manager_route - Pick a room for a new player
+ *
+ * Chooses the FULLEST room that still has a free seat, then queues the
+ * player in that room's worker inbox and rings its doorbell.
+ */
+int room_manager_route(RoomManager* manager, Socket socket,
+                       const struct sockaddr_in* addr, const ConnectMsg* connect,
+                       const NetUdpHeader* udp_header) {
+    pthread_mutex_lock(&manager->lock);
+
+    Room* best = NULL;
+    int best_fill = -1;
+    for (int r = 0; r < manager->room_count; r++) {
+        Room* room = &manager->rooms[r];
+        int fill = room->seated + room->reserved;
+        if (fill < manager->limits.max_players && fill > best_fill) {
+            best = room;
+            best_fill = fill;
+        }
+    }
+
+    if (best != NULL) {
+        best->reserved++;
+    }
+    pthread_mutex_unlock(&manager->lock);
+
+    if (best == NULL) {
+        return -1;  // Every room is full
+    }
+
+    RoomWorker* worker = best->worker;
+    int queued = 0;
+
+    pthread_mutex_lock(&worker->inbox_lock);
+    if (worker->inbox_count < ROOM_INBOX_SIZE) {
+        PendingJoin* join = &worker->inbox[worker->inbox_count++];
+        join->socket = socket;
+        join->addr = *addr;
+        join->connect = *connect;
+        join->room = best;
+        join->is_udp = (udp_header != NULL);
+        if (udp_header != NULL) {
+            join->udp_header = *udp_header;
+        }
+        queued = 1;
+    }
+    pthread_mutex_unlock(&worker->inbox_lock);
+
+    if (!queued) {
+        pthread_mutex_lock(&manager->lock);
+        best->reserved--;
+        pthread_mutex_unlock(&manager->lock);
+        return -1;
+    }
+
+    // Ring the doorbell. A full pipe already guarantees a wakeup.
+    char bell = 1;
+    if (write(worker->wake_pipe[1], &bell, 1) < 0 && errno != EAGAIN) {
+        perror("write(wake_pipe) failed");
+    }
+
+    return best->server.room_id;
+}
+
+/**
+ * room_manager_stop - Stop and join all worker threads
+ */
+void room_manager_stop(RoomManager* manager) {
+    if (manager == NULL) return;
+
+    manager->running = 0;
+
+    for (int w = 0; w < manager->started_workers; w++) {
+        char bell = 1;
+        if (write(manager->workers[w].wake_pipe[1], &bell, 1) < 0 && errno != EAGAIN) {
+            perror("write(wake_pipe) failed");
+        }
+    }
+    for (int w = 0; w < manager->started_workers; w++) {
+        pthread_join(manager->workers[w].thread, NULL);
+    }
+    manager->started_workers = 0;
+
+    // Only now: a worker may have been waiting for a free frame
+    for (int s = 0; s < manager->stage_count; s++) {
+        pipeline_stage_stop(&manager->stages[s]);
+    }
+}
+
+/**
+ * room_manager_destroy - Disconnect everyone and free all memory
+ */
+void room_manager_destroy(RoomManager* manager) {
+    if (manager == NULL) return;
+
+    for (int r = 0; r < manager->room_count; r++) {
+        GameServer* server = &manager->rooms[r].server;
+        recorder_close(server->recorder, server);
+        server->recorder = NULL;
+        if (server->reactor != NULL) {
+            game_server_cleanup(server);
+        }
+        pipeline_room_destroy(server->output);
+        server->output = NULL;
+    }
+    for (int s = 0; s < manager->stage_count; s++) {
+        pipeline_stage_free(&manager->stages[s]);
+    }
+    free(manager->stages);
+
+    for (int w = 0; w < manager->worker_count; w++) {
+        RoomWorker* worker = &manager->workers[w];
+
+        // Players that were routed but never seated
+        for (int i = 0; i < worker->inbox_count; i++) {
+            if (!worker->inbox[i].is_udp) {
+                net_close(worker->inbox[i].socket);
+            }
+        }
+
+        input_queue_destroy(worker->inputs);
+        free(worker->outputs);
+        net_uring_destroy(worker->uring);
+        net_reactor_destroy(worker->reactor);
+        if (worker->wake_pipe[0] >= 0) close(worker->wake_pipe[0]);
+        if (worker->wake_pipe[1] >= 0) close(worker->wake_pipe[1]);
+        if (worker->udp_socket != INVALID_SOCKET) net_close(worker->udp_socket);
+        pthread_mutex_destroy(&worker->inbox_lock);
+        free(worker->udp_in);
+        free(worker->udp_out.items);
+        free(worker->rooms);
+    }
+
+    pthread_mutex_destroy(&manager->lock);
+    free(manager->workers);
+    free(manager->rooms);
+    free(manager);
+}
@@ -0,0 +1,247 @@
+/**
+ * room_manager.h - Many Rooms, One Thread Per Core
+ *
+ * CONCEPT: Sharding Work Across Cores
+ * ===================================
+ * One game loop on one thread uses one CPU core. A machine with 16 cores
+ * used to run 16 server PROCESSES to host 16 matches. Instead, we run
+ * one process with a pool of worker threads:
+ *
+ *     ┌──────────────┐   new player    ┌───────────────────────────┐
+ *     │ MAIN THREAD  │ ──────────────▶ │ WORKER 0 (pinned: CPU 0)  │
+ *     │  accept()    │                 │   Room 0, Room 2, Room 4  │
+ *     │  handshake   │                 └───────────────────────────┘
+ *     │  pick a room │ ──────────────▶ ┌───────────────────────────┐
+ *     └──────────────┘                 │ WORKER 1 (pinned: CPU 1)  │
+ *                                      │   Room 1, Room 3, Room 5  │
+ *                                      └───────────────────────────┘
+ *
+ * Each worker owns its rooms exclusively: it runs their tick loops and
+ * all their socket I/O through its own reactor (including, with UDP
+ * enabled, its own UDP socket - see RoomWorker.udp_socket, and with
+ * io_uring enabled, its own ring - see RoomWorker.uring). Rooms never
+ * share data, so the simulation needs no locks at all.
+ *
+ * The only shared data is the seat bookkeeping used to route new
+ * connections (protected by one mutex, touched only on join/leave) and
+ * each worker's small "inbox" of players waiting to be seated.
+ *
+ * With 'pipeline' set, each worker also gets an OUTPUT STAGE thread
+ * that encodes and sends its rooms' snapshots while the worker
+ * simulates the next tick (see pipeline.h). With 'io_threads' set,
+ * there are that many stages instead, rooms dealt to them round-robin,
+ * and they read the player sockets too: each worker then only drains
+ * its InputQueue at the start of every tick (see input_queue.h).
+ *
+ * CONCEPT: CPU Pinning
+ * ====================
+ * On Linux each worker is pinned to one core with pthread_setaffinity_np.
+ * A pinned thread keeps its caches warm instead of being migrated around
+ * by the scheduler. Other platforms simply skip the pinning.
+ */
+
+#ifndef ROOM_MANAGER_H
+#define ROOM_MANAGER_H
+
+#include <pthread.h>
+
+#include "game_server.h"
+#include "tick_scheduler.h"
+#include "metrics.h"
+#include "pipeline.h"
+
+// Most joins a worker accepts between two ticks
+#define ROOM_INBOX_SIZE 64
+
+// Most rooms on one worker (10 bits of the UDP connection id)
+#define ROOM_MAX_PER_WORKER 1024
+
+// Forward declarations
+typedef struct RoomWorker RoomWorker;
+typedef struct RoomManager RoomManager;
+
+/**
+ * Room - A GameServer plus the bookkeeping needed to route players to it
+ *
+ * 'seated' and 'reserved' are guarded by the manager's mutex.
+ * 'server' belongs to the worker thread.
+ */
+typedef struct {
+    GameServer server;      // The world itself (worker thread only)
+    RoomWorker* worker;     // Worker that simulates this room
+    int seated;             // Players currently in the room
+    int reserved;           // Players routed here but not seated yet
+} Room;
+
+/**
+ * PendingJoin - A handshaken client on its way to a room
+ */
+typedef struct {
+    Socket socket;              // INVALID_SOCKET for UDP clients
+    struct sockaddr_in addr;
+    ConnectMsg connect;
+    Room* room;
+
+    int is_udp;
+    NetUdpHeader udp_header;    // Header of the MSG_CONNECT datagram
+} PendingJoin;
+
+/**
+ * RoomWorker - One pinned thread running the tick loop for its rooms
+ */
+struct RoomWorker {
+    pthread_t thread;
+    int index;                  // Worker number (also its CPU)
+    RoomManager* manager;
+
+    NetReactor* reactor;        // Player sockets of all our rooms
+    int wake_pipe[2];           // Main thread writes here to wake us
+
+    Room** rooms;               // Rooms this worker simulates
+    int room_count;
+
+    // UDP (only if the manager has 'udp' set): one socket per worker on an
+    // ephemeral port. Its address (&udp_socket) marks it in the reactor.
+    Socket udp_socket;
+    NetUdpOutbox udp_out;       // Shared by all our rooms, flushed per loop
+    NetDatagram* udp_in;        // NET_UDP_BATCH_SIZE receive slots
+
+    // io_uring (only if the manager has 'io_uring' set): TCP player
+    // sockets are read and written through it instead of the reactor.
+    // Its descriptor, marked by &uring, wakes the reactor on completions.
+    NetUring* uring;
+
+    // Pipeline (only if the manager has 'pipeline' set): the stages that
+    // send our rooms' frames, each rung once per loop after the ticks
+    OutputStage** outputs;
+    int output_count;
+
+    // I/O threads (only if the manager has 'io_threads' set): inputs
+    // they decoded for our rooms, applied at the start of each tick
+    InputQueue* inputs;
+
+    // Tick timing (worker thread only)
+    TickScheduler sched;
+    TickStats last_stats;       // Most recent statistics window
+
+    // Our shard of the manager's metrics (written by this thread only)
+    MetricsShard* metrics;
+    uint64_t udp_dropped_seen;  // udp_out.dropped already counted
+    uint64_t syscalls_seen;     // net_syscall_count already counted
+
+    // Joins handed over by the main thread (guarded by inbox_lock)
+    pthread_mutex_t inbox_lock;
+    PendingJoin inbox[ROOM_INBOX_SIZE];
+    int inbox_count;
+};
+
+/**
+ * RoomManager - Owns every room and worker
+ */
+struct RoomManager {
+    Room* rooms;
+    int room_count;
+
+    RoomWorker* workers;
+    int worker_count;
+    int started_workers;        // Threads actually running
+
+    RoomLimits limits;          // Size of every room
+    Metrics* metrics;           // Shard 0: main thread, shard 1 + w: worker w,
+                                // shard 1 + worker_count + s: output stage s
+
+    OutputStage* stages;        // One per worker, or io_threads (pipeline only)
+    int stage_count;            // Stages set up
+
+    pthread_mutex_t lock;       // Guards Room.seated / Room.reserved
+    volatile int running;
+
+    int max_catchup;            // Ticks a late worker may run back-to-back
+    int msg_budget;             // Messages handled per player per tick
+    int byte_budget;            // Bytes handled per player per tick
+    int udp;                    // Also host UDP players?
+    int io_uring;               // Player sockets through io_uring (cleared if unavailable)
+    int pipeline;               // Snapshots sent by an output thread per worker (TCP only)
+    int io_threads;             // Instead: this many stages that also read
+                                // (implies 'pipeline'; 0 = off)
+    const char* record_dir;     // Record every room here (NULL = don't)
+    PhysicsMode physics;        // Movement math of every room
+    int max_rewind;             // Lag compensation cap, ticks (0 = off)
+};
+
+/**
+ * room_manager_create - Allocate rooms and workers
+ *
+ * Rooms are dealt round-robin: room i runs on worker (i % worker_count).
+ * max_catchup, msg_budget, byte_budget and max_rewind start at their
+ * defaults (TICK_DEFAULT_MAX_CATCHUP, DEFAULT_MSG_BUDGET,
+ * DEFAULT_BYTE_BUDGET, DEFAULT_MAX_REWIND)
+ * udp, io_uring, pipeline and io_threads at 0, record_dir at NULL and physics at
+ * PHYSICS_FLOAT; change them before room_manager_start() to override.
+ *
+ * @param worker_count  Number of worker threads (usually = CPU cores)
+ * @param room_count    Number of rooms to host (at most
+ *                      ROOM_MAX_PER_WORKER per worker)
+ * @param limits        Table sizes of every room
+ * @param metrics       Registry with at least worker_count + 1 shards
+ *                      (2 * worker_count + 1 to use 'pipeline', plus
+ *                      io_threads - worker_count more if that is
+ *                      larger; NOT owned by the manager)
+ * @return              New manager, or NULL on failure
+ */
+RoomManager* room_manager_create(int worker_count, int room_count, const RoomLimits* limits,
+                                 Metrics* metrics);
+
+/**
+ * room_manager_start - Spawn the worker threads
+ *
+ * With 'udp' set, each worker first gets its UDP socket. With
+ * 'io_uring' set, each worker gets a ring - or, if the kernel can't
+ * provide one, 'io_uring' is cleared and every worker stays on its
+ * reactor. With 'pipeline' set, the output stages (one per worker, or
+ * 'io_threads' of them) are set up and started first. With 'record_dir'
+ * set, every room starts recording to record_dir/room-NNN.vdr (see
+ * recording.h).
+ *
+ * @param manager  The manager
+ * @return         0 on success, -1 if any thread failed to start
+ */
+int room_manager_start(RoomManager* manager);
+
+/**
+ * room_manager_route - Hand a handshaken client to a room with free seats
+ *
+ * Rooms that already have players are preferred, so matches fill up
+ * instead of everyone ending up alone in their own room.
+ *
+ * The worker sends MSG_CONNECT_ACK once it seats the player.
+ *
+ * @param manager     The manager
+ * @param socket      Client socket (ownership passes to the manager on
+ *                    success), or INVALID_SOCKET for a UDP client
+ * @param addr        Client address
+ * @param connect     The client's MSG_CONNECT payload
+ * @param udp_header  UDP: header of the MSG_CONNECT datagram; TCP: NULL
+ * @return            Room index, or -1 if every room is full
+ */
+int room_manager_route(RoomManager* manager, Socket socket,
+                       const struct sockaddr_in* addr, const ConnectMsg* connect,
+                       const NetUdpHeader* udp_header);
+
+/**
+ * room_manager_stop - Stop and join all worker threads (then the output stages)
+ *
+ * @param manager  The manager
+ */
+void room_manager_stop(RoomManager* manager);
+
+/**
+ * room_manager_destroy - Disconnect everyone and free all memory
+ *
+ * Call room_manager_stop() first.
+ *
+ * @param manager  The manager (NULL is ignored)
+ */
+void room_manager_destroy(RoomManager* manager);
+
+#endif // ROOM_MANAGER_H
@@ -16,8 +16,39 @@
  *
  * This prevents cheating (clients can't just say "I'm at the exit!").
  *
- * NOTE: This is a BLOCKING server for educational purposes.
- * In Module 5, we'll make it non-blocking with threads.
+ * ARCHITECTURE: Rooms and Workers
+ * ===============================
+ * One process hosts many independent matches ("rooms"):
+ *     - game_server.c:  the simulation of ONE room
+ *     - room_manager.c: worker threads (one per core) that tick the rooms
+ *     - server.c:       this file - accepts connections, reads MSG_CONNECT
+ *                       and routes each new player to a room with a free seat
+ *
+ * The MSG_CONNECT handshake never blocks: accepted sockets wait in a
+ * handshake table until their whole ConnectMsg has arrived (see
+ * handshake.h), so a client that connects and stays silent delays
+ * nobody - not other joins, and certainly not a room's tick loop.
+ *
+ * TRANSPORTS: With --udp the server ALSO accepts UDP clients on the same
+ * port number. The main thread's UDP socket only ever sees MSG_CONNECT;
+ * after that each player talks to their worker's own UDP socket (see
+ * network.h, "UDP and Head-of-Line Blocking").
+ *
+ * I/O BACKEND: With --io-uring the workers read and write player sockets
+ * through io_uring instead of one system call per socket (see
+ * net_uring.h), and this thread takes new connections from a multishot
+ * accept. Handshakes still go through the reactor - they are rare.
+ *
+ * PIPELINE: With --pipeline every worker gets an output thread that
+ * encodes and sends snapshots while the worker simulates the next tick
+ * (see pipeline.h). With --io-threads N, N network threads do that for
+ * all rooms and also read the player sockets: they answer pings
+ * themselves and queue decoded inputs for the workers (see
+ * input_queue.h).
+ *
+ * METRICS: With --metrics PATH the main thread also answers scrapes on a
+ * Unix-domain socket (see metrics.h). The workers only ever write their
+ * own shard, so a scrape never waits for - or delays - a tick.
  */
 
 #include <stdio.h>
@@ -25,82 +56,46 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <math.h>
 #include <errno.h>
 
 #include "protocol.h"
 #include "network.h"
+#include "room_manager.h"
+#include "metrics.h"
+#include "handshake.h"
+#include "net_uring.h"
+#include "log.h"
 
 // Server configuration
 #define SERVER_PORT 8080
-#define TICK_RATE 60        // Updates per second
-#define MAX_PLAYERS 4
+#define DEFAULT_ROOMS_PER_WORKER 4
 
-// Global running flag (for signal handling)
-static volatile int g_running = 1;
+// Most reactor events the main thread handles per wakeup
+#define MAIN_MAX_EVENTS 64
 
-/**
- * ServerPlayer - Server's view of a connected player
- */
-typedef struct {
-    int active;             // Is this slot in use?
-    Socket socket;          // Client's socket
-    char name[16];          // Player name
-    struct sockaddr_in addr; // Client address
-
-    // Game state (server is authoritative)
-    float x, y;             // Position
-    float vx, vy;           // Velocity
-    int health;             // HP
-    uint8_t weapon;         // Current weapon
-    uint8_t input_flags;    // Last received input
-    uint32_t last_sequence; // Last input sequence number
-
-    // Weapon state
-    float fire_cooldown;    // Time until can fire again
-} ServerPlayer;
+// Submission queue of the main thread's accept ring (--io-uring)
+#define MAIN_URING_ENTRIES 8
 
-/**
- * ServerBullet - A bullet in the game world
- */
-typedef struct {
-    int active;
-    uint8_t owner_id;       // Which player fired it
-    float x, y;             // Position
-    float vx, vy;           // Velocity
-    uint8_t weapon_type;    // Type of weapon that created it
-    float lifetime;         // Remaining lifetime
-} ServerBullet;
-
-// Maximum bullets the server tracks
-#define MAX_SERVER_BULLETS 200
-
-// Bullet configuration
-#define BULLET_LIFETIME 2.0f
-
-// Weapon-specific configurations (must match client weapon.c)
-// Fire rates: shots per second -> cooldown = 1/rate
-#define SPREAD_FIRE_RATE    3.0f    // 3 shots/sec
-#define RAPID_FIRE_RATE     10.0f   // 10 shots/sec
-#define LASER_FIRE_RATE     1.5f    // 1.5 shots/sec
-
-#define SPREAD_BULLET_SPEED 400.0f
-#define RAPID_BULLET_SPEED  600.0f
-#define LASER_BULLET_SPEED  800.0f
+// UDP clients resend MSG_CONNECT until acked; remember recent ones so a
+// resend isn't routed a second time
+#define RECENT_UDP_CONNECTS 64
 
 /**
- * GameServer - Server state
+ * RecentConnect - A UDP client that was routed recently
  */
 typedef struct {
-    Socket listen_socket;
-    ServerPlayer players[MAX_PLAYERS];
-    int player_count;
-    uint32_t tick;          // Server tick counter
+    struct sockaddr_in addr;
+    uint64_t time_ms;
+} RecentConnect;
+
+static RecentConnect g_recent_connects[RECENT_UDP_CONNECTS];
+static int g_recent_next = 0;
+
+// The main thread's metrics shard (handshakes and rejections)
+static MetricsShard* g_metrics = NULL;
 
-    // Bullets
-    ServerBullet bullets[MAX_SERVER_BULLETS];
-    int bullet_count;
-} GameServer;
+// Global running flag (for signal handling)
+static volatile int g_running = 1;
 
 /**
  * signal_handler - Handle Ctrl+C gracefully
@@ -112,556 +107,284 @@ static void signal_handler(int sig) {
 }
 
 /**
- * server_init - Initialize the game server
+ * server_reject - Send a failed MSG_CONNECT_ACK and hang up
  */
-static int server_init(GameServer* server, uint16_t port) {
-    printf("Initializing server on port %d...\n", port);
+static void server_reject(Socket client_socket, uint8_t reason) {
+    ConnectAckMsg ack = { .success = 0, .player_id = 0, .reason = reason };
+    NetBatch batch;
+    net_batch_begin(&batch, client_socket, 0);
+    net_batch_add(&batch, MSG_CONNECT_ACK, &ack, sizeof(ack));
+    net_batch_flush(&batch);
+    net_close(client_socket);
+
+    metrics_message(g_metrics, 1, MSG_CONNECT_ACK, sizeof(MessageHeader) + sizeof(ack));
+    metrics_add(g_metrics, METRIC_REJECTS, 1);
+}
 
-    // Initialize player slots
-    memset(server->players, 0, sizeof(server->players));
-    server->player_count = 0;
-    server->tick = 0;
+/**
+ * server_begin_handshake - Put an accepted socket into the handshake table
+ *
+ * Its MSG_CONNECT is read as it arrives (server_continue_handshake).
+ */
+static void server_begin_handshake(Socket client_socket, const struct sockaddr_in* addr,
+                                   NetReactor* reactor, HandshakeTable* handshakes) {
+    struct sockaddr_in client_addr = *addr;
+    char addr_str[32];
+    net_addr_to_string(&client_addr, addr_str, sizeof(addr_str));
 
-    // Create listening socket
-    server->listen_socket = net_create_server(port, 5);
-    if (server->listen_socket == INVALID_SOCKET) {
-        fprintf(stderr, "Failed to create server socket\n");
-        return -1;
+    if (handshake_begin(handshakes, reactor, client_socket, &client_addr, net_time_ms()) == NULL) {
+        // Too many half-open connections (a flood?): this one costs nothing
+        LOG_WARN("Handshake table full, dropping connection from %s", addr_str);
+        net_close(client_socket);
+        metrics_add(g_metrics, METRIC_HANDSHAKE_FAILURES, 1);
+        return;
     }
 
-    printf("Server listening on port %d\n", port);
-    return 0;
+    // Snapshots must leave the moment they are written (see network.h)
+    net_set_nodelay(client_socket);
+    LOG_INFO("New connection from %s", addr_str);
 }
 
 /**
- * server_cleanup - Clean up server resources
+ * server_accept_new_client - Take one connection off the accept queue
+ *
+ * Called when the reactor reports the listen socket as readable.
+ *
+ * @return 1 if a connection was taken off the accept queue (even if it
+ *         was then dropped), 0 if nobody was waiting
  */
-static void server_cleanup(GameServer* server) {
-    // Close all client connections
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        if (server->players[i].active) {
-            net_close(server->players[i].socket);
-        }
-    }
+static int server_accept_new_client(Socket listen_socket, NetReactor* reactor,
+                                    HandshakeTable* handshakes) {
+    struct sockaddr_in client_addr;
+    Socket client_socket = net_accept_client(listen_socket, &client_addr);
 
-    // Close listening socket
-    net_close(server->listen_socket);
-    printf("Server cleaned up\n");
+    if (client_socket == INVALID_SOCKET) {
+        return 0;  // No client waiting
+    }
+    server_begin_handshake(client_socket, &client_addr, reactor, handshakes);
+    return 1;
 }
 
 /**
- * server_find_free_slot - Find an unused player slot
+ * server_reap_accepts - Connections delivered by the multishot accept
+ *
+ * The completions carry only the new socket; getpeername() fills in the
+ * address. A failed accept (say, out of descriptors) is just skipped -
+ * net_uring_reap() re-arms the accept if the kernel ended it, and the
+ * submit here hands that to the kernel.
  */
-static int server_find_free_slot(GameServer* server) {
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        if (!server->players[i].active) {
-            return i;
+static void server_reap_accepts(NetUring* ring, NetReactor* reactor,
+                                HandshakeTable* handshakes) {
+    NetUringEvent events[MAIN_MAX_EVENTS];
+    int count;
+    do {
+        count = net_uring_reap(ring, events, MAIN_MAX_EVENTS);
+        for (int i = 0; i < count; i++) {
+            if (events[i].result < 0) continue;
+
+            Socket client_socket = events[i].result;
+            struct sockaddr_in client_addr;
+            socklen_t addr_len = sizeof(client_addr);
+            memset(&client_addr, 0, sizeof(client_addr));
+            getpeername(client_socket, (struct sockaddr*)&client_addr, &addr_len);
+            server_begin_handshake(client_socket, &client_addr, reactor, handshakes);
         }
-    }
-    return -1;  // No free slots
+    } while (count == MAIN_MAX_EVENTS);
+    net_uring_submit(ring);
 }
 
 /**
- * server_accept_new_client - Handle a new client connection
+ * server_continue_handshake - A pending connection is readable
  *
  * Protocol:
- *   1. Accept TCP connection
- *   2. Read MSG_CONNECT from client
- *   3. Validate and send MSG_CONNECT_ACK
- *   4. Initialize player if successful
+ *   1. Read as much of MSG_CONNECT as has arrived
+ *   2. Once complete, validate it and route it to a room
+ *   3. The room's worker seats the player and sends MSG_CONNECT_ACK
  */
-static void server_accept_new_client(GameServer* server) {
-    struct sockaddr_in client_addr;
-    Socket client_socket = net_accept_client(server->listen_socket, &client_addr);
-
-    if (client_socket == INVALID_SOCKET) {
-        return;  // No client waiting
-    }
-
-    char addr_str[32];
-    net_addr_to_string(&client_addr, addr_str, sizeof(addr_str));
-    printf("New connection from %s\n", addr_str);
-
-    // --- READ MSG_CONNECT FROM CLIENT ---
-    // The client sends MSG_CONNECT after TCP connect, we must read it
-    MessageHeader connect_header;
-    if (net_recv_all(client_socket, &connect_header, sizeof(connect_header)) != sizeof(connect_header)) {
-        printf("Failed to read connect header from %s\n", addr_str);
-        net_close(client_socket);
+static void server_continue_handshake(HandshakeTable* handshakes, NetReactor* reactor,
+                                      Handshake* handshake, RoomManager* rooms) {
+    int result = handshake_read(handshake);
+    if (result == 0) return;  // Rest still in flight
+    if (result < 0) {
+        handshake_end(handshakes, reactor, handshake, 1);
+        metrics_add(g_metrics, METRIC_HANDSHAKE_FAILURES, 1);
         return;
     }
 
-    if (connect_header.type != MSG_CONNECT) {
-        printf("Expected MSG_CONNECT, got type %d from %s\n", connect_header.type, addr_str);
-        net_close(client_socket);
-        return;
-    }
+    // Complete: the socket leaves the table (and our reactor) either way
+    Socket client_socket = handshake->socket;
+    struct sockaddr_in client_addr = handshake->addr;
+    ConnectMsg connect_msg = handshake->connect;
+    handshake_end(handshakes, reactor, handshake, 0);
+    metrics_message(g_metrics, 0, MSG_CONNECT, sizeof(MessageHeader) + sizeof(connect_msg));
 
-    ConnectMsg connect_msg;
-    if (net_recv_all(client_socket, &connect_msg, sizeof(connect_msg)) != sizeof(connect_msg)) {
-        printf("Failed to read connect payload from %s\n", addr_str);
-        net_close(client_socket);
-        return;
-    }
+    char addr_str[32];
+    net_addr_to_string(&client_addr, addr_str, sizeof(addr_str));
 
     // Check protocol version
-    if (connect_msg.version != PROTOCOL_VERSION) {
-        printf("Version mismatch from %s (got %d, expected %d)\n",
-               addr_str, connect_msg.version, PROTOCOL_VERSION);
-        ConnectAckMsg ack = { .success = 0, .player_id = 0, .reason = 1 };
-        MessageHeader header = { .type = MSG_CONNECT_ACK, .length = sizeof(ack) };
-        net_send_all(client_socket, &header, sizeof(header));
-        net_send_all(client_socket, &ack, sizeof(ack));
-        net_close(client_socket);
+    if (!PROTOCOL_VERSION_SUPPORTED(connect_msg.version)) {
+        LOG_INFO("Version mismatch from %s (got %d, expected %d or %d)",
+                 addr_str, connect_msg.version, PROTOCOL_VERSION, PROTOCOL_VERSION_RAW);
+        server_reject(client_socket, 1);
         return;
     }
 
-    // Find a free player slot
-    int slot = server_find_free_slot(server);
-    if (slot < 0) {
-        printf("Server full, rejecting connection from %s\n", addr_str);
-        ConnectAckMsg ack = { .success = 0, .player_id = 0, .reason = 0 };
-        MessageHeader header = { .type = MSG_CONNECT_ACK, .length = sizeof(ack) };
-        net_send_all(client_socket, &header, sizeof(header));
-        net_send_all(client_socket, &ack, sizeof(ack));
-        net_close(client_socket);
+    // Hand the player to a room with a free seat
+    int room = room_manager_route(rooms, client_socket, &client_addr, &connect_msg, NULL);
+    if (room < 0) {
+        LOG_INFO("All rooms full, rejecting connection from %s", addr_str);
+        server_reject(client_socket, 0);
         return;
     }
 
-    // Initialize player
-    ServerPlayer* player = &server->players[slot];
-    memset(player, 0, sizeof(ServerPlayer));
-    player->active = 1;
-    player->socket = client_socket;
-    player->addr = client_addr;
-    // Use name from connect message if provided, otherwise default
-    if (connect_msg.name[0] != '\0') {
-        strncpy(player->name, connect_msg.name, sizeof(player->name) - 1);
-        player->name[sizeof(player->name) - 1] = '\0';
-    } else {
-        snprintf(player->name, sizeof(player->name), "Player%d", slot + 1);
-    }
-
-    // Initial position (spread players out)
-    player->x = 100.0f + (slot * 150.0f);
-    player->y = 400.0f;
-    player->health = 100;
-    player->weapon = 0;
-
-    server->player_count++;
-
-    // Send acceptance message
-    ConnectAckMsg ack = {
-        .success = 1,
-        .player_id = (uint8_t)slot,
-        .reason = 0
-    };
-    MessageHeader header = { .type = MSG_CONNECT_ACK, .length = sizeof(ack) };
-    net_send_all(client_socket, &header, sizeof(header));
-    net_send_all(client_socket, &ack, sizeof(ack));
-
-    printf("Player %d (%s) joined from %s\n", slot, player->name, addr_str);
+    LOG_INFO("Routed %s to room %d", addr_str, room);
 }
 
 /**
- * server_handle_client_message - Process a message from a client
+ * server_seen_udp_connect - Was this address routed moments ago?
  *
- * NOTE: Uses non-blocking sockets, so we must distinguish between:
- *   - No data available (EAGAIN) -> just return, try again later
- *   - Connection closed (recv returns 0 with data) -> disconnect
- *   - Error -> disconnect
+ * Records the address if not. The table is a small ring: it only has to
+ * remember clients for as long as they keep resending.
  */
-static void server_handle_client_message(GameServer* server, int player_id) {
-    ServerPlayer* player = &server->players[player_id];
-    if (!player->active) return;
-
-    // Read message header (non-blocking)
-    MessageHeader header;
-    int bytes = recv(player->socket, &header, sizeof(header), 0);
-
-    if (bytes == 0) {
-        // Connection closed by client
-        printf("Player %d disconnected (connection closed)\n", player_id);
-        net_close(player->socket);
-        player->active = 0;
-        server->player_count--;
-        return;
-    }
-
-    if (bytes < 0) {
-        // Check if it's just "no data available" vs actual error
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            // No data available right now, that's fine
-            return;
+static int server_seen_udp_connect(const struct sockaddr_in* addr, uint64_t now_ms) {
+    for (int i = 0; i < RECENT_UDP_CONNECTS; i++) {
+        RecentConnect* recent = &g_recent_connects[i];
+        if (recent->time_ms != 0 &&
+            now_ms - recent->time_ms < NET_UDP_TIMEOUT_MS &&
+            recent->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            recent->addr.sin_port == addr->sin_port) {
+            return 1;
         }
-        // Actual error
-        printf("Player %d disconnected (error: %s)\n", player_id, strerror(errno));
-        net_close(player->socket);
-        player->active = 0;
-        server->player_count--;
-        return;
     }
 
-    if (bytes != sizeof(header)) {
-        // Partial header - shouldn't happen with small reads, but handle it
-        return;
-    }
-
-    // Handle message based on type
-    switch (header.type) {
-        case MSG_PLAYER_INPUT: {
-            // Read input data
-            PlayerInputMsg input;
-            if (net_recv_all(player->socket, &input, sizeof(input)) <= 0) {
-                return;
-            }
-
-            // Validate sequence (ignore old/duplicate messages)
-            if (input.sequence <= player->last_sequence) {
-                return;  // Old message, ignore
-            }
-            player->last_sequence = input.sequence;
-
-            // Store input for processing in update
-            player->input_flags = input.input_flags;
-            player->weapon = input.weapon_type;
-
-            // Debug output (reduced verbosity - only show changes)
-            static uint8_t last_flags[MAX_PLAYERS] = {0};
-            if (input.input_flags != last_flags[player_id]) {
-                printf("Player %d input: ", player_id);
-                if (input.input_flags & INPUT_UP) printf("UP ");
-                if (input.input_flags & INPUT_DOWN) printf("DOWN ");
-                if (input.input_flags & INPUT_LEFT) printf("LEFT ");
-                if (input.input_flags & INPUT_RIGHT) printf("RIGHT ");
-                if (input.input_flags & INPUT_FIRE) printf("FIRE ");
-                printf("weapon=%d\n", input.weapon_type);
-                last_flags[player_id] = input.input_flags;
-            }
-            printf("(seq=%u)\n", input.sequence);
-            break;
-        }
-
-        case MSG_DISCONNECT: {
-            printf("Player %d sent disconnect\n", player_id);
-            net_close(player->socket);
-            player->active = 0;
-            server->player_count--;
-            break;
-        }
-
-        case MSG_PING: {
-            // Echo back pong
-            PingMsg ping;
-            if (net_recv_all(player->socket, &ping, sizeof(ping)) > 0) {
-                PongMsg pong = {
-                    .client_timestamp = ping.timestamp,
-                    .server_timestamp = server->tick
-                };
-                MessageHeader pong_header = { .type = MSG_PONG, .length = sizeof(pong) };
-                net_send_all(player->socket, &pong_header, sizeof(pong_header));
-                net_send_all(player->socket, &pong, sizeof(pong));
-            }
-            break;
-        }
-
-        default:
-            printf("Unknown message type %d from player %d\n", header.type, player_id);
-            break;
-    }
+    g_recent_connects[g_recent_next].addr = *addr;
+    g_recent_connects[g_recent_next].time_ms = now_ms;
+    g_recent_next = (g_recent_next + 1) % RECENT_UDP_CONNECTS;
+    return 0;
 }
 
 /**
- * server_find_free_bullet - Find an unused bullet slot
+ * server_reject_udp - Send an (unreliable) failed MSG_CONNECT_ACK
  */
-static int server_find_free_bullet(GameServer* server) {
-    for (int i = 0; i < MAX_SERVER_BULLETS; i++) {
-        if (!server->bullets[i].active) {
-            return i;
-        }
+static void server_reject_udp(Socket udp_socket, const struct sockaddr_in* addr,
+                              const NetUdpHeader* header, uint8_t reason) {
+    NetUdpConnection conn;
+    net_udp_connection_accept(&conn, 0, addr, header);
+
+    ConnectAckMsg ack = { .success = 0, .player_id = 0, .reason = reason };
+    NetUdpSend reply = { .addr = *addr, .body = NULL, .body_length = 0 };
+    reply.head_length = net_udp_encode(&conn, reply.head, sizeof(reply.head),
+                                       MSG_CONNECT_ACK, &ack, sizeof(ack));
+    if (net_udp_send_batch(udp_socket, &reply, 1) != 1) {
+        metrics_add(g_metrics, METRIC_SEND_FAILURES, 1);
+    } else {
+        metrics_message(g_metrics, 1, MSG_CONNECT_ACK, sizeof(MessageHeader) + sizeof(ack));
     }
-    return -1;  // No free slots
-}
-
-/**
- * server_spawn_single_bullet - Create a single bullet with given parameters
- */
-static void server_spawn_single_bullet(GameServer* server, int player_id,
-                                        float x, float y, float vx, float vy,
-                                        uint8_t weapon_type) {
-    int slot = server_find_free_bullet(server);
-    if (slot < 0) return;  // No room for more bullets
-
-    ServerBullet* bullet = &server->bullets[slot];
-    bullet->active = 1;
-    bullet->owner_id = (uint8_t)player_id;
-    bullet->x = x;
-    bullet->y = y;
-    bullet->vx = vx;
-    bullet->vy = vy;
-    bullet->weapon_type = weapon_type;
-    bullet->lifetime = BULLET_LIFETIME;
-
-    server->bullet_count++;
+    metrics_add(g_metrics, METRIC_REJECTS, 1);
 }
 
 /**
- * server_spawn_bullet - Create bullets based on weapon type
+ * server_handle_udp_connects - Route every MSG_CONNECT datagram waiting
+ *
+ * Same steps as the TCP handshake, without the blocking: one datagram
+ * IS the whole MSG_CONNECT, so it is either complete or dropped.
  */
-static void server_spawn_bullet(GameServer* server, int player_id, float x, float y) {
-    uint8_t weapon = server->players[player_id].weapon;
-
-    switch (weapon) {
-        case WEAPON_TYPE_SPREAD: {
-            // Spread: 3 bullets in a fan pattern
-            float speed = SPREAD_BULLET_SPEED;
-            float angles[] = { -0.2618f, 0.0f, 0.2618f };  // -15, 0, +15 degrees in radians
-
-            for (int i = 0; i < 3; i++) {
-                float vx = speed * sinf(angles[i]);
-                float vy = -speed * cosf(angles[i]);
-                float spawn_x = x + 10.0f * sinf(angles[i]);
-                float spawn_y = y - 20.0f;
-                server_spawn_single_bullet(server, player_id, spawn_x, spawn_y, vx, vy, weapon);
+static void server_handle_udp_connects(Socket udp_socket, RoomManager* rooms,
+                                       NetDatagram* batch) {
+    int count;
+    do {
+        count = net_udp_recv_batch(udp_socket, batch, NET_UDP_BATCH_SIZE);
+        uint64_t now_ms = net_time_ms();
+
+        for (int i = 0; i < count; i++) {
+            NetUdpHeader header;
+            if (net_udp_parse_header(batch[i].data, batch[i].length, &header) != 0 ||
+                header.connection_id != 0) {
+                continue;  // Not ours, or meant for a worker
             }
-            break;
-        }
-
-        case WEAPON_TYPE_RAPID: {
-            // Rapid: single fast bullet straight up
-            float speed = RAPID_BULLET_SPEED;
-            server_spawn_single_bullet(server, player_id, x, y - 25.0f, 0, -speed, weapon);
-            break;
-        }
-
-        case WEAPON_TYPE_LASER: {
-            // Laser: single very fast bullet
-            float speed = LASER_BULLET_SPEED;
-            server_spawn_single_bullet(server, player_id, x, y - 30.0f, 0, -speed, weapon);
-            break;
-        }
 
-        default: {
-            // Default to spread behavior
-            float speed = SPREAD_BULLET_SPEED;
-            server_spawn_single_bullet(server, player_id, x, y - 20.0f, 0, -speed, weapon);
-            break;
-        }
-    }
-}
-
-/**
- * server_update_bullets - Update all bullets
- */
-static void server_update_bullets(GameServer* server, float dt) {
-    for (int i = 0; i < MAX_SERVER_BULLETS; i++) {
-        ServerBullet* bullet = &server->bullets[i];
-        if (!bullet->active) continue;
-
-        // Update position
-        bullet->x += bullet->vx * dt;
-        bullet->y += bullet->vy * dt;
-
-        // Update lifetime
-        bullet->lifetime -= dt;
-
-        // Remove if expired or out of bounds
-        if (bullet->lifetime <= 0 ||
-            bullet->x < 0 || bullet->x > GAME_WIDTH ||
-            bullet->y < 0 || bullet->y > GAME_HEIGHT) {
-            bullet->active = 0;
-            server->bullet_count--;
-        }
-    }
-}
+            // A fresh connection delivers only reliable message #0
+            NetUdpConnection conn;
+            NetFrame frame;
+            net_udp_connection_init(&conn, 0, &batch[i].addr);
+            if (!net_udp_receive(&conn, batch[i].data, batch[i].length, now_ms, &frame) ||
+                frame.header.type != MSG_CONNECT ||
+                frame.header.length < sizeof(ConnectMsg)) {
+                continue;
+            }
+            if (server_seen_udp_connect(&batch[i].addr, now_ms)) {
+                continue;  // A resend - the worker will ack it
+            }
 
-/**
- * get_weapon_cooldown - Get fire cooldown based on weapon type
- */
-static float get_weapon_cooldown(uint8_t weapon_type) {
-    switch (weapon_type) {
-        case WEAPON_TYPE_SPREAD: return 1.0f / SPREAD_FIRE_RATE;
-        case WEAPON_TYPE_RAPID:  return 1.0f / RAPID_FIRE_RATE;
-        case WEAPON_TYPE_LASER:  return 1.0f / LASER_FIRE_RATE;
-        default:                 return 1.0f / SPREAD_FIRE_RATE;
-    }
-}
+            char addr_str[32];
+            net_addr_to_string(&batch[i].addr, addr_str, sizeof(addr_str));
+            LOG_INFO("New UDP connection from %s", addr_str);
+            metrics_message(g_metrics, 0, MSG_CONNECT,
+                            sizeof(MessageHeader) + (uint64_t)frame.header.length);
+
+            ConnectMsg connect_msg;
+            memcpy(&connect_msg, frame.payload, sizeof(connect_msg));
+            if (!PROTOCOL_VERSION_SUPPORTED(connect_msg.version)) {
+                LOG_INFO("Version mismatch from %s (got %d, expected %d or %d)",
+                         addr_str, connect_msg.version, PROTOCOL_VERSION, PROTOCOL_VERSION_RAW);
+                server_reject_udp(udp_socket, &batch[i].addr, &header, 1);
+                continue;
+            }
 
-/**
- * server_handle_firing - Process fire input from players
- */
-static void server_handle_firing(GameServer* server, float dt) {
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        ServerPlayer* player = &server->players[i];
-        if (!player->active) continue;
-
-        // Update cooldown
-        if (player->fire_cooldown > 0) {
-            player->fire_cooldown -= dt;
-        }
+            int room = room_manager_route(rooms, INVALID_SOCKET, &batch[i].addr,
+                                          &connect_msg, &header);
+            if (room < 0) {
+                LOG_INFO("All rooms full, rejecting connection from %s", addr_str);
+                server_reject_udp(udp_socket, &batch[i].addr, &header, 0);
+                continue;
+            }
 
-        // Check if firing
-        if ((player->input_flags & INPUT_FIRE) && player->fire_cooldown <= 0) {
-            server_spawn_bullet(server, i, player->x, player->y);
-            player->fire_cooldown = get_weapon_cooldown(player->weapon);
+            LOG_INFO("Routed %s to room %d", addr_str, room);
         }
-    }
+    } while (count == NET_UDP_BATCH_SIZE);
 }
 
 /**
- * server_update_physics - Update game physics based on player input
- *
- * CONCEPT: Server-Side Physics
- * ============================
- * The server runs the same physics that the client would.
- * Clients send input, server calculates results.
- *
- * This prevents cheating - clients can't lie about their position.
- *
- * IMPORTANT: Uses shared constants from protocol.h to match client physics!
+ * clamp_int - Limit a command line value to [lo, hi]
  */
-static void server_update_physics(GameServer* server, float dt) {
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        ServerPlayer* player = &server->players[i];
-        if (!player->active) continue;
-
-        // Apply input to velocity (same formula as client)
-        float accel_x = 0, accel_y = 0;
-        if (player->input_flags & INPUT_UP)    accel_y = -1.0f;
-        if (player->input_flags & INPUT_DOWN)  accel_y = 1.0f;
-        if (player->input_flags & INPUT_LEFT)  accel_x = -1.0f;
-        if (player->input_flags & INPUT_RIGHT) accel_x = 1.0f;
-
-        // Normalize diagonal movement
-        if (accel_x != 0 && accel_y != 0) {
-            float inv_sqrt2 = 0.7071f;
-            accel_x *= inv_sqrt2;
-            accel_y *= inv_sqrt2;
-        }
-
-        // Apply acceleration
-        player->vx += accel_x * PLAYER_ACCELERATION * dt;
-        player->vy += accel_y * PLAYER_ACCELERATION * dt;
-
-        // Apply friction (adjusted for frame rate)
-        float friction = powf(PLAYER_FRICTION, dt * 60.0f);
-        player->vx *= friction;
-        player->vy *= friction;
-
-        // Clamp velocity to max speed
-        float speed = sqrtf(player->vx * player->vx + player->vy * player->vy);
-        if (speed > PLAYER_SPEED) {
-            float scale = PLAYER_SPEED / speed;
-            player->vx *= scale;
-            player->vy *= scale;
-        }
-
-        // Stop if very slow
-        if (fabsf(player->vx) < 1.0f) player->vx = 0;
-        if (fabsf(player->vy) < 1.0f) player->vy = 0;
-
-        // Update position
-        player->x += player->vx * dt;
-        player->y += player->vy * dt;
-
-        // Clamp to screen bounds (using shared constants)
-        float hw = 32, hh = 32;  // Half player size
-        if (player->x < hw) { player->x = hw; player->vx = 0; }
-        if (player->x > GAME_WIDTH - hw) { player->x = GAME_WIDTH - hw; player->vx = 0; }
-        if (player->y < hh) { player->y = hh; player->vy = 0; }
-        if (player->y > GAME_HEIGHT - hh) { player->y = GAME_HEIGHT - hh; player->vy = 0; }
-    }
+static int clamp_int(int value, int lo, int hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+    return value;
 }
 
 /**
- * server_send_state - Send game state to all clients
+ * print_usage - Command line help
  */
-static void server_send_state(GameServer* server) {
-    // Count active bullets (capped at MAX_SYNC_BULLETS)
-    int bullet_count = 0;
-    for (int i = 0; i < MAX_SERVER_BULLETS && bullet_count < MAX_SYNC_BULLETS; i++) {
-        if (server->bullets[i].active) {
-            bullet_count++;
-        }
-    }
-
-    // Build game state message
-    // Size = header + GameStateMsg base + (player_count * PlayerState) + (bullet_count * BulletState)
-    int state_size = sizeof(GameStateMsg) +
-                     server->player_count * sizeof(PlayerState) +
-                     bullet_count * sizeof(BulletState);
-    int total_size = sizeof(MessageHeader) + state_size;
-
-    uint8_t* buffer = malloc(total_size);
-    if (buffer == NULL) return;
-
-    // Fill header
-    MessageHeader* header = (MessageHeader*)buffer;
-    header->type = MSG_GAME_STATE;
-    header->length = state_size;
-
-    // Fill game state
-    GameStateMsg* state = (GameStateMsg*)(buffer + sizeof(MessageHeader));
-    state->tick = server->tick;
-    state->your_sequence = 0;  // Will be overwritten per-player
-    state->player_count = server->player_count;
-    state->bullet_count = (uint8_t)bullet_count;
-
-    // Fill player states
-    int idx = 0;
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        ServerPlayer* sp = &server->players[i];
-        if (!sp->active) continue;
-
-        PlayerState* ps = &state->players[idx];
-        ps->player_id = (uint8_t)i;
-        ps->x = sp->x;
-        ps->y = sp->y;
-        ps->vx = sp->vx;
-        ps->vy = sp->vy;
-        ps->health = (int16_t)sp->health;
-        ps->weapon = sp->weapon;
-        ps->flags = (sp->input_flags & INPUT_FIRE) ? 1 : 0;  // Flag if firing
-        idx++;
-    }
-
-    // Fill bullet states (after player states)
-    BulletState* bullets_data = (BulletState*)(buffer + sizeof(MessageHeader) +
-                                                sizeof(GameStateMsg) +
-                                                server->player_count * sizeof(PlayerState));
-    int bidx = 0;
-    for (int i = 0; i < MAX_SERVER_BULLETS && bidx < bullet_count; i++) {
-        ServerBullet* sb = &server->bullets[i];
-        if (!sb->active) continue;
-
-        BulletState* bs = &bullets_data[bidx];
-        bs->owner_id = sb->owner_id;
-        bs->x = sb->x;
-        bs->y = sb->y;
-        bs->vx = sb->vx;
-        bs->vy = sb->vy;
-        bs->weapon_type = sb->weapon_type;
-        bidx++;
-    }
-
-    // Send to each client
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        ServerPlayer* player = &server->players[i];
-        if (!player->active) continue;
-
-        // Customize the sequence number for this player
-        state->your_sequence = player->last_sequence;
-
-        // Send the state - if it fails, disconnect the player
-        if (net_send_all(player->socket, buffer, total_size) < 0) {
-            printf("Failed to send state to player %d, disconnecting\n", i);
-            net_close(player->socket);
-            player->active = 0;
-            server->player_count--;
-        }
-    }
-
-    free(buffer);
+static void print_usage(const char* program) {
+    printf("Usage: %s [PORT] [options]\n\n", program);
+    printf("Options:\n");
+    printf("  --workers N      Simulation threads (default: one per CPU core)\n");
+    printf("  --rooms N        Rooms to host (default: %d per worker)\n",
+           DEFAULT_ROOMS_PER_WORKER);
+    printf("  --max-catchup N  Ticks a late worker may run back-to-back (default: %d)\n",
+           TICK_DEFAULT_MAX_CATCHUP);
+    printf("  --msg-budget N   Messages handled per player per tick (default: %d)\n",
+           DEFAULT_MSG_BUDGET);
+    printf("  --byte-budget N  Bytes handled per player per tick (default: %d)\n",
+           DEFAULT_BYTE_BUDGET);
+    printf("  --max-players N  Players per room (default: %d, at most %d)\n",
+           DEFAULT_MAX_PLAYERS, PROTOCOL_MAX_PLAYERS);
+    printf("  --max-bullets N  Bullets per room (default: %d, at most %d)\n",
+           DEFAULT_MAX_BULLETS, PROTOCOL_MAX_BULLETS);
+    printf("  --sync-bullets N Bullets sent to each client per snapshot (default: %d)\n",
+           DEFAULT_SYNC_BULLETS);
+    printf("  --udp            Also accept UDP clients on the same port\n");
+    printf("  --io-uring       Player sockets through io_uring (Linux 6.0+, else epoll)\n");
+    printf("  --pipeline       Send snapshots from an output thread per worker (TCP, epoll)\n");
+    printf("  --io-threads N   Pipeline through N threads that also read inputs and answer pings\n");
+    printf("  --metrics PATH   Serve Prometheus metrics on this Unix socket\n");
+    printf("  --record DIR     Record every room's inputs to DIR (see ./replay)\n");
+    printf("  --physics MODE   Movement math: float (default) or fixed (deterministic)\n");
+    printf("  --max-rewind MS  Lag compensation: shots see targets up to MS in the past\n");
+    printf("                   (default: %d, at most %d, 0 = off)\n",
+           DEFAULT_MAX_REWIND * 1000 / TICK_RATE, WORLD_HISTORY_MAX_REWIND * 1000 / TICK_RATE);
+    printf("  --help, -h       Show this help\n");
 }
 
 /**
@@ -669,11 +392,77 @@ static void server_send_state(GameServer* server) {
  */
 int main(int argc, char* argv[]) {
     uint16_t port = SERVER_PORT;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int rooms = 0;
+    int max_catchup = TICK_DEFAULT_MAX_CATCHUP;
+    int msg_budget = DEFAULT_MSG_BUDGET;
+    int byte_budget = DEFAULT_BYTE_BUDGET;
+    RoomLimits limits = {
+        .max_players = DEFAULT_MAX_PLAYERS,
+        .max_bullets = DEFAULT_MAX_BULLETS,
+        .sync_bullets = DEFAULT_SYNC_BULLETS
+    };
+    int udp = 0;
+    int io_uring = 0;
+    int pipeline = 0;
+    int io_threads = 0;
+    const char* metrics_path = NULL;
+    const char* record_dir = NULL;
+    PhysicsMode physics = PHYSICS_FLOAT;
+    int max_rewind = DEFAULT_MAX_REWIND;
 
     // Parse command line arguments
-    if (argc > 1) {
-        port = (uint16_t)atoi(argv[1]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rooms") == 0 && i + 1 < argc) {
+            rooms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-catchup") == 0 && i + 1 < argc) {
+            max_catchup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--msg-budget") == 0 && i + 1 < argc) {
+            msg_budget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--byte-budget") == 0 && i + 1 < argc) {
+            byte_budget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-players") == 0 && i + 1 < argc) {
+            limits.max_players = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-bullets") == 0 && i + 1 < argc) {
+            limits.max_bullets = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sync-bullets") == 0 && i + 1 < argc) {
+            limits.sync_bullets = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--udp") == 0) {
+            udp = 1;
+        } else if (strcmp(argv[i], "--io-uring") == 0) {
+            io_uring = 1;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = 1;
+        } else if (strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc) {
+            io_threads = atoi(argv[++i]);
+            if (io_threads < 1) io_threads = 1;
+            pipeline = 1;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_dir = argv[++i];
+        } else if (strcmp(argv[i], "--physics") == 0 && i + 1 < argc) {
+            physics = (strcmp(argv[++i], "fixed") == 0) ? PHYSICS_FIXED : PHYSICS_FLOAT;
+        } else if (strcmp(argv[i], "--max-rewind") == 0 && i + 1 < argc) {
+            max_rewind = atoi(argv[++i]) * TICK_RATE / 1000;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            port = (uint16_t)atoi(argv[i]);
+        }
     }
+    if (workers < 1) workers = 1;
+    if (rooms < 1) rooms = workers * DEFAULT_ROOMS_PER_WORKER;
+
+    // Room sizes: within what the wire format can address, and no
+    // client is sent more bullets than exist
+    limits.max_players = clamp_int(limits.max_players, 1, PROTOCOL_MAX_PLAYERS);
+    limits.max_bullets = clamp_int(limits.max_bullets, 1, PROTOCOL_MAX_BULLETS);
+    limits.sync_bullets = clamp_int(limits.sync_bullets, 1, limits.max_bullets);
+    if (limits.sync_bullets > UINT16_MAX) limits.sync_bullets = UINT16_MAX;
 
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════╗\n");
@@ -694,61 +483,223 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    // Initialize server
-    GameServer server;
-    if (server_init(&server, port) != 0) {
+    printf("Initializing server on port %d...\n", port);
+
+    // Create listening socket
+    Socket listen_socket = net_create_server(port, 64);
+    if (listen_socket == INVALID_SOCKET) {
+        fprintf(stderr, "Failed to create server socket\n");
         net_cleanup();
         return 1;
     }
 
-    // Make listen socket non-blocking so we can check for new connections
-    // without blocking the main loop
-    net_set_nonblocking(server.listen_socket);
+    // With --io-uring a multishot accept takes connections off the listen
+    // socket, and the ring's descriptor (marked by &accept_ring) is what
+    // the reactor watches. The socket stays BLOCKING for that: io_uring
+    // waits for readiness itself, but hands a non-blocking socket's EAGAIN
+    // straight back - ending the multishot request every time.
+    NetUring* accept_ring = NULL;
+    if (io_uring) {
+        accept_ring = net_uring_create(MAIN_URING_ENTRIES, 0, 0);
+        if (accept_ring != NULL &&
+            (net_uring_accept(accept_ring, listen_socket, &listen_socket) != 0 ||
+             net_uring_submit(accept_ring) < 0)) {
+            net_uring_destroy(accept_ring);
+            accept_ring = NULL;
+        }
+    }
 
-    printf("Server running. Press Ctrl+C to stop.\n\n");
+    // Otherwise make the listen socket non-blocking so accept() never
+    // stalls the loop, then register it with the reactor ONCE.
+    if (accept_ring == NULL) {
+        net_set_nonblocking(listen_socket);
+    }
 
-    // Main server loop
-    // In a real game, this would run at TICK_RATE ticks per second.
-    // For simplicity, we just use usleep().
+    NetReactor* reactor = net_reactor_create(3 + HANDSHAKE_MAX_PENDING);
+    HandshakeTable handshakes;
+    if (handshake_table_init(&handshakes, HANDSHAKE_MAX_PENDING) != 0) {
+        fprintf(stderr, "Failed to allocate the handshake table\n");
+        net_uring_destroy(accept_ring);
+        net_reactor_destroy(reactor);
+        net_close(listen_socket);
+        net_cleanup();
+        return 1;
+    }
+    if (reactor == NULL ||
+        ((accept_ring != NULL) ?
+            net_reactor_add(reactor, net_uring_fd(accept_ring), NET_EVENT_READ, &accept_ring) :
+            net_reactor_add(reactor, listen_socket, NET_EVENT_READ, &listen_socket)) != 0) {
+        fprintf(stderr, "Failed to create reactor\n");
+        handshake_table_free(&handshakes, reactor);
+        net_uring_destroy(accept_ring);
+        net_reactor_destroy(reactor);
+        net_close(listen_socket);
+        net_cleanup();
+        return 1;
+    }
 
-    float dt = 1.0f / TICK_RATE;
+    // UDP handshakes arrive on the same port number; the socket's own
+    // address marks it in the reactor
+    Socket udp_socket = INVALID_SOCKET;
+    NetDatagram* udp_batch = NULL;
+    if (udp) {
+        udp_socket = net_create_udp_socket(port);
+        udp_batch = calloc(NET_UDP_BATCH_SIZE, sizeof(NetDatagram));
+        if (udp_socket == INVALID_SOCKET || udp_batch == NULL ||
+            net_reactor_add(reactor, udp_socket, NET_EVENT_READ, &udp_socket) != 0) {
+            fprintf(stderr, "Failed to create UDP socket\n");
+            free(udp_batch);
+            if (udp_socket != INVALID_SOCKET) net_close(udp_socket);
+            handshake_table_free(&handshakes, reactor);
+            net_uring_destroy(accept_ring);
+            net_reactor_destroy(reactor);
+            net_close(listen_socket);
+            net_cleanup();
+            return 1;
+        }
+    }
 
-    while (g_running) {
-        // Check for new connections
-        server_accept_new_client(&server);
-
-        // Process messages from each connected client
-        for (int i = 0; i < MAX_PLAYERS; i++) {
-            if (server.players[i].active) {
-                // Make client socket non-blocking for polling
-                net_set_nonblocking(server.players[i].socket);
-                server_handle_client_message(&server, i);
-            }
+    // One metrics shard for this thread, one per worker (and one per
+    // output stage). The registry exists even without --metrics; it's
+    // just never scraped.
+    int stages = (io_threads > 0) ? io_threads : pipeline ? workers : 0;
+    Metrics* metrics = metrics_create(workers + 1 + stages);
+    Socket metrics_socket = INVALID_SOCKET;
+    if (metrics != NULL && metrics_path != NULL) {
+        metrics_socket = metrics_listen(metrics_path);
+        if (metrics_socket == INVALID_SOCKET ||
+            net_reactor_add(reactor, metrics_socket, NET_EVENT_READ, &metrics_socket) != 0) {
+            fprintf(stderr, "Failed to open metrics socket %s\n", metrics_path);
+            if (metrics_socket != INVALID_SOCKET) net_close(metrics_socket);
+            metrics_socket = INVALID_SOCKET;
+        }
+    }
+    g_metrics = (metrics != NULL) ? metrics_shard(metrics, 0) : NULL;
+
+    // Create the rooms and start one simulation thread per worker
+    RoomManager* manager = (metrics != NULL) ?
+        room_manager_create(workers, rooms, &limits, metrics) : NULL;
+    if (manager != NULL) {
+        manager->max_catchup = (max_catchup > 0) ? max_catchup : 1;
+        manager->msg_budget = (msg_budget > 0) ? msg_budget : 1;
+        manager->byte_budget = (byte_budget > 0) ? byte_budget : 1;
+        manager->udp = udp;
+        manager->io_uring = io_uring;
+        manager->pipeline = pipeline;
+        manager->io_threads = io_threads;
+        manager->record_dir = record_dir;
+        manager->physics = physics;
+        manager->max_rewind = (max_rewind < 0) ? 0 :
+            (max_rewind > WORLD_HISTORY_MAX_REWIND) ? WORLD_HISTORY_MAX_REWIND : max_rewind;
+    }
+    if (manager == NULL || room_manager_start(manager) != 0) {
+        fprintf(stderr, "Failed to start room workers\n");
+        room_manager_destroy(manager);
+        if (metrics_socket != INVALID_SOCKET) {
+            net_close(metrics_socket);
+            unlink(metrics_path);
         }
+        metrics_destroy(metrics);
+        free(udp_batch);
+        if (udp_socket != INVALID_SOCKET) net_close(udp_socket);
+        handshake_table_free(&handshakes, reactor);
+        net_uring_destroy(accept_ring);
+        net_reactor_destroy(reactor);
+        net_close(listen_socket);
+        net_cleanup();
+        return 1;
+    }
+
+    printf("Server listening on port %d%s (%d rooms on %d workers)\n",
+           port, udp ? " (TCP + UDP)" : "", manager->room_count, manager->worker_count);
+    printf("Room size: %d players, %d bullets (%d per client)\n",
+           limits.max_players, limits.max_bullets, limits.sync_bullets);
+    printf("Bullet kernel: %s\n", manager->rooms[0].server.bullets.kernel);
+    printf("Physics: %s, lag compensation up to %d ticks\n",
+           (physics == PHYSICS_FIXED) ? "Q16.16 fixed point" : "float", manager->max_rewind);
+    printf("Player I/O: %s\n", manager->io_uring ?
+           "io_uring (multishot recv, one batched submit per loop)" : "epoll reactor");
+    if (manager->io_threads > 0) {
+        printf("Pipeline: %d I/O threads (input, pongs, snapshots), %d frames per room in flight\n",
+               manager->stage_count, PIPELINE_DEPTH);
+    } else if (manager->pipeline) {
+        printf("Pipeline: %d output threads, %d frames per room in flight\n",
+               manager->stage_count, PIPELINE_DEPTH);
+    }
+    if (metrics_socket != INVALID_SOCKET) {
+        printf("Metrics on unix:%s\n", metrics_path);
+    }
+    if (record_dir != NULL) {
+        printf("Recording rooms to %s/room-NNN.vdr\n", record_dir);
+    }
+    printf("Server running. Press Ctrl+C to stop.\n\n");
 
-        // Update game physics
-        server_update_physics(&server, dt);
+    // From here on the workers log through the formatter thread, so a
+    // slow terminal or pipe never stalls a tick (see log.h)
+    fflush(stdout);
+    log_init(stdout);
 
-        // Handle firing and update bullets
-        server_handle_firing(&server, dt);
-        server_update_bullets(&server, dt);
+    // Main thread loop: the rooms tick on their own threads, so all we
+    // do here is sleep in the reactor until someone connects (or scrapes),
+    // or a pending handshake's deadline comes up.
+    NetEvent events[MAIN_MAX_EVENTS];
+    while (g_running) {
+        int timeout_ms = handshake_timeout_ms(&handshakes, net_time_ms());
+        int ready = net_reactor_wait(reactor, events, MAIN_MAX_EVENTS, timeout_ms);
+        for (int e = 0; e < ready; e++) {
+            if (events[e].user_data == &udp_socket) {
+                server_handle_udp_connects(udp_socket, manager, udp_batch);
+                continue;
+            }
+            if (events[e].user_data == &metrics_socket) {
+                while (metrics_serve(metrics, metrics_socket)) {
+                }
+                continue;
+            }
 
-        // Send state to all clients
-        if (server.player_count > 0) {
-            server_send_state(&server);
+            if (events[e].user_data == &listen_socket) {
+                // Accept everyone who is waiting
+                while (server_accept_new_client(listen_socket, reactor, &handshakes)) {
+                }
+                continue;
+            }
+            if (events[e].user_data == &accept_ring) {
+                continue;  // Reaped below
+            }
+
+            // A connection in the handshake table
+            server_continue_handshake(&handshakes, reactor, (Handshake*)events[e].user_data,
+                                      manager);
         }
 
-        // Increment tick
-        server.tick++;
+        // The accept ring is checked every time round: reading its
+        // completion queue is free, and its wakeup may have been an EINTR
+        if (accept_ring != NULL) {
+            server_reap_accepts(accept_ring, reactor, &handshakes);
+        }
 
-        // Sleep to maintain tick rate
-        usleep((useconds_t)(dt * 1000000));
+        int expired = handshake_expire(&handshakes, reactor, net_time_ms());
+        metrics_add(g_metrics, METRIC_HANDSHAKE_FAILURES, (uint64_t)expired);
     }
 
     // Cleanup
-    server_cleanup(&server);
+    room_manager_stop(manager);
+    room_manager_destroy(manager);
+    log_shutdown();
+    if (metrics_socket != INVALID_SOCKET) {
+        net_close(metrics_socket);
+        unlink(metrics_path);
+    }
+    metrics_destroy(metrics);
+    free(udp_batch);
+    if (udp_socket != INVALID_SOCKET) net_close(udp_socket);
+    handshake_table_free(&handshakes, reactor);
+    net_uring_destroy(accept_ring);
+    net_reactor_destroy(reactor);
+    net_close(listen_socket);
     net_cleanup();
 
+    printf("Server cleaned up\n");
     printf("Server stopped.\n");
     return 0;
 }
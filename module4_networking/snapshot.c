@@ -0,0 +1,621 @@
+/**
+ * snapshot.c - Building and Sending MSG_GAME_STATE
+ *
+ * See snapshot.h for the message split, the history ring and the arena,
+ * and GameStateMsg in protocol.h for the delta format.
+ */
+
+#include "snapshot.h"
+#include "wire.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Worst-case record sizes: id + mask + every field
+#define PLAYER_RECORD_MAX (1 + sizeof(PlayerState))
+#define BULLET_RECORD_MAX (3 + sizeof(BulletState))
+
+// Worst-case removal: a 16-bit id as a varint gap
+#define REMOVAL_MAX 3
+
+// Cap on the body pool of one room (see snapshot_init)
+#define SNAPSHOT_BODY_POOL_MAX (16u << 20)
+
+/**
+ * align8 - Round a size up to a multiple of 8
+ */
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+/**
+ * snapshot_init - Allocate the arena
+ *
+ * The ONLY allocation, carved up as:
+ *
+ *     ┌─ deltas ─┬─ frame 0 ─┬ ... ┬─ frame 31 ─┬─────── body pool ───────┐
+ *     │ (structs)│ views     │     │            │ bodies, back to back,   │
+ *     │          │ bullets   │     │            │ bump-allocated per tick │
+ *     │          │ players   │     │            │                         │
+ *     │          │ view ids  │     │            │                         │
+ *     └──────────┴───────────┴─────┴────────────┴─────────────────────────┘
+ *
+ * Every client needs at most two bodies per tick (its delta, and the
+ * full snapshot that delta must beat). With a handful of players the
+ * pool holds 2 * max_players worst-case bodies; in a large match that
+ * would be gigabytes, so the pool is capped and bodies only take their
+ * actual size - a client whose body doesn't fit is skipped for a tick.
+ */
+int snapshot_init(SnapshotBuilder* snap, int max_players, int max_bullets, int view_capacity) {
+    memset(snap, 0, sizeof(SnapshotBuilder));
+    snap->max_players = max_players;
+    snap->max_bullets = max_bullets;
+    snap->view_capacity = view_capacity;
+    snap->delta_capacity = 2 * max_players;
+
+    // A frame holds the union of the views: no more than every view full
+    snap->frame_bullets = max_bullets;
+    if ((long)max_players * view_capacity < max_bullets) {
+        snap->frame_bullets = max_players * view_capacity;
+    }
+
+    size_t deltas_size = align8(snap->delta_capacity * sizeof(SnapshotDelta));
+    size_t views_size = align8(max_players * sizeof(SnapshotView));
+    size_t bullets_size = align8(snap->frame_bullets * sizeof(SnapshotBullet));
+    size_t players_size = align8(max_players * sizeof(PlayerState));
+    size_t ids_size = align8((size_t)max_players * view_capacity * sizeof(uint16_t));
+    size_t frame_size = views_size + bullets_size + players_size + ids_size;
+
+    // A body: every removal plus every record at full size (a client
+    // sees at most view_capacity bullets, then and now)
+    snap->body_capacity = (int)(max_players * (REMOVAL_MAX + PLAYER_RECORD_MAX) +
+                                view_capacity * (REMOVAL_MAX + BULLET_RECORD_MAX));
+
+    size_t pool = (size_t)snap->delta_capacity * snap->body_capacity;
+    if (pool > SNAPSHOT_BODY_POOL_MAX) pool = SNAPSHOT_BODY_POOL_MAX;
+    if (pool < 2 * (size_t)snap->body_capacity) pool = 2 * (size_t)snap->body_capacity;
+    snap->pool_size = pool;
+
+    snap->arena = malloc(deltas_size + SNAPSHOT_HISTORY * frame_size + pool);
+    if (snap->arena == NULL) return -1;
+
+    snap->deltas = (SnapshotDelta*)snap->arena;
+    for (int i = 0; i < SNAPSHOT_HISTORY; i++) {
+        SnapshotFrame* frame = &snap->history[i];
+        uint8_t* memory = snap->arena + deltas_size + i * frame_size;
+        frame->valid = 0;
+        frame->views = (SnapshotView*)memory;        memory += views_size;
+        frame->bullets = (SnapshotBullet*)memory;    memory += bullets_size;
+        frame->players = (PlayerState*)memory;       memory += players_size;
+
+        uint16_t* ids = (uint16_t*)memory;
+        for (int v = 0; v < max_players; v++) {
+            frame->views[v].ids = ids + (size_t)v * view_capacity;
+            frame->views[v].count = 0;
+        }
+    }
+
+    snap->pool = snap->arena + deltas_size + SNAPSHOT_HISTORY * frame_size;
+    snap->current = &snap->history[0];
+    return 0;
+}
+
+/**
+ * snapshot_free - Release the arena
+ */
+void snapshot_free(SnapshotBuilder* snap) {
+    free(snap->arena);
+    snap->arena = NULL;
+    snap->current = NULL;
+}
+
+/**
+ * snapshot_begin - Start filling this tick's history frame
+ */
+void snapshot_begin(SnapshotBuilder* snap, uint32_t tick) {
+    SnapshotFrame* frame = &snap->history[tick % SNAPSHOT_HISTORY];
+    frame->tick = tick;
+    frame->valid = 1;
+    frame->player_count = 0;
+    frame->bullet_count = 0;
+
+    for (int v = 0; v < snap->max_players; v++) {
+        frame->views[v].count = 0;
+    }
+
+    snap->current = frame;
+    snap->delta_count = 0;
+    snap->pool_used = 0;
+}
+
+/**
+ * snapshot_add_player - Next PlayerState of the current frame
+ */
+PlayerState* snapshot_add_player(SnapshotBuilder* snap) {
+    SnapshotFrame* frame = snap->current;
+    if (frame->player_count >= snap->max_players) return NULL;
+    return &frame->players[frame->player_count++];
+}
+
+/**
+ * snapshot_add_bullet - Next BulletState of the current frame
+ */
+BulletState* snapshot_add_bullet(SnapshotBuilder* snap, uint16_t id) {
+    SnapshotFrame* frame = snap->current;
+    if (frame->bullet_count >= snap->frame_bullets || id >= snap->max_bullets) return NULL;
+
+    SnapshotBullet* bullet = &frame->bullets[frame->bullet_count++];
+    bullet->id = id;
+    return &bullet->state;
+}
+
+/**
+ * snapshot_view - The viewer's interest set in the current frame
+ */
+SnapshotView* snapshot_view(SnapshotBuilder* snap, int viewer) {
+    return &snap->current->views[viewer];
+}
+
+/**
+ * snapshot_previous_view - The viewer's set one tick ago, if still known
+ */
+const SnapshotView* snapshot_previous_view(const SnapshotBuilder* snap, int viewer) {
+    uint32_t tick = snap->current->tick - 1;
+    const SnapshotFrame* frame = &snap->history[tick % SNAPSHOT_HISTORY];
+    if (!frame->valid || frame->tick != tick || frame == snap->current) return NULL;
+    return &frame->views[viewer];
+}
+
+/**
+ * BodyWriter - Output of one body in either encoding
+ *
+ * The merge walks in snapshot_encode() decide WHAT goes into a body;
+ * these helpers decide HOW it looks on the wire.
+ */
+typedef struct {
+    int quantized;
+    uint8_t* out;           // Raw: next free byte
+    BitWriter bits;         // Quantized: the bit stream
+    int prev_id;            // Quantized: last id of the current list
+} BodyWriter;
+
+/**
+ * put_bytes / put_float - Append a raw field
+ *
+ * The structs are packed, so fields are copied out by value rather than
+ * by address (a pointer to a packed member may be misaligned).
+ */
+static void put_bytes(BodyWriter* bw, const void* value, size_t size) {
+    memcpy(bw->out, value, size);
+    bw->out += size;
+}
+
+static void put_float(BodyWriter* bw, float value) {
+    put_bytes(bw, &value, sizeof(value));
+}
+
+/**
+ * player_changes - Which fields differ from the baseline?
+ */
+static uint8_t player_changes(const BodyWriter* bw, const PlayerState* base,
+                              const PlayerState* now) {
+    if (bw->quantized) return wire_player_changes(base, now);
+
+    uint8_t mask = 0;
+    if (base->x != now->x)           mask |= PLAYER_FIELD_X;
+    if (base->y != now->y)           mask |= PLAYER_FIELD_Y;
+    if (base->vx != now->vx)         mask |= PLAYER_FIELD_VX;
+    if (base->vy != now->vy)         mask |= PLAYER_FIELD_VY;
+    if (base->health != now->health) mask |= PLAYER_FIELD_HEALTH;
+    if (base->weapon != now->weapon) mask |= PLAYER_FIELD_WEAPON;
+    if (base->flags != now->flags)   mask |= PLAYER_FIELD_FLAGS;
+    return mask;
+}
+
+static uint8_t bullet_changes(const BodyWriter* bw, const BulletState* base,
+                              const BulletState* now) {
+    if (bw->quantized) return wire_bullet_changes(base, now);
+
+    uint8_t mask = 0;
+    if (base->owner_id != now->owner_id)       mask |= BULLET_FIELD_OWNER;
+    if (base->x != now->x)                     mask |= BULLET_FIELD_X;
+    if (base->y != now->y)                     mask |= BULLET_FIELD_Y;
+    if (base->vx != now->vx)                   mask |= BULLET_FIELD_VX;
+    if (base->vy != now->vy)                   mask |= BULLET_FIELD_VY;
+    if (base->weapon_type != now->weapon_type) mask |= BULLET_FIELD_WEAPON;
+    return mask;
+}
+
+/**
+ * put_removal - Append one removed player or bullet id
+ */
+static void put_removal(BodyWriter* bw, uint16_t id) {
+    if (bw->quantized) {
+        wire_write_id(&bw->bits, id, bw->prev_id);
+        bw->prev_id = id;
+        return;
+    }
+    put_bytes(bw, &id, sizeof(id));
+}
+
+/**
+ * put_player / put_bullet - Append one entity record
+ */
+static void put_player(BodyWriter* bw, const PlayerState* ps, uint8_t mask) {
+    if (bw->quantized) {
+        wire_write_player(&bw->bits, ps, bw->prev_id, mask);
+        bw->prev_id = ps->player_id;
+        return;
+    }
+
+    uint16_t id = ps->player_id;
+    put_bytes(bw, &id, sizeof(id));
+    *bw->out++ = mask;
+    if (mask & PLAYER_FIELD_X)  put_float(bw, ps->x);
+    if (mask & PLAYER_FIELD_Y)  put_float(bw, ps->y);
+    if (mask & PLAYER_FIELD_VX) put_float(bw, ps->vx);
+    if (mask & PLAYER_FIELD_VY) put_float(bw, ps->vy);
+    if (mask & PLAYER_FIELD_HEALTH) {
+        int16_t health = ps->health;
+        put_bytes(bw, &health, sizeof(health));
+    }
+    if (mask & PLAYER_FIELD_WEAPON) *bw->out++ = ps->weapon;
+    if (mask & PLAYER_FIELD_FLAGS)  *bw->out++ = ps->flags;
+}
+
+static void put_bullet(BodyWriter* bw, const SnapshotBullet* bullet, uint8_t mask) {
+    const BulletState* bs = &bullet->state;
+    if (bw->quantized) {
+        wire_write_bullet(&bw->bits, bullet->id, bw->prev_id, bs, mask);
+        bw->prev_id = bullet->id;
+        return;
+    }
+
+    put_bytes(bw, &bullet->id, sizeof(bullet->id));
+    *bw->out++ = mask;
+    if (mask & BULLET_FIELD_OWNER) {
+        uint16_t owner = bs->owner_id;
+        put_bytes(bw, &owner, sizeof(owner));
+    }
+    if (mask & BULLET_FIELD_X)      put_float(bw, bs->x);
+    if (mask & BULLET_FIELD_Y)      put_float(bw, bs->y);
+    if (mask & BULLET_FIELD_VX)     put_float(bw, bs->vx);
+    if (mask & BULLET_FIELD_VY)     put_float(bw, bs->vy);
+    if (mask & BULLET_FIELD_WEAPON) *bw->out++ = bs->weapon_type;
+}
+
+/**
+ * snapshot_encode - Diff the current frame against 'base' (NULL = empty)
+ *
+ * Frames and views are sorted by id, so each section is one merge walk:
+ *
+ *     base: 1 3 4 7        i ──▶
+ *     now:  1 4 5 7 8      j ──▶
+ *           = - = + = +    (- removal, + add, = compare fields)
+ *
+ * Only bullets in the viewer's set are considered, on both sides: the
+ * client's baseline is what it was SENT at that tick, and a bullet that
+ * leaves the set is a removal like one that was destroyed. A frame
+ * holds every bullet of every view, so a view id is always found in
+ * its frame.
+ *
+ * delta->quantized selects the encoding; delta->view / base_view are
+ * the viewer's sets now and at the baseline.
+ */
+static void snapshot_encode(const SnapshotBuilder* snap, const SnapshotFrame* base,
+                            SnapshotDelta* delta) {
+    static const SnapshotFrame empty = { 0 };
+    static const SnapshotView no_view = { 0 };
+    const SnapshotFrame* now = snap->current;
+    const SnapshotView* view = delta->view;
+    const SnapshotView* base_view = delta->base_view;
+    if (base == NULL) base = &empty;
+    if (base_view == NULL) base_view = &no_view;
+
+    BodyWriter bw = { .quantized = delta->quantized, .out = delta->body, .prev_id = -1 };
+    bits_writer_init(&bw.bits, delta->body, snap->body_capacity);
+    int count, i, j, k;
+
+    // Players gone since the baseline
+    count = 0;
+    for (i = 0, j = 0; i < base->player_count; i++) {
+        uint16_t id = base->players[i].player_id;
+        while (j < now->player_count && now->players[j].player_id < id) j++;
+        if (j == now->player_count || now->players[j].player_id != id) {
+            put_removal(&bw, id);
+            count++;
+        }
+    }
+    delta->player_removals = (uint16_t)count;
+
+    // Bullets gone from the viewer's set since the baseline (each id
+    // list restarts from -1)
+    count = 0;
+    bw.prev_id = -1;
+    for (i = 0, j = 0; i < base_view->count; i++) {
+        uint16_t id = base_view->ids[i];
+        while (j < view->count && view->ids[j] < id) j++;
+        if (j == view->count || view->ids[j] != id) {
+            put_removal(&bw, id);
+            count++;
+        }
+    }
+    delta->bullet_removals = (uint16_t)count;
+
+    // Players added or changed
+    count = 0;
+    bw.prev_id = -1;
+    for (j = 0, i = 0; j < now->player_count; j++) {
+        const PlayerState* ps = &now->players[j];
+        while (i < base->player_count && base->players[i].player_id < ps->player_id) i++;
+
+        uint8_t mask = STATE_ENTITY_NEW | PLAYER_FIELDS_ALL;
+        if (i < base->player_count && base->players[i].player_id == ps->player_id) {
+            mask = player_changes(&bw, &base->players[i], ps);
+            if (mask == 0) continue;
+        }
+        put_player(&bw, ps, mask);
+        count++;
+    }
+    delta->player_updates = (uint16_t)count;
+
+    // Bullets added or changed: walk the view, with j in the current
+    // frame, k in the base view and i in the base frame
+    count = 0;
+    bw.prev_id = -1;
+    i = j = k = 0;
+    for (int v = 0; v < view->count; v++) {
+        uint16_t id = view->ids[v];
+        while (j < now->bullet_count && now->bullets[j].id < id) j++;
+        const SnapshotBullet* bullet = &now->bullets[j];
+
+        uint8_t mask = STATE_ENTITY_NEW | BULLET_FIELDS_ALL;
+        while (k < base_view->count && base_view->ids[k] < id) k++;
+        if (k < base_view->count && base_view->ids[k] == id) {
+            while (i < base->bullet_count && base->bullets[i].id < id) i++;
+            mask = bullet_changes(&bw, &base->bullets[i].state, &bullet->state);
+            if (mask == 0) continue;
+        }
+        put_bullet(&bw, bullet, mask);
+        count++;
+    }
+    delta->bullet_updates = (uint16_t)count;
+
+    delta->body_size = bw.quantized ? bits_writer_finish(&bw.bits)
+                                    : (int)(bw.out - delta->body);
+}
+
+/**
+ * same_view - Do two interest sets hold the same ids?
+ */
+static int same_view(const SnapshotView* a, const SnapshotView* b) {
+    return a->count == b->count &&
+           memcmp(a->ids, b->ids, (size_t)a->count * sizeof(uint16_t)) == 0;
+}
+
+/**
+ * snapshot_find - A body already encoded this tick for the same inputs
+ *
+ * Two viewers can share a body if they want the same encoding against
+ * the same baseline tick AND had the same interest sets then and now
+ * (with few bullets everyone's set is "all of them", so this is common).
+ */
+static const SnapshotDelta* snapshot_find(const SnapshotBuilder* snap, uint32_t baseline_tick,
+                                          int quantized, const SnapshotView* view,
+                                          const SnapshotView* base_view) {
+    for (int i = 0; i < snap->delta_count; i++) {
+        const SnapshotDelta* d = &snap->deltas[i];
+        if (d->baseline_tick != baseline_tick || d->quantized != quantized) continue;
+        if (!same_view(d->view, view)) continue;
+        if (base_view != NULL && !same_view(d->base_view, base_view)) continue;
+        return d;
+    }
+    return NULL;
+}
+
+/**
+ * snapshot_add_delta - Encode a new body at the end of the pool
+ *
+ * The body is given the worst case to write into, then only keeps the
+ * bytes it used.
+ */
+static const SnapshotDelta* snapshot_add_delta(SnapshotBuilder* snap, const SnapshotFrame* base,
+                                               uint32_t baseline_tick, int quantized,
+                                               const SnapshotView* view,
+                                               const SnapshotView* base_view) {
+    if (snap->delta_count >= snap->delta_capacity ||
+        snap->pool_size - snap->pool_used < (size_t)snap->body_capacity) {
+        return NULL;
+    }
+
+    SnapshotDelta* delta = &snap->deltas[snap->delta_count++];
+    delta->baseline_tick = baseline_tick;
+    delta->quantized = quantized;
+    delta->view = view;
+    delta->base_view = base_view;
+    delta->body = snap->pool + snap->pool_used;
+    snapshot_encode(snap, base, delta);
+    snap->pool_used += (size_t)delta->body_size;
+    return delta;
+}
+
+/**
+ * snapshot_delta - Body for one viewer whose newest snapshot is 'baseline_tick'
+ *
+ * The viewer's full snapshot is encoded too (or found in the cache): it
+ * is the fallback, and the yardstick a delta must beat.
+ */
+const SnapshotDelta* snapshot_delta(SnapshotBuilder* snap, int viewer, uint32_t baseline_tick,
+                                    int quantized) {
+    const SnapshotView* view = snapshot_view(snap, viewer);
+
+    const SnapshotDelta* full = snapshot_find(snap, STATE_NO_BASELINE, quantized, view, NULL);
+    if (full == NULL) {
+        full = snapshot_add_delta(snap, NULL, STATE_NO_BASELINE, quantized, view, NULL);
+    }
+
+    // Is the baseline still in the history?
+    if (baseline_tick == STATE_NO_BASELINE) return full;
+    const SnapshotFrame* base = &snap->history[baseline_tick % SNAPSHOT_HISTORY];
+    if (!base->valid || base->tick != baseline_tick || base == snap->current) {
+        return full;
+    }
+    const SnapshotView* base_view = &base->views[viewer];
+
+    const SnapshotDelta* delta = snapshot_find(snap, baseline_tick, quantized, view, base_view);
+    if (delta != NULL) return delta;
+
+    delta = snapshot_add_delta(snap, base, baseline_tick, quantized, view, base_view);
+    if (delta == NULL) return full;
+    if (full != NULL && delta->body_size >= full->body_size) {
+        // Lots of churn: the delta isn't worth it
+        snap->delta_count--;
+        snap->pool_used -= (size_t)delta->body_size;
+        return full;
+    }
+    return delta;
+}
+
+/**
+ * write_state_header - The fixed fields of GameStateMsg, either encoding
+ *
+ * The header is built as a struct and copied (or bit-packed), so the
+ * output needs no particular alignment.
+ *
+ * @return  Bytes written (at most SNAPSHOT_STATE_HEADER_MAX)
+ */
+static int write_state_header(const SnapshotBuilder* snap, const SnapshotDelta* delta,
+                              uint32_t your_sequence, uint8_t* out) {
+    GameStateMsg state = {
+        .tick = snap->current->tick,
+        .baseline_tick = delta->baseline_tick,
+        .your_sequence = your_sequence,
+        .player_updates = delta->player_updates,
+        .player_removals = delta->player_removals,
+        .bullet_updates = delta->bullet_updates,
+        .bullet_removals = delta->bullet_removals
+    };
+
+    if (delta->quantized) return wire_write_state_header(&state, out);
+    memcpy(out, &state, sizeof(GameStateMsg));
+    return (int)sizeof(GameStateMsg);
+}
+
+/**
+ * snapshot_piece - One frame of the message
+ *
+ * A fragmented message is the state header followed by the body, cut
+ * into equal chunks:
+ *
+ *     ┌─ state header ─┬──────────────── body ────────────────┐
+ *     ├──── piece 0 ───────────┼──── piece 1 ────┼─ piece 2 ─┤
+ *
+ * Piece 0's chunk starts with the header (in its owned head), the rest
+ * of every chunk points into the shared body.
+ */
+int snapshot_piece(const SnapshotBuilder* snap, const SnapshotDelta* delta,
+                   uint32_t your_sequence, int max_payload, int index, SnapshotPiece* piece) {
+    uint8_t state[SNAPSHOT_STATE_HEADER_MAX];
+    int state_length = write_state_header(snap, delta, your_sequence, state);
+    int total = state_length + delta->body_size;
+
+    // Fits: the plain message
+    if (total <= max_payload) {
+        MessageHeader header = { .type = MSG_GAME_STATE, .length = (uint16_t)total };
+        memcpy(piece->head, &header, sizeof(header));
+        memcpy(piece->head + sizeof(header), state, state_length);
+        piece->head_length = (int)sizeof(header) + state_length;
+        piece->body = delta->body;
+        piece->body_length = delta->body_size;
+        return 1;
+    }
+
+    int chunk = max_payload - (int)sizeof(StateFragmentMsg);
+    int count = (total + chunk - 1) / chunk;
+    int start = index * chunk;
+    int end = (start + chunk < total) ? start + chunk : total;
+
+    MessageHeader header = {
+        .type = MSG_STATE_FRAGMENT,
+        .length = (uint16_t)(sizeof(StateFragmentMsg) + (end - start))
+    };
+    StateFragmentMsg fragment = {
+        .tick = snap->current->tick,
+        .index = (uint16_t)index,
+        .count = (uint16_t)count
+    };
+    uint8_t* out = piece->head;
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, &fragment, sizeof(fragment));
+    out += sizeof(fragment);
+
+    // The header only ever lands in piece 0: a chunk is far larger
+    if (index == 0) {
+        memcpy(out, state, state_length);
+        out += state_length;
+        piece->body = delta->body;
+        piece->body_length = end - state_length;
+    } else {
+        piece->body = delta->body + (start - state_length);
+        piece->body_length = end - start;
+    }
+    piece->head_length = (int)(out - piece->head);
+    return count;
+}
+
+/**
+ * snapshot_send - Per-client heads + shared body slices, one push per batch
+ *
+ * Each piece is two iovecs, so up to NET_MAX_IOVECS / 2 pieces go out
+ * per push (one push for anything that fits a single message). Every
+ * batch after the first continues the same LATEST message, so a newer
+ * snapshot supersedes all of it or none.
+ */
+int snapshot_send(const SnapshotBuilder* snap, const SnapshotDelta* delta,
+                  NetSendQueue* queue, Socket socket, uint32_t your_sequence) {
+    SnapshotPiece pieces[NET_MAX_IOVECS / 2];
+    struct iovec parts[NET_MAX_IOVECS];
+    int total_sent = 0;
+
+    int count = 1;
+    for (int index = 0; index < count; ) {
+        int batch = 0;
+        do {
+            SnapshotPiece* piece = &pieces[batch];
+            count = snapshot_piece(snap, delta, your_sequence, SNAPSHOT_TCP_PAYLOAD_MAX,
+                                   index++, piece);
+            parts[2 * batch] = (struct iovec){ piece->head, (size_t)piece->head_length };
+            parts[2 * batch + 1] = (struct iovec){ (void*)piece->body, (size_t)piece->body_length };
+            batch++;
+        } while (index < count && batch < NET_MAX_IOVECS / 2);
+
+        int flags = NET_QUEUE_LATEST | ((total_sent > 0) ? NET_QUEUE_CONTINUE : 0);
+        int sent = net_send_queue_push(queue, socket, parts, 2 * batch, flags);
+        if (sent < 0) return sent;
+        total_sent += sent;
+    }
+    return total_sent;
+}
+
+/**
+ * snapshot_count_sent - Frames out of a byte count
+ *
+ * snapshot_send() reports bytes, not frames; every piece but the last
+ * of a fragmented state is exactly one full frame, so the byte count
+ * alone tells how many frames went out, and of which type.
+ */
+void snapshot_count_sent(MetricsShard* metrics, int sent) {
+    const int full_frame = (int)sizeof(MessageHeader) + SNAPSHOT_TCP_PAYLOAD_MAX;
+    metrics_observe(metrics, METRIC_CLIENT_BYTES, (uint64_t)sent);
+
+    if (sent <= full_frame) {
+        metrics_message(metrics, 1, MSG_GAME_STATE, (uint64_t)sent);
+        return;
+    }
+    int frames = (sent + full_frame - 1) / full_frame;
+    for (int f = 0; f < frames; f++) {
+        int length = (f < frames - 1) ? full_frame : sent - (frames - 1) * full_frame;
+        metrics_message(metrics, 1, MSG_STATE_FRAGMENT, (uint64_t)length);
+    }
+}
@@ -0,0 +1,319 @@
+/**
+ * snapshot.h - Building and Sending MSG_GAME_STATE
+ *
+ * CONCEPT: Encode Once, Send Many
+ * ===============================
+ * Every player in a room receives (a view of) the same world. What
+ * differs per recipient is your_sequence (the last input the server
+ * processed for THAT player), the BASELINE the delta is relative to
+ * (see GameStateMsg in protocol.h) and which bullets they are sent.
+ * So we split the message in two pieces:
+ *
+ *     ┌──────────────── per client (built on the stack) ──────────────┐
+ *     │ MessageHeader │ tick │ baseline │ your_sequence │ 4 counts     │
+ *     └───────────────────────────────────────────────────────────────┘
+ *     ┌──────── shared (encoded ONCE per distinct body needed) ───────┐
+ *     │ removals │ player records │ bullet records                    │
+ *     └───────────────────────────────────────────────────────────────┘
+ *
+ * and hand both to the kernel in one sendmsg() (see net_send_vectored).
+ * Clients that acked the same tick, speak the same encoding (raw or
+ * quantized - see wire.h) and see the same bullets share one encoded
+ * body; in practice a room needs only a handful of distinct bodies per
+ * tick.
+ *
+ * CONCEPT: Snapshot History
+ * =========================
+ * To diff against "the snapshot tick 100 that client 3 acked", the
+ * server must still have it. The builder keeps the last SNAPSHOT_HISTORY
+ * snapshots in a ring indexed by tick:
+ *
+ *     history[tick % SNAPSHOT_HISTORY]
+ *
+ * An ack older than that (or never received) gets a full snapshot.
+ *
+ * CONCEPT: Arena
+ * ==============
+ * History frames and encoded bodies live in ONE buffer sized for the
+ * worst case at init and reused every tick. Nothing is allocated while
+ * the game runs.
+ *
+ * CONCEPT: Per-Viewer Views
+ * =========================
+ * Each client is only sent its own interest set (see interest.h), and a
+ * frame holds just the bullets in at least one of those sets. The sets
+ * are recorded in the frame, so a later delta knows exactly what that
+ * client had at the baseline.
+ *
+ * A set is stored as a sorted list of at most view_capacity ids (the
+ * per-client bullet budget), not as a bitset over every possible id:
+ * the history then costs players × budget per frame, however many
+ * thousand bullets the room has.
+ *
+ * CONCEPT: Pieces
+ * ===============
+ * With hundreds of players a message can outgrow one frame (64 KB over
+ * TCP, one datagram over UDP). snapshot_piece() cuts it into
+ * MSG_STATE_FRAGMENT pieces (see StateFragmentMsg in protocol.h); each
+ * piece is again a small per-client head plus a slice of the shared
+ * body, so nothing is copied.
+ *
+ * USAGE (players MUST be added before bullets, both in ascending id):
+ *
+ *     snapshot_begin(&snap, tick);
+ *     PlayerState* ps = snapshot_add_player(&snap);      // fill *ps
+ *     BulletState* bs = snapshot_add_bullet(&snap, id);  // NULL when full
+ *     SnapshotView* view = snapshot_view(&snap, viewer); // per client
+ *
+ *     const SnapshotDelta* d = snapshot_delta(&snap, viewer, acked_tick, quantized);
+ *     snapshot_send(&snap, d, &send_queue, socket, your_sequence);
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+#include "network.h"
+#include "wire.h"
+#include "metrics.h"
+
+// Per-client piece: MessageHeader + the fixed fields of GameStateMsg
+// in the larger of the two encodings
+#define SNAPSHOT_STATE_HEADER_MAX \
+    (sizeof(GameStateMsg) > WIRE_STATE_HEADER_MAX ? sizeof(GameStateMsg) : WIRE_STATE_HEADER_MAX)
+#define SNAPSHOT_HEADER_MAX (sizeof(MessageHeader) + SNAPSHOT_STATE_HEADER_MAX)
+
+// Head of one piece: a fragment also carries its StateFragmentMsg
+#define SNAPSHOT_PIECE_HEAD_MAX (SNAPSHOT_HEADER_MAX + sizeof(StateFragmentMsg))
+
+// Largest payload of one frame per transport
+#define SNAPSHOT_TCP_PAYLOAD_MAX UINT16_MAX
+#define SNAPSHOT_UDP_PAYLOAD_MAX \
+    (NET_UDP_MAX_PACKET - (int)sizeof(NetUdpHeader) - (int)sizeof(MessageHeader))
+
+// Snapshots kept as possible baselines (~0.5 s at 60 Hz)
+#define SNAPSHOT_HISTORY 32
+
+/**
+ * SnapshotBullet - A bullet in a history frame (bullets need an id to be
+ * matched against the baseline; the id is the stable bullet id)
+ */
+typedef struct {
+    uint16_t id;
+    BulletState state;
+} SnapshotBullet;
+
+/**
+ * SnapshotView - One viewer's interest set: bullet ids, ascending
+ */
+typedef struct {
+    uint16_t* ids;              // view_capacity entries
+    int count;
+} SnapshotView;
+
+/**
+ * SnapshotFrame - One tick's world (sorted by id) and who saw what
+ *
+ * The frame holds the bullets SOME viewer was sent; views[viewer] is
+ * the interest set of bullet ids that viewer was actually sent.
+ */
+typedef struct {
+    uint32_t tick;
+    int valid;
+    PlayerState* players;
+    int player_count;
+    SnapshotBullet* bullets;
+    int bullet_count;
+    SnapshotView* views;        // max_players sets
+} SnapshotFrame;
+
+/**
+ * SnapshotDelta - The current frame encoded against one baseline
+ */
+typedef struct {
+    uint32_t baseline_tick;     // STATE_NO_BASELINE = full snapshot
+    int quantized;              // Encoding: 1 = wire.h, 0 = raw structs
+    const SnapshotView* view;       // Viewer's set now
+    const SnapshotView* base_view;  // Viewer's set at the baseline (NULL = full)
+    uint8_t* body;
+    int body_size;
+    uint16_t player_updates;
+    uint16_t player_removals;
+    uint16_t bullet_updates;
+    uint16_t bullet_removals;
+} SnapshotDelta;
+
+/**
+ * SnapshotPiece - One frame of one client's message: a small owned head
+ * (MessageHeader, StateFragmentMsg if fragmented, state header in the
+ * first piece) plus a slice of the shared body
+ */
+typedef struct {
+    uint8_t head[SNAPSHOT_PIECE_HEAD_MAX];
+    int head_length;
+    const uint8_t* body;
+    int body_length;
+} SnapshotPiece;
+
+/**
+ * SnapshotBuilder - History ring plus this tick's encoded bodies
+ */
+typedef struct {
+    uint8_t* arena;             // The one allocation
+    int max_players;
+    int max_bullets;            // Bound on bullet ids
+    int frame_bullets;          // Bullets per frame (the union of the views)
+    int view_capacity;          // Most bullets in one viewer's set
+
+    SnapshotFrame history[SNAPSHOT_HISTORY];
+    SnapshotFrame* current;     // Frame being built / sent this tick
+
+    // Bodies encoded this tick (reset by snapshot_begin): full snapshots
+    // and deltas, shared by every viewer that needs the same one
+    SnapshotDelta* deltas;
+    int delta_count;
+    int delta_capacity;         // 2 per player: a delta and its full fallback
+    int body_capacity;          // Worst-case size of one body
+
+    // Where the bodies live: bump-allocated, reset by snapshot_begin
+    uint8_t* pool;
+    size_t pool_size;
+    size_t pool_used;
+} SnapshotBuilder;
+
+/**
+ * snapshot_init - Allocate the arena (once, at room creation)
+ *
+ * @param snap           Builder to initialize
+ * @param max_players    Most players (and viewers) a snapshot will ever hold
+ * @param max_bullets    Most bullets in the room; ids must be below this
+ * @param view_capacity  Most bullets one viewer is sent
+ * @return               0 on success, -1 if out of memory
+ */
+int snapshot_init(SnapshotBuilder* snap, int max_players, int max_bullets, int view_capacity);
+
+/**
+ * snapshot_free - Release the arena
+ *
+ * @param snap  Builder to free
+ */
+void snapshot_free(SnapshotBuilder* snap);
+
+/**
+ * snapshot_begin - Start a new snapshot
+ *
+ * Reuses the history slot of tick - SNAPSHOT_HISTORY and forgets the
+ * bodies encoded last tick.
+ *
+ * @param snap  The builder
+ * @param tick  Server tick this snapshot describes
+ */
+void snapshot_begin(SnapshotBuilder* snap, uint32_t tick);
+
+/**
+ * snapshot_add_player - Reserve the next PlayerState
+ *
+ * @param snap  The builder
+ * @return      Slot to fill in (player_id included), or NULL if full
+ */
+PlayerState* snapshot_add_player(SnapshotBuilder* snap);
+
+/**
+ * snapshot_add_bullet - Reserve the next BulletState
+ *
+ * @param snap  The builder
+ * @param id    Stable bullet id (ascending within one snapshot)
+ * @return      Slot to fill in, or NULL if full or id >= max_bullets
+ */
+BulletState* snapshot_add_bullet(SnapshotBuilder* snap, uint16_t id);
+
+/**
+ * snapshot_view - A viewer's interest set in the current frame
+ *
+ * Starts empty each tick; fill in the ids (ascending) of every bullet
+ * this viewer should be sent - at most view_capacity of them.
+ *
+ * @param snap    The builder
+ * @param viewer  Player slot (< max_players)
+ * @return        The set to fill in
+ */
+SnapshotView* snapshot_view(SnapshotBuilder* snap, int viewer);
+
+/**
+ * snapshot_previous_view - A viewer's interest set one tick ago
+ *
+ * @param snap    The builder (after snapshot_begin)
+ * @param viewer  Player slot
+ * @return        Last tick's set, or NULL if that tick isn't in the history
+ */
+const SnapshotView* snapshot_previous_view(const SnapshotBuilder* snap, int viewer);
+
+/**
+ * snapshot_delta - Encode one viewer's snapshot against a baseline
+ *
+ * Returns a cached body if another client already needed the same one
+ * this tick (same baseline, encoding and interest sets). Falls back to
+ * the full snapshot if the baseline is no longer in the history or the
+ * delta would not be smaller.
+ *
+ * @param snap          The finished snapshot (views filled in)
+ * @param viewer        Player slot the body is for
+ * @param baseline_tick Tick the client acked (STATE_NO_BASELINE = none)
+ * @param quantized     1 for the bit-packed encoding, 0 for raw structs
+ * @return              Encoded body (valid until the next snapshot_begin),
+ *                      or NULL if this tick's body pool is used up
+ */
+const SnapshotDelta* snapshot_delta(SnapshotBuilder* snap, int viewer, uint32_t baseline_tick,
+                                    int quantized);
+
+/**
+ * snapshot_piece - Cut one client's message into frames
+ *
+ * If the whole MSG_GAME_STATE payload fits in 'max_payload' bytes there
+ * is one piece: the message itself. Otherwise every piece is a
+ * MSG_STATE_FRAGMENT of at most 'max_payload' bytes.
+ *
+ * @param snap           The finished snapshot
+ * @param delta          Body from snapshot_delta() for this client
+ * @param your_sequence  Last input sequence processed for this client
+ * @param max_payload    Largest payload of one frame (SNAPSHOT_*_PAYLOAD_MAX)
+ * @param index          Piece to build (0 .. count-1)
+ * @param piece          Receives the piece
+ * @return               Number of pieces the message needs
+ */
+int snapshot_piece(const SnapshotBuilder* snap, const SnapshotDelta* delta,
+                   uint32_t your_sequence, int max_payload, int index, SnapshotPiece* piece);
+
+/**
+ * snapshot_send - Send the snapshot to one client over TCP
+ *
+ * Builds the per-client heads on the stack and pushes them together
+ * with the shared body slices into the client's send queue, as a
+ * NET_QUEUE_LATEST message: if the client is so far behind that the
+ * previous snapshot hasn't started to leave, this one replaces it.
+ *
+ * @param snap           The finished snapshot
+ * @param delta          Body from snapshot_delta() for this client
+ * @param queue          Client's send queue
+ * @param socket         Client socket
+ * @param your_sequence  Last input sequence processed for this client
+ * @return               Bytes sent or queued, -1 on error,
+ *                       NET_QUEUE_FULL if the queue has no room
+ */
+int snapshot_send(const SnapshotBuilder* snap, const SnapshotDelta* delta,
+                  NetSendQueue* queue, Socket socket, uint32_t your_sequence);
+
+/**
+ * snapshot_count_sent - Record one client's snapshot_send() in the metrics
+ *
+ * Bytes per client, plus messages sent by type (MSG_GAME_STATE, or
+ * one MSG_STATE_FRAGMENT per frame of a fragmented state).
+ *
+ * @param metrics  Shard of the sending thread
+ * @param sent     What snapshot_send() returned (>= 0)
+ */
+void snapshot_count_sent(MetricsShard* metrics, int sent);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,105 @@
+/**
+ * spatial_grid.c - Uniform Grid Implementation
+ *
+ * See spatial_grid.h for the counting-sort rebuild.
+ */
+
+#include "spatial_grid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * cell_coord - Column or row of a coordinate, clamped to the grid
+ */
+static int cell_coord(float value, int cells) {
+    int c = (int)(value / SPATIAL_CELL_SIZE);
+    if (c < 0) return 0;
+    if (c >= cells) return cells - 1;
+    return c;
+}
+
+/**
+ * spatial_grid_init - One allocation for the items and the scratch
+ */
+int spatial_grid_init(SpatialGrid* grid, int max_items) {
+    memset(grid, 0, sizeof(SpatialGrid));
+
+    int capacity = max_items * SPATIAL_CELLS_PER_ITEM;
+    uint16_t* memory = malloc((size_t)capacity * 3 * sizeof(uint16_t));
+    if (memory == NULL) return -1;
+
+    grid->memory = memory;
+    grid->capacity = capacity;
+    grid->items = memory;
+    grid->pending_cell = memory + capacity;
+    grid->pending_item = memory + 2 * capacity;
+    return 0;
+}
+
+/**
+ * spatial_grid_free - Release the one allocation
+ */
+void spatial_grid_free(SpatialGrid* grid) {
+    free(grid->memory);
+    memset(grid, 0, sizeof(SpatialGrid));
+}
+
+/**
+ * spatial_grid_clear - Zero the per-cell counts
+ */
+void spatial_grid_clear(SpatialGrid* grid) {
+    memset(grid->cell_start, 0, sizeof(grid->cell_start));
+    grid->pending_count = 0;
+}
+
+/**
+ * spatial_grid_insert - Record one pair per touched cell and count it
+ *
+ * Counts go into cell_start[c + 1] so that finish's prefix sum turns
+ * them straight into start offsets.
+ */
+void spatial_grid_insert(SpatialGrid* grid, uint16_t item,
+                         float min_x, float min_y, float max_x, float max_y) {
+    int col0 = cell_coord(min_x, SPATIAL_GRID_COLS);
+    int col1 = cell_coord(max_x, SPATIAL_GRID_COLS);
+    int row0 = cell_coord(min_y, SPATIAL_GRID_ROWS);
+    int row1 = cell_coord(max_y, SPATIAL_GRID_ROWS);
+
+    for (int row = row0; row <= row1; row++) {
+        for (int col = col0; col <= col1; col++) {
+            if (grid->pending_count >= grid->capacity) return;
+            int cell = row * SPATIAL_GRID_COLS + col;
+            grid->pending_cell[grid->pending_count] = (uint16_t)cell;
+            grid->pending_item[grid->pending_count] = item;
+            grid->pending_count++;
+            grid->cell_start[cell + 1]++;
+        }
+    }
+}
+
+/**
+ * spatial_grid_finish - Prefix sum, then scatter
+ */
+void spatial_grid_finish(SpatialGrid* grid) {
+    int fill[SPATIAL_GRID_CELLS];
+
+    for (int c = 0; c < SPATIAL_GRID_CELLS; c++) {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+        fill[c] = grid->cell_start[c];
+    }
+
+    for (int i = 0; i < grid->pending_count; i++) {
+        grid->items[fill[grid->pending_cell[i]]++] = grid->pending_item[i];
+    }
+}
+
+/**
+ * spatial_grid_query - The items of the point's cell
+ */
+const uint16_t* spatial_grid_query(const SpatialGrid* grid, float x, float y, int* count) {
+    int cell = cell_coord(y, SPATIAL_GRID_ROWS) * SPATIAL_GRID_COLS +
+               cell_coord(x, SPATIAL_GRID_COLS);
+    *count = grid->cell_start[cell + 1] - grid->cell_start[cell];
+    return grid->items + grid->cell_start[cell];
+}
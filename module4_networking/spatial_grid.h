@@ -0,0 +1,134 @@
+/**
+ * spatial_grid.h - Uniform Grid for "What's Near This Point?"
+ *
+ * CONCEPT: Broadphase
+ * ===================
+ * Does any bullet hit any player? The brute-force answer tests every
+ * bullet against every player: bullets × players tests per tick, most
+ * of them between things on opposite sides of the screen.
+ *
+ * A BROADPHASE first narrows it down to pairs that are close. The
+ * simplest one is a uniform grid laid over the field:
+ *
+ *     ┌─────┬─────┬─────┬─────┬─────┬─────┬─────┐
+ *     │     │     │     │     │     │     │     │
+ *     ├─────┼─────┼─────┼─────┼─────┼─────┼─────┤
+ *     │     │  ┏━━┿━━┓  │     │   · │     │     │   ✈ player box
+ *     ├─────┼──╂──┼──╂──┼─────┼─────┼─────┼─────┤     touches 4 cells
+ *     │     │  ┗━━┿━━┛  │     │     │     │     │
+ *     ├─────┼─────┼─────┼─────┼─────┼─────┼─────┤   · bullet is in
+ *     │     │     │     │     │     │     │     │     exactly 1 cell
+ *     └─────┴─────┴─────┴─────┴─────┴─────┴─────┘
+ *
+ * Each player's box is filed under every cell it touches; a bullet then
+ * only looks at the players filed under ITS cell - usually none. The
+ * cost is ~one lookup per bullet, however many bullets there are.
+ *
+ * Cells are at least half as big as the largest box (a hitbox swept
+ * over the lag compensation window, see world_history.h), so a box
+ * touches at most 3 × 3 cells.
+ *
+ * CONCEPT: Rebuild, Don't Update
+ * ==============================
+ * Everything moves every tick, so instead of moving entries between
+ * cells the grid is rebuilt from scratch each tick - a counting sort:
+ *
+ *     1. insert:  note (cell, item) pairs and count items per cell
+ *     2. finish:  prefix sum of the counts = where each cell starts
+ *     3.          scatter the items into one array, cell by cell
+ *
+ * A cell's items end up contiguous in memory, and nothing is allocated
+ * after init.
+ */
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Grid over the GAME_WIDTH x GAME_HEIGHT field
+#define SPATIAL_CELL_SIZE 128
+#define SPATIAL_GRID_COLS ((GAME_WIDTH + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE)
+#define SPATIAL_GRID_ROWS ((GAME_HEIGHT + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE)
+#define SPATIAL_GRID_CELLS (SPATIAL_GRID_COLS * SPATIAL_GRID_ROWS)
+
+// Boxes no larger than two cells touch at most this many cells
+#define SPATIAL_CELLS_PER_ITEM 9
+
+/**
+ * SpatialGrid - Items filed by the cells their boxes touch
+ *
+ * Cell c holds items[cell_start[c] .. cell_start[c + 1] - 1].
+ */
+typedef struct {
+    int cell_start[SPATIAL_GRID_CELLS + 1];
+    uint16_t* items;            // Sorted by cell (after finish)
+
+    // Insert scratch: one (cell, item) pair per touched cell
+    uint16_t* pending_cell;
+    uint16_t* pending_item;
+    int pending_count;
+
+    int capacity;               // Pairs (max_items × SPATIAL_CELLS_PER_ITEM)
+    void* memory;               // The one allocation
+} SpatialGrid;
+
+/**
+ * spatial_grid_init - Allocate room for 'max_items' boxes
+ *
+ * @param grid       Grid to initialize
+ * @param max_items  Most items inserted per rebuild
+ * @return           0 on success, -1 if out of memory
+ */
+int spatial_grid_init(SpatialGrid* grid, int max_items);
+
+/**
+ * spatial_grid_free - Release the grid's memory
+ *
+ * @param grid  Grid to free
+ */
+void spatial_grid_free(SpatialGrid* grid);
+
+/**
+ * spatial_grid_clear - Start a rebuild (forget every item)
+ *
+ * @param grid  The grid
+ */
+void spatial_grid_clear(SpatialGrid* grid);
+
+/**
+ * spatial_grid_insert - File an item under every cell its box touches
+ *
+ * The box is clipped to the field; it must not be larger than
+ * 2 × SPATIAL_CELL_SIZE on either axis.
+ *
+ * @param grid                The grid (between clear and finish)
+ * @param item                Caller's index for the item
+ * @param min_x, min_y        Top-left corner of the box
+ * @param max_x, max_y        Bottom-right corner of the box
+ */
+void spatial_grid_insert(SpatialGrid* grid, uint16_t item,
+                         float min_x, float min_y, float max_x, float max_y);
+
+/**
+ * spatial_grid_finish - Sort the inserted items into their cells
+ *
+ * @param grid  The grid
+ */
+void spatial_grid_finish(SpatialGrid* grid);
+
+/**
+ * spatial_grid_query - Items whose boxes may contain a point
+ *
+ * Candidates only: the caller still does the exact test.
+ *
+ * @param grid   The grid (after finish)
+ * @param x, y   The point (clamped to the field)
+ * @param count  Receives the number of items
+ * @return       The cell's items
+ */
+const uint16_t* spatial_grid_query(const SpatialGrid* grid, float x, float y, int* count);
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,186 @@
+/**
+ * tick_scheduler.c - Drift-Free Fixed-Rate Ticking Implementation
+ *
+ * See tick_scheduler.h for the concepts. The typical loop:
+ *
+ *     TickScheduler sched;
+ *     tick_scheduler_init(&sched, TICK_RATE, TICK_DEFAULT_MAX_CATCHUP);
+ *
+ *     while (running) {
+ *         tick_scheduler_sleep(&sched);
+ *         int due = tick_scheduler_due(&sched);
+ *         for (int i = 0; i < due; i++) {
+ *             tick_scheduler_begin_work(&sched);
+ *             simulate(dt);
+ *             tick_scheduler_end_work(&sched);
+ *         }
+ *     }
+ */
+
+#include "tick_scheduler.h"
+
+#include <time.h>
+#include <errno.h>
+
+#define NS_PER_SEC 1000000000ULL
+#define NS_PER_MS  1000000ULL
+
+/**
+ * tick_now_ns - Read CLOCK_MONOTONIC
+ *
+ * CLOCK_REALTIME can jump (NTP, the user changing the clock).
+ * CLOCK_MONOTONIC only ever moves forward at a steady rate.
+ */
+uint64_t tick_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * tick_scheduler_init - Start ticking from now
+ */
+void tick_scheduler_init(TickScheduler* sched, int tick_rate, int max_catchup) {
+    if (tick_rate < 1) tick_rate = 1;
+    if (max_catchup < 1) max_catchup = 1;
+
+    sched->period_ns = NS_PER_SEC / (uint64_t)tick_rate;
+    sched->max_catchup = max_catchup;
+    sched->work_start_ns = 0;
+    sched->last_work_ns = 0;
+    sched->last_slack_ns = 0;
+
+    TickStats discard;
+    tick_scheduler_take_window(sched, &discard);
+    tick_scheduler_reset(sched);
+}
+
+/**
+ * tick_scheduler_reset - Next tick is due one period from now
+ *
+ * An empty statistics window restarts too, so idle time before the
+ * first tick doesn't drag the reported rate below TICK_RATE.
+ */
+void tick_scheduler_reset(TickScheduler* sched) {
+    uint64_t now = tick_now_ns();
+    sched->next_deadline_ns = now + sched->period_ns;
+    if (sched->ticks == 0) {
+        sched->window_start_ns = now;
+    }
+}
+
+/**
+ * tick_scheduler_timeout_ms - Whole milliseconds until the next deadline
+ */
+int tick_scheduler_timeout_ms(const TickScheduler* sched) {
+    uint64_t now = tick_now_ns();
+    if (now >= sched->next_deadline_ns) return 0;
+    return (int)((sched->next_deadline_ns - now) / NS_PER_MS);
+}
+
+/**
+ * tick_scheduler_sleep - Sleep until the next deadline
+ *
+ * Linux can sleep until an ABSOLUTE time (TIMER_ABSTIME), which is
+ * immune to the gap between reading the clock and going to sleep.
+ * Elsewhere we compute the remaining time and use nanosleep(); the
+ * deadline itself is still absolute, so errors don't accumulate.
+ */
+void tick_scheduler_sleep(const TickScheduler* sched) {
+#ifdef __linux__
+    struct timespec deadline = {
+        .tv_sec = (time_t)(sched->next_deadline_ns / NS_PER_SEC),
+        .tv_nsec = (long)(sched->next_deadline_ns % NS_PER_SEC)
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+        // Interrupted by a signal - the deadline hasn't moved, sleep again
+    }
+#else
+    uint64_t now = tick_now_ns();
+    while (now < sched->next_deadline_ns) {
+        uint64_t remaining = sched->next_deadline_ns - now;
+        struct timespec ts = {
+            .tv_sec = (time_t)(remaining / NS_PER_SEC),
+            .tv_nsec = (long)(remaining % NS_PER_SEC)
+        };
+        nanosleep(&ts, NULL);
+        now = tick_now_ns();
+    }
+#endif
+}
+
+/**
+ * tick_scheduler_due - Count (and consume) the ticks that are due
+ *
+ * Deadlines stay on the original grid (t0 + n*P) even after skipping,
+ * so a hiccup never shifts the phase of later ticks.
+ */
+int tick_scheduler_due(TickScheduler* sched) {
+    uint64_t now = tick_now_ns();
+    if (now < sched->next_deadline_ns) return 0;
+
+    uint64_t owed = (now - sched->next_deadline_ns) / sched->period_ns + 1;
+    uint64_t run = owed;
+    if (run > (uint64_t)sched->max_catchup) {
+        run = (uint64_t)sched->max_catchup;
+        sched->skipped += owed - run;
+    }
+
+    sched->next_deadline_ns += owed * sched->period_ns;
+    return (int)run;
+}
+
+/**
+ * tick_scheduler_begin_work - Start timing one tick
+ */
+void tick_scheduler_begin_work(TickScheduler* sched) {
+    sched->work_start_ns = tick_now_ns();
+}
+
+/**
+ * tick_scheduler_end_work - Stop timing one tick
+ */
+void tick_scheduler_end_work(TickScheduler* sched) {
+    uint64_t now = tick_now_ns();
+
+    sched->last_work_ns = now - sched->work_start_ns;
+    sched->last_slack_ns = (int64_t)sched->next_deadline_ns - (int64_t)now;
+
+    sched->ticks++;
+    sched->total_work_ns += sched->last_work_ns;
+    if (sched->last_work_ns > sched->max_work_ns) {
+        sched->max_work_ns = sched->last_work_ns;
+    }
+    if (sched->last_slack_ns < sched->min_slack_ns) {
+        sched->min_slack_ns = sched->last_slack_ns;
+    }
+    if (sched->last_slack_ns < 0) {
+        sched->overruns++;
+    }
+}
+
+/**
+ * tick_scheduler_take_window - Summarize and reset the statistics window
+ */
+void tick_scheduler_take_window(TickScheduler* sched, TickStats* out) {
+    uint64_t now = tick_now_ns();
+    double elapsed_s = (double)(now - sched->window_start_ns) / (double)NS_PER_SEC;
+
+    out->ticks = sched->ticks;
+    out->overruns = sched->overruns;
+    out->skipped = sched->skipped;
+    out->rate_hz = (elapsed_s > 0.0) ? (double)sched->ticks / elapsed_s : 0.0;
+    out->avg_work_ms = (sched->ticks > 0)
+                       ? (double)sched->total_work_ns / (double)sched->ticks / (double)NS_PER_MS
+                       : 0.0;
+    out->max_work_ms = (double)sched->max_work_ns / (double)NS_PER_MS;
+    out->min_slack_ms = (sched->ticks > 0) ? (double)sched->min_slack_ns / (double)NS_PER_MS : 0.0;
+
+    sched->ticks = 0;
+    sched->overruns = 0;
+    sched->skipped = 0;
+    sched->total_work_ns = 0;
+    sched->max_work_ns = 0;
+    sched->min_slack_ns = INT64_MAX;
+    sched->window_start_ns = now;
+}
@@ -0,0 +1,165 @@
+/**
+ * tick_scheduler.h - Drift-Free Fixed-Rate Ticking
+ *
+ * CONCEPT: Relative Sleep Drifts, Absolute Deadlines Don't
+ * ========================================================
+ * The naive game loop:
+ *
+ *     while (running) {
+ *         do_work();            // takes W ms
+ *         usleep(16667);        // then sleeps a FULL tick
+ *     }
+ *
+ * Every tick lasts 16.7 ms + W, so at W = 4 ms we run at ~48 Hz, not 60.
+ * The error accumulates forever ("drift").
+ *
+ * A scheduler instead keeps a list of absolute deadlines on a clock that
+ * never jumps (CLOCK_MONOTONIC):
+ *
+ *     deadline:  t0   t0+P   t0+2P   t0+3P ...     (P = 1/TICK_RATE)
+ *
+ * After the work we sleep UNTIL the next deadline, so the work time is
+ * absorbed into the period instead of added to it.
+ *
+ * CONCEPT: Catch-Up
+ * =================
+ * If a tick takes longer than P (an "overrun"), the next deadline is
+ * already in the past. We then run several ticks back-to-back to catch
+ * up - but at most 'max_catchup' of them. Beyond that we drop the missed
+ * ticks (counted in 'skipped') instead of spiraling: a server that tries
+ * to catch up on work it can't finish only falls further behind.
+ *
+ * This is the JavaScript equivalent of an accumulator-based
+ * requestAnimationFrame loop with a clamp on the accumulated time.
+ */
+
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <stdint.h>
+
+// Default limit on ticks run back-to-back when behind
+#define TICK_DEFAULT_MAX_CATCHUP 4
+
+/**
+ * TickScheduler - Deadline bookkeeping plus timing statistics
+ *
+ * All times are nanoseconds on CLOCK_MONOTONIC.
+ */
+typedef struct {
+    uint64_t period_ns;         // Length of one tick
+    uint64_t next_deadline_ns;  // When the next tick is due
+    int max_catchup;            // Most ticks run back-to-back
+
+    // Per-tick timing (updated by tick_scheduler_end_work)
+    uint64_t work_start_ns;     // Set by tick_scheduler_begin_work
+    uint64_t last_work_ns;      // How long the last tick's work took
+    int64_t last_slack_ns;      // Time left before the next deadline (<0 = late)
+
+    // Totals since init (or since the last tick_scheduler_take_window)
+    uint64_t ticks;             // Ticks actually run
+    uint64_t overruns;          // Ticks that finished after the next deadline
+    uint64_t skipped;           // Ticks dropped because catch-up was capped
+    uint64_t total_work_ns;
+    uint64_t max_work_ns;
+    int64_t min_slack_ns;
+    uint64_t window_start_ns;   // Start of the current statistics window
+} TickScheduler;
+
+/**
+ * TickStats - Summary of one statistics window
+ */
+typedef struct {
+    double rate_hz;             // Ticks run per second of wall time
+    double avg_work_ms;
+    double max_work_ms;
+    double min_slack_ms;
+    uint64_t ticks;
+    uint64_t overruns;
+    uint64_t skipped;
+} TickStats;
+
+/**
+ * tick_now_ns - Read the monotonic clock
+ *
+ * @return  Nanoseconds since an arbitrary fixed point (never jumps)
+ */
+uint64_t tick_now_ns(void);
+
+/**
+ * tick_scheduler_init - Start ticking at 'tick_rate' Hz from now
+ *
+ * @param sched        Scheduler to initialize
+ * @param tick_rate    Ticks per second
+ * @param max_catchup  Most ticks to run back-to-back when behind (>= 1)
+ */
+void tick_scheduler_init(TickScheduler* sched, int tick_rate, int max_catchup);
+
+/**
+ * tick_scheduler_reset - Forget missed deadlines (e.g. after idling)
+ *
+ * The next tick becomes due one period from now. If no ticks have run
+ * in the current statistics window, the window restarts as well.
+ *
+ * @param sched  The scheduler
+ */
+void tick_scheduler_reset(TickScheduler* sched);
+
+/**
+ * tick_scheduler_timeout_ms - Milliseconds until the next deadline
+ *
+ * Rounded DOWN, so it is safe to pass to net_reactor_wait() and then
+ * finish with tick_scheduler_sleep() for the sub-millisecond remainder.
+ *
+ * @param sched  The scheduler
+ * @return       0 if the deadline has passed, else whole ms remaining
+ */
+int tick_scheduler_timeout_ms(const TickScheduler* sched);
+
+/**
+ * tick_scheduler_sleep - Sleep until the next deadline
+ *
+ * Returns immediately if the deadline has already passed.
+ *
+ * @param sched  The scheduler
+ */
+void tick_scheduler_sleep(const TickScheduler* sched);
+
+/**
+ * tick_scheduler_due - How many ticks should run right now?
+ *
+ * Advances the deadline past every tick it reports. Ticks beyond
+ * max_catchup are dropped and counted in 'skipped'.
+ *
+ * @param sched  The scheduler
+ * @return       0 if the next deadline is still in the future,
+ *               else 1..max_catchup
+ */
+int tick_scheduler_due(TickScheduler* sched);
+
+/**
+ * tick_scheduler_begin_work - Mark the start of one tick's work
+ *
+ * @param sched  The scheduler
+ */
+void tick_scheduler_begin_work(TickScheduler* sched);
+
+/**
+ * tick_scheduler_end_work - Mark the end of one tick's work
+ *
+ * Records work time and slack, and counts an overrun if the work
+ * finished after the next deadline.
+ *
+ * @param sched  The scheduler
+ */
+void tick_scheduler_end_work(TickScheduler* sched);
+
+/**
+ * tick_scheduler_take_window - Summarize and reset the statistics window
+ *
+ * @param sched  The scheduler
+ * @param out    Filled with the window's statistics
+ */
+void tick_scheduler_take_window(TickScheduler* sched, TickStats* out);
+
+#endif // TICK_SCHEDULER_H
@@ -0,0 +1,289 @@
+/**
+ * wire.h - Bit-Packed, Quantized Message Encoding
+ *
+ * CONCEPT: Send Bits, Not Structs
+ * ===============================
+ * A PlayerState as a packed struct is 21 bytes: four 32-bit floats for
+ * position and velocity, although nobody can see the difference
+ * between x = 412.3871 and x = 412.375. We know the RANGE of every
+ * field, so we only need as many bits as that range and the precision
+ * we care about require:
+ *
+ *     field              range                      precision    bits
+ *     ─────────────────  ─────────────────────────  ───────────  ────
+ *     x, y               screen ± WIRE_POS_MARGIN   1/16 px       14
+ *     player vx, vy      ±PLAYER_SPEED              ~0.15 px/s    12
+ *     bullet vx, vy      ±WIRE_BULLET_SPEED_MAX     ~0.4 px/s     12
+ *     health             0..255                     1              8
+ *     weapon             0..3                       1              2
+ *
+ * Positions are FIXED-POINT (value * 16, offset by the margin), so
+ * whole pixels survive exactly. Velocities are scaled symmetrically
+ * around 0, so "standing still" stays exactly 0.
+ *
+ * CONCEPT: Bit Streams
+ * ====================
+ * Fields of 14 or 2 bits don't line up with bytes, so they are written
+ * into a BIT stream: each value is appended right after the previous
+ * one, least significant bit first, and the last byte is padded.
+ *
+ *     x (14 bits)        y (14 bits)        vx (12) ...
+ *     ├──────────────────┼──────────────────┼───────────
+ *     byte 0   byte 1   byte 2   byte 3   byte 4  ...
+ *
+ * CONCEPT: Varints
+ * ================
+ * Numbers that are USUALLY small but CAN be large (sequence numbers,
+ * ticks, counts, gaps between sorted ids) are written 7 bits at a time
+ * with a "more follows" bit: 100 costs 8 bits, 100000 costs 24.
+ *
+ * The raw-struct encoding (PROTOCOL_VERSION_RAW) is still supported;
+ * the version in MSG_CONNECT decides which one a connection speaks.
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Quantized schema (PROTOCOL_VERSION)
+#define WIRE_POS_FRACTION_BITS 4        // Positions in 1/16 px
+#define WIRE_POS_MARGIN        64       // Off-screen slack on every side (px)
+#define WIRE_POS_X_BITS        14       // (GAME_WIDTH  + 2 * margin) * 16 < 2^14
+#define WIRE_POS_Y_BITS        14       // (GAME_HEIGHT + 2 * margin) * 16 < 2^14
+#define WIRE_PLAYER_VEL_BITS   12       // ±PLAYER_SPEED
+#define WIRE_BULLET_SPEED_MAX  800.0f   // Must be >= every *_BULLET_SPEED
+#define WIRE_BULLET_VEL_BITS   12       // ±WIRE_BULLET_SPEED_MAX
+#define WIRE_HEALTH_BITS       8        // Clamped to 0..255
+#define WIRE_WEAPON_BITS       2
+#define WIRE_FLAGS_BITS        8
+#define WIRE_INPUT_FLAGS_BITS  5        // INPUT_UP .. INPUT_FIRE
+
+// Largest encodings (buffer sizes)
+#define WIRE_INPUT_MAX         (sizeof(PlayerInputMsg))  // Raw is the larger one
+#define WIRE_STATE_HEADER_MAX  27       // 3 × 32-bit varint + 4 × 16-bit varint
+
+/**
+ * BitWriter - Appends values of any bit width to a byte buffer
+ *
+ * Writing past the capacity sets 'overflow' instead of writing; check
+ * it once with bits_writer_finish().
+ */
+typedef struct {
+    uint8_t* data;
+    int capacity;           // Bytes available
+    int length;             // Whole bytes written so far
+    uint64_t scratch;       // Bits not yet flushed to data (LSB first)
+    int scratch_bits;
+    int overflow;
+} BitWriter;
+
+/**
+ * BitReader - Reads values back in the order they were written
+ *
+ * Reading past the end sets 'overflow' and returns zeros.
+ */
+typedef struct {
+    const uint8_t* data;
+    int size;
+    int length;             // Whole bytes consumed so far
+    uint64_t scratch;
+    int scratch_bits;
+    int overflow;
+} BitReader;
+
+/**
+ * bits_writer_init - Start writing at the beginning of a buffer
+ *
+ * @param writer    Writer to initialize
+ * @param data      Output buffer
+ * @param capacity  Size of the buffer in bytes
+ */
+void bits_writer_init(BitWriter* writer, uint8_t* data, int capacity);
+
+/**
+ * bits_write - Append the low 'count' bits of 'value'
+ *
+ * @param writer  The writer
+ * @param value   Value to write (higher bits are ignored)
+ * @param count   Number of bits, 1..32
+ */
+void bits_write(BitWriter* writer, uint32_t value, int count);
+
+/**
+ * bits_write_varint - Append a value in 7-bit groups
+ *
+ * @param writer  The writer
+ * @param value   Value to write (8 bits per started group of 7)
+ */
+void bits_write_varint(BitWriter* writer, uint32_t value);
+
+/**
+ * bits_writer_finish - Pad the last byte
+ *
+ * @param writer  The writer
+ * @return        Bytes written, or -1 if the buffer was too small
+ */
+int bits_writer_finish(BitWriter* writer);
+
+/**
+ * bits_reader_init - Start reading at the beginning of a buffer
+ *
+ * @param reader  Reader to initialize
+ * @param data    Encoded bytes
+ * @param size    Number of bytes available
+ */
+void bits_reader_init(BitReader* reader, const uint8_t* data, int size);
+
+/**
+ * bits_read - Read a 'count'-bit value
+ *
+ * @param reader  The reader
+ * @param count   Number of bits, 1..32
+ * @return        The value (0 once past the end)
+ */
+uint32_t bits_read(BitReader* reader, int count);
+
+/**
+ * bits_read_varint - Read a value written by bits_write_varint()
+ *
+ * @param reader  The reader
+ * @return        The value (0 if truncated or longer than 32 bits)
+ */
+uint32_t bits_read_varint(BitReader* reader);
+
+/**
+ * bits_reader_align - Skip the padding up to the next byte
+ *
+ * @param reader  The reader
+ * @return        Bytes consumed so far (offset of whatever follows)
+ */
+int bits_reader_align(BitReader* reader);
+
+/**
+ * wire_encode_input - Encode a PlayerInputMsg payload
+ *
+ * Quantized layout: input flags (5 bits), weapon (2 bits), padding bit,
+ * varint sequence, varint ack_tick + 1 (so STATE_NO_BASELINE is 0).
+ * player_id is not sent - the server knows who the connection is.
+ *
+ * @param input    Message to encode
+ * @param version  PROTOCOL_VERSION or PROTOCOL_VERSION_RAW
+ * @param out      At least WIRE_INPUT_MAX bytes
+ * @return         Payload length
+ */
+int wire_encode_input(const PlayerInputMsg* input, uint8_t version, uint8_t* out);
+
+/**
+ * wire_decode_input - Decode a PlayerInputMsg payload
+ *
+ * @param payload  Message payload
+ * @param length   Payload length
+ * @param version  Protocol version the sender speaks
+ * @param out      Decoded message (player_id is 0 when quantized)
+ * @return         0 on success, -1 if malformed
+ */
+int wire_decode_input(const uint8_t* payload, int length, uint8_t version,
+                      PlayerInputMsg* out);
+
+/**
+ * wire_write_state_header - Encode the fixed part of GameStateMsg
+ *
+ * Quantized layout: varint tick, varint (tick - baseline_tick) with 0
+ * meaning "no baseline", varint your_sequence, the four counts as
+ * varints, padded to a byte. The body follows byte-aligned.
+ *
+ * @param state  Header fields
+ * @param out    At least WIRE_STATE_HEADER_MAX bytes
+ * @return       Bytes written
+ */
+int wire_write_state_header(const GameStateMsg* state, uint8_t* out);
+
+/**
+ * wire_read_state_header - Decode the fixed part of GameStateMsg
+ *
+ * @param payload  Message payload
+ * @param length   Payload length
+ * @param out      Decoded header fields
+ * @return         Offset of the body, or -1 if malformed
+ */
+int wire_read_state_header(const uint8_t* payload, int length, GameStateMsg* out);
+
+/**
+ * wire_player_changes / wire_bullet_changes - Changed-field mask
+ *
+ * Like comparing the fields, but on their QUANTIZED values: a change
+ * smaller than the precision doesn't show on the wire, so it isn't
+ * sent at all.
+ *
+ * @param base  Entity in the baseline
+ * @param now   Entity now
+ * @return      PLAYER_FIELD_* / BULLET_FIELD_* bits that differ
+ */
+uint8_t wire_player_changes(const PlayerState* base, const PlayerState* now);
+uint8_t wire_bullet_changes(const BulletState* base, const BulletState* now);
+
+/**
+ * wire_write_id / wire_read_id - Player or bullet id as a gap
+ *
+ * Ids are sorted, so each one is sent as a varint distance to the
+ * previous id of the same list (prev_id = -1 for the first): a room
+ * with 300 players still spends 8 bits per id, not 16.
+ *
+ * @param prev_id  Previous id in this list, or -1
+ */
+void wire_write_id(BitWriter* writer, uint16_t id, int prev_id);
+uint16_t wire_read_id(BitReader* reader, int prev_id);
+
+/**
+ * wire_write_player - Append one player record
+ *
+ * Layout: player_id gap (varint), NEW (1 bit), field mask (7 bits, only
+ * if not NEW - a new entity has every field), then the masked fields.
+ *
+ * @param writer   The writer
+ * @param ps       Player to write
+ * @param prev_id  Id of the previous player record, or -1
+ * @param mask     STATE_ENTITY_NEW | fields, or changed fields only
+ */
+void wire_write_player(BitWriter* writer, const PlayerState* ps, int prev_id, uint8_t mask);
+
+/**
+ * wire_read_player - Read one player record
+ *
+ * @param reader   The reader
+ * @param prev_id  Id of the previous player record, or -1
+ * @param out      player_id and the masked fields are filled in
+ * @return         The record's mask (same meaning as for writing)
+ */
+uint8_t wire_read_player(BitReader* reader, int prev_id, PlayerState* out);
+
+/**
+ * wire_write_bullet - Append one bullet record
+ *
+ * Layout: id gap (varint), NEW (1 bit), field mask (6 bits, only if not
+ * NEW), then the masked fields.
+ *
+ * @param writer   The writer
+ * @param id       Bullet id
+ * @param prev_id  Id of the previous bullet record, or -1
+ * @param bs       Bullet to write
+ * @param mask     STATE_ENTITY_NEW | fields, or changed fields only
+ */
+void wire_write_bullet(BitWriter* writer, uint16_t id, int prev_id,
+                       const BulletState* bs, uint8_t mask);
+
+/**
+ * wire_read_bullet - Read one bullet record
+ *
+ * @param reader   The reader
+ * @param prev_id  Id of the previous bullet record, or -1
+ * @param id       Receives the bullet id
+ * @param out      Masked fields are filled in
+ * @return         The record's mask
+ */
+uint8_t wire_read_bullet(BitReader* reader, int prev_id, uint16_t* id, BulletState* out);
+
+#endif // WIRE_H
@@ -0,0 +1,42 @@
+/**
+ * world_history.c - Per-Tick Ring of Player Positions
+ *
+ * See world_history.h for how lag compensation uses it.
+ */
+
+#include "world_history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * world_history_init - Zeroed rows, every slot's life starting at tick 0
+ */
+int world_history_init(WorldHistory* history, int max_players) {
+    memset(history, 0, sizeof(WorldHistory));
+    history->points = calloc((size_t)WORLD_HISTORY_TICKS * max_players, sizeof(HistoryPoint));
+    history->since = calloc((size_t)max_players, sizeof(uint32_t));
+    if (history->points == NULL || history->since == NULL) {
+        world_history_free(history);
+        return -1;
+    }
+    history->max_players = max_players;
+    return 0;
+}
+
+/**
+ * world_history_free - Free both arrays
+ */
+void world_history_free(WorldHistory* history) {
+    free(history->points);
+    free(history->since);
+    memset(history, 0, sizeof(WorldHistory));
+}
+
+/**
+ * world_history_restart - Write the position, cut off everything older
+ */
+void world_history_restart(WorldHistory* history, int slot, uint32_t tick, float x, float y) {
+    world_history_row(history, tick)[slot] = (HistoryPoint){ x, y };
+    history->since[slot] = tick;
+}
@@ -0,0 +1,136 @@
+/**
+ * world_history.h - Where Every Player Was, Tick by Tick (Lag Compensation)
+ *
+ * CONCEPT: The Shooter Aims at the Past
+ * =====================================
+ * A client draws the newest snapshot it has. That snapshot left the
+ * server half a round trip ago, and the shot it triggers arrives half a
+ * round trip later - so by the time the server sees FIRE, every target
+ * has moved on by one full RTT:
+ *
+ *     tick 100   server sends snapshot 100 ──┐
+ *                                             │ RTT/2
+ *     tick 103   client draws 100, fires ◀───┘
+ *                     │ RTT/2
+ *     tick 106   server gets the input ◀──┘   target is 6 ticks further
+ *
+ * At 300 px/s, 6 ticks is 30 px: a laser that was dead on target on the
+ * shooter's screen flies through empty space on the server.
+ *
+ * LAG COMPENSATION tests the shot against the world the shooter SAW.
+ * Every input carries 'ack_tick', the newest snapshot the client had;
+ * input tick - ack_tick is the shooter's lag in ticks (RTT plus however
+ * long the client sat on the snapshot). Each bullet remembers the lag of
+ * the player who fired it, and its hit test puts the targets back where
+ * they were that many ticks ago.
+ *
+ * CONCEPT: A Ring of Rows
+ * =======================
+ * The server keeps the last WORLD_HISTORY_TICKS ticks of player
+ * positions in one array, a row per tick:
+ *
+ *                    slot 0    slot 1    slot 2    slot 3
+ *     row  0  (t=96) [x,y]     [x,y]     [x,y]     [x,y]
+ *     row  1  (t=97) [x,y]     [x,y]     [x,y]     [x,y]
+ *     ...
+ *     row 10 (t=106) [x,y]  ◀─ this tick (tick & 15)
+ *     row 11  (t=91) [x,y]  ◀─ oldest, overwritten next tick
+ *
+ * The row of tick t is t % WORLD_HISTORY_TICKS (a mask, it's a power of
+ * two), so "where was player p at tick t" is one multiply-add: O(1), no
+ * search, and nothing is allocated after init. Memory is fixed at
+ * WORLD_HISTORY_TICKS × max_players × 8 bytes (512 bytes for 4
+ * players, 32 KB for 256). A whole row is contiguous, so rewinding
+ * everyone to one tick reads adjacent memory.
+ *
+ * CONCEPT: Don't Rewind Through a Respawn
+ * =======================================
+ * A player that joined or was shot down at tick s has no past before s
+ * (or rather, a past that belongs to its previous life). 'since' holds
+ * s per slot, and lookups are clamped to it - so a shot aimed at the
+ * spot where someone died never damages their fresh respawn.
+ *
+ * The rewind is capped (GameServer.max_rewind, at most
+ * WORLD_HISTORY_MAX_REWIND): a client claiming a huge lag - honest or
+ * not - can't shoot far into the past.
+ */
+
+#ifndef WORLD_HISTORY_H
+#define WORLD_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Ticks of history kept (a power of two; 16 ticks = 267 ms at 60 Hz)
+#define WORLD_HISTORY_TICKS 16
+#define WORLD_HISTORY_MASK  (WORLD_HISTORY_TICKS - 1)
+
+// Deepest rewind the ring can answer (the rest is this tick)
+#define WORLD_HISTORY_MAX_REWIND (WORLD_HISTORY_TICKS - 1)
+
+/**
+ * HistoryPoint - One player's position at one tick
+ */
+typedef struct {
+    float x, y;
+} HistoryPoint;
+
+/**
+ * WorldHistory - Player positions of the last WORLD_HISTORY_TICKS ticks
+ */
+typedef struct {
+    HistoryPoint* points;   // WORLD_HISTORY_TICKS rows of max_players
+    uint32_t* since;        // Per slot: first tick of its current life
+    int max_players;
+} WorldHistory;
+
+/**
+ * world_history_init - Allocate the ring
+ *
+ * @param history      History to initialize
+ * @param max_players  Slots per row
+ * @return             0 on success, -1 if out of memory
+ */
+int world_history_init(WorldHistory* history, int max_players);
+
+/**
+ * world_history_free - Release the ring
+ *
+ * @param history  History to free
+ */
+void world_history_free(WorldHistory* history);
+
+/**
+ * world_history_row - The row of 'tick' (write this tick's positions here)
+ */
+static inline HistoryPoint* world_history_row(WorldHistory* history, uint32_t tick) {
+    return &history->points[(size_t)(tick & WORLD_HISTORY_MASK) * history->max_players];
+}
+
+/**
+ * world_history_restart - A slot's past begins now (join, respawn)
+ *
+ * @param history  The history
+ * @param slot     Player slot
+ * @param tick     Current tick
+ * @param x, y     Position at 'tick'
+ */
+void world_history_restart(WorldHistory* history, int slot, uint32_t tick, float x, float y);
+
+/**
+ * world_history_at - Where 'slot' was 'rewind' ticks before 'now'
+ *
+ * @param history  The history ('now' must be recorded already)
+ * @param slot     Player slot
+ * @param now      Current tick
+ * @param rewind   Ticks back, 0 .. WORLD_HISTORY_MAX_REWIND
+ * @return         The position (clamped to the slot's current life)
+ */
+static inline HistoryPoint world_history_at(const WorldHistory* history, int slot,
+                                            uint32_t now, int rewind) {
+    uint32_t tick = now - (uint32_t)rewind;
+    if ((int32_t)(tick - history->since[slot]) < 0) tick = history->since[slot];
+    return history->points[(size_t)(tick & WORLD_HISTORY_MASK) * history->max_players + slot];
+}
+
+#endif // WORLD_HISTORY_H
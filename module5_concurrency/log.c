@@ -0,0 +1,475 @@
+/**
+ * log.c - Per-Thread Record Rings and the Formatter Thread
+ *
+ * See log.h for the design.
+ */
+
+// clock_gettime()/usleep() under -std=c11 (must come before any #include)
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "log.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(LogRecord) == 192, "LogRecord should stay three cache lines");
+_Static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0,
+               "LOG_RING_RECORDS must be a power of two");
+
+// args[] value of a %s whose bytes didn't fit into 'text'
+#define LOG_TEXT_NONE LOG_TEXT_BYTES
+
+/**
+ * LogRing - One thread's records (single producer, single consumer)
+ *
+ * head, tail and dropped each get their own cache line so the producer
+ * and the formatter never write to the same one.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head;     // Next slot to fill (producer)
+    _Alignas(64) _Atomic uint32_t tail;     // Next slot to format (formatter)
+    _Alignas(64) _Atomic uint64_t dropped;  // Records lost to a full ring (producer)
+    LogRecord records[LOG_RING_RECORDS];
+} LogRing;
+
+static struct {
+    FILE* out;
+    uint64_t start_ns;
+    pthread_t thread;
+    _Atomic int running;                    // Records go to the rings
+    _Atomic int stopping;                   // Formatter: drain and exit
+
+    pthread_mutex_t register_lock;
+    LogRing* rings[LOG_MAX_THREADS];
+    _Atomic int ring_count;
+    _Atomic uint64_t unringed_dropped;      // Threads past LOG_MAX_THREADS
+
+    uint64_t dropped_reported;              // Formatter only
+} g_log = { .register_lock = PTHREAD_MUTEX_INITIALIZER };
+
+// The calling thread's ring (NULL until it first logs)
+static _Thread_local LogRing* t_ring = NULL;
+
+static const char* const g_level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+/**
+ * log_now_ns - CLOCK_MONOTONIC in nanoseconds
+ */
+static uint64_t log_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * log_level_name - "INFO" etc. (clamped)
+ */
+static const char* log_level_name(int level) {
+    if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+    return g_level_names[level];
+}
+
+// ============================================================================
+// CONVERSION SPECS
+// ============================================================================
+//
+// The producer and the formatter walk the same format string with the
+// same parser: the producer to know which type to va_arg() next, the
+// formatter to know which type to hand snprintf().
+
+typedef enum {
+    SPEC_LITERAL,       // %%
+    SPEC_SIGNED,        // d i c
+    SPEC_UNSIGNED,      // u x X o
+    SPEC_DOUBLE,        // f F e E g G a A
+    SPEC_STRING,        // s
+    SPEC_POINTER,       // p
+    SPEC_UNSUPPORTED    // *, %n, long double, anything else
+} SpecKind;
+
+typedef struct {
+    SpecKind kind;
+    char length;        // 0, 'l', 'L' (ll), 'z', 'j', 't' (h/hh promote to int)
+    int size;           // Characters from '%' to the conversion letter
+} LogSpec;
+
+/**
+ * parse_spec - Parse the conversion starting at 'p' (which is '%')
+ */
+static void parse_spec(const char* p, LogSpec* spec) {
+    const char* start = p++;
+    spec->kind = SPEC_UNSUPPORTED;
+    spec->length = 0;
+
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) p++;
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') p++;
+    }
+
+    if (*p == 'h') {
+        p++;
+        if (*p == 'h') p++;
+    } else if (*p == 'l') {
+        p++;
+        spec->length = 'l';
+        if (*p == 'l') {
+            p++;
+            spec->length = 'L';
+        }
+    } else if (*p == 'z' || *p == 'j' || *p == 't') {
+        spec->length = *p++;
+    }
+
+    switch (*p) {
+        case '%': spec->kind = SPEC_LITERAL; break;
+        case 'd': case 'i': case 'c': spec->kind = SPEC_SIGNED; break;
+        case 'u': case 'x': case 'X': case 'o': spec->kind = SPEC_UNSIGNED; break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A': spec->kind = SPEC_DOUBLE; break;
+        case 's': spec->kind = SPEC_STRING; break;
+        case 'p': spec->kind = SPEC_POINTER; break;
+        default: break;
+    }
+    if (*p != '\0') p++;
+    spec->size = (int)(p - start);
+}
+
+/**
+ * read_integer - va_arg() an integer of the spec's type, widened to 64 bits
+ */
+static uint64_t read_integer(va_list* args, const LogSpec* spec) {
+    int is_signed = (spec->kind == SPEC_SIGNED);
+    switch (spec->length) {
+        case 'l': return is_signed ? (uint64_t)va_arg(*args, long)
+                                   : (uint64_t)va_arg(*args, unsigned long);
+        case 'L': return is_signed ? (uint64_t)va_arg(*args, long long)
+                                   : (uint64_t)va_arg(*args, unsigned long long);
+        case 'z': return (uint64_t)va_arg(*args, size_t);
+        case 'j': return (uint64_t)va_arg(*args, intmax_t);
+        case 't': return (uint64_t)va_arg(*args, ptrdiff_t);
+        default:  return is_signed ? (uint64_t)va_arg(*args, int)
+                                   : (uint64_t)va_arg(*args, unsigned int);
+    }
+}
+
+/**
+ * format_integer - snprintf() a stored integer with its original type
+ */
+static int format_integer(char* out, size_t size, const char* fmt,
+                          const LogSpec* spec, uint64_t value) {
+    int is_signed = (spec->kind == SPEC_SIGNED);
+    switch (spec->length) {
+        case 'l': return is_signed ? snprintf(out, size, fmt, (long)value)
+                                   : snprintf(out, size, fmt, (unsigned long)value);
+        case 'L': return is_signed ? snprintf(out, size, fmt, (long long)value)
+                                   : snprintf(out, size, fmt, (unsigned long long)value);
+        case 'z': return snprintf(out, size, fmt, (size_t)value);
+        case 'j': return snprintf(out, size, fmt, (intmax_t)value);
+        case 't': return snprintf(out, size, fmt, (ptrdiff_t)value);
+        default:  return is_signed ? snprintf(out, size, fmt, (int)value)
+                                   : snprintf(out, size, fmt, (unsigned int)value);
+    }
+}
+
+// ============================================================================
+// PRODUCER
+// ============================================================================
+
+/**
+ * log_ring_get - The calling thread's ring, created on first use
+ *
+ * Registration takes a lock, but only once per thread.
+ */
+static LogRing* log_ring_get(void) {
+    if (t_ring != NULL) return t_ring;
+
+    pthread_mutex_lock(&g_log.register_lock);
+    int count = atomic_load_explicit(&g_log.ring_count, memory_order_relaxed);
+    if (count < LOG_MAX_THREADS) {
+        LogRing* ring = aligned_alloc(64, sizeof(LogRing));
+        if (ring != NULL) {
+            memset(ring, 0, sizeof(LogRing));
+            g_log.rings[count] = ring;
+            // Publish the pointer before the count that makes it visible
+            atomic_store_explicit(&g_log.ring_count, count + 1, memory_order_release);
+            t_ring = ring;
+        }
+    }
+    pthread_mutex_unlock(&g_log.register_lock);
+    return t_ring;
+}
+
+/**
+ * log_capture - Copy the arguments 'format' names into 'record'
+ */
+static void log_capture(LogRecord* record, const char* format, va_list* args) {
+    int count = 0;
+    size_t used = 0;
+
+    for (const char* p = strchr(format, '%'); p != NULL; p = strchr(p, '%')) {
+        LogSpec spec;
+        parse_spec(p, &spec);
+        p += spec.size;
+        if (spec.kind == SPEC_LITERAL) continue;
+        if (spec.kind == SPEC_UNSUPPORTED || count == LOG_MAX_ARGS) break;
+
+        uint64_t value;
+        if (spec.kind == SPEC_DOUBLE) {
+            double d = va_arg(*args, double);
+            memcpy(&value, &d, sizeof(value));
+        } else if (spec.kind == SPEC_POINTER) {
+            value = (uint64_t)(uintptr_t)va_arg(*args, void*);
+        } else if (spec.kind == SPEC_STRING) {
+            const char* s = va_arg(*args, const char*);
+            if (s == NULL) s = "(null)";
+            value = LOG_TEXT_NONE;
+            if (used < LOG_TEXT_BYTES) {
+                size_t room = LOG_TEXT_BYTES - used - 1;
+                size_t length = 0;
+                while (length < room && s[length] != '\0') length++;
+                memcpy(record->text + used, s, length);
+                record->text[used + length] = '\0';
+                value = used;
+                used += length + 1;
+            }
+        } else {
+            value = read_integer(args, &spec);
+        }
+        record->args[count++] = value;
+    }
+
+    record->arg_count = (uint8_t)count;
+    record->text_used = (uint8_t)used;
+}
+
+/**
+ * log_write - Fill the next slot of our ring, or count a drop
+ */
+void log_write(int level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!atomic_load_explicit(&g_log.running, memory_order_acquire)) {
+        // No formatter thread: print it ourselves
+        FILE* out = (g_log.out != NULL) ? g_log.out : stdout;
+        fprintf(out, "%-5s ", log_level_name(level));
+        vfprintf(out, format, args);
+        fputc('\n', out);
+        va_end(args);
+        return;
+    }
+
+    LogRing* ring = log_ring_get();
+    if (ring == NULL) {
+        atomic_fetch_add_explicit(&g_log.unringed_dropped, 1, memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_RECORDS) {
+        // Full: never wait for the formatter
+        uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        atomic_store_explicit(&ring->dropped, dropped + 1, memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+
+    LogRecord* record = &ring->records[head & (LOG_RING_RECORDS - 1)];
+    record->time_ns = log_now_ns();
+    record->format = format;
+    record->level = (uint8_t)level;
+    log_capture(record, format, &args);
+    va_end(args);
+
+    // Publish: the formatter sees the record only after it is complete
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * log_dropped - Sum the per-ring counters
+ */
+uint64_t log_dropped(void) {
+    uint64_t total = atomic_load_explicit(&g_log.unringed_dropped, memory_order_relaxed);
+    int count = atomic_load_explicit(&g_log.ring_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        total += atomic_load_explicit(&g_log.rings[i]->dropped, memory_order_relaxed);
+    }
+    return total;
+}
+
+// ============================================================================
+// FORMATTER
+// ============================================================================
+
+/**
+ * log_format - Turn a record back into the line printf() would have made
+ */
+static void log_format(const LogRecord* record, FILE* out) {
+    char line[512];
+    size_t used = 0;
+    int arg = 0;
+
+    double seconds = (double)(record->time_ns - g_log.start_ns) / 1e9;
+    used += (size_t)snprintf(line, sizeof(line), "[%9.3f] %-5s ",
+                             seconds, log_level_name(record->level));
+
+    const char* p = record->format;
+    while (*p != '\0' && used < sizeof(line) - 1) {
+        if (*p != '%') {
+            line[used++] = *p++;
+            continue;
+        }
+
+        LogSpec spec;
+        parse_spec(p, &spec);
+        if (spec.kind == SPEC_LITERAL) {
+            line[used++] = '%';
+            p += spec.size;
+            continue;
+        }
+        if (spec.kind == SPEC_UNSUPPORTED || arg == record->arg_count) {
+            // Print the rest of the format as it is
+            used += (size_t)snprintf(line + used, sizeof(line) - used, "%s", p);
+            break;
+        }
+
+        char fmt[32];
+        if (spec.size >= (int)sizeof(fmt)) break;
+        memcpy(fmt, p, (size_t)spec.size);
+        fmt[spec.size] = '\0';
+        p += spec.size;
+
+        uint64_t value = record->args[arg++];
+        char* dest = line + used;
+        size_t room = sizeof(line) - used;
+        int written;
+        if (spec.kind == SPEC_DOUBLE) {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            written = snprintf(dest, room, fmt, d);
+        } else if (spec.kind == SPEC_POINTER) {
+            written = snprintf(dest, room, fmt, (void*)(uintptr_t)value);
+        } else if (spec.kind == SPEC_STRING) {
+            const char* s = (value < record->text_used) ? record->text + value : "";
+            written = snprintf(dest, room, fmt, s);
+        } else {
+            written = format_integer(dest, room, fmt, &spec, value);
+        }
+        if (written > 0) used += (size_t)written;
+    }
+
+    if (used > sizeof(line) - 1) used = sizeof(line) - 1;
+    line[used++] = '\n';
+    fwrite(line, 1, used, out);
+}
+
+/**
+ * log_oldest - The ring whose next record is the oldest, or NULL if
+ *              every ring is empty
+ *
+ * Taking records oldest-first merges the threads into one timeline.
+ */
+static LogRing* log_oldest(void) {
+    LogRing* oldest = NULL;
+    uint64_t oldest_ns = 0;
+
+    int count = atomic_load_explicit(&g_log.ring_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        LogRing* ring = g_log.rings[i];
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == head) continue;
+
+        uint64_t time_ns = ring->records[tail & (LOG_RING_RECORDS - 1)].time_ns;
+        if (oldest == NULL || time_ns < oldest_ns) {
+            oldest = ring;
+            oldest_ns = time_ns;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * log_report_drops - One WARN line whenever the drop count has grown
+ */
+static void log_report_drops(FILE* out) {
+    uint64_t dropped = log_dropped();
+    if (dropped == g_log.dropped_reported) return;
+
+    double seconds = (double)(log_now_ns() - g_log.start_ns) / 1e9;
+    fprintf(out, "[%9.3f] %-5s log: %llu records dropped\n", seconds,
+            log_level_name(LOG_LEVEL_WARN),
+            (unsigned long long)(dropped - g_log.dropped_reported));
+    g_log.dropped_reported = dropped;
+}
+
+/**
+ * log_thread_func - Format records until stopped, then drain the rest
+ */
+static void* log_thread_func(void* arg) {
+    (void)arg;
+    FILE* out = g_log.out;
+
+    for (;;) {
+        LogRing* ring = log_oldest();
+        if (ring != NULL) {
+            uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            log_format(&ring->records[tail & (LOG_RING_RECORDS - 1)], out);
+            // Hand the slot back to the producer
+            atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+            continue;
+        }
+
+        // Everything is written: the one place we may block on I/O
+        log_report_drops(out);
+        fflush(out);
+        if (atomic_load_explicit(&g_log.stopping, memory_order_acquire)) break;
+        usleep(LOG_FLUSH_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+/**
+ * log_init - Start the formatter thread
+ */
+int log_init(FILE* out) {
+    g_log.out = (out != NULL) ? out : stdout;
+    g_log.start_ns = log_now_ns();
+    atomic_store(&g_log.stopping, 0);
+
+    if (pthread_create(&g_log.thread, NULL, log_thread_func, NULL) != 0) {
+        return -1;
+    }
+    atomic_store_explicit(&g_log.running, 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * log_shutdown - Send new lines straight to 'out', drain the rings, stop
+ *
+ * The rings are NOT freed: every thread that ever logged still holds
+ * its own in t_ring, which only that thread can clear. They stay
+ * registered until the process exits, so a thread that logs during
+ * shutdown or after a later log_init() writes into live memory (and a
+ * new formatter drains it).
+ */
+void log_shutdown(void) {
+    if (!atomic_load(&g_log.running)) return;
+
+    atomic_store_explicit(&g_log.running, 0, memory_order_release);
+    atomic_store_explicit(&g_log.stopping, 1, memory_order_release);
+    pthread_join(g_log.thread, NULL);
+}
@@ -35,6 +35,8 @@
 #include "shared_state.h"
 #include "network_client.h"
 #include "protocol.h"
+#include "physics.h"
+#include "log.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -59,9 +61,8 @@
 typedef struct {
     Vector2 position;
     Vector2 velocity;
-    float speed;
-    float acceleration;
-    float friction;
+    FixedBody fixed;        // Exact state (PHYSICS_FIXED; position/velocity follow it)
+    float substep_carry;    // Frame time not stepped yet, in substeps (PHYSICS_FIXED)
 
     Weapon weapon;
     int is_thrusting;
@@ -98,13 +99,19 @@ typedef struct {
     SharedState shared;
     int online_mode;
 
-    // Remote players (copied from shared state each frame)
-    RemotePlayer remote_players[MAX_PLAYERS];
+    // Movement math of the offline prediction (match the server's --physics)
+    PhysicsMode physics;
+
+    // Remote players (copied from shared state each frame; the arrays
+    // grow to the server's room size)
+    RemotePlayer* remote_players;
     int remote_player_count;
+    int remote_player_capacity;
 
     // Remote bullets (from other players, copied from shared state)
-    RemoteBullet remote_bullets[MAX_REMOTE_BULLETS];
+    RemoteBullet* remote_bullets;
     int remote_bullet_count;
+    int remote_bullet_capacity;
 
     // Frame stats
     int frame_count;
@@ -145,14 +152,14 @@ static void unload_assets(GameAssets* assets) {
 /**
  * init_local_player - Initialize the local player
  *
- * Uses shared physics constants from protocol.h for consistency with server.
+ * Movement itself is physics.c, shared with the server.
  */
 static void init_local_player(LocalPlayer* player, GameAssets* assets) {
     player->position = (Vector2){ SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT * 0.75f };
     player->velocity = (Vector2){ 0, 0 };
-    player->speed = PLAYER_SPEED;
-    player->acceleration = PLAYER_ACCELERATION;
-    player->friction = PLAYER_FRICTION;
+    player->fixed = (FixedBody){ fixed_from_float(player->position.x),
+                                 fixed_from_float(player->position.y), 0, 0 };
+    player->substep_carry = 0;
 
     player->weapon = weapon_create(WEAPON_SPREAD);
     player->is_thrusting = 0;
@@ -167,43 +174,13 @@ static void init_local_player(LocalPlayer* player, GameAssets* assets) {
  */
 static uint8_t handle_input(LocalPlayer* player, BulletList* bullets) {
     uint8_t input_flags = 0;
-    player->is_thrusting = 0;
-
-    float accel_x = 0, accel_y = 0;
-
-    // Movement
-    if (IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) {
-        accel_y = -1.0f;
-        player->is_thrusting = 1;
-        input_flags |= INPUT_UP;
-    }
-    if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN)) {
-        accel_y = 1.0f;
-        player->is_thrusting = 1;
-        input_flags |= INPUT_DOWN;
-    }
-    if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT)) {
-        accel_x = -1.0f;
-        player->is_thrusting = 1;
-        input_flags |= INPUT_LEFT;
-    }
-    if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) {
-        accel_x = 1.0f;
-        player->is_thrusting = 1;
-        input_flags |= INPUT_RIGHT;
-    }
 
-    // Normalize diagonal
-    if (accel_x != 0 && accel_y != 0) {
-        float inv_sqrt2 = 0.7071f;
-        accel_x *= inv_sqrt2;
-        accel_y *= inv_sqrt2;
-    }
-
-    // Apply acceleration
-    float dt = GetFrameTime();
-    player->velocity.x += accel_x * player->acceleration * dt;
-    player->velocity.y += accel_y * player->acceleration * dt;
+    // Movement (applied by update_local_player / the server)
+    if (IsKeyDown(KEY_W) || IsKeyDown(KEY_UP))    input_flags |= INPUT_UP;
+    if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN))  input_flags |= INPUT_DOWN;
+    if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT))  input_flags |= INPUT_LEFT;
+    if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) input_flags |= INPUT_RIGHT;
+    player->is_thrusting = (input_flags & (INPUT_UP | INPUT_DOWN | INPUT_LEFT | INPUT_RIGHT)) != 0;
 
     // Weapon switching
     if (IsKeyPressed(KEY_ONE)) player->weapon = weapon_create(WEAPON_SPREAD);
@@ -221,36 +198,28 @@ static uint8_t handle_input(LocalPlayer* player, BulletList* bullets) {
 
 /**
  * update_local_player - Update player physics
+ *
+ * The same step the server runs (physics.c). In PHYSICS_FIXED mode the
+ * frame time is turned into whole substeps and the leftover fraction
+ * carried into the next frame, so nothing is lost or counted twice; at
+ * 60 FPS each frame is exactly one server tick.
  */
-static void update_local_player(LocalPlayer* player, float dt) {
-    // Friction
-    float friction = powf(player->friction, dt * 60.0f);
-    player->velocity.x *= friction;
-    player->velocity.y *= friction;
-
-    // Clamp velocity
-    float speed = sqrtf(player->velocity.x * player->velocity.x +
-                        player->velocity.y * player->velocity.y);
-    if (speed > player->speed) {
-        float scale = player->speed / speed;
-        player->velocity.x *= scale;
-        player->velocity.y *= scale;
+static void update_local_player(LocalPlayer* player, uint8_t input_flags, float dt,
+                                PhysicsMode physics) {
+    PhysicsBody body;
+    if (physics == PHYSICS_FIXED) {
+        player->substep_carry += dt * (PHYSICS_TICK_RATE * PHYSICS_SUBSTEPS);
+        int substeps = (int)player->substep_carry;
+        player->substep_carry -= (float)substeps;
+        physics_step_fixed(&player->fixed, input_flags, substeps);
+        fixed_body_to_float(&body, &player->fixed);
+    } else {
+        body = (PhysicsBody){ player->position.x, player->position.y,
+                              player->velocity.x, player->velocity.y };
+        physics_step_float(&body, input_flags, dt);
     }
-
-    // Stop if slow
-    if (fabsf(player->velocity.x) < 1.0f) player->velocity.x = 0;
-    if (fabsf(player->velocity.y) < 1.0f) player->velocity.y = 0;
-
-    // Update position
-    player->position.x += player->velocity.x * dt;
-    player->position.y += player->velocity.y * dt;
-
-    // Clamp to screen
-    float hw = 32, hh = 32;
-    if (player->position.x < hw) { player->position.x = hw; player->velocity.x = 0; }
-    if (player->position.x > SCREEN_WIDTH - hw) { player->position.x = SCREEN_WIDTH - hw; player->velocity.x = 0; }
-    if (player->position.y < hh) { player->position.y = hh; player->velocity.y = 0; }
-    if (player->position.y > SCREEN_HEIGHT - hh) { player->position.y = SCREEN_HEIGHT - hh; player->velocity.y = 0; }
+    player->position = (Vector2){ body.x, body.y };
+    player->velocity = (Vector2){ body.vx, body.vy };
 
     // Update weapon cooldown
     weapon_update(&player->weapon, dt);
@@ -426,6 +395,8 @@ int main(int argc, char* argv[]) {
     const char* host = DEFAULT_HOST;
     uint16_t port = DEFAULT_PORT;
     int online = 0;
+    NetTransport transport = NET_TRANSPORT_TCP;
+    PhysicsMode physics = PHYSICS_FLOAT;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--online") == 0 || strcmp(argv[i], "-o") == 0) {
@@ -436,6 +407,11 @@ int main(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             port = (uint16_t)atoi(argv[++i]);
             online = 1;
+        } else if (strcmp(argv[i], "--udp") == 0) {
+            transport = NET_TRANSPORT_UDP;
+            online = 1;
+        } else if (strcmp(argv[i], "--physics") == 0 && i + 1 < argc) {
+            physics = (strcmp(argv[++i], "fixed") == 0) ? PHYSICS_FIXED : PHYSICS_FLOAT;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("Void Drifter - Module 5: Complete Game\n\n");
             printf("Usage: %s [options]\n\n", argv[0]);
@@ -443,6 +419,8 @@ int main(int argc, char* argv[]) {
             printf("  --online, -o     Connect to server\n");
             printf("  --host HOST      Server address (default: %s)\n", DEFAULT_HOST);
             printf("  --port PORT      Server port (default: %d)\n", DEFAULT_PORT);
+            printf("  --udp            Connect over UDP (server needs --udp)\n");
+            printf("  --physics MODE   Movement math: float (default) or fixed (Q16.16)\n");
             printf("  --help, -h       Show this help\n");
             return 0;
         }
@@ -456,7 +434,12 @@ int main(int argc, char* argv[]) {
     printf("╚════════════════════════════════════════════════════════════╝\n\n");
 
     if (online) {
-        printf("Mode: ONLINE (connecting to %s:%d)\n\n", host, port);
+        printf("Mode: ONLINE (connecting to %s:%d over %s)\n\n", host, port,
+               (transport == NET_TRANSPORT_UDP) ? "UDP" : "TCP");
+        // The network thread logs through the formatter thread, never
+        // blocking on stdout between sends (see log.h)
+        fflush(stdout);
+        log_init(stdout);
     } else {
         printf("Mode: OFFLINE (single player)\n");
         printf("Use --online to connect to a server.\n\n");
@@ -469,6 +452,7 @@ int main(int argc, char* argv[]) {
     // Initialize game state
     GameState game = {0};
     game.online_mode = online;
+    game.physics = physics;
 
     // Load assets
     if (load_assets(&game.assets) != 0) {
@@ -493,7 +477,7 @@ int main(int argc, char* argv[]) {
     if (online) {
         game.net_client = net_client_create();
         if (game.net_client != NULL) {
-            net_client_connect(game.net_client, &game.shared, host, port);
+            net_client_connect(game.net_client, &game.shared, host, port, transport);
         }
     }
 
@@ -520,7 +504,7 @@ int main(int argc, char* argv[]) {
         // In online mode, server is authoritative - use server position directly
         // In offline mode, run local physics
         if (!online) {
-            update_local_player(&game.player, game.delta_time);
+            update_local_player(&game.player, input, game.delta_time, game.physics);
         } else {
             // Still need to update weapon cooldown in online mode for local bullet visuals
             weapon_update(&game.player.weapon, game.delta_time);
@@ -529,8 +513,10 @@ int main(int argc, char* argv[]) {
 
         // Copy remote player and bullet data from shared state
         if (online) {
-            game.remote_player_count = shared_state_copy_players(&game.shared, game.remote_players);
-            game.remote_bullet_count = shared_state_copy_bullets(&game.shared, game.remote_bullets);
+            game.remote_player_count = shared_state_copy_players(&game.shared, &game.remote_players,
+                                                                 &game.remote_player_capacity);
+            game.remote_bullet_count = shared_state_copy_bullets(&game.shared, &game.remote_bullets,
+                                                                 &game.remote_bullet_capacity);
 
             // Use server-authoritative position directly (no prediction)
             float server_x, server_y, server_vx, server_vy;
@@ -567,8 +553,11 @@ int main(int argc, char* argv[]) {
         net_client_disconnect(game.net_client);
         net_client_destroy(game.net_client);
     }
+    log_shutdown();
 
     shared_state_destroy(&game.shared);
+    free(game.remote_players);
+    free(game.remote_bullets);
     bullet_list_destroy(&game.bullets);
     unload_assets(&game.assets);
     CloseWindow();
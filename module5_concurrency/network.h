@@ -18,6 +18,9 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>   // For struct iovec (vectored I/O)
+
+#include "protocol.h"  // For MessageHeader (framing)
 
 // Socket type alias for potential Windows compatibility
 typedef int Socket;
@@ -123,6 +126,123 @@ Socket net_connect_to_server(const char* host, uint16_t port);
  */
 int net_send_all(Socket socket, const void* data, int length);
 
+/**
+ * CONCEPT: Vectored I/O (Scatter/Gather)
+ * ======================================
+ * To send a header and a body that live in different places, we used to
+ * either call send() twice or copy both into one buffer first. sendmsg()
+ * takes a LIST of (pointer, length) pieces instead and sends them as one
+ * contiguous write:
+ *
+ *     struct iovec parts[2] = {
+ *         { header, 13 },      // per-client piece
+ *         { body, 900 }        // shared by every client
+ *     };
+ *     net_send_vectored(sock, parts, 2);   // one syscall, zero copies
+ */
+
+// Most pieces net_send_vectored() accepts in one call
+#define NET_MAX_IOVECS 16
+
+/**
+ * net_send_vectored - Send several buffers as one stream write
+ *
+ * Like net_send_all(), keeps going after partial sends until every
+ * byte of every piece is out.
+ *
+ * @param socket  Socket to send on
+ * @param iov     Pieces to send, in order (not modified)
+ * @param count   Number of pieces (1..NET_MAX_IOVECS)
+ * @return        Total bytes sent, or -1 on error
+ */
+int net_send_vectored(Socket socket, const struct iovec* iov, int count);
+
+/**
+ * CONCEPT: Write-Write-Read and Nagle's Algorithm
+ * ===============================================
+ * By default TCP holds back a small segment while an earlier one is
+ * still unacknowledged (Nagle), hoping to merge it with more data. The
+ * receiver in turn delays its ACK (up to ~40 ms) hoping to piggyback
+ * it on a reply. Sending one message as two writes is the worst case:
+ *
+ *     send(header)   ──▶  goes out, receiver waits for the rest...
+ *     send(payload)  ──▶  held by Nagle until the header is ACKed
+ *                         ...which the receiver delays: +40 ms
+ *
+ * Games want every message out NOW, so every TCP connection here runs
+ * with TCP_NODELAY (net_set_nodelay). That makes each write its own
+ * segment - so a message must also be ONE write, and several messages
+ * due at the same moment should be one write too:
+ *
+ *     NetBatch batch;
+ *     net_batch_begin(&batch, sock, 0);
+ *     net_batch_add(&batch, MSG_CONNECT_ACK, &ack, sizeof(ack));
+ *     net_batch_add(&batch, MSG_PONG, &pong, sizeof(pong));
+ *     net_batch_flush(&batch);             // one sendmsg() for both
+ *
+ * A batch holds NET_BATCH_MESSAGES messages (header + payload = two
+ * iovecs each) and flushes by itself when full. With 'cork' set, a
+ * batch that needs more than one write corks the socket (TCP_CORK) for
+ * the duration, so the writes leave as full-sized segments rather than
+ * a short one at each boundary; a batch that fits one write never pays
+ * for the extra setsockopt() calls.
+ *
+ * Batches send blocking (like net_send_all): meant for blocking sockets
+ * and small control traffic. Non-blocking connections with a backlog
+ * use a NetSendQueue, which gathers in the same way.
+ */
+
+// Messages a NetBatch holds before it flushes by itself
+#define NET_BATCH_MESSAGES (NET_MAX_IOVECS / 2)
+
+/**
+ * NetBatch - Messages for one connection, sent with one write
+ *
+ * Payloads are NOT copied: they must stay valid until the flush.
+ */
+typedef struct {
+    Socket socket;
+    int cork;                // Cork the socket if the batch overflows
+    int corked;              // ...and it currently is
+    int count;               // Messages waiting
+    int failed;              // A write failed: later ones are skipped
+    int sent;                // Bytes written since net_batch_begin()
+    MessageHeader headers[NET_BATCH_MESSAGES];
+    struct iovec parts[NET_MAX_IOVECS];
+} NetBatch;
+
+/**
+ * net_batch_begin - Start an empty batch
+ *
+ * @param batch   Batch to initialize
+ * @param socket  Connection the messages go to
+ * @param cork    1 to use TCP_CORK when the batch needs several writes
+ */
+void net_batch_begin(NetBatch* batch, Socket socket, int cork);
+
+/**
+ * net_batch_add - Append one framed message
+ *
+ * @param batch    The batch
+ * @param type     Message type (MSG_*)
+ * @param payload  Payload, kept by reference until the flush (NULL if 0)
+ * @param length   Payload bytes
+ * @return         0 on success, -1 if a write has failed
+ */
+int net_batch_add(NetBatch* batch, uint8_t type, const void* payload, int length);
+
+/**
+ * net_batch_flush - Write everything appended, in one sendmsg()
+ *
+ * Also uncorks the socket if the batch corked it. The batch is empty
+ * (and reusable) afterwards.
+ *
+ * @param batch  The batch
+ * @return       Bytes written since net_batch_begin(), or -1 if any
+ *               write failed
+ */
+int net_batch_flush(NetBatch* batch);
+
 /**
  * net_recv_all - Receive exactly N bytes
  *
@@ -167,6 +287,29 @@ void net_close(Socket socket);
  */
 int net_set_nonblocking(Socket socket);
 
+/**
+ * net_set_nodelay - Turn Nagle's algorithm off (TCP_NODELAY)
+ *
+ * Every write leaves immediately instead of waiting for the previous
+ * segment's ACK. See "Write-Write-Read" above.
+ *
+ * @param socket  Connected (or accepted) TCP socket
+ * @return        0 on success, -1 on error
+ */
+int net_set_nodelay(Socket socket);
+
+/**
+ * net_set_cork - Hold back partial segments until uncorked (TCP_CORK)
+ *
+ * While corked, the kernel only sends full segments; uncorking sends
+ * the rest at once. TCP_NOPUSH is the BSD/macOS equivalent.
+ *
+ * @param socket  TCP socket
+ * @param on      1 to cork, 0 to uncork (and send what is held)
+ * @return        0 on success, -1 on error or if unsupported
+ */
+int net_set_cork(Socket socket, int on);
+
 /**
  * net_get_error_string - Get human-readable error message
  *
@@ -184,4 +327,715 @@ const char* net_get_error_string(void);
  */
 char* net_addr_to_string(const struct sockaddr_in* addr, char* buffer, int size);
 
+/**
+ * CONCEPT: The Reactor Pattern
+ * ============================
+ * Polling every socket every tick costs one system call per socket,
+ * even when nothing has arrived:
+ *
+ *     for each player: recv() -> EAGAIN   // 4 players = 4 wasted syscalls
+ *
+ * A reactor flips this around. We register each socket ONCE, then ask
+ * the kernel a single question: "which of these are ready?"
+ *
+ *     net_reactor_add(reactor, sock, NET_EVENT_READ, player);  // once
+ *     n = net_reactor_wait(reactor, events, 64, timeout);      // per tick
+ *     // events[0..n) are the ONLY sockets worth touching
+ *
+ * This is the same idea as Node's event loop (libuv is a reactor!).
+ *
+ * Backends:
+ *     - Linux:  epoll (cost scales with READY sockets, not total sockets)
+ *     - Others: poll() fallback (same API, O(sockets) per wait)
+ */
+
+// Readiness bits reported in NetEvent.events
+#define NET_EVENT_READ  (1 << 0)  // Data (or a new connection) is waiting
+#define NET_EVENT_WRITE (1 << 1)  // Send buffer has room
+#define NET_EVENT_ERROR (1 << 2)  // Hangup or socket error
+
+/**
+ * NetEvent - One ready socket returned by net_reactor_wait()
+ */
+typedef struct {
+    Socket socket;       // The socket that is ready
+    uint32_t events;     // Which NET_EVENT_* conditions are ready
+    void* user_data;     // Pointer given to net_reactor_add()
+} NetEvent;
+
+/**
+ * NetReactor - Opaque readiness multiplexer (epoll/poll wrapper)
+ *
+ * The struct is defined in network.c because its layout depends on
+ * the platform backend.
+ */
+typedef struct NetReactor NetReactor;
+
+/**
+ * net_reactor_create - Create a reactor
+ *
+ * @param max_sockets  Expected number of sockets (a sizing hint, not a cap)
+ * @return             New reactor, or NULL on failure
+ */
+NetReactor* net_reactor_create(int max_sockets);
+
+/**
+ * net_reactor_destroy - Destroy a reactor
+ *
+ * Does NOT close the registered sockets - they belong to the caller.
+ *
+ * @param reactor  Reactor to destroy (NULL is ignored)
+ */
+void net_reactor_destroy(NetReactor* reactor);
+
+/**
+ * net_reactor_add - Start watching a socket
+ *
+ * Readiness is level-triggered: a socket keeps being reported as long as
+ * unread data remains, so it is fine to read only part of it per wakeup.
+ *
+ * @param reactor    The reactor
+ * @param socket     Socket to watch (should be non-blocking)
+ * @param events     NET_EVENT_READ and/or NET_EVENT_WRITE
+ * @param user_data  Returned in NetEvent.user_data (e.g. a ServerPlayer*)
+ * @return           0 on success, -1 on error
+ */
+int net_reactor_add(NetReactor* reactor, Socket socket, uint32_t events, void* user_data);
+
+/**
+ * net_reactor_modify - Change the watched events of a registered socket
+ *
+ * @param reactor    The reactor
+ * @param socket     A socket previously passed to net_reactor_add()
+ * @param events     New NET_EVENT_* mask
+ * @param user_data  New user pointer
+ * @return           0 on success, -1 on error
+ */
+int net_reactor_modify(NetReactor* reactor, Socket socket, uint32_t events, void* user_data);
+
+/**
+ * net_reactor_remove - Stop watching a socket
+ *
+ * IMPORTANT: Call this BEFORE net_close(). Once closed, the descriptor
+ * number can be reused by the next accept().
+ *
+ * @param reactor  The reactor
+ * @param socket   Socket to forget
+ * @return         0 on success, -1 if it was not registered
+ */
+int net_reactor_remove(NetReactor* reactor, Socket socket);
+
+/**
+ * net_reactor_wait - Wait until at least one socket is ready
+ *
+ * @param reactor     The reactor
+ * @param events      Output array of ready sockets
+ * @param max_events  Capacity of 'events'
+ * @param timeout_ms  0 = just check, -1 = wait forever, >0 = milliseconds
+ * @return            Number of events filled in (0 on timeout/signal), -1 on error
+ */
+int net_reactor_wait(NetReactor* reactor, NetEvent* events, int max_events, int timeout_ms);
+
+/**
+ * CONCEPT: Stream Framing
+ * =======================
+ * TCP delivers a stream of bytes, not messages. One recv() can return
+ * half a header, three whole messages, or two and a half:
+ *
+ *     recv #1: [hdr|payload][hdr|pay          <- 1.5 messages
+ *     recv #2: load][hdr|payload]             <- the rest + 1 more
+ *
+ * Reading "one header, then its payload" per wakeup either blocks
+ * (waiting for the rest) or loses sync with the stream (dropping it).
+ *
+ * Instead each connection owns a receive buffer:
+ *     1. net_recv_buffer_fill() reads EVERYTHING the kernel has, in as
+ *        few recv() calls as possible (usually one)
+ *     2. net_recv_buffer_next() hands out complete frames one by one,
+ *        as pointers INTO the buffer (no copying)
+ *     3. A partial frame simply stays in the buffer until more arrives
+ *
+ *     ┌──────────┬────────────────────────┬─────────────┐
+ *     │ consumed │ unread (frames + part) │    free     │
+ *     └──────────┴────────────────────────┴─────────────┘
+ *     0         head                     tail      capacity
+ *
+ * The buffer works like a ring that "unrolls" itself: instead of letting
+ * a frame wrap around the end (which would split its payload in two),
+ * fill() slides the few unread bytes back to offset 0 first. Every frame
+ * is therefore contiguous and can be read in place.
+ */
+
+/**
+ * NetRecvBuffer - Per-connection receive buffer
+ *
+ * The memory is supplied by the caller (e.g. an array inside the
+ * player struct), so the framing layer never allocates.
+ */
+typedef struct {
+    uint8_t* data;       // Caller-owned storage
+    int capacity;        // Size of 'data' (largest frame that fits)
+    int head;            // First unread byte
+    int tail;            // One past the last received byte
+    int peer_closed;     // recv() reported end-of-stream or an error
+} NetRecvBuffer;
+
+/**
+ * NetFrame - One complete message inside a NetRecvBuffer
+ *
+ * 'payload' points into the buffer and stays valid until the next
+ * net_recv_buffer_fill() on the same buffer.
+ */
+typedef struct {
+    MessageHeader header;    // Copy of the message header
+    const uint8_t* payload;  // header.length bytes (unaligned!)
+} NetFrame;
+
+/**
+ * net_recv_buffer_init - Attach a receive buffer to caller storage
+ *
+ * @param buffer    Buffer to initialize
+ * @param storage   Memory to receive into
+ * @param capacity  Size of 'storage' in bytes
+ */
+void net_recv_buffer_init(NetRecvBuffer* buffer, uint8_t* storage, int capacity);
+
+/**
+ * net_recv_buffer_fill - Read everything that is waiting on a socket
+ *
+ * Never blocks, even on a blocking socket (uses MSG_DONTWAIT).
+ * Invalidates payload pointers of previously returned frames.
+ *
+ * If the peer hangs up after sending data, that data is returned first;
+ * the NEXT call reports the disconnect. Drain frames before giving up.
+ *
+ * @param socket  Socket to read from
+ * @param buffer  The connection's receive buffer
+ * @return        Bytes read (0 = nothing waiting), or -1 if the
+ *                connection is closed or broken
+ */
+int net_recv_buffer_fill(Socket socket, NetRecvBuffer* buffer);
+
+/**
+ * net_recv_buffer_append - Add bytes that were received elsewhere
+ *
+ * For a backend that reads into its own buffers (net_uring.h): slides
+ * unread bytes to offset 0 if needed, then copies what fits.
+ * Invalidates payload pointers like net_recv_buffer_fill().
+ *
+ * @param buffer  The connection's receive buffer
+ * @param data    Received bytes
+ * @param length  How many
+ * @return        Bytes taken (less than 'length' if the buffer is full)
+ */
+int net_recv_buffer_append(NetRecvBuffer* buffer, const uint8_t* data, int length);
+
+/**
+ * net_recv_buffer_next - Take the next complete frame
+ *
+ * @param buffer  The connection's receive buffer
+ * @param frame   Output: header and a pointer to the payload
+ * @return        1 if a frame was returned, 0 if more bytes are needed,
+ *                -1 if the stream is corrupt (frame larger than the buffer)
+ */
+int net_recv_buffer_next(NetRecvBuffer* buffer, NetFrame* frame);
+
+/**
+ * CONCEPT: Send Queues and Backpressure
+ * =====================================
+ * A non-blocking send() to a client that isn't reading fails with
+ * EAGAIN once the kernel's send buffer is full - or worse, takes HALF a
+ * message, after which the stream is only valid if the other half
+ * follows before anything else. Looping until everything is out would
+ * stall the whole room on one player with bad Wi-Fi.
+ *
+ * So every connection owns a bounded output queue. Sending goes:
+ *
+ *     queue empty?  ── yes ──▶ sendmsg() straight from the caller's
+ *          │                  buffers (zero copy, the common case);
+ *          no                 whatever the kernel didn't take is
+ *          │                  copied into the queue
+ *          ▼
+ *     append to the queue; the owner watches for NET_EVENT_WRITE and
+ *     calls net_send_queue_flush() when the socket has room again
+ *
+ *     ┌──────┬─────────────────────────┬────────────────────┬────────┐
+ *     │ sent │ in flight (must finish) │ newest snapshot    │  free  │
+ *     └──────┴─────────────────────────┴────────────────────┴────────┘
+ *     0     head                     latest            tail   capacity
+ *
+ * The kernel's send buffer is the first stage: bytes only land in OUR
+ * queue once that is full, so a non-empty queue already means the
+ * client is a whole socket buffer behind.
+ *
+ * CONCEPT: Stale Snapshots Are Worthless
+ * ======================================
+ * Snapshots are "latest wins": once tick 12 is queued, tick 11 that
+ * hasn't left yet is just delay. A message pushed with NET_QUEUE_LATEST
+ * replaces the previous NET_QUEUE_LATEST message if not one byte of
+ * that has been sent - so a slow client's backlog is at most one
+ * half-sent message plus the newest snapshot, never a growing pile of
+ * old ones. (Deltas stay valid: each is encoded against the tick the
+ * client ACKED, not the one sent before it.)
+ *
+ * A message that no longer fits returns NET_QUEUE_FULL; the owner
+ * decides whether that's the end of the connection.
+ *
+ * An ASYNC queue (set 'async' after init) never sends by itself: push
+ * only appends, and the owner hands the queued bytes to a backend that
+ * completes sends later (net_uring.h) with net_send_queue_begin_async()
+ * and net_send_queue_end_async(). Bytes in flight are pinned - no
+ * compaction, no superseding - until the send completes.
+ */
+
+// Push flags
+#define NET_QUEUE_LATEST   (1 << 0)  // Superseded by the next LATEST message while unsent
+#define NET_QUEUE_CONTINUE (1 << 1)  // More pieces of the message pushed just before
+
+// net_send_queue_push(): the message doesn't fit in the queue
+#define NET_QUEUE_FULL (-2)
+
+/**
+ * NetSendQueue - Per-connection output queue
+ *
+ * The storage is allocated on first use (most connections never need
+ * it) and released by net_send_queue_free().
+ */
+typedef struct {
+    uint8_t* data;       // NULL until something had to be queued
+    int capacity;        // Most bytes ever queued
+    int head;            // First unsent byte
+    int tail;            // One past the last queued byte
+    int latest;          // Start of the unsent LATEST message (-1 = none)
+    int latest_end;      // One past its last byte
+    uint64_t superseded; // LATEST messages dropped for a newer one
+    int async;           // Push only queues; sends go through begin/end_async
+    int in_flight;       // Async: bytes from 'head' a send is reading
+} NetSendQueue;
+
+/**
+ * net_send_queue_init - Set up an empty queue (allocates nothing)
+ *
+ * @param queue     Queue to initialize
+ * @param capacity  Most bytes it may hold (fit at least two of the
+ *                  largest message)
+ */
+void net_send_queue_init(NetSendQueue* queue, int capacity);
+
+/**
+ * net_send_queue_free - Release the storage (the queue is empty afterwards)
+ *
+ * @param queue  Queue to free
+ */
+void net_send_queue_free(NetSendQueue* queue);
+
+/**
+ * net_send_queue_pending - Bytes waiting for the socket to accept them
+ */
+static inline int net_send_queue_pending(const NetSendQueue* queue) {
+    return queue->tail - queue->head;
+}
+
+/**
+ * net_send_queue_push - Send one message (or queue what can't go out now)
+ *
+ * Never blocks. Bytes are sent in push order; nothing is sent directly
+ * while older bytes are still queued (an async queue never sends
+ * directly).
+ *
+ * @param queue   The connection's queue
+ * @param socket  Socket to send on
+ * @param iov     Pieces of the message, in order (not modified)
+ * @param count   Number of pieces (1..NET_MAX_IOVECS)
+ * @param flags   NET_QUEUE_* bits
+ * @return        Bytes sent or queued, -1 on a socket error,
+ *                NET_QUEUE_FULL if the message doesn't fit (part of it
+ *                may be sent already: close the connection)
+ */
+int net_send_queue_push(NetSendQueue* queue, Socket socket,
+                        const struct iovec* iov, int count, int flags);
+
+/**
+ * net_send_queue_flush - Send as much of the queue as the socket takes
+ *
+ * Call when the socket is writable (NET_EVENT_WRITE).
+ *
+ * @param queue   The connection's queue
+ * @param socket  Socket to send on
+ * @return        Bytes still pending (0 = drained, stop watching for
+ *                NET_EVENT_WRITE), or -1 on a socket error
+ */
+int net_send_queue_flush(NetSendQueue* queue, Socket socket);
+
+/**
+ * net_send_queue_begin_async - Pin the next bytes for an asynchronous send
+ *
+ * Only call with nothing in flight. Hands out everything before an
+ * unsent LATEST message (so that one can still be superseded), or all
+ * of it if the queue starts with one.
+ *
+ * @param queue  An async queue
+ * @param data   Output: where the bytes start
+ * @return       How many bytes to send (0 = nothing pending)
+ */
+int net_send_queue_begin_async(NetSendQueue* queue, const uint8_t** data);
+
+/**
+ * net_send_queue_end_async - The asynchronous send completed
+ *
+ * @param queue  An async queue
+ * @param sent   Bytes the send took (the rest is sent again next time;
+ *               0 on an error)
+ */
+void net_send_queue_end_async(NetSendQueue* queue, int sent);
+
+/**
+ * CONCEPT: UDP and Head-of-Line Blocking
+ * ======================================
+ * TCP delivers bytes IN ORDER. If one segment is lost, everything sent
+ * after it waits in the kernel until the retransmission arrives - even
+ * snapshots that are already stale by then:
+ *
+ *     TCP:  snap 10 [lost]  snap 11 [held]  snap 12 [held] ... resend 10
+ *     UDP:  snap 10 [lost]  snap 11 [used]  snap 12 [used]
+ *
+ * Most game traffic is "latest wins" (snapshots, inputs), so only a few
+ * control messages really need ordering and reliability. This layer adds
+ * exactly that on top of UDP datagrams. Every datagram is:
+ *
+ *     ┌──────────────────────── NetUdpHeader (17 bytes) ─────────────────────┐
+ *     │ protocol_id │ connection_id │ sequence │ ack │ ack_bits │ flags │ rseq │
+ *     └──────────────────────────────────────────────────────────────────────┘
+ *     followed by ONE framed message (MessageHeader + payload)
+ *
+ *   - connection_id  Picks the player on the server (0 = not connected yet)
+ *   - sequence       Every packet's number. Unreliable packets older than
+ *                    the newest one received are dropped ("sequenced")
+ *   - ack, ack_bits  "I received packet 'ack', and packet ack-1-i for every
+ *                    set bit i" - 33 packets of history in every header,
+ *                    so one lost ack costs nothing
+ *   - rseq           Reliable messages (MSG_CONNECT, MSG_CONNECT_ACK,
+ *                    MSG_DISCONNECT) are numbered, resent until the packet
+ *                    carrying them is acked, and delivered strictly in order
+ *
+ * Like the rest of the protocol, fields are sent in host byte order.
+ */
+
+// Transport selected on the command line
+typedef enum {
+    NET_TRANSPORT_TCP = 0,
+    NET_TRANSPORT_UDP
+} NetTransport;
+
+#define NET_UDP_PROTOCOL_ID     0x5644  // "VD" - anything else is dropped
+#define NET_UDP_MAX_PACKET      1200    // Stays under common path MTUs
+#define NET_UDP_HEAD_MAX        64      // Per-datagram bytes built by NetUdpSend
+#define NET_UDP_BATCH_SIZE      64      // Datagrams per recvmmsg/sendmmsg
+#define NET_UDP_RELIABLE_WINDOW 8       // Unacked reliable messages per connection
+#define NET_UDP_RELIABLE_MAX    32      // Largest reliable payload (control only)
+#define NET_UDP_RESEND_MS       100     // Resend an unacked reliable message after
+#define NET_UDP_TIMEOUT_MS      5000    // Silence after which a peer is gone
+
+#define NET_UDP_FLAG_RELIABLE   (1 << 0)  // rseq is valid
+#define NET_UDP_FLAG_HAS_ACK    (1 << 1)  // ack/ack_bits are valid
+
+/**
+ * NetUdpHeader - Prefix of every datagram
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t protocol_id;    // NET_UDP_PROTOCOL_ID
+    uint32_t connection_id;  // Assigned by the server
+    uint16_t sequence;       // This packet's number
+    uint16_t ack;            // Newest packet received from the peer
+    uint32_t ack_bits;       // Packets ack-1 .. ack-32 received?
+    uint8_t flags;           // NET_UDP_FLAG_*
+    uint16_t reliable_seq;   // Reliable message number (if FLAG_RELIABLE)
+} NetUdpHeader;
+
+/**
+ * NetUdpReliable - One reliable message waiting for its ack
+ */
+typedef struct {
+    uint8_t message[sizeof(MessageHeader) + NET_UDP_RELIABLE_MAX];
+    int length;              // Framed size, 0 = slot free
+    uint16_t reliable_seq;
+    uint16_t packet_seq;     // Packet it was last sent in
+    int sent;                // Sent at least once?
+    uint64_t sent_ms;
+} NetUdpReliable;
+
+/**
+ * NetUdpConnection - Sequence/ack state of one UDP peer
+ */
+typedef struct {
+    uint32_t connection_id;
+    struct sockaddr_in addr;     // Where the peer's packets go
+
+    uint16_t local_sequence;     // Next packet number we send
+    uint16_t remote_sequence;    // Newest packet number received
+    uint32_t received_bits;      // History behind remote_sequence
+    int received_any;
+
+    uint16_t reliable_send_seq;  // Next reliable number we assign
+    uint16_t reliable_recv_seq;  // Next reliable number we deliver
+    NetUdpReliable outbox[NET_UDP_RELIABLE_WINDOW];
+
+    uint64_t last_recv_ms;       // For timeouts
+} NetUdpConnection;
+
+/**
+ * NetDatagram - One received datagram (see net_udp_recv_batch)
+ */
+typedef struct {
+    struct sockaddr_in addr;     // Sender
+    int length;
+    uint8_t data[NET_UDP_MAX_PACKET];
+} NetDatagram;
+
+/**
+ * NetUdpSend - One datagram to send: a small owned head plus an
+ * optional shared body that is NOT copied (e.g. a snapshot body
+ * sent to every player)
+ */
+typedef struct {
+    struct sockaddr_in addr;
+    uint8_t head[NET_UDP_HEAD_MAX];
+    int head_length;
+    const void* body;
+    int body_length;
+} NetUdpSend;
+
+/**
+ * NetUdpOutbox - Datagrams collected during a tick, sent in batches
+ */
+typedef struct {
+    Socket socket;
+    NetUdpSend* items;           // Caller-allocated array
+    int count;
+    int capacity;
+    uint64_t dropped;            // Datagrams the kernel refused (total)
+} NetUdpOutbox;
+
+/**
+ * net_time_ms - Monotonic milliseconds (for resends and timeouts)
+ */
+uint64_t net_time_ms(void);
+
+/**
+ * net_syscall_count - Socket system calls made by the calling thread
+ *
+ * Counts the hot-path calls in this file (send/recv and friends, the
+ * reactor's epoll calls, UDP batches) and io_uring_enter() in
+ * net_uring.c. Diff two readings to see what a loop iteration costs.
+ */
+extern _Thread_local uint64_t net_syscall_count;
+
+/**
+ * net_resolve - Turn "host" + port into an address
+ *
+ * @param host  IP address or hostname
+ * @param port  Port number
+ * @param out   Filled with the address
+ * @return      0 on success, -1 if the host can't be resolved
+ */
+int net_resolve(const char* host, uint16_t port, struct sockaddr_in* out);
+
+/**
+ * net_create_udp_socket - Create a non-blocking UDP socket
+ *
+ * @param port  Local port to bind (0 = let the kernel pick one)
+ * @return      Socket, or INVALID_SOCKET on error
+ */
+Socket net_create_udp_socket(uint16_t port);
+
+/**
+ * net_udp_connection_init - Start a fresh connection
+ *
+ * @param conn  Connection to initialize
+ * @param id    Connection id (0 on a client until the server assigns one)
+ * @param addr  Peer address
+ */
+void net_udp_connection_init(NetUdpConnection* conn, uint32_t id, const struct sockaddr_in* addr);
+
+/**
+ * net_udp_connection_accept - Server side: start from a client's MSG_CONNECT
+ *
+ * Records the MSG_CONNECT packet as received (so our first reply acks
+ * it) and as the first reliable message delivered.
+ *
+ * @param conn     Connection to initialize
+ * @param id       Connection id assigned by the server (never 0)
+ * @param addr     Client address
+ * @param connect  Header of the client's MSG_CONNECT packet
+ */
+void net_udp_connection_accept(NetUdpConnection* conn, uint32_t id,
+                               const struct sockaddr_in* addr, const NetUdpHeader* connect);
+
+/**
+ * net_udp_parse_header - Validate and copy out a datagram's header
+ *
+ * @return  0 if the datagram is ours, -1 otherwise
+ */
+int net_udp_parse_header(const uint8_t* packet, int length, NetUdpHeader* out);
+
+/**
+ * net_udp_write_header - Write an unreliable header (uses one sequence)
+ *
+ * @param conn  The connection
+ * @param out   At least sizeof(NetUdpHeader) bytes
+ * @return      Bytes written
+ */
+int net_udp_write_header(NetUdpConnection* conn, uint8_t* out);
+
+/**
+ * net_udp_encode - Build a complete unreliable datagram
+ *
+ * @return  Datagram size, or -1 if it doesn't fit in 'capacity'
+ */
+int net_udp_encode(NetUdpConnection* conn, uint8_t* out, int capacity,
+                   uint8_t type, const void* payload, int length);
+
+/**
+ * net_udp_queue_reliable - Queue a reliable, ordered message
+ *
+ * Nothing is sent yet - net_udp_next_resend() produces the datagram.
+ *
+ * @return  0 on success, -1 if the payload is too big or the window is full
+ */
+int net_udp_queue_reliable(NetUdpConnection* conn, uint8_t type,
+                           const void* payload, int length);
+
+/**
+ * net_udp_next_resend - Build the next reliable datagram that is due
+ *
+ * Due = never sent, or unacked for NET_UDP_RESEND_MS. Call in a loop
+ * until it returns 0.
+ *
+ * @return  Datagram size, or 0 if nothing is due
+ */
+int net_udp_next_resend(NetUdpConnection* conn, uint64_t now_ms, uint8_t* out, int capacity);
+
+/**
+ * net_udp_reliable_pending - Reliable messages not acked yet
+ */
+int net_udp_reliable_pending(const NetUdpConnection* conn);
+
+/**
+ * net_udp_receive - Run one datagram through the sequence/ack layer
+ *
+ * Updates ack history, retires acked reliable messages, and decides
+ * whether the message should be delivered:
+ *     - unreliable: only if it is the newest packet so far
+ *     - reliable:   only if it is the next one in order
+ *
+ * @param frame  Output: the message (payload points into 'packet')
+ * @return       1 = deliver 'frame', 0 = drop
+ */
+int net_udp_receive(NetUdpConnection* conn, const uint8_t* packet, int length,
+                    uint64_t now_ms, NetFrame* frame);
+
+/**
+ * net_udp_recv_batch - Receive up to 'max' waiting datagrams
+ *
+ * Linux: ONE recvmmsg() call for the whole batch. Never blocks.
+ *
+ * @return  Datagrams received (0 if none), -1 on error
+ */
+int net_udp_recv_batch(Socket socket, NetDatagram* out, int max);
+
+/**
+ * net_udp_send_batch - Send many datagrams
+ *
+ * Linux: one sendmmsg() per NET_UDP_BATCH_SIZE datagrams. Datagrams the
+ * kernel refuses (e.g. full socket buffer) are dropped - it's UDP.
+ *
+ * @return  Datagrams actually sent
+ */
+int net_udp_send_batch(Socket socket, const NetUdpSend* items, int count);
+
+/**
+ * net_udp_outbox_add - Reserve the next datagram in an outbox
+ *
+ * Flushes first if the outbox is full.
+ *
+ * @return  Datagram to fill in (head_length = 0, no body)
+ */
+NetUdpSend* net_udp_outbox_add(NetUdpOutbox* outbox, const struct sockaddr_in* addr);
+
+/**
+ * net_udp_outbox_flush - Send everything collected so far
+ *
+ * @return  Datagrams sent
+ */
+int net_udp_outbox_flush(NetUdpOutbox* outbox);
+
+/**
+ * NetLink - A client's connection to the server over either transport
+ *
+ * Hides the TCP/UDP difference from client code:
+ *     - TCP: frames are cut out of the byte stream (NetRecvBuffer)
+ *     - UDP: each datagram carries one frame; MSG_CONNECT/MSG_DISCONNECT
+ *            are sent reliably, everything else is unreliable-sequenced
+ *
+ * UDP NOTE: the server answers MSG_CONNECT from the socket of the worker
+ * thread that will host us (a different port). The link switches to
+ * whatever address the MSG_CONNECT_ACK came from.
+ */
+typedef struct {
+    NetTransport transport;
+    Socket socket;
+    NetRecvBuffer recv_buf;      // TCP: stream buffer, UDP: one datagram
+    NetUdpConnection udp;
+} NetLink;
+
+/**
+ * net_link_open - Connect to the server
+ *
+ * @param link       Link to open
+ * @param transport  NET_TRANSPORT_TCP or NET_TRANSPORT_UDP
+ * @param host       Server address
+ * @param port       Server port
+ * @param storage    Receive memory (at least NET_UDP_MAX_PACKET bytes)
+ * @param capacity   Size of 'storage'
+ * @return           0 on success, -1 on error
+ */
+int net_link_open(NetLink* link, NetTransport transport, const char* host, uint16_t port,
+                  uint8_t* storage, int capacity);
+
+/**
+ * net_link_send - Send one message
+ *
+ * @param reliable  UDP: resend until acked (control messages only);
+ *                  TCP: ignored - everything is reliable
+ * @return          0 on success, -1 on error
+ */
+int net_link_send(NetLink* link, uint8_t type, const void* payload, int length, int reliable);
+
+/**
+ * net_link_poll - Get the next received message, if any
+ *
+ * Never blocks. Also drives UDP resends and timeouts. The payload
+ * stays valid until the next call.
+ *
+ * @return  1 = 'frame' filled, 0 = nothing yet, -1 = connection lost
+ */
+int net_link_poll(NetLink* link, NetFrame* frame);
+
+/**
+ * net_link_wait - Sleep until data arrives or 'timeout_ms' passes
+ */
+void net_link_wait(NetLink* link, int timeout_ms);
+
+/**
+ * net_link_flush - Wait (up to 'timeout_ms') until reliable messages are acked
+ *
+ * Use before closing so MSG_DISCONNECT really arrives. No-op on TCP.
+ */
+void net_link_flush(NetLink* link, int timeout_ms);
+
+/**
+ * net_link_close - Close the link's socket
+ */
+void net_link_close(NetLink* link);
+
 #endif // NETWORK_H
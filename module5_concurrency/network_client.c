@@ -18,15 +18,22 @@
 #include "network_client.h"
 #include "network.h"
 #include "protocol.h"
+#include "state_decoder.h"
+#include "wire.h"
+#include "log.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
-#include <errno.h>
 
 // How often to send input (in microseconds)
 #define SEND_INTERVAL_US 16667  // ~60Hz
 
+// How long to wait for MSG_CONNECT_ACK, and for MSG_DISCONNECT to be
+// acked when leaving over UDP
+#define CONNECT_TIMEOUT_MS 5000
+#define DISCONNECT_FLUSH_MS 500
+
 /**
  * thread_send_input - Send current input to server
  */
@@ -39,16 +46,14 @@ static void thread_send_input(NetworkClient* client) {
         .player_id = client->player_id,
         .input_flags = flags,
         .weapon_type = weapon_type,
-        .sequence = sequence
-    };
-
-    MessageHeader header = {
-        .type = MSG_PLAYER_INPUT,
-        .length = sizeof(input)
+        .sequence = sequence,
+        .ack_tick = state_decoder_ack(&client->decoder)
     };
+    uint8_t payload[WIRE_INPUT_MAX];
+    int length = wire_encode_input(&input, PROTOCOL_VERSION, payload);
 
-    net_send_all(client->socket, &header, sizeof(header));
-    net_send_all(client->socket, &input, sizeof(input));
+    // Unreliable over UDP: the next input supersedes a lost one
+    net_link_send(&client->link, MSG_PLAYER_INPUT, payload, length, 0);
 
     // Update stats
     shared_state_lock(client->shared);
@@ -56,112 +61,178 @@ static void thread_send_input(NetworkClient* client) {
     shared_state_unlock(client->shared);
 }
 
+/**
+ * thread_apply_state - Publish one MSG_GAME_STATE to SharedState
+ *
+ * The payload is a delta against a snapshot we acked earlier; the
+ * decoder rebuilds the complete world from it (see state_decoder.h).
+ * A MSG_STATE_FRAGMENT only publishes once its last piece is in.
+ */
+static void thread_apply_state(NetworkClient* client, const NetFrame* frame) {
+    const DecodedState* state;
+    if (frame->header.type == MSG_STATE_FRAGMENT) {
+        state = state_decoder_apply_fragment(&client->decoder, frame->payload,
+                                             frame->header.length);
+        if (state == NULL) return;  // More pieces to come (or one was lost)
+    } else {
+        state = state_decoder_apply(&client->decoder, frame->payload, frame->header.length);
+    }
+    if (state == NULL) {
+        LOG_DEBUG("Skipped GameStateMsg (%u bytes): stale or unknown baseline",
+                  frame->header.length);
+        return;
+    }
+
+    // The decoder holds at most the limits the buffers were sized for
+    RemotePlayer* players = client->players;
+    int player_count = state->player_count;
+
+    for (int i = 0; i < player_count; i++) {
+        const PlayerState* ps = &state->players[i];
+        players[i].active = 1;
+        players[i].id = ps->player_id;
+        players[i].x = ps->x;
+        players[i].y = ps->y;
+        players[i].vx = ps->vx;
+        players[i].vy = ps->vy;
+        players[i].health = ps->health;
+        players[i].weapon = ps->weapon;
+    }
+
+    RemoteBullet* bullets = client->bullets;
+    int bullet_count = state->bullet_count;
+
+    for (int i = 0; i < bullet_count; i++) {
+        const BulletState* bs = &state->bullets[i].state;
+        bullets[i].active = 1;
+        bullets[i].owner_id = bs->owner_id;
+        bullets[i].x = bs->x;
+        bullets[i].y = bs->y;
+        bullets[i].vx = bs->vx;
+        bullets[i].vy = bs->vy;
+        bullets[i].weapon_type = bs->weapon_type;
+    }
+
+    shared_state_update_players(client->shared, players, player_count, state->tick);
+    shared_state_update_bullets(client->shared, bullets, bullet_count);
+}
+
+/**
+ * thread_wait_for_ack - Wait for MSG_CONNECT_ACK
+ *
+ * Polls the link (which also resends MSG_CONNECT over UDP) until the
+ * acknowledgement arrives or CONNECT_TIMEOUT_MS passes.
+ *
+ * @return 1 if 'ack' was filled, 0 on timeout or error
+ */
+static int thread_wait_for_ack(NetworkClient* client, ConnectAckMsg* ack) {
+    uint64_t deadline = net_time_ms() + CONNECT_TIMEOUT_MS;
+
+    while (client->running && net_time_ms() < deadline) {
+        NetFrame frame;
+        int result = net_link_poll(&client->link, &frame);
+        if (result < 0) return 0;
+        if (result == 0) {
+            net_link_wait(&client->link, NET_UDP_RESEND_MS);
+            continue;
+        }
+
+        if (frame.header.type != MSG_CONNECT_ACK) {
+            LOG_WARN("Unexpected message type: %d (expected %d)",
+                     frame.header.type, MSG_CONNECT_ACK);
+            return 0;
+        }
+        if (frame.header.length < sizeof(ConnectAckMsg)) {
+            LOG_WARN("Short ack payload: %u bytes", frame.header.length);
+            return 0;
+        }
+        memcpy(ack, frame.payload, sizeof(ConnectAckMsg));
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * network_thread_func - The main thread function
  *
  * LIFECYCLE:
- * 1. Connect to server
- * 2. Wait for connection acknowledgement (BLOCKING - reliable handshake)
- * 3. Switch to non-blocking mode
- * 4. Loop: Send input, receive state
- * 5. Disconnect when running == false
+ * 1. Connect to server (TCP connect, or just open a UDP socket)
+ * 2. Send MSG_CONNECT and wait for MSG_CONNECT_ACK
+ * 3. Loop: Send input, receive state (never blocks)
+ * 4. Send MSG_DISCONNECT when running == false
  */
 static void* network_thread_func(void* arg) {
     NetworkClient* client = (NetworkClient*)arg;
-
-    printf("DEBUG: Network thread starting, connecting to %s:%d\n",
-           client->host, client->port);
+    LOG_DEBUG("Network thread starting, connecting to %s:%d over %s",
+              client->host, client->port,
+              (client->transport == NET_TRANSPORT_UDP) ? "UDP" : "TCP");
 
     // Connect to server
     shared_state_set_status(client->shared, NET_CONNECTING, "Connecting...");
 
-    client->socket = net_connect_to_server(client->host, client->port);
-    if (client->socket < 0) {
-        printf("DEBUG: Failed to connect to server\n");
+    if (net_link_open(&client->link, client->transport, client->host, client->port,
+                      client->recv_storage, sizeof(client->recv_storage)) != 0) {
+        LOG_ERROR("Failed to connect to server");
         shared_state_set_status(client->shared, NET_ERROR, "Failed to connect");
         client->running = 0;
         return NULL;
     }
-    printf("DEBUG: TCP connection established, socket=%d\n", client->socket);
+    LOG_DEBUG("Socket ready, socket=%d", client->link.socket);
 
-    // Send connect request
+    // Send connect request (reliable: resent over UDP until acked)
     ConnectMsg connect_msg = {
         .version = PROTOCOL_VERSION
     };
     strncpy(connect_msg.name, "Player", sizeof(connect_msg.name));
 
-    MessageHeader header = {
-        .type = MSG_CONNECT,
-        .length = sizeof(connect_msg)
-    };
-
-    printf("DEBUG: Sending MSG_CONNECT (header=%lu bytes, payload=%lu bytes)\n",
-           sizeof(header), sizeof(connect_msg));
+    LOG_DEBUG("Sending MSG_CONNECT (payload=%zu bytes)", sizeof(connect_msg));
 
-    int sent1 = net_send_all(client->socket, &header, sizeof(header));
-    int sent2 = net_send_all(client->socket, &connect_msg, sizeof(connect_msg));
-    printf("DEBUG: Sent header=%d, payload=%d\n", sent1, sent2);
-
-    if (sent1 < 0 || sent2 < 0) {
-        printf("DEBUG: Failed to send connect message\n");
+    if (net_link_send(&client->link, MSG_CONNECT, &connect_msg, sizeof(connect_msg), 1) < 0) {
+        LOG_ERROR("Failed to send connect message");
         shared_state_set_status(client->shared, NET_ERROR, "Failed to send connect");
         client->running = 0;
-        net_close(client->socket);
-        client->socket = -1;
+        net_link_close(&client->link);
         return NULL;
     }
 
-    // --- BLOCKING HANDSHAKE ---
-    // Wait for MSG_CONNECT_ACK before going non-blocking
-    // This ensures reliable connection establishment
-    printf("DEBUG: Waiting for MSG_CONNECT_ACK...\n");
-    MessageHeader ack_header;
-    int recv_bytes = net_recv_all(client->socket, &ack_header, sizeof(ack_header));
-    printf("DEBUG: Received ack_header: %d bytes (expected %lu), type=%d\n",
-           recv_bytes, sizeof(ack_header), ack_header.type);
-
-    if (recv_bytes != sizeof(ack_header)) {
-        printf("DEBUG: Failed to receive ack header\n");
+    // --- HANDSHAKE ---
+    // Wait for MSG_CONNECT_ACK before starting the game loop
+    LOG_DEBUG("Waiting for MSG_CONNECT_ACK...");
+    ConnectAckMsg ack;
+    if (!thread_wait_for_ack(client, &ack)) {
+        LOG_ERROR("No MSG_CONNECT_ACK received");
         shared_state_set_status(client->shared, NET_ERROR, "No response from server");
         client->running = 0;
-        net_close(client->socket);
-        client->socket = -1;
-        return NULL;
-    }
-
-    if (ack_header.type != MSG_CONNECT_ACK) {
-        printf("DEBUG: Unexpected message type: %d (expected %d)\n",
-               ack_header.type, MSG_CONNECT_ACK);
-        shared_state_set_status(client->shared, NET_ERROR, "Unexpected response");
-        client->running = 0;
-        net_close(client->socket);
-        client->socket = -1;
+        net_link_close(&client->link);
         return NULL;
     }
+    LOG_DEBUG("Received ack: success=%d, player_id=%d", ack.success, ack.player_id);
 
-    ConnectAckMsg ack;
-    recv_bytes = net_recv_all(client->socket, &ack, sizeof(ack));
-    printf("DEBUG: Received ack payload: %d bytes (expected %lu), success=%d, player_id=%d\n",
-           recv_bytes, sizeof(ack), ack.success, ack.player_id);
-
-    if (recv_bytes != sizeof(ack)) {
-        printf("DEBUG: Failed to receive ack payload\n");
-        shared_state_set_status(client->shared, NET_ERROR, "Incomplete ACK");
+    if (!ack.success) {
+        const char* reason = (ack.reason == 0) ? "Server full" : "Version mismatch";
+        LOG_ERROR("Connection rejected: %s", reason);
+        shared_state_set_status(client->shared, NET_ERROR, reason);
         client->running = 0;
-        net_close(client->socket);
-        client->socket = -1;
+        net_link_close(&client->link);
         return NULL;
     }
 
-    if (!ack.success) {
-        const char* reason = (ack.reason == 0) ? "Server full" : "Version mismatch";
-        printf("DEBUG: Connection rejected: %s\n", reason);
-        shared_state_set_status(client->shared, NET_ERROR, reason);
+    // Size everything that holds players or bullets from the room size
+    // the server announced
+    client->players = malloc((size_t)ack.max_players * sizeof(RemotePlayer));
+    client->bullets = malloc((size_t)ack.max_bullets * sizeof(RemoteBullet));
+    if (client->players == NULL || client->bullets == NULL ||
+        state_decoder_init(&client->decoder, PROTOCOL_VERSION,
+                           ack.max_players, ack.max_bullets) != 0 ||
+        shared_state_set_limits(client->shared, ack.max_players, ack.max_bullets) != 0) {
+        LOG_ERROR("Out of memory for %d players", ack.max_players);
+        shared_state_set_status(client->shared, NET_ERROR, "Out of memory");
         client->running = 0;
-        net_close(client->socket);
-        client->socket = -1;
+        net_link_close(&client->link);
         return NULL;
     }
+    LOG_INFO("Room size: %d players, %d bullets per snapshot",
+             ack.max_players, ack.max_bullets);
 
     // Successfully connected!
     client->player_id = ack.player_id;
@@ -169,115 +240,37 @@ static void* network_thread_func(void* arg) {
     client->shared->my_id = ack.player_id;
     shared_state_unlock(client->shared);
     shared_state_set_status(client->shared, NET_CONNECTED, "Connected!");
-    printf("DEBUG: Successfully connected as player %d\n", client->player_id);
+    LOG_INFO("Successfully connected as player %d", client->player_id);
 
     // NOW make socket non-blocking for the game loop
-    net_set_nonblocking(client->socket);
+    net_set_nonblocking(client->link.socket);
 
     // Main loop
     while (client->running) {
         // --- RECEIVE ---
-        // Try to read without blocking
-        MessageHeader msg_header;
-        int bytes = recv(client->socket, &msg_header, sizeof(msg_header), 0);
-
-        if (bytes == sizeof(msg_header)) {
-            // Got a complete header, read the payload
-            uint8_t payload[BUFFER_SIZE];
-
-            switch (msg_header.type) {
-                case MSG_GAME_STATE: {
-                    // Read the fixed part of GameStateMsg
-                    GameStateMsg state_hdr;
-                    int state_bytes = recv(client->socket, &state_hdr, sizeof(GameStateMsg), 0);
-                    if (state_bytes != sizeof(GameStateMsg)) {
-                        // Partial or no data - skip this frame
-                        if (state_bytes > 0) {
-                            printf("DEBUG: Partial GameStateMsg: got %d, expected %lu\n",
-                                   state_bytes, sizeof(GameStateMsg));
-                        }
-                        break;
-                    }
-                    if (state_bytes == sizeof(GameStateMsg)) {
-                        RemotePlayer players[MAX_PLAYERS];
-                        int player_count = (state_hdr.player_count > MAX_PLAYERS)
-                                           ? MAX_PLAYERS : state_hdr.player_count;
-
-                        int all_received = 1;
-
-                        // Receive player states
-                        for (int i = 0; i < player_count; i++) {
-                            PlayerState ps;
-                            int ps_bytes = recv(client->socket, &ps, sizeof(ps), 0);
-                            if (ps_bytes == sizeof(ps)) {
-                                players[i].active = 1;
-                                players[i].id = ps.player_id;
-                                players[i].x = ps.x;
-                                players[i].y = ps.y;
-                                players[i].vx = ps.vx;
-                                players[i].vy = ps.vy;
-                                players[i].health = ps.health;
-                                players[i].weapon = ps.weapon;
-                            } else {
-                                all_received = 0;
-                                break;
-                            }
-                        }
-
-                        // Receive bullet states
-                        RemoteBullet bullets[MAX_REMOTE_BULLETS];
-                        int bullet_count = (state_hdr.bullet_count > MAX_REMOTE_BULLETS)
-                                           ? MAX_REMOTE_BULLETS : state_hdr.bullet_count;
-
-                        if (all_received) {
-                            for (int i = 0; i < bullet_count; i++) {
-                                BulletState bs;
-                                int bs_bytes = recv(client->socket, &bs, sizeof(bs), 0);
-                                if (bs_bytes == sizeof(bs)) {
-                                    bullets[i].active = 1;
-                                    bullets[i].owner_id = bs.owner_id;
-                                    bullets[i].x = bs.x;
-                                    bullets[i].y = bs.y;
-                                    bullets[i].vx = bs.vx;
-                                    bullets[i].vy = bs.vy;
-                                    bullets[i].weapon_type = bs.weapon_type;
-                                } else {
-                                    all_received = 0;
-                                    break;
-                                }
-                            }
-                        }
-
-                        if (all_received) {
-                            shared_state_update_players(client->shared, players, player_count,
-                                                        state_hdr.tick);
-                            shared_state_update_bullets(client->shared, bullets, bullet_count);
-                        }
-                    }
-                    break;
-                }
-
-                default:
-                    // Skip unknown message
-                    if (msg_header.length > 0 && msg_header.length < BUFFER_SIZE) {
-                        recv(client->socket, payload, msg_header.length, 0);
-                    }
-                    break;
+        // Handle every message that arrived since last time (never
+        // blocks). Over TCP a partial message just waits in the buffer
+        // for the rest of its bytes; over UDP stale snapshots that
+        // arrive late are already dropped by the link.
+        NetFrame frame;
+        int result;
+        while ((result = net_link_poll(&client->link, &frame)) > 0) {
+            if (frame.header.type == MSG_GAME_STATE ||
+                frame.header.type == MSG_STATE_FRAGMENT) {
+                thread_apply_state(client, &frame);
+            } else if (frame.header.type == MSG_DISCONNECT) {
+                result = -1;
+                break;
             }
-        } else if (bytes == 0) {
-            // Connection closed
-            printf("DEBUG: Server closed connection (recv returned 0)\n");
+            // Other message types are skipped - the frame is already consumed
+        }
+
+        if (result < 0) {
+            LOG_WARN("Server closed connection");
             shared_state_set_status(client->shared, NET_DISCONNECTED, "Server closed");
             client->running = 0;
             break;
-        } else if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-            // Actual error
-            printf("DEBUG: recv error: %s (errno=%d)\n", strerror(errno), errno);
-            shared_state_set_status(client->shared, NET_ERROR, "Connection error");
-            client->running = 0;
-            break;
         }
-        // bytes < 0 with EAGAIN/EWOULDBLOCK means no data available - that's fine
 
         // --- SEND ---
         thread_send_input(client);
@@ -286,11 +279,13 @@ static void* network_thread_func(void* arg) {
         usleep(SEND_INTERVAL_US);
     }
 
-    // Cleanup
-    printf("Network thread exiting\n");
-    if (client->socket >= 0) {
-        net_close(client->socket);
-        client->socket = -1;
+    // Cleanup: say goodbye (over UDP the server would otherwise keep
+    // our seat until it times us out)
+    LOG_INFO("Network thread exiting");
+    if (client->link.socket >= 0) {
+        net_link_send(&client->link, MSG_DISCONNECT, NULL, 0, 1);
+        net_link_flush(&client->link, DISCONNECT_FLUSH_MS);
+        net_link_close(&client->link);
     }
 
     return NULL;
@@ -304,7 +299,7 @@ NetworkClient* net_client_create(void) {
     if (client == NULL) return NULL;
 
     memset(client, 0, sizeof(NetworkClient));
-    client->socket = -1;
+    client->link.socket = -1;
     client->running = 0;
 
     return client;
@@ -319,6 +314,10 @@ void net_client_destroy(NetworkClient* client) {
     // Stop thread if running
     net_client_disconnect(client);
 
+    // The thread is gone: its buffers can go too
+    state_decoder_free(&client->decoder);
+    free(client->players);
+    free(client->bullets);
     free(client);
 }
 
@@ -326,12 +325,13 @@ void net_client_destroy(NetworkClient* client) {
  * net_client_connect - Start connection (spawns thread)
  */
 int net_client_connect(NetworkClient* client, SharedState* shared,
-                       const char* host, uint16_t port) {
+                       const char* host, uint16_t port, NetTransport transport) {
     if (client == NULL || shared == NULL || host == NULL) return -1;
 
     // Store connection info
     strncpy(client->host, host, sizeof(client->host) - 1);
     client->port = port;
+    client->transport = transport;
     client->shared = shared;
     client->running = 1;
 
@@ -360,9 +360,8 @@ void net_client_disconnect(NetworkClient* client) {
     }
 
     // Close socket if still open
-    if (client->socket >= 0) {
-        net_close(client->socket);
-        client->socket = -1;
+    if (client->link.socket >= 0) {
+        net_link_close(&client->link);
     }
 }
 
@@ -17,6 +17,11 @@
 #include <pthread.h>
 #include <stdint.h>
 #include "shared_state.h"
+#include "network.h"
+#include "state_decoder.h"
+
+// Receive buffer size: big enough for the largest possible frame
+#define NET_CLIENT_RECV_BUFFER_SIZE (sizeof(MessageHeader) + UINT16_MAX)
 
 // Forward declaration
 typedef struct NetworkClient NetworkClient;
@@ -29,8 +34,9 @@ struct NetworkClient {
     pthread_t thread;
     volatile int running;       // Thread checks this to know when to stop
 
-    // Connection
-    int socket;
+    // Connection (TCP or UDP - see NetLink in network.h)
+    NetTransport transport;
+    NetLink link;
     char host[64];
     uint16_t port;
 
@@ -38,7 +44,18 @@ struct NetworkClient {
     SharedState* shared;
 
     // Our player ID (assigned by server)
-    uint8_t player_id;
+    uint16_t player_id;
+
+    // Snapshots we can apply deltas to (network thread only)
+    StateDecoder decoder;
+
+    // Conversion buffers for SharedState, sized from MSG_CONNECT_ACK
+    // (network thread only)
+    RemotePlayer* players;
+    RemoteBullet* bullets;
+
+    // Receive memory behind link.recv_buf (network thread only)
+    uint8_t recv_storage[NET_CLIENT_RECV_BUFFER_SIZE];
 };
 
 /**
@@ -65,14 +82,15 @@ void net_client_destroy(NetworkClient* client);
  *     2. Handle send/receive in a loop
  *     3. Update SharedState with received data
  *
- * @param client  The client
- * @param shared  Shared state (must outlive the client!)
- * @param host    Server hostname/IP
- * @param port    Server port
- * @return        0 on success, -1 on failure
+ * @param client     The client
+ * @param shared     Shared state (must outlive the client!)
+ * @param host       Server hostname/IP
+ * @param port       Server port
+ * @param transport  NET_TRANSPORT_TCP or NET_TRANSPORT_UDP
+ * @return           0 on success, -1 on failure
  */
 int net_client_connect(NetworkClient* client, SharedState* shared,
-                       const char* host, uint16_t port);
+                       const char* host, uint16_t port, NetTransport transport);
 
 /**
  * net_client_disconnect - Stop the network thread
@@ -0,0 +1,154 @@
+/**
+ * physics.h - Ship Movement, Shared by Server and Client
+ *
+ * The server's authoritative step and the client's prediction step are
+ * the SAME code: both call physics_step_float() or physics_step_fixed(),
+ * so they can't drift apart when one side is edited and the other isn't.
+ *
+ * CONCEPT: Why Float Physics Isn't Reproducible
+ * =============================================
+ * The float step is correct, but "the same inputs give the same result"
+ * only holds on one build on one machine:
+ *
+ *     powf(0.95f, dt * 60)   libm implementations round differently
+ *                            (glibc, musl, MSVC, Apple all may disagree
+ *                            in the last bit)
+ *     sqrtf, a * b + c       compilers may fuse multiply-adds (FMA) or
+ *                            keep x87 80-bit intermediates
+ *     dt                     the client's frame time isn't the server's
+ *                            tick, so the two integrate different curves
+ *
+ * One differing bit is enough: it grows every tick, and two machines
+ * that simulate the same inputs end up in different places.
+ *
+ * CONCEPT: Q16.16 Fixed Point
+ * ===========================
+ * A fixed_t is an int32 counting 1/65536ths:
+ *
+ *     bit 31           16 15            0
+ *        ┌──────────────┬───────────────┐
+ *        │ integer part │   fraction    │    1.5 = 0x00018000
+ *        └──────────────┴───────────────┘
+ *      range ±32768, resolution 0.0000153 (plenty for an 800x600 arena)
+ *
+ * Adding is integer addition. Multiplying widens to 64 bits and divides
+ * by 65536 again. Integer arithmetic is exact and defined by the C
+ * standard, so every compiler on every CPU produces the same bits.
+ * Divisions truncate toward zero, which also keeps a leftward ship
+ * decelerating exactly like a rightward one.
+ *
+ * CONCEPT: Table-Driven Friction
+ * ==============================
+ * Friction is "multiply velocity by 0.95 per 1/60 s", i.e. 0.95^(dt*60)
+ * for a step of dt seconds - the powf() above. The fixed step measures
+ * time in SUBSTEPS (1/16 of a tick) instead of seconds, so there are
+ * only 17 possible exponents, and their results are precomputed
+ * constants in physics.c:
+ *
+ *     substeps   0      1      2     ...   16
+ *     factor  65536  65326  65117    ...  62259   (0.95^(k/16) in Q16.16)
+ *
+ * A longer step is split into whole ticks plus a remainder. The server
+ * always steps exactly one tick (PHYSICS_SUBSTEPS); a client that
+ * steps the same whole ticks with the same inputs gets the same bits,
+ * which is what input-only lockstep needs.
+ *
+ * Which mode a room uses is a server option (--physics fixed); the float
+ * step stays the default.
+ */
+
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Simulation steps per second (the server's TICK_RATE)
+#define PHYSICS_TICK_RATE 60
+
+// Fixed-step time resolution: one tick = this many substeps
+#define PHYSICS_SUBSTEPS 16
+
+/**
+ * fixed_t - Q16.16 fixed-point number
+ */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE   (1 << FIXED_SHIFT)
+
+/**
+ * PhysicsMode - Which step a room runs
+ */
+typedef enum {
+    PHYSICS_FLOAT = 0,      // physics_step_float (dt in seconds)
+    PHYSICS_FIXED = 1       // physics_step_fixed (deterministic)
+} PhysicsMode;
+
+/**
+ * PhysicsBody / FixedBody - What the step moves
+ */
+typedef struct {
+    float x, y;
+    float vx, vy;
+} PhysicsBody;
+
+typedef struct {
+    fixed_t x, y;
+    fixed_t vx, vy;
+} FixedBody;
+
+/**
+ * fixed_from_float / fixed_to_float - Convert (rounding to nearest)
+ *
+ * Only for spawning and display: a float can't hold every Q16.16 value
+ * in this range, so state that must stay exact is kept as fixed_t.
+ */
+static inline fixed_t fixed_from_float(float value) {
+    float scaled = value * (float)FIXED_ONE;
+    return (fixed_t)(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+static inline float fixed_to_float(fixed_t value) {
+    return (float)value / (float)FIXED_ONE;
+}
+
+/**
+ * fixed_mul - Product of two Q16.16 numbers
+ */
+static inline fixed_t fixed_mul(fixed_t a, fixed_t b) {
+    return (fixed_t)(((int64_t)a * b) / FIXED_ONE);
+}
+
+/**
+ * physics_step_float - Move a ship for 'dt' seconds (float math)
+ *
+ * Acceleration from the held INPUT_* directions, frame-rate adjusted
+ * friction, a PLAYER_SPEED cap and the arena bounds.
+ *
+ * @param body         Ship to move
+ * @param input_flags  INPUT_* bits held during the step
+ * @param dt           Step length in seconds
+ */
+void physics_step_float(PhysicsBody* body, uint8_t input_flags, float dt);
+
+/**
+ * physics_step_fixed - Move a ship for 'substeps' / PHYSICS_SUBSTEPS ticks
+ *
+ * Same rules as physics_step_float, in Q16.16 with table-driven
+ * friction: bit-exact on every machine.
+ *
+ * @param body         Ship to move
+ * @param input_flags  INPUT_* bits held during the step
+ * @param substeps     Step length (PHYSICS_SUBSTEPS = one tick; 0 = no-op)
+ */
+void physics_step_fixed(FixedBody* body, uint8_t input_flags, int substeps);
+
+/**
+ * fixed_body_from_float / fixed_body_to_float - Convert a whole body
+ */
+void fixed_body_from_float(FixedBody* out, const PhysicsBody* body);
+void fixed_body_to_float(PhysicsBody* out, const FixedBody* body);
+
+#endif // PHYSICS_H
@@ -33,9 +33,14 @@
 
 // Network configuration
 #define DEFAULT_PORT 8080
-#define MAX_CLIENTS 4
 #define BUFFER_SIZE 1024
 
+// Hard ceilings of the wire format: player ids and bullet ids are 16-bit.
+// The limits a server actually uses are chosen at startup and announced
+// in ConnectAckMsg.
+#define PROTOCOL_MAX_PLAYERS 4096
+#define PROTOCOL_MAX_BULLETS 65536
+
 /**
  * MessageType - Types of messages in our protocol
  *
@@ -52,7 +57,8 @@ typedef enum {
     MSG_PLAYER_INPUT,     // Client sends input state
     MSG_GAME_STATE,       // Server sends world state
     MSG_PING,             // Latency check request
-    MSG_PONG              // Latency check response
+    MSG_PONG,             // Latency check response
+    MSG_STATE_FRAGMENT    // One piece of a MSG_GAME_STATE too big for one frame
 } MessageType;
 
 /**
@@ -124,10 +130,11 @@ typedef struct __attribute__((packed)) {
  * Sent from Client -> Server every frame (or when input changes)
  */
 typedef struct __attribute__((packed)) {
-    uint8_t player_id;   // Which player (for future multiplayer)
+    uint16_t player_id;  // Which player (for future multiplayer)
     uint8_t input_flags; // Bitfield of INPUT_* flags
     uint8_t weapon_type; // Current weapon (0=spread, 1=rapid, 2=laser)
     uint32_t sequence;   // Message sequence number (for ordering)
+    uint32_t ack_tick;   // Newest GameStateMsg tick applied (STATE_NO_BASELINE = none)
 } PlayerInputMsg;
 
 // Weapon types (must match client's WeaponType enum)
@@ -141,7 +148,7 @@ typedef struct __attribute__((packed)) {
  * Part of the game state sent from server to client.
  */
 typedef struct __attribute__((packed)) {
-    uint8_t player_id;   // Player identifier
+    uint16_t player_id;  // Player identifier
     float x, y;          // Position
     float vx, vy;        // Velocity
     int16_t health;      // Current health
@@ -155,30 +162,112 @@ typedef struct __attribute__((packed)) {
  * Part of the game state sent from server to client.
  */
 typedef struct __attribute__((packed)) {
-    uint8_t owner_id;        // Which player fired this bullet
+    uint16_t owner_id;       // Which player fired this bullet
     float x, y;              // Position
     float vx, vy;            // Velocity
     uint8_t weapon_type;     // Type of weapon that created it
 } BulletState;
 
-// Maximum bullets to sync per frame
-#define MAX_SYNC_BULLETS 50
-
 /**
- * GameStateMsg - Server sends current world state to client
+ * GameStateMsg - Server sends the world state to one client
+ *
+ * CONCEPT: Delta Snapshots
+ * ========================
+ * Between two ticks most of the world doesn't change: idle players keep
+ * their position, a bullet keeps its velocity, owner and weapon. So
+ * instead of resending every PlayerState and BulletState in full, the
+ * server encodes the difference to a BASELINE - a snapshot the client
+ * told us it has (PlayerInputMsg.ack_tick):
+ *
+ *     baseline (tick 100)        now (tick 103)          delta
+ *     player 0 (10,10) idle      player 0 (10,10) idle   -
+ *     player 1 (50,80)           player 1 (52,80)        1: mask=X  x=52
+ *     bullet 7 (30,200)          bullet 7 (30,180)       7: mask=Y  y=180
+ *     bullet 9                   -                       remove 9
+ *     -                          bullet 12               12: NEW + all fields
+ *
+ * The client keeps its last few reconstructed snapshots, looks up the
+ * baseline by tick, and applies the delta on top of it. Only ACKED
+ * snapshots are used as baselines, so a lost packet never leaves the
+ * client unable to decode. Without a usable baseline (new client, or the
+ * ack is too old) the server sends a full snapshot: a delta against
+ * "nothing" (baseline_tick = STATE_NO_BASELINE), i.e. every entity NEW.
  *
- * Contains positions of all players and bullets.
+ * Layout after this header in the raw encoding (each field only if its
+ * mask bit is set, in bit order; entities sorted by id - the quantized
+ * encoding keeps this order but packs the fields, see wire.h):
+ *
+ *     player_removals × uint16 player_id
+ *     bullet_removals × uint16 bullet_id
+ *     player_updates  × { uint16 player_id, uint8 mask, fields... }
+ *     bullet_updates  × { uint16 bullet_id, uint8 mask, fields... }
+ *
+ * A big match can produce a message longer than MessageHeader.length
+ * can describe (or than one UDP datagram holds); it is then sent as
+ * MSG_STATE_FRAGMENT pieces instead (see StateFragmentMsg).
  */
 typedef struct __attribute__((packed)) {
-    uint32_t tick;           // Server tick number
-    uint32_t your_sequence;  // Last input sequence server processed
-    uint8_t player_count;    // Number of players in this update
-    uint8_t bullet_count;    // Number of bullets in this update
-    // Followed by player_count * PlayerState, then bullet_count * BulletState
-    // We use a flexible array member for players (bullets follow after)
-    PlayerState players[];   // Array of player states (C99 flexible array)
+    uint32_t tick;            // Server tick number
+    uint32_t baseline_tick;   // Snapshot this is relative to (STATE_NO_BASELINE = full)
+    uint32_t your_sequence;   // Last input sequence server processed
+    uint16_t player_updates;  // Players added or changed
+    uint16_t player_removals; // Players gone since the baseline
+    uint16_t bullet_updates;  // Bullets added or changed
+    uint16_t bullet_removals; // Bullets gone since the baseline
 } GameStateMsg;
 
+// "No baseline": full snapshot / nothing received yet
+#define STATE_NO_BASELINE 0xFFFFFFFFu
+
+// Entity record flag: not in the baseline, all fields follow
+#define STATE_ENTITY_NEW (1 << 7)
+
+// Changed-field bits of a player record (PlayerState fields, in order)
+#define PLAYER_FIELD_X      (1 << 0)  // float
+#define PLAYER_FIELD_Y      (1 << 1)  // float
+#define PLAYER_FIELD_VX     (1 << 2)  // float
+#define PLAYER_FIELD_VY     (1 << 3)  // float
+#define PLAYER_FIELD_HEALTH (1 << 4)  // int16_t
+#define PLAYER_FIELD_WEAPON (1 << 5)  // uint8_t
+#define PLAYER_FIELD_FLAGS  (1 << 6)  // uint8_t
+#define PLAYER_FIELDS_ALL   0x7F
+
+// Changed-field bits of a bullet record (BulletState fields, in order)
+#define BULLET_FIELD_OWNER  (1 << 0)  // uint16_t (raw) / varint (quantized)
+#define BULLET_FIELD_X      (1 << 1)  // float
+#define BULLET_FIELD_Y      (1 << 2)  // float
+#define BULLET_FIELD_VX     (1 << 3)  // float
+#define BULLET_FIELD_VY     (1 << 4)  // float
+#define BULLET_FIELD_WEAPON (1 << 5)  // uint8_t
+#define BULLET_FIELDS_ALL   0x3F
+
+/**
+ * StateFragmentMsg - Header of one MSG_STATE_FRAGMENT
+ *
+ * CONCEPT: Fragmentation
+ * ======================
+ * When a MSG_GAME_STATE payload (state header + body) is too big for one
+ * frame, the server cuts it into pieces and sends each as its own
+ * message:
+ *
+ *     payload:   [ state header | body ..................................... ]
+ *                ├──── piece 0 ────┼──── piece 1 ────┼──── piece 2 ────┤
+ *
+ *     message:   [MessageHeader][StateFragmentMsg][ bytes of piece i ]
+ *
+ * The client appends the pieces of one tick in order and decodes the
+ * payload once the last one arrived. Pieces never arrive out of order
+ * (TCP keeps order; sequenced UDP drops anything older than what it
+ * already delivered), so a gap simply means "this snapshot is lost" -
+ * the client keeps acking the older one and the next delta is built
+ * against that.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t tick;           // Snapshot the piece belongs to
+    uint16_t index;          // Piece number, 0 .. count-1
+    uint16_t count;          // Pieces in this snapshot
+} StateFragmentMsg;
+
 /**
  * ConnectMsg - Client requests to join the game
  */
@@ -192,8 +281,10 @@ typedef struct __attribute__((packed)) {
  */
 typedef struct __attribute__((packed)) {
     uint8_t success;         // 1 = connected, 0 = rejected
-    uint8_t player_id;       // Assigned player ID
+    uint16_t player_id;      // Assigned player ID
     uint8_t reason;          // If rejected, why (0 = full, 1 = version mismatch)
+    uint16_t max_players;    // Most players a snapshot can hold
+    uint16_t max_bullets;    // Most bullets a snapshot can hold (per client)
 } ConnectAckMsg;
 
 /**
@@ -211,21 +302,28 @@ typedef struct __attribute__((packed)) {
 /**
  * Helper macros for message size calculation
  *
- * CONCEPT: sizeof with Flexible Arrays
- * ====================================
- * GameStateMsg has a flexible array member (players[]).
- * sizeof(GameStateMsg) gives the size WITHOUT any array elements.
- * To get total size: sizeof(GameStateMsg) + count * sizeof(PlayerState)
+ * MSG_GAME_STATE has no fixed size: it depends on what changed since
+ * the baseline (see GameStateMsg).
  */
 #define MSG_SIZE_CONNECT        (sizeof(MessageHeader) + sizeof(ConnectMsg))
 #define MSG_SIZE_CONNECT_ACK    (sizeof(MessageHeader) + sizeof(ConnectAckMsg))
 #define MSG_SIZE_PLAYER_INPUT   (sizeof(MessageHeader) + sizeof(PlayerInputMsg))
 #define MSG_SIZE_PING           (sizeof(MessageHeader) + sizeof(PingMsg))
 #define MSG_SIZE_PONG           (sizeof(MessageHeader) + sizeof(PongMsg))
-#define MSG_SIZE_GAME_STATE(n)  (sizeof(MessageHeader) + sizeof(GameStateMsg) + (n) * sizeof(PlayerState))
 
-// Protocol version (increment when making breaking changes)
-#define PROTOCOL_VERSION 1
+/**
+ * Protocol versions (increment when making breaking changes)
+ *
+ * Both encodings carry the same messages and the same delta format:
+ *     PROTOCOL_VERSION      PlayerInputMsg and GameStateMsg bit-packed
+ *                           and quantized (see wire.h)
+ *     PROTOCOL_VERSION_RAW  The packed structs above, copied as-is
+ *
+ * The server speaks whichever one the client's MSG_CONNECT asks for.
+ */
+#define PROTOCOL_VERSION     5
+#define PROTOCOL_VERSION_RAW 4
+#define PROTOCOL_VERSION_SUPPORTED(v) ((v) == PROTOCOL_VERSION || (v) == PROTOCOL_VERSION_RAW)
 
 /**
  * Shared Physics Constants
@@ -237,6 +335,7 @@ typedef struct __attribute__((packed)) {
 #define PLAYER_SPEED        300.0f    // Max velocity
 #define PLAYER_ACCELERATION 800.0f    // How fast we reach max speed
 #define PLAYER_FRICTION     0.95f     // Velocity multiplier per frame (at 60fps)
+#define PLAYER_HALF_SIZE    32.0f     // Ship sprite half-size (bounds and hitbox)
 
 // Screen bounds (for position clamping)
 #define GAME_WIDTH  800
@@ -14,6 +14,7 @@
  */
 
 #include "shared_state.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -37,10 +38,9 @@ int shared_state_init(SharedState* state) {
     state->status = NET_DISCONNECTED;
     snprintf(state->status_message, sizeof(state->status_message), "Not connected");
 
-    // Initialize player slots
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        state->players[i].active = 0;
-    }
+    // No tables until the server tells us its room size
+    state->players = NULL;
+    state->bullets = NULL;
 
     return 0;
 }
@@ -54,10 +54,50 @@ int shared_state_init(SharedState* state) {
 void shared_state_destroy(SharedState* state) {
     if (state == NULL) return;
 
+    free(state->players);
+    free(state->bullets);
+    state->players = NULL;
+    state->bullets = NULL;
+
     // Destroy the mutex
     pthread_mutex_destroy(&state->mutex);
 }
 
+/**
+ * shared_state_set_limits - Allocate the tables for the server's room size
+ *
+ * The new tables are allocated before taking the lock, so the main
+ * thread never waits on malloc.
+ */
+int shared_state_set_limits(SharedState* state, int max_players, int max_bullets) {
+    if (state == NULL) return -1;
+
+    RemotePlayer* players = calloc((size_t)max_players, sizeof(RemotePlayer));
+    RemoteBullet* bullets = calloc((size_t)max_bullets, sizeof(RemoteBullet));
+    if (players == NULL || bullets == NULL) {
+        free(players);
+        free(bullets);
+        return -1;
+    }
+
+    pthread_mutex_lock(&state->mutex);
+
+    RemotePlayer* old_players = state->players;
+    RemoteBullet* old_bullets = state->bullets;
+    state->players = players;
+    state->bullets = bullets;
+    state->max_players = max_players;
+    state->max_bullets = max_bullets;
+    state->player_count = 0;
+    state->bullet_count = 0;
+
+    pthread_mutex_unlock(&state->mutex);
+
+    free(old_players);
+    free(old_bullets);
+    return 0;
+}
+
 /**
  * shared_state_lock - Acquire the mutex
  *
@@ -168,13 +208,13 @@ void shared_state_update_players(SharedState* state, const RemotePlayer* players
 
     pthread_mutex_lock(&state->mutex);
 
-    // Clear all players first
-    for (int i = 0; i < MAX_PLAYERS; i++) {
+    // Clear the players in use first
+    for (int i = 0; i < state->player_count; i++) {
         state->players[i].active = 0;
     }
 
     // Copy new player data
-    int copied = (count > MAX_PLAYERS) ? MAX_PLAYERS : count;
+    int copied = (count > state->max_players) ? state->max_players : count;
     for (int i = 0; i < copied; i++) {
         state->players[i] = players[i];
         state->players[i].active = 1;
@@ -199,15 +239,28 @@ void shared_state_update_players(SharedState* state, const RemotePlayer* players
  *     1. Caller has their own copy (can read without lock)
  *     2. Lock is held briefly (just for memcpy)
  *     3. No risk of stale pointers
+ *
+ * The caller's buffer only grows when the room size changes (once,
+ * after connecting), so normally this is just the memcpy.
  */
-int shared_state_copy_players(SharedState* state, RemotePlayer* out) {
-    if (state == NULL || out == NULL) return 0;
+int shared_state_copy_players(SharedState* state, RemotePlayer** out, int* capacity) {
+    if (state == NULL || out == NULL || capacity == NULL) return 0;
 
     pthread_mutex_lock(&state->mutex);
 
-    // Copy all player data
-    memcpy(out, state->players, sizeof(state->players));
     int count = state->player_count;
+    if (count > *capacity) {
+        RemotePlayer* grown = realloc(*out, (size_t)state->max_players * sizeof(RemotePlayer));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&state->mutex);
+            return 0;
+        }
+        *out = grown;
+        *capacity = state->max_players;
+    }
+
+    // Copy the players in use
+    if (count > 0) memcpy(*out, state->players, (size_t)count * sizeof(RemotePlayer));
 
     pthread_mutex_unlock(&state->mutex);
 
@@ -226,9 +279,9 @@ int shared_state_get_my_position(SharedState* state, float* x, float* y, float*
     pthread_mutex_lock(&state->mutex);
 
     int found = 0;
-    uint8_t my_id = state->my_id;
+    uint16_t my_id = state->my_id;
 
-    for (int i = 0; i < MAX_PLAYERS; i++) {
+    for (int i = 0; i < state->player_count; i++) {
         if (state->players[i].active && state->players[i].id == my_id) {
             if (x)  *x  = state->players[i].x;
             if (y)  *y  = state->players[i].y;
@@ -252,13 +305,13 @@ void shared_state_update_bullets(SharedState* state, const RemoteBullet* bullets
 
     pthread_mutex_lock(&state->mutex);
 
-    // Clear existing bullets
-    for (int i = 0; i < MAX_REMOTE_BULLETS; i++) {
+    // Clear the bullets in use
+    for (int i = 0; i < state->bullet_count; i++) {
         state->bullets[i].active = 0;
     }
 
     // Copy new bullet data
-    int copied = (count > MAX_REMOTE_BULLETS) ? MAX_REMOTE_BULLETS : count;
+    int copied = (count > state->max_bullets) ? state->max_bullets : count;
     for (int i = 0; i < copied; i++) {
         state->bullets[i] = bullets[i];
         state->bullets[i].active = 1;
@@ -271,13 +324,23 @@ void shared_state_update_bullets(SharedState* state, const RemoteBullet* bullets
 /**
  * shared_state_copy_bullets - Copy bullet data for rendering
  */
-int shared_state_copy_bullets(SharedState* state, RemoteBullet* out) {
-    if (state == NULL || out == NULL) return 0;
+int shared_state_copy_bullets(SharedState* state, RemoteBullet** out, int* capacity) {
+    if (state == NULL || out == NULL || capacity == NULL) return 0;
 
     pthread_mutex_lock(&state->mutex);
 
-    memcpy(out, state->bullets, sizeof(state->bullets));
     int count = state->bullet_count;
+    if (count > *capacity) {
+        RemoteBullet* grown = realloc(*out, (size_t)state->max_bullets * sizeof(RemoteBullet));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&state->mutex);
+            return 0;
+        }
+        *out = grown;
+        *capacity = state->max_bullets;
+    }
+
+    if (count > 0) memcpy(*out, state->bullets, (size_t)count * sizeof(RemoteBullet));
 
     pthread_mutex_unlock(&state->mutex);
 
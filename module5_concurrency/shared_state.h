@@ -11,6 +11,10 @@
  *     - Network thread writes to 'server_state'
  *     - Main thread reads from 'local_state'
  *     - Once per frame, we copy server -> local (under lock)
+ *
+ * The player and bullet tables are sized at runtime: the server
+ * announces its room size in MSG_CONNECT_ACK, and the network thread
+ * passes it to shared_state_set_limits() before the first update.
  */
 
 #ifndef SHARED_STATE_H
@@ -20,18 +24,12 @@
 #include <stdint.h>
 #include "raylib.h"
 
-// Maximum players supported
-#define MAX_PLAYERS 4
-
-// Maximum bullets to track
-#define MAX_REMOTE_BULLETS 50
-
 /**
  * RemotePlayer - State of another player received from server
  */
 typedef struct {
     int active;
-    uint8_t id;
+    uint16_t id;
     float x, y;
     float vx, vy;
     int health;
@@ -43,7 +41,7 @@ typedef struct {
  */
 typedef struct {
     int active;
-    uint8_t owner_id;
+    uint16_t owner_id;
     float x, y;
     float vx, vy;
     uint8_t weapon_type;
@@ -68,7 +66,7 @@ typedef enum {
  *     - mutex: The lock that protects all other fields
  *     - status: Current network connection status
  *     - my_id: Our player ID assigned by server
- *     - players: State of all players from server
+ *     - players: State of all players from server (max_players slots)
  *     - server_tick: Last tick number from server
  *     - input_to_send: Input flags to be sent to server
  */
@@ -81,16 +79,18 @@ typedef struct {
     char status_message[64];
 
     // Our identity
-    uint8_t my_id;
+    uint16_t my_id;
 
     // Server-authoritative state
-    RemotePlayer players[MAX_PLAYERS];
+    RemotePlayer* players;
     int player_count;
+    int max_players;
     uint32_t server_tick;
 
     // Bullets from server
-    RemoteBullet bullets[MAX_REMOTE_BULLETS];
+    RemoteBullet* bullets;
     int bullet_count;
+    int max_bullets;
 
     // Client -> Server communication
     uint8_t input_to_send;      // Input flags to send next
@@ -123,6 +123,19 @@ int shared_state_init(SharedState* state);
  */
 void shared_state_destroy(SharedState* state);
 
+/**
+ * shared_state_set_limits - Size the player and bullet tables (thread-safe)
+ *
+ * Called by network thread once MSG_CONNECT_ACK has told it the room
+ * size. Forgets any players and bullets held so far.
+ *
+ * @param state        State to update
+ * @param max_players  ConnectAckMsg.max_players
+ * @param max_bullets  ConnectAckMsg.max_bullets
+ * @return             0 on success, -1 if out of memory
+ */
+int shared_state_set_limits(SharedState* state, int max_players, int max_bullets);
+
 /**
  * shared_state_lock - Acquire the mutex
  *
@@ -200,11 +213,15 @@ void shared_state_update_players(SharedState* state, const RemotePlayer* players
  *
  * Called by main thread to get current player positions.
  *
- * @param state   State to read from
- * @param out     Output array (must be at least MAX_PLAYERS)
- * @return        Number of players copied
+ * The caller's buffer is grown (realloc) when the room is bigger than
+ * it; start with *out = NULL and *capacity = 0, and free(*out) when done.
+ *
+ * @param state     State to read from
+ * @param out       In/out: the caller's array
+ * @param capacity  In/out: entries *out has room for
+ * @return          Number of players copied
  */
-int shared_state_copy_players(SharedState* state, RemotePlayer* out);
+int shared_state_copy_players(SharedState* state, RemotePlayer** out, int* capacity);
 
 /**
  * shared_state_get_my_position - Get local player's server-authoritative position
@@ -236,10 +253,13 @@ void shared_state_update_bullets(SharedState* state, const RemoteBullet* bullets
  *
  * Called by main thread to get current bullet positions.
  *
- * @param state   State to read from
- * @param out     Output array (must be at least MAX_REMOTE_BULLETS)
- * @return        Number of bullets copied
+ * Grows the caller's buffer like shared_state_copy_players().
+ *
+ * @param state     State to read from
+ * @param out       In/out: the caller's array
+ * @param capacity  In/out: entries *out has room for
+ * @return          Number of bullets copied
  */
-int shared_state_copy_bullets(SharedState* state, RemoteBullet* out);
+int shared_state_copy_bullets(SharedState* state, RemoteBullet** out, int* capacity);
 
 #endif // SHARED_STATE_H
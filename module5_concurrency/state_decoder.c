@@ -0,0 +1,384 @@
+/**
+ * state_decoder.c - Rebuilding the World from Delta Snapshots
+ *
+ * See state_decoder.h, and GameStateMsg in protocol.h for the format.
+ */
+
+#include "state_decoder.h"
+#include "wire.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Reader - Bounds-checked cursor over a message body
+ *
+ * Any read past the end sets 'ok' to 0 and returns zeros, so the
+ * decoder can check once at the end instead of after every field.
+ */
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+    int ok;
+} Reader;
+
+static void read_bytes(Reader* r, void* out, size_t size) {
+    if (r->end - r->p < (long)size) {
+        r->ok = 0;
+        memset(out, 0, size);
+        return;
+    }
+    memcpy(out, r->p, size);
+    r->p += size;
+}
+
+static uint8_t read_u8(Reader* r) {
+    uint8_t value;
+    read_bytes(r, &value, sizeof(value));
+    return value;
+}
+
+static uint16_t read_u16(Reader* r) {
+    uint16_t value;
+    read_bytes(r, &value, sizeof(value));
+    return value;
+}
+
+static float read_float(Reader* r) {
+    float value;
+    read_bytes(r, &value, sizeof(value));
+    return value;
+}
+
+/**
+ * state_decoder_init - One allocation for every frame and the reassembly
+ *
+ * The largest payload has every player and bullet slot removed AND
+ * added (different ids): a removal (at most 3 bytes) plus a full record
+ * per slot, in whichever encoding is bigger - the raw one.
+ */
+int state_decoder_init(StateDecoder* decoder, uint8_t version, int max_players, int max_bullets) {
+    memset(decoder, 0, sizeof(StateDecoder));
+    decoder->latest = NULL;
+    decoder->quantized = (version == PROTOCOL_VERSION);
+    decoder->max_players = max_players;
+    decoder->max_bullets = max_bullets;
+    decoder->assembly_next = -1;
+
+    size_t players_size = (size_t)max_players * sizeof(PlayerState);
+    size_t bullets_size = (size_t)max_bullets * sizeof(DecodedBullet);
+    size_t frame_size = (players_size + bullets_size + 7) & ~(size_t)7;
+    decoder->assembly_capacity = WIRE_STATE_HEADER_MAX +
+                                 max_players * (3 + 1 + (int)sizeof(PlayerState)) +
+                                 max_bullets * (3 + 1 + (int)sizeof(DecodedBullet));
+
+    uint8_t* memory = malloc((STATE_DECODER_HISTORY + 1) * frame_size +
+                             (size_t)decoder->assembly_capacity);
+    if (memory == NULL) return -1;
+    decoder->memory = memory;
+
+    // Bullets first: they hold a uint16_t, players are packed bytes
+    for (int i = 0; i <= STATE_DECODER_HISTORY; i++) {
+        DecodedState* frame = (i < STATE_DECODER_HISTORY) ? &decoder->frames[i]
+                                                          : &decoder->scratch;
+        frame->bullets = (DecodedBullet*)(memory + i * frame_size);
+        frame->players = (PlayerState*)(memory + i * frame_size + bullets_size);
+    }
+    decoder->assembly = memory + (STATE_DECODER_HISTORY + 1) * frame_size;
+    return 0;
+}
+
+/**
+ * state_decoder_free - Release the one allocation
+ */
+void state_decoder_free(StateDecoder* decoder) {
+    free(decoder->memory);
+    memset(decoder, 0, sizeof(StateDecoder));
+}
+
+/**
+ * find_player / find_bullet - Index of 'id', or where it would go
+ *
+ * Binary search: a big match has hundreds of players per snapshot.
+ */
+static int find_player(const DecodedState* state, uint16_t id) {
+    int lo = 0, hi = state->player_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (state->players[mid].player_id < id) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int find_bullet(const DecodedState* state, uint16_t id) {
+    int lo = 0, hi = state->bullet_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (state->bullets[mid].id < id) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * BodyReader - Input of one body in either encoding
+ */
+typedef struct {
+    int quantized;
+    Reader raw;
+    BitReader bits;
+    int prev_id;            // Quantized: last id of the current list
+} BodyReader;
+
+/**
+ * read_removal - One removed player or bullet id
+ */
+static uint16_t read_removal(BodyReader* br) {
+    if (br->quantized) {
+        uint16_t id = wire_read_id(&br->bits, br->prev_id);
+        br->prev_id = id;
+        return id;
+    }
+    return read_u16(&br->raw);
+}
+
+/**
+ * read_player / read_bullet - One record: id, mask and the masked fields
+ */
+static uint8_t read_player(BodyReader* br, PlayerState* fields) {
+    if (br->quantized) {
+        uint8_t mask = wire_read_player(&br->bits, br->prev_id, fields);
+        br->prev_id = fields->player_id;
+        return mask;
+    }
+
+    Reader* r = &br->raw;
+    fields->player_id = read_u16(r);
+    uint8_t mask = read_u8(r);
+    if (mask & PLAYER_FIELD_X)  fields->x = read_float(r);
+    if (mask & PLAYER_FIELD_Y)  fields->y = read_float(r);
+    if (mask & PLAYER_FIELD_VX) fields->vx = read_float(r);
+    if (mask & PLAYER_FIELD_VY) fields->vy = read_float(r);
+    if (mask & PLAYER_FIELD_HEALTH) fields->health = (int16_t)read_u16(r);
+    if (mask & PLAYER_FIELD_WEAPON) fields->weapon = read_u8(r);
+    if (mask & PLAYER_FIELD_FLAGS)  fields->flags = read_u8(r);
+    return mask;
+}
+
+static uint8_t read_bullet(BodyReader* br, uint16_t* id, BulletState* fields) {
+    if (br->quantized) {
+        uint8_t mask = wire_read_bullet(&br->bits, br->prev_id, id, fields);
+        br->prev_id = *id;
+        return mask;
+    }
+
+    Reader* r = &br->raw;
+    *id = read_u16(r);
+    uint8_t mask = read_u8(r);
+    if (mask & BULLET_FIELD_OWNER)  fields->owner_id = read_u16(r);
+    if (mask & BULLET_FIELD_X)      fields->x = read_float(r);
+    if (mask & BULLET_FIELD_Y)      fields->y = read_float(r);
+    if (mask & BULLET_FIELD_VX)     fields->vx = read_float(r);
+    if (mask & BULLET_FIELD_VY)     fields->vy = read_float(r);
+    if (mask & BULLET_FIELD_WEAPON) fields->weapon_type = read_u8(r);
+    return mask;
+}
+
+/**
+ * apply_player - Apply one player record
+ *
+ * @return 0 on success, -1 if the record doesn't fit our view
+ */
+static int apply_player(StateDecoder* decoder, DecodedState* state, BodyReader* br) {
+    PlayerState fields;
+    memset(&fields, 0, sizeof(fields));
+    uint8_t mask = read_player(br, &fields);
+    uint16_t id = fields.player_id;
+
+    int i = find_player(state, id);
+    int exists = (i < state->player_count && state->players[i].player_id == id);
+
+    if (mask & STATE_ENTITY_NEW) {
+        if (exists || state->player_count == decoder->max_players) return -1;
+        memmove(&state->players[i + 1], &state->players[i],
+                (state->player_count - i) * sizeof(PlayerState));
+        state->players[i] = fields;  // Every field is present
+        state->player_count++;
+        return 0;
+    }
+    if (!exists) return -1;  // Change to a player the baseline doesn't have
+
+    PlayerState* ps = &state->players[i];
+    if (mask & PLAYER_FIELD_X)  ps->x = fields.x;
+    if (mask & PLAYER_FIELD_Y)  ps->y = fields.y;
+    if (mask & PLAYER_FIELD_VX) ps->vx = fields.vx;
+    if (mask & PLAYER_FIELD_VY) ps->vy = fields.vy;
+    if (mask & PLAYER_FIELD_HEALTH) ps->health = fields.health;
+    if (mask & PLAYER_FIELD_WEAPON) ps->weapon = fields.weapon;
+    if (mask & PLAYER_FIELD_FLAGS)  ps->flags = fields.flags;
+    return 0;
+}
+
+/**
+ * apply_bullet - Apply one bullet record
+ */
+static int apply_bullet(StateDecoder* decoder, DecodedState* state, BodyReader* br) {
+    uint16_t id;
+    BulletState fields;
+    memset(&fields, 0, sizeof(fields));
+    uint8_t mask = read_bullet(br, &id, &fields);
+
+    int i = find_bullet(state, id);
+    int exists = (i < state->bullet_count && state->bullets[i].id == id);
+
+    if (mask & STATE_ENTITY_NEW) {
+        if (exists || state->bullet_count == decoder->max_bullets) return -1;
+        memmove(&state->bullets[i + 1], &state->bullets[i],
+                (state->bullet_count - i) * sizeof(DecodedBullet));
+        state->bullets[i].id = id;
+        state->bullets[i].state = fields;
+        state->bullet_count++;
+        return 0;
+    }
+    if (!exists) return -1;
+
+    BulletState* bs = &state->bullets[i].state;
+    if (mask & BULLET_FIELD_OWNER)  bs->owner_id = fields.owner_id;
+    if (mask & BULLET_FIELD_X)      bs->x = fields.x;
+    if (mask & BULLET_FIELD_Y)      bs->y = fields.y;
+    if (mask & BULLET_FIELD_VX)     bs->vx = fields.vx;
+    if (mask & BULLET_FIELD_VY)     bs->vy = fields.vy;
+    if (mask & BULLET_FIELD_WEAPON) bs->weapon_type = fields.weapon_type;
+    return 0;
+}
+
+/**
+ * state_decoder_apply - Baseline + delta = new snapshot
+ *
+ * The result is built in the scratch frame and only swapped into the
+ * ring once the whole message decoded cleanly, so a bad message can
+ * never corrupt a future baseline.
+ */
+const DecodedState* state_decoder_apply(StateDecoder* decoder,
+                                        const uint8_t* payload, int length) {
+    // Fixed fields: a packed struct, or bit-packed varints
+    GameStateMsg header;
+    int body_offset;
+    if (decoder->quantized) {
+        body_offset = wire_read_state_header(payload, length, &header);
+        if (body_offset < 0) return NULL;
+    } else {
+        if (length < (int)sizeof(GameStateMsg)) return NULL;
+        memcpy(&header, payload, sizeof(header));
+        body_offset = (int)sizeof(GameStateMsg);
+    }
+
+    // Older than what we have (only possible over UDP): nothing new
+    if (decoder->latest != NULL && (int32_t)(header.tick - decoder->latest->tick) <= 0) {
+        return NULL;
+    }
+
+    // Start from the baseline (or from nothing for a full snapshot)
+    DecodedState* next = &decoder->scratch;
+    next->player_count = 0;
+    next->bullet_count = 0;
+    if (header.baseline_tick != STATE_NO_BASELINE) {
+        const DecodedState* base = &decoder->frames[header.baseline_tick % STATE_DECODER_HISTORY];
+        if (!base->valid || base->tick != header.baseline_tick) return NULL;
+        memcpy(next->players, base->players, base->player_count * sizeof(PlayerState));
+        memcpy(next->bullets, base->bullets, base->bullet_count * sizeof(DecodedBullet));
+        next->player_count = base->player_count;
+        next->bullet_count = base->bullet_count;
+    }
+
+    BodyReader br = {
+        .quantized = decoder->quantized,
+        .raw = { payload + body_offset, payload + length, 1 },
+        .prev_id = -1
+    };
+    bits_reader_init(&br.bits, payload + body_offset, length - body_offset);
+
+    for (int n = 0; n < header.player_removals; n++) {
+        uint16_t id = read_removal(&br);
+        int i = find_player(next, id);
+        if (i < next->player_count && next->players[i].player_id == id) {
+            memmove(&next->players[i], &next->players[i + 1],
+                    (next->player_count - i - 1) * sizeof(PlayerState));
+            next->player_count--;
+        }
+    }
+
+    br.prev_id = -1;  // Each id list starts over
+    for (int n = 0; n < header.bullet_removals; n++) {
+        uint16_t id = read_removal(&br);
+        int i = find_bullet(next, id);
+        if (i < next->bullet_count && next->bullets[i].id == id) {
+            memmove(&next->bullets[i], &next->bullets[i + 1],
+                    (next->bullet_count - i - 1) * sizeof(DecodedBullet));
+            next->bullet_count--;
+        }
+    }
+
+    br.prev_id = -1;
+    for (int n = 0; n < header.player_updates; n++) {
+        if (apply_player(decoder, next, &br) != 0) return NULL;
+    }
+    br.prev_id = -1;
+    for (int n = 0; n < header.bullet_updates; n++) {
+        if (apply_bullet(decoder, next, &br) != 0) return NULL;
+    }
+    if (!br.raw.ok || br.bits.overflow) return NULL;
+
+    next->tick = header.tick;
+    next->valid = 1;
+
+    // Commit: the finished scratch frame takes the ring slot's place
+    DecodedState* slot = &decoder->frames[header.tick % STATE_DECODER_HISTORY];
+    DecodedState old = *slot;
+    *slot = *next;
+    *next = old;
+    next->valid = 0;
+
+    decoder->latest = slot;
+    decoder->your_sequence = header.your_sequence;
+    return slot;
+}
+
+/**
+ * state_decoder_apply_fragment - Append one piece, decode after the last
+ */
+const DecodedState* state_decoder_apply_fragment(StateDecoder* decoder,
+                                                 const uint8_t* payload, int length) {
+    StateFragmentMsg fragment;
+    if (length < (int)sizeof(fragment)) return NULL;
+    memcpy(&fragment, payload, sizeof(fragment));
+    const uint8_t* piece = payload + sizeof(fragment);
+    int piece_length = length - (int)sizeof(fragment);
+    if (fragment.index >= fragment.count) return NULL;
+
+    // Piece 0 starts a new payload; anything else must be the next one
+    if (fragment.index == 0) {
+        decoder->assembly_tick = fragment.tick;
+        decoder->assembly_length = 0;
+        decoder->assembly_next = 0;
+    }
+    if (fragment.tick != decoder->assembly_tick || fragment.index != decoder->assembly_next ||
+        piece_length > decoder->assembly_capacity - decoder->assembly_length) {
+        decoder->assembly_next = -1;  // A piece went missing: wait for the next piece 0
+        return NULL;
+    }
+
+    memcpy(decoder->assembly + decoder->assembly_length, piece, piece_length);
+    decoder->assembly_length += piece_length;
+    decoder->assembly_next++;
+    if (decoder->assembly_next < fragment.count) return NULL;
+
+    decoder->assembly_next = -1;
+    return state_decoder_apply(decoder, decoder->assembly, decoder->assembly_length);
+}
+
+/**
+ * state_decoder_ack - Newest tick we can decode deltas against
+ */
+uint32_t state_decoder_ack(const StateDecoder* decoder) {
+    return (decoder->latest != NULL) ? decoder->latest->tick : STATE_NO_BASELINE;
+}
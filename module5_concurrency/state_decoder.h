@@ -0,0 +1,135 @@
+/**
+ * state_decoder.h - Rebuilding the World from Delta Snapshots
+ *
+ * The client half of delta snapshots (see GameStateMsg in protocol.h).
+ *
+ * The server only sends what changed since a BASELINE - a snapshot we
+ * told it we have. To apply a delta we therefore need that exact
+ * baseline, so the decoder keeps the last STATE_DECODER_HISTORY
+ * reconstructed snapshots in a ring indexed by tick, just like the
+ * server's history:
+ *
+ *     delta for tick 103 vs baseline 100
+ *         frames[100 % 32]  ──copy──▶  frames[103 % 32]
+ *                                       - drop removed ids
+ *                                       - patch changed fields
+ *                                       - insert NEW entities
+ *
+ * Then state_decoder_ack() tells the server "I have 103", which it
+ * will use as the baseline from now on.
+ *
+ * Shared by the CLI client (module 4) and the game (module 5).
+ */
+
+#ifndef STATE_DECODER_H
+#define STATE_DECODER_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Reconstructed snapshots kept as baselines (matches the server's history)
+#define STATE_DECODER_HISTORY 32
+
+/**
+ * DecodedBullet - A bullet plus the id the server matches it by
+ */
+typedef struct {
+    uint16_t id;
+    BulletState state;
+} DecodedBullet;
+
+/**
+ * DecodedState - One complete, reconstructed snapshot (sorted by id)
+ */
+typedef struct {
+    uint32_t tick;
+    int valid;
+    PlayerState* players;           // max_players entries
+    int player_count;
+    DecodedBullet* bullets;         // max_bullets entries
+    int bullet_count;
+} DecodedState;
+
+/**
+ * StateDecoder - History of reconstructed snapshots
+ *
+ * Sized at runtime from the limits in MSG_CONNECT_ACK: every frame has
+ * room for max_players players and max_bullets bullets.
+ */
+typedef struct {
+    DecodedState frames[STATE_DECODER_HISTORY];
+    DecodedState scratch;           // Next snapshot while it is decoded
+    const DecodedState* latest;     // Newest applied snapshot (NULL = none)
+    uint32_t your_sequence;         // From the newest snapshot
+    int quantized;                  // Encoding: 1 = wire.h, 0 = raw structs
+    int max_players;
+    int max_bullets;
+
+    // MSG_STATE_FRAGMENT reassembly (see StateFragmentMsg)
+    uint8_t* assembly;              // Payload pieces received so far
+    int assembly_length;
+    int assembly_capacity;          // Largest possible payload
+    uint32_t assembly_tick;
+    int assembly_next;              // Piece expected next, -1 = none
+
+    void* memory;                   // The one allocation
+} StateDecoder;
+
+/**
+ * state_decoder_init - Start with no snapshots
+ *
+ * Call once the server's limits are known (after MSG_CONNECT_ACK).
+ *
+ * @param decoder      Decoder to initialize
+ * @param version      Protocol version sent in MSG_CONNECT (selects the encoding)
+ * @param max_players  ConnectAckMsg.max_players
+ * @param max_bullets  ConnectAckMsg.max_bullets
+ * @return             0 on success, -1 if out of memory
+ */
+int state_decoder_init(StateDecoder* decoder, uint8_t version, int max_players, int max_bullets);
+
+/**
+ * state_decoder_free - Release the decoder's memory
+ *
+ * @param decoder  Decoder to free
+ */
+void state_decoder_free(StateDecoder* decoder);
+
+/**
+ * state_decoder_apply - Decode one MSG_GAME_STATE payload
+ *
+ * @param decoder  The decoder
+ * @param payload  Message payload (state header + body)
+ * @param length   Payload length from the MessageHeader
+ * @return         The reconstructed snapshot, or NULL if the message is
+ *                 malformed, older than what we have, or its baseline
+ *                 is unknown (the server falls back to a full snapshot)
+ */
+const DecodedState* state_decoder_apply(StateDecoder* decoder,
+                                        const uint8_t* payload, int length);
+
+/**
+ * state_decoder_apply_fragment - Collect one MSG_STATE_FRAGMENT
+ *
+ * Pieces are appended in order; the last one completes the payload,
+ * which is then decoded like a MSG_GAME_STATE.
+ *
+ * @param decoder  The decoder
+ * @param payload  Message payload (StateFragmentMsg + piece)
+ * @param length   Payload length from the MessageHeader
+ * @return         The reconstructed snapshot once the last piece is in;
+ *                 NULL while pieces are missing or if one was lost
+ */
+const DecodedState* state_decoder_apply_fragment(StateDecoder* decoder,
+                                                 const uint8_t* payload, int length);
+
+/**
+ * state_decoder_ack - Tick to report in PlayerInputMsg.ack_tick
+ *
+ * @param decoder  The decoder
+ * @return         Newest applied tick, or STATE_NO_BASELINE
+ */
+uint32_t state_decoder_ack(const StateDecoder* decoder);
+
+#endif // STATE_DECODER_H
@@ -0,0 +1,430 @@
+/**
+ * wire.c - Bit-Packed, Quantized Message Encoding
+ *
+ * See wire.h for the schema and the bit stream format.
+ */
+
+#include "wire.h"
+
+#include <string.h>
+
+// The chosen bit widths must cover the ranges they encode
+_Static_assert((GAME_WIDTH + 2 * WIRE_POS_MARGIN) << WIRE_POS_FRACTION_BITS
+               <= (1 << WIRE_POS_X_BITS), "WIRE_POS_X_BITS too small");
+_Static_assert((GAME_HEIGHT + 2 * WIRE_POS_MARGIN) << WIRE_POS_FRACTION_BITS
+               <= (1 << WIRE_POS_Y_BITS), "WIRE_POS_Y_BITS too small");
+
+// ============================================================================
+// BIT STREAMS
+// ============================================================================
+
+/**
+ * bits_writer_init - Empty stream over 'data'
+ */
+void bits_writer_init(BitWriter* writer, uint8_t* data, int capacity) {
+    writer->data = data;
+    writer->capacity = capacity;
+    writer->length = 0;
+    writer->scratch = 0;
+    writer->scratch_bits = 0;
+    writer->overflow = 0;
+}
+
+/**
+ * bits_write - Add bits to the scratch word, flush whole bytes
+ */
+void bits_write(BitWriter* writer, uint32_t value, int count) {
+    uint64_t mask = ((uint64_t)1 << count) - 1;
+    writer->scratch |= ((uint64_t)value & mask) << writer->scratch_bits;
+    writer->scratch_bits += count;
+
+    while (writer->scratch_bits >= 8) {
+        if (writer->length == writer->capacity) {
+            writer->overflow = 1;
+        } else {
+            writer->data[writer->length++] = (uint8_t)writer->scratch;
+        }
+        writer->scratch >>= 8;
+        writer->scratch_bits -= 8;
+    }
+}
+
+/**
+ * bits_write_varint - Low 7 bits first, top bit = "more follows"
+ */
+void bits_write_varint(BitWriter* writer, uint32_t value) {
+    do {
+        uint32_t group = value & 0x7F;
+        value >>= 7;
+        bits_write(writer, group | (value != 0 ? 0x80 : 0), 8);
+    } while (value != 0);
+}
+
+/**
+ * bits_writer_finish - Flush the partial last byte
+ */
+int bits_writer_finish(BitWriter* writer) {
+    if (writer->scratch_bits > 0) {
+        bits_write(writer, 0, 8 - writer->scratch_bits);
+    }
+    return writer->overflow ? -1 : writer->length;
+}
+
+/**
+ * bits_reader_init - Stream over 'size' bytes of 'data'
+ */
+void bits_reader_init(BitReader* reader, const uint8_t* data, int size) {
+    reader->data = data;
+    reader->size = size;
+    reader->length = 0;
+    reader->scratch = 0;
+    reader->scratch_bits = 0;
+    reader->overflow = 0;
+}
+
+/**
+ * bits_read - Pull in bytes until 'count' bits are buffered
+ *
+ * Bytes are only loaded when needed, so fewer than 8 bits are ever left
+ * over - which is what makes bits_reader_align() a simple reset.
+ */
+uint32_t bits_read(BitReader* reader, int count) {
+    while (reader->scratch_bits < count) {
+        if (reader->length == reader->size) {
+            reader->overflow = 1;
+            return 0;
+        }
+        reader->scratch |= (uint64_t)reader->data[reader->length++] << reader->scratch_bits;
+        reader->scratch_bits += 8;
+    }
+
+    uint64_t mask = ((uint64_t)1 << count) - 1;
+    uint32_t value = (uint32_t)(reader->scratch & mask);
+    reader->scratch >>= count;
+    reader->scratch_bits -= count;
+    return value;
+}
+
+/**
+ * bits_read_varint - At most 5 groups (35 bits) make a uint32_t
+ */
+uint32_t bits_read_varint(BitReader* reader) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint32_t group = bits_read(reader, 8);
+        value |= (group & 0x7F) << shift;
+        if ((group & 0x80) == 0) return value;
+    }
+    reader->overflow = 1;
+    return 0;
+}
+
+/**
+ * bits_reader_align - Drop the padding bits of the current byte
+ */
+int bits_reader_align(BitReader* reader) {
+    reader->scratch = 0;
+    reader->scratch_bits = 0;
+    return reader->length;
+}
+
+// ============================================================================
+// QUANTIZATION
+// ============================================================================
+
+/**
+ * quantize_position - Fixed point: (v + margin) * 2^fraction_bits
+ */
+static uint32_t quantize_position(float value, int bits) {
+    float max = (float)((1u << bits) - 1);
+    float q = (value + WIRE_POS_MARGIN) * (1 << WIRE_POS_FRACTION_BITS);
+    if (q < 0.0f) q = 0.0f;
+    if (q > max) q = max;
+    return (uint32_t)(q + 0.5f);
+}
+
+static float dequantize_position(uint32_t q) {
+    return (float)q / (1 << WIRE_POS_FRACTION_BITS) - WIRE_POS_MARGIN;
+}
+
+/**
+ * quantize_velocity - Map ±limit onto ±(2^(bits-1) - 1), biased to unsigned
+ *
+ * Symmetric around zero so 0.0 encodes (and decodes) exactly.
+ */
+static uint32_t quantize_velocity(float value, float limit, int bits) {
+    int levels = (1 << (bits - 1)) - 1;
+    float q = value / limit * levels;
+    if (q < -levels) q = (float)-levels;
+    if (q > levels) q = (float)levels;
+    int rounded = (int)(q < 0.0f ? q - 0.5f : q + 0.5f);
+    return (uint32_t)(rounded + levels);
+}
+
+static float dequantize_velocity(uint32_t q, float limit, int bits) {
+    int levels = (1 << (bits - 1)) - 1;
+    return (float)((int)q - levels) * limit / levels;
+}
+
+static uint32_t quantize_health(int health) {
+    int max = (1 << WIRE_HEALTH_BITS) - 1;
+    if (health < 0) return 0;
+    return (uint32_t)(health > max ? max : health);
+}
+
+// ============================================================================
+// MESSAGES
+// ============================================================================
+
+/**
+ * wire_encode_input - Raw struct copy or bit-packed
+ */
+int wire_encode_input(const PlayerInputMsg* input, uint8_t version, uint8_t* out) {
+    if (version == PROTOCOL_VERSION_RAW) {
+        memcpy(out, input, sizeof(PlayerInputMsg));
+        return (int)sizeof(PlayerInputMsg);
+    }
+
+    BitWriter writer;
+    bits_writer_init(&writer, out, (int)WIRE_INPUT_MAX);
+    bits_write(&writer, input->input_flags, WIRE_INPUT_FLAGS_BITS);
+    bits_write(&writer, input->weapon_type, WIRE_WEAPON_BITS);
+    bits_write(&writer, 0, 1);
+    bits_write_varint(&writer, input->sequence);
+    bits_write_varint(&writer, input->ack_tick + 1);
+    return bits_writer_finish(&writer);
+}
+
+/**
+ * wire_decode_input - Inverse of wire_encode_input()
+ */
+int wire_decode_input(const uint8_t* payload, int length, uint8_t version,
+                      PlayerInputMsg* out) {
+    if (version == PROTOCOL_VERSION_RAW) {
+        if (length < (int)sizeof(PlayerInputMsg)) return -1;
+        memcpy(out, payload, sizeof(PlayerInputMsg));
+        return 0;
+    }
+
+    BitReader reader;
+    bits_reader_init(&reader, payload, length);
+    out->player_id = 0;
+    out->input_flags = (uint8_t)bits_read(&reader, WIRE_INPUT_FLAGS_BITS);
+    out->weapon_type = (uint8_t)bits_read(&reader, WIRE_WEAPON_BITS);
+    bits_read(&reader, 1);
+    out->sequence = bits_read_varint(&reader);
+    out->ack_tick = bits_read_varint(&reader) - 1;
+    return reader.overflow ? -1 : 0;
+}
+
+/**
+ * wire_write_state_header - Ticks as varints, baseline as a distance
+ */
+int wire_write_state_header(const GameStateMsg* state, uint8_t* out) {
+    BitWriter writer;
+    bits_writer_init(&writer, out, WIRE_STATE_HEADER_MAX);
+    bits_write_varint(&writer, state->tick);
+    bits_write_varint(&writer, (state->baseline_tick == STATE_NO_BASELINE)
+                               ? 0 : state->tick - state->baseline_tick);
+    bits_write_varint(&writer, state->your_sequence);
+    bits_write_varint(&writer, state->player_updates);
+    bits_write_varint(&writer, state->player_removals);
+    bits_write_varint(&writer, state->bullet_updates);
+    bits_write_varint(&writer, state->bullet_removals);
+    return bits_writer_finish(&writer);
+}
+
+/**
+ * wire_read_state_header - Inverse of wire_write_state_header()
+ */
+int wire_read_state_header(const uint8_t* payload, int length, GameStateMsg* out) {
+    BitReader reader;
+    bits_reader_init(&reader, payload, length);
+    out->tick = bits_read_varint(&reader);
+    uint32_t distance = bits_read_varint(&reader);
+    out->baseline_tick = (distance == 0) ? STATE_NO_BASELINE : out->tick - distance;
+    out->your_sequence = bits_read_varint(&reader);
+    out->player_updates = (uint16_t)bits_read_varint(&reader);
+    out->player_removals = (uint16_t)bits_read_varint(&reader);
+    out->bullet_updates = (uint16_t)bits_read_varint(&reader);
+    out->bullet_removals = (uint16_t)bits_read_varint(&reader);
+    if (reader.overflow) return -1;
+    return bits_reader_align(&reader);
+}
+
+/**
+ * wire_player_changes - Compare the values the client would see
+ */
+uint8_t wire_player_changes(const PlayerState* base, const PlayerState* now) {
+    uint8_t mask = 0;
+    if (quantize_position(base->x, WIRE_POS_X_BITS) != quantize_position(now->x, WIRE_POS_X_BITS)) {
+        mask |= PLAYER_FIELD_X;
+    }
+    if (quantize_position(base->y, WIRE_POS_Y_BITS) != quantize_position(now->y, WIRE_POS_Y_BITS)) {
+        mask |= PLAYER_FIELD_Y;
+    }
+    if (quantize_velocity(base->vx, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS) !=
+        quantize_velocity(now->vx, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS)) {
+        mask |= PLAYER_FIELD_VX;
+    }
+    if (quantize_velocity(base->vy, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS) !=
+        quantize_velocity(now->vy, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS)) {
+        mask |= PLAYER_FIELD_VY;
+    }
+    if (quantize_health(base->health) != quantize_health(now->health)) {
+        mask |= PLAYER_FIELD_HEALTH;
+    }
+    if (base->weapon != now->weapon) mask |= PLAYER_FIELD_WEAPON;
+    if (base->flags != now->flags)   mask |= PLAYER_FIELD_FLAGS;
+    return mask;
+}
+
+uint8_t wire_bullet_changes(const BulletState* base, const BulletState* now) {
+    uint8_t mask = 0;
+    if (base->owner_id != now->owner_id) mask |= BULLET_FIELD_OWNER;
+    if (quantize_position(base->x, WIRE_POS_X_BITS) != quantize_position(now->x, WIRE_POS_X_BITS)) {
+        mask |= BULLET_FIELD_X;
+    }
+    if (quantize_position(base->y, WIRE_POS_Y_BITS) != quantize_position(now->y, WIRE_POS_Y_BITS)) {
+        mask |= BULLET_FIELD_Y;
+    }
+    if (quantize_velocity(base->vx, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS) !=
+        quantize_velocity(now->vx, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS)) {
+        mask |= BULLET_FIELD_VX;
+    }
+    if (quantize_velocity(base->vy, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS) !=
+        quantize_velocity(now->vy, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS)) {
+        mask |= BULLET_FIELD_VY;
+    }
+    if (base->weapon_type != now->weapon_type) mask |= BULLET_FIELD_WEAPON;
+    return mask;
+}
+
+/**
+ * write_mask / read_mask - NEW bit, then the field bits unless NEW
+ */
+static void write_mask(BitWriter* writer, uint8_t mask, int field_bits) {
+    if (mask & STATE_ENTITY_NEW) {
+        bits_write(writer, 1, 1);
+    } else {
+        bits_write(writer, 0, 1);
+        bits_write(writer, mask, field_bits);
+    }
+}
+
+static uint8_t read_mask(BitReader* reader, int field_bits, uint8_t all_fields) {
+    if (bits_read(reader, 1)) return STATE_ENTITY_NEW | all_fields;
+    return (uint8_t)bits_read(reader, field_bits);
+}
+
+/**
+ * wire_write_player - One player record, fields in mask-bit order
+ */
+void wire_write_player(BitWriter* writer, const PlayerState* ps, int prev_id, uint8_t mask) {
+    wire_write_id(writer, ps->player_id, prev_id);
+    write_mask(writer, mask, 7);
+    if (mask & PLAYER_FIELD_X) {
+        bits_write(writer, quantize_position(ps->x, WIRE_POS_X_BITS), WIRE_POS_X_BITS);
+    }
+    if (mask & PLAYER_FIELD_Y) {
+        bits_write(writer, quantize_position(ps->y, WIRE_POS_Y_BITS), WIRE_POS_Y_BITS);
+    }
+    if (mask & PLAYER_FIELD_VX) {
+        bits_write(writer, quantize_velocity(ps->vx, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS),
+                   WIRE_PLAYER_VEL_BITS);
+    }
+    if (mask & PLAYER_FIELD_VY) {
+        bits_write(writer, quantize_velocity(ps->vy, PLAYER_SPEED, WIRE_PLAYER_VEL_BITS),
+                   WIRE_PLAYER_VEL_BITS);
+    }
+    if (mask & PLAYER_FIELD_HEALTH) bits_write(writer, quantize_health(ps->health), WIRE_HEALTH_BITS);
+    if (mask & PLAYER_FIELD_WEAPON) bits_write(writer, ps->weapon, WIRE_WEAPON_BITS);
+    if (mask & PLAYER_FIELD_FLAGS)  bits_write(writer, ps->flags, WIRE_FLAGS_BITS);
+}
+
+/**
+ * wire_read_player - Inverse of wire_write_player()
+ */
+uint8_t wire_read_player(BitReader* reader, int prev_id, PlayerState* out) {
+    out->player_id = wire_read_id(reader, prev_id);
+    uint8_t mask = read_mask(reader, 7, PLAYER_FIELDS_ALL);
+    if (mask & PLAYER_FIELD_X) {
+        out->x = dequantize_position(bits_read(reader, WIRE_POS_X_BITS));
+    }
+    if (mask & PLAYER_FIELD_Y) {
+        out->y = dequantize_position(bits_read(reader, WIRE_POS_Y_BITS));
+    }
+    if (mask & PLAYER_FIELD_VX) {
+        out->vx = dequantize_velocity(bits_read(reader, WIRE_PLAYER_VEL_BITS),
+                                      PLAYER_SPEED, WIRE_PLAYER_VEL_BITS);
+    }
+    if (mask & PLAYER_FIELD_VY) {
+        out->vy = dequantize_velocity(bits_read(reader, WIRE_PLAYER_VEL_BITS),
+                                      PLAYER_SPEED, WIRE_PLAYER_VEL_BITS);
+    }
+    if (mask & PLAYER_FIELD_HEALTH) out->health = (int16_t)bits_read(reader, WIRE_HEALTH_BITS);
+    if (mask & PLAYER_FIELD_WEAPON) out->weapon = (uint8_t)bits_read(reader, WIRE_WEAPON_BITS);
+    if (mask & PLAYER_FIELD_FLAGS)  out->flags = (uint8_t)bits_read(reader, WIRE_FLAGS_BITS);
+    return mask;
+}
+
+/**
+ * wire_write_id - Distance to the previous id, minus one
+ */
+void wire_write_id(BitWriter* writer, uint16_t id, int prev_id) {
+    bits_write_varint(writer, (uint32_t)(id - prev_id - 1));
+}
+
+uint16_t wire_read_id(BitReader* reader, int prev_id) {
+    return (uint16_t)(prev_id + 1 + (int)bits_read_varint(reader));
+}
+
+/**
+ * wire_write_bullet - One bullet record, fields in mask-bit order
+ */
+void wire_write_bullet(BitWriter* writer, uint16_t id, int prev_id,
+                       const BulletState* bs, uint8_t mask) {
+    wire_write_id(writer, id, prev_id);
+    write_mask(writer, mask, 6);
+    if (mask & BULLET_FIELD_OWNER) bits_write_varint(writer, bs->owner_id);
+    if (mask & BULLET_FIELD_X) {
+        bits_write(writer, quantize_position(bs->x, WIRE_POS_X_BITS), WIRE_POS_X_BITS);
+    }
+    if (mask & BULLET_FIELD_Y) {
+        bits_write(writer, quantize_position(bs->y, WIRE_POS_Y_BITS), WIRE_POS_Y_BITS);
+    }
+    if (mask & BULLET_FIELD_VX) {
+        bits_write(writer, quantize_velocity(bs->vx, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS),
+                   WIRE_BULLET_VEL_BITS);
+    }
+    if (mask & BULLET_FIELD_VY) {
+        bits_write(writer, quantize_velocity(bs->vy, WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS),
+                   WIRE_BULLET_VEL_BITS);
+    }
+    if (mask & BULLET_FIELD_WEAPON) bits_write(writer, bs->weapon_type, WIRE_WEAPON_BITS);
+}
+
+/**
+ * wire_read_bullet - Inverse of wire_write_bullet()
+ */
+uint8_t wire_read_bullet(BitReader* reader, int prev_id, uint16_t* id, BulletState* out) {
+    *id = wire_read_id(reader, prev_id);
+    uint8_t mask = read_mask(reader, 6, BULLET_FIELDS_ALL);
+    if (mask & BULLET_FIELD_OWNER) out->owner_id = (uint16_t)bits_read_varint(reader);
+    if (mask & BULLET_FIELD_X) {
+        out->x = dequantize_position(bits_read(reader, WIRE_POS_X_BITS));
+    }
+    if (mask & BULLET_FIELD_Y) {
+        out->y = dequantize_position(bits_read(reader, WIRE_POS_Y_BITS));
+    }
+    if (mask & BULLET_FIELD_VX) {
+        out->vx = dequantize_velocity(bits_read(reader, WIRE_BULLET_VEL_BITS),
+                                      WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS);
+    }
+    if (mask & BULLET_FIELD_VY) {
+        out->vy = dequantize_velocity(bits_read(reader, WIRE_BULLET_VEL_BITS),
+                                      WIRE_BULLET_SPEED_MAX, WIRE_BULLET_VEL_BITS);
+    }
+    if (mask & BULLET_FIELD_WEAPON) out->weapon_type = (uint8_t)bits_read(reader, WIRE_WEAPON_BITS);
+    return mask;
+}